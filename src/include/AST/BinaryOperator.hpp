@@ -31,9 +31,12 @@ class BinaryOperatorNode final : public ExpressionNode {
     const ExpressionNode &getRightOperand() const { return *m_right_operand.get(); }
     ExpressionNode* getL() { return m_left_operand.get(); }
     ExpressionNode* getR() { return m_right_operand.get(); }
+    ExpressionNode* releaseL() { return m_left_operand.release(); }
+    ExpressionNode* releaseR() { return m_right_operand.release(); }
 
     void accept(AstNodeVisitor &p_visitor) override { p_visitor.visit(*this); }
     void visitChildNodes(AstNodeVisitor &p_visitor) override;
+    void rewriteChildExpressions(ExpressionRewriter &p_rewriter) override;
 };
 
 #endif
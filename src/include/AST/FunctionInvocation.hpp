@@ -29,6 +29,7 @@ class FunctionInvocationNode final : public ExpressionNode {
 
     void accept(AstNodeVisitor &p_visitor) override { p_visitor.visit(*this); }
     void visitChildNodes(AstNodeVisitor &p_visitor) override;
+    void rewriteChildExpressions(ExpressionRewriter &p_rewriter) override;
 };
 
 #endif
@@ -26,9 +26,11 @@ class UnaryOperatorNode final : public ExpressionNode {
 
     const ExpressionNode &getOperand() const { return *m_operand.get(); }
     ExpressionNode *getVal() { return m_operand.get(); }
+    ExpressionNode *releaseVal() { return m_operand.release(); }
 
     void accept(AstNodeVisitor &p_visitor) override { p_visitor.visit(*this); }
     void visitChildNodes(AstNodeVisitor &p_visitor) override;
+    void rewriteChildExpressions(ExpressionRewriter &p_rewriter) override;
 };
 
 #endif
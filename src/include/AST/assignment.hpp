@@ -24,6 +24,7 @@ class AssignmentNode final : public AstNode {
 
     void accept(AstNodeVisitor &p_visitor) override { p_visitor.visit(*this); }
     void visitChildNodes(AstNodeVisitor &p_visitor) override;
+    void rewriteChildExpressions(ExpressionRewriter &p_rewriter) override;
 };
 
 #endif
@@ -4,6 +4,7 @@
 #include <cstdint>
 
 class AstNodeVisitor;
+class ExpressionRewriter;
 
 struct Location {
     uint32_t line;
@@ -30,6 +31,8 @@ class AstNode {
 
     virtual void accept(AstNodeVisitor &p_visitor) = 0;
     virtual void visitChildNodes(AstNodeVisitor &p_visitor){};
+    // offers every expression this node owns directly for replacement
+    virtual void rewriteChildExpressions(ExpressionRewriter &p_rewriter){};
 };
 
 #endif
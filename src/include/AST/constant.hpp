@@ -36,6 +36,11 @@ class Constant {
     const char *getConstantValueCString() const;
 
     decltype(m_value.integer) integer() const { return m_value.integer; }
+    decltype(m_value.real) real() const { return m_value.real; }
+    decltype(m_value.boolean) boolean() const { return m_value.boolean; }
+    // what an integer or boolean constant is as a machine word, a boolean
+    // being 0 or 1
+    int32_t word() const;
 };
 
 #endif
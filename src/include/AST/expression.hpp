@@ -20,4 +20,13 @@ class ExpressionNode : public AstNode {
     void setInferredType(PType *p_type) { m_type.reset(p_type); }
 };
 
+// AST nodes can't be copied or moved, so a pass that wants to replace an
+// expression gets the owning pointer from the parent and resets it.
+class ExpressionRewriter {
+  public:
+    virtual ~ExpressionRewriter() = default;
+
+    virtual void rewrite(std::unique_ptr<ExpressionNode> &p_expr) = 0;
+};
+
 #endif
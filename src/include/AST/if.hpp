@@ -25,6 +25,7 @@ class IfNode final : public AstNode {
 
     void accept(AstNodeVisitor &p_visitor) override { p_visitor.visit(*this); }
     void visitChildNodes(AstNodeVisitor &p_visitor) override;
+    void rewriteChildExpressions(ExpressionRewriter &p_rewriter) override;
 
     ExpressionNode* getCond() { return m_condition.get(); }
     CompoundStatementNode* getBody() { return m_body.get(); }
@@ -22,6 +22,7 @@ class ReturnNode final : public AstNode {
     ExpressionNode*getRetVal() {return m_ret_val.get(); }
     void accept(AstNodeVisitor &p_visitor) override { p_visitor.visit(*this); }
     void visitChildNodes(AstNodeVisitor &p_visitor) override;
+    void rewriteChildExpressions(ExpressionRewriter &p_rewriter) override;
 };
 
 #endif
@@ -0,0 +1,72 @@
+#ifndef CODEGEN_CODE_GEN_OPTIONS_H
+#define CODEGEN_CODE_GEN_OPTIONS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class RegAllocKind : uint8_t {
+    kStackMachine, // push/pop every intermediate value (--regalloc=stack)
+    kSethiUllman,  // expression trees in a small register pool, ordered by
+                   // register need (--regalloc=sethi-ullman)
+    kLinearScan    // code selected from the IR into virtual registers +
+                   // linear scan (default)
+};
+
+struct CodeGenOptions {
+    RegAllocKind regalloc = RegAllocKind::kLinearScan;
+    // instructions a peephole rule may look at, 0 turns the pass off
+    size_t peephole_window = 6;
+    // report what the optimizations did on stderr
+    bool print_stats = false;
+    // functions of at most this many instructions are inlined, as are the
+    // ones called from a single place (--inline-threshold=N), 0 for none
+    size_t inline_threshold = 16;
+    // report every inlining decision on stderr (--opt-remarks)
+    bool opt_remarks = false;
+    // propagate constants along the branches that can be taken and drop
+    // the code that cannot run (--no-sccp turns it off)
+    bool propagate_constants = true;
+    // turn tail recursion into loops and leave the frame before other tail
+    // calls (--no-tail-calls turns it off)
+    bool eliminate_tail_calls = true;
+    // replace computations done before by their value (--no-gvn turns it
+    // off)
+    bool number_values = true;
+    // move loop-invariant computations out of loops (--no-licm turns it off)
+    bool hoist_invariants = true;
+    // drop unused computations, stores nothing reads, statements after a
+    // return and the functions main never calls (--no-dce turns it off)
+    bool eliminate_dead_code = true;
+    // copies of the body in an unrolled for loop (--unroll=N), 1 for none
+    uint32_t unroll_factor = 1;
+    // for loops running at most this often are unrolled completely
+    // (--full-unroll=N), 0 for none
+    uint32_t max_full_unroll = 16;
+    // strip-mine the for loops over arrays into instructions of the V
+    // extension (-march=rv32gcv; -march=rv32gc leaves them scalar)
+    bool vectorize_loops = false;
+    // reorder the instructions of each block for the pipeline of the
+    // MachineModel called tune (-mtune=NAME, --no-schedule turns it off)
+    bool schedule_instrs = true;
+    std::string tune = "generic";
+    // emit the 16-bit encodings of the C extension where they fit and
+    // prefer x8 ~ x15 when allocating registers (--rvc)
+    bool compress_instrs = false;
+    // count how often each block runs and each branch is taken; the
+    // program adds its counts to this file at exit (--profile-generate,
+    // next to the source by default, or --profile-generate=FILE)
+    std::string profile_generate;
+    // inline and lay out the blocks by the counts in this file
+    // (--profile-use=FILE)
+    std::string profile_use;
+    // what is written to the save path: the assembly listing (.S) and the
+    // object the assembler would make of it (.o), for linking with io.c
+    // straight away (--emit=asm, --emit=obj or both, --emit=asm,obj)
+    bool emit_assembly = true;
+    bool emit_object = false;
+    // print the IR on stdout before selecting instructions (--dump-ir)
+    bool dump_ir = false;
+};
+
+#endif
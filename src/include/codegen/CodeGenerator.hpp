@@ -1,13 +1,28 @@
 #ifndef CODEGEN_CODE_GENERATOR_H
 #define CODEGEN_CODE_GENERATOR_H
 
+#include "codegen/CodeGenOptions.hpp"
+#include "codegen/ELFWriter.hpp"
+#include "codegen/InstructionScheduler.hpp"
+#include "codegen/MachineFunction.hpp"
+#include "codegen/PeepholeOptimizer.hpp"
+#include "codegen/RVCCompressor.hpp"
+#include "codegen/RegisterNeed.hpp"
 #include "sema/SymbolTable.hpp"
 #include "visitor/AstNodeVisitor.hpp"
 
 #include <memory>
 #include <cstdarg>
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+class ExpressionNode;
 
 static void dumpInstructions(FILE *p_out_file, const char *format, ...) {
+    if (!p_out_file) {
+        return; // --emit=obj without the listing
+    }
     va_list args;
     va_start(args, format);
     vfprintf(p_out_file, format, args);
@@ -16,15 +31,63 @@ static void dumpInstructions(FILE *p_out_file, const char *format, ...) {
 
 class CodeGenerator final : public AstNodeVisitor {
   private:
+    struct FileCloser {
+        void operator()(FILE *p_file) const { fclose(p_file); }
+    };
+
     const SymbolManager *m_symbol_manager_ptr;
     std::string m_source_file_path;
-    std::unique_ptr<FILE> m_output_file;
+    // the listing, nullptr without --emit=asm
+    std::unique_ptr<FILE, FileCloser> m_output_file;
+    // --emit=obj: the object and where it goes
+    std::unique_ptr<ELFWriter> m_object;
+    std::string m_object_path;
+    CodeGenOptions m_options;
+    PeepholeOptimizer m_peephole;
+    InstructionScheduler m_scheduler;
+    RVCCompressor m_compressor;
+
+    // the function whose body is being generated
+    std::unique_ptr<MachineFunction> m_function;
+    // the finished ones, written out once it is known which are called
+    std::vector<std::unique_ptr<MachineFunction>> m_functions;
+    // register holding the value of the last visited expression
+    int m_value = kNoReg;
+    // label in front of the epilogue, where return statements jump to
+    int m_return_label = 0;
+
+    // Sethi-Ullman mode: which pool registers hold a value, the ones pushed
+    // around the current call and the spill slots free for reuse
+    RegisterNeedLabeler m_need_labeler;
+    std::vector<bool> m_pool_in_use;
+    std::vector<int> m_saved_pool_regs;
+    std::vector<int> m_free_spill_slots;
+
+    size_t m_num_strength_reduced = 0;
+    size_t m_num_vectorized = 0;
+    size_t m_num_promoted = 0;
+    size_t m_num_inlined = 0;
+    size_t m_num_constants = 0;
+    size_t m_num_branches_folded = 0;
+    size_t m_num_blocks_removed = 0;
+    size_t m_num_redundant = 0;
+    size_t m_num_hoisted = 0;
+    size_t m_num_dead = 0;
+    size_t m_num_dead_functions = 0;
+    size_t m_num_recursions_removed = 0;
+    size_t m_num_tail_calls = 0;
+    size_t m_num_blocks_moved = 0;
+    size_t m_num_cold_blocks = 0;
+    // --profile-generate: what the writer gets to know about the counters
+    size_t m_num_counters = 0;
+    uint32_t m_profile_checksum = 0;
 
   public:
     ~CodeGenerator() = default;
     CodeGenerator(const std::string source_file_name,
                   const std::string save_path,
-                  const SymbolManager *const p_symbol_manager);
+                  const SymbolManager *const p_symbol_manager,
+                  const CodeGenOptions &p_options = CodeGenOptions());
 
     void visit(ProgramNode &p_program) override;
     void visit(DeclNode &p_decl) override;
@@ -45,20 +108,74 @@ class CodeGenerator final : public AstNodeVisitor {
     void visit(ReturnNode &p_return) override;
     void initLocal(const SymbolTable *table);
     void pushVarAddr(const VariableReferenceNode &var);
-    void pushVar(SymbolEntry& symbol, int size);
     void pushReg(const char* reg);
     void pop2Reg(const char* reg);
+    // push/pop the pool registers that live across a call
     void saveRegs();
     void loadRegs();
     void dumpLabel(int id);
     void dumpGoto(int id);
-    void dumpInstrs(const char* format, ...) {
-        va_list args;
-        va_start(args, format);
-        vfprintf(m_output_file.get(), format, args);
-        va_end(args);
+    // appends the assembly text to the current function
+    void dumpInstrs(const char* format, ...);
+
+  private:
+    bool useStackMachine() const {
+        return m_options.regalloc == RegAllocKind::kStackMachine;
+    }
+    bool useSethiUllman() const {
+        return m_options.regalloc == RegAllocKind::kSethiUllman;
     }
+    // the linear scan allocator works on code selected from the IR, the
+    // other modes generate straight from the AST
+    bool useIR() const {
+        return m_options.regalloc == RegAllocKind::kLinearScan;
+    }
+
+    // builds the IR of every function, optimizes it and selects the code
+    void generateFromIR(ProgramNode &p_program);
+    void dumpFunctionHeader(const std::string &p_name);
+
+    void beginFunction(const std::string &p_name, const bool p_returns_value);
+    // assigns the slots of the locals declared anywhere in p_scope
+    void layoutFrame(AstNode &p_scope);
+    void endFunction();
+    // a zeroed global of p_size bytes: .comm in the listing, .bss in the
+    // object
+    void emitCommon(const std::string &p_name, const size_t p_size);
+    // writes out main and the functions it may end up calling
+    void emitFunctions();
+    // the counters of --profile-generate and the function .fini_array runs
+    // at exit to write them out with __p_profile_write (runtime/profile.c)
+    void emitProfileWriter();
 
+    void emit(const char *p_opcode,
+              std::initializer_list<MachineOperand> p_operands);
+    int evaluate(ExpressionNode &p_expr);
+    // Jumps to label p_label if p_cond evaluates to p_jump_if and falls
+    // through otherwise. A relational condition becomes one compare-and-branch
+    // instead of a boolean tested against zero; and, or and not become jumps,
+    // so the right operand of and/or only runs if it decides the result.
+    void branchOnCondition(ExpressionNode &p_cond, const bool p_jump_if,
+                           const int p_label);
+    // the 0/1 value of an and/or, computed with branchOnCondition()
+    void materializeCondition(ExpressionNode &p_cond);
+    // Multiplies, divides or takes the modulo by an integer constant with
+    // shifts, adds and mulh where that beats mul, div and rem. Returns false
+    // without emitting anything if it does not.
+    bool reduceStrength(BinaryOperatorNode &p_bin_op);
+    // evaluates both operands, the one needing more registers first
+    void evaluateOperands(ExpressionNode &p_lhs, ExpressionNode &p_rhs,
+                          int &p_lhs_value, int &p_rhs_value);
+    // a register for a new value: virtual, or taken from the pool
+    int newValue();
+    // gives a pool register back once its value is consumed
+    void releaseValue(const int p_value);
+    int getNumFreeRegs() const;
+    int spillValue(const int p_value);
+    int reloadValue(const int p_slot);
+    // loads the value of a scalar variable into a new register
+    int loadVar(const SymbolEntry &p_entry);
+    void storeVar(const SymbolEntry &p_entry, const int p_value);
 };
 
 #endif
@@ -0,0 +1,90 @@
+#ifndef CODEGEN_ELF_WRITER_H
+#define CODEGEN_ELF_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// The relocations the code and data refer to other symbols with
+namespace reloc {
+constexpr uint32_t kAbs32 = 1;   // R_RISCV_32, a word holding the address
+constexpr uint32_t kBranch = 16; // R_RISCV_BRANCH, the 13-bit B-type offset
+constexpr uint32_t kJal = 17;    // R_RISCV_JAL, the 21-bit J-type offset
+constexpr uint32_t kCall = 18;   // R_RISCV_CALL, an auipc + jalr pair
+constexpr uint32_t kHi20 = 26;   // R_RISCV_HI20, lui of an address
+constexpr uint32_t kLo12I = 27;  // R_RISCV_LO12_I, addi or a load after it
+constexpr uint32_t kLo12S = 28;  // R_RISCV_LO12_S, a store after it
+} // namespace reloc
+
+// Builds a relocatable ELF32 object for RV32 in memory and writes it out,
+// what the assembler makes of the listing otherwise. There are the
+// sections .text, .rodata, .bss and .fini_array; their contents are
+// appended through getBytes(), symbols are defined at offsets into them,
+// and every symbol referred to without a definition is left for the
+// linker. The flags say RVC and the double-float ABI, as for the objects
+// of the rv32gc/ilp32d toolchain the output is linked with.
+class ELFWriter {
+  public:
+    enum class SectionKind : uint8_t { kText, kRodata, kBss, kFiniArray };
+    enum class SymbolKind : uint8_t { kFunction, kObject };
+
+    struct Relocation {
+        uint32_t offset;
+        uint32_t type;
+        std::string symbol;
+        int32_t addend;
+    };
+
+  private:
+    struct Section {
+        std::vector<uint8_t> bytes;
+        size_t size = 0; // what .bss takes, which has no bytes
+        std::vector<Relocation> relocations;
+    };
+    struct Symbol {
+        std::string name;
+        SectionKind section;
+        uint32_t value;
+        uint32_t size;
+        SymbolKind kind;
+        bool is_global;
+    };
+
+    std::string m_source_name;
+    Section m_sections[4];
+    std::vector<Symbol> m_symbols;
+    std::map<std::string, size_t> m_symbol_index;
+
+  public:
+    ~ELFWriter() = default;
+    explicit ELFWriter(const std::string &p_source_name)
+        : m_source_name(p_source_name) {}
+
+    std::vector<uint8_t> &getBytes(const SectionKind p_section) {
+        return m_sections[static_cast<size_t>(p_section)].bytes;
+    }
+    size_t getSize(const SectionKind p_section) const;
+    // pads the section to a multiple of p_align, with p_fill if it has
+    // bytes (repeated, the least significant byte first)
+    void align(const SectionKind p_section, const uint32_t p_align,
+               const uint32_t p_fill = 0, const uint32_t p_fill_size = 1);
+    // makes room in .bss
+    void reserve(const size_t p_size) {
+        m_sections[static_cast<size_t>(SectionKind::kBss)].size += p_size;
+    }
+
+    void addRelocation(const SectionKind p_section,
+                       const Relocation &p_relocation);
+    void defineSymbol(const std::string &p_name, const SectionKind p_section,
+                      const uint32_t p_value, const uint32_t p_size,
+                      const SymbolKind p_kind, const bool p_is_global);
+
+    size_t getNumRelocations() const;
+
+    // Returns false if p_path cannot be written.
+    bool write(const std::string &p_path) const;
+};
+
+#endif
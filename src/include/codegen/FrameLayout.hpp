@@ -0,0 +1,37 @@
+#ifndef CODEGEN_FRAME_LAYOUT_H
+#define CODEGEN_FRAME_LAYOUT_H
+
+#include "visitor/AstNodeVisitor.hpp"
+
+class PType;
+class SymbolTable;
+
+// Assigns SymbolEntry::stkLoc of every local of a function, nested compound
+// statements and for loops included. Scopes that are never live at the same
+// time (siblings) share their slots, so the frame only grows to the deepest
+// chain of nested scopes.
+class FrameLayout final : public AstNodeVisitor {
+  private:
+    // s0-relative offsets: where the next slot ends, and the lowest one used
+    int m_offset;
+    int m_lowest;
+
+  public:
+    ~FrameLayout() = default;
+    FrameLayout(const int p_top) : m_offset(p_top), m_lowest(p_top) {}
+
+    int getLowestOffset() const { return m_lowest; }
+
+    static int getSlotSize(const PType &p_type);
+
+    void visit(FunctionNode &p_function) override;
+    void visit(CompoundStatementNode &p_compound_statement) override;
+    void visit(IfNode &p_if) override;
+    void visit(WhileNode &p_while) override;
+    void visit(ForNode &p_for) override;
+
+  private:
+    void layoutScope(const SymbolTable *p_table);
+};
+
+#endif
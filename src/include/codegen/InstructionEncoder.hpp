@@ -0,0 +1,51 @@
+#ifndef CODEGEN_INSTRUCTION_ENCODER_H
+#define CODEGEN_INSTRUCTION_ENCODER_H
+
+#include "codegen/ELFWriter.hpp"
+#include "codegen/MachineFunction.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Assembles finished functions into the .text of an ELFWriter: the
+// instructions of RV32IM, the C extension and the part of V the vectorizer
+// uses, each looked up in a table of formats and fixed bits, and the
+// pseudo-instructions the code generator writes (li, la, mv, call, tail,
+// j, beqz...) expanded as the assembler would.
+//
+// Branches to the labels of the function are resolved here. One that does
+// not reach its label is widened, c.beqz to beq and a branch to the
+// inverted branch over a jal, until all of them reach. The other symbols
+// are left to the linker: calls and la get R_RISCV_CALL and
+// R_RISCV_HI20/LO12_I, jal R_RISCV_JAL and a branch R_RISCV_BRANCH.
+class InstructionEncoder {
+  private:
+    struct Layout {
+        std::vector<int64_t> addresses; // by instruction
+        std::vector<uint8_t> levels;    // of the branches and jumps
+        std::map<std::string, int64_t> labels;
+    };
+
+    ELFWriter &m_writer;
+
+  public:
+    ~InstructionEncoder() = default;
+    explicit InstructionEncoder(ELFWriter &p_writer) : m_writer(p_writer) {}
+
+    // appends p_function and defines its name at its first instruction
+    void encode(const MachineFunction &p_function, const bool p_is_global);
+
+  private:
+    void layOut(const MachineFunction &p_function, Layout &p_layout) const;
+    // Appends the code of p_instr to p_code; p_level says how far a branch
+    // has been widened. Relocations get offsets into p_code.
+    void encodeInstr(const MachineInstr &p_instr, const int64_t p_address,
+                     const uint8_t p_level, const Layout &p_layout,
+                     std::vector<uint8_t> &p_code,
+                     std::vector<ELFWriter::Relocation> &p_relocations) const;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef CODEGEN_INSTRUCTION_SCHEDULER_H
+#define CODEGEN_INSTRUCTION_SCHEDULER_H
+
+#include "codegen/MachineFunction.hpp"
+#include "codegen/MachineModel.hpp"
+
+#include <cstddef>
+#include <cstdio>
+
+// List scheduling of a finished function (registers allocated, prologue and
+// epilogue in place) for the pipeline of a MachineModel. Each run of
+// instructions between labels, calls, terminators and vector instructions
+// is reordered along the dependences through registers and memory, issuing
+// a ready instruction on the longest latency path first, so that a load or
+// a mul no longer sits right in front of its use when something else can
+// go in between.
+//
+// Memory accesses only pass each other when they use the same base
+// register, not written in between, and do not overlap.
+class InstructionScheduler {
+  public:
+    using Instrs = MachineFunction::Instrs;
+
+  private:
+    const MachineModel &m_model;
+    // whether to reorder at all, the estimates are kept either way
+    bool m_enabled;
+
+    size_t m_num_moved = 0;
+    size_t m_cycles_before = 0;
+    size_t m_cycles_after = 0;
+
+  public:
+    ~InstructionScheduler() = default;
+    InstructionScheduler(const MachineModel &p_model, const bool p_enabled)
+        : m_model(p_model), m_enabled(p_enabled) {}
+
+    void run(MachineFunction &p_function);
+
+    // Static estimate of the cycles p_instrs take on the pipeline when
+    // every instruction runs once: each issues a cycle after the previous
+    // one, or once its operands are ready if that is later.
+    size_t estimateCycles(const Instrs &p_instrs) const;
+
+    void printStats(FILE *p_out_file) const;
+
+  private:
+    // reorders the instructions [p_begin, p_end), none of them a barrier
+    void scheduleRegion(Instrs &p_instrs, size_t p_begin, size_t p_end);
+};
+
+#endif
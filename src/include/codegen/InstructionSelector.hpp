@@ -0,0 +1,114 @@
+#ifndef CODEGEN_INSTRUCTION_SELECTOR_H
+#define CODEGEN_INSTRUCTION_SELECTOR_H
+
+#include "codegen/MachineFunction.hpp"
+#include "ir/IR.hpp"
+
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Translates an IR function into RISC-V instructions on virtual registers,
+// one per value, for LinearScanRegisterAllocator to assign. Along the way
+// it folds constants into immediates (x0 for a zero), a compare into the
+// branch that is its only use, and multiplication and division by a
+// constant into cheaper sequences.
+//
+// Vectors never leave their block, so they get their registers right
+// there: the register groups of the LMUL the last vsetvl chose, v0 left
+// for masks, each free again once its last use is selected.
+//
+// Phis leave SSA through copies right before the terminator of each
+// predecessor. Where nothing after those copies can still need the old
+// values, as when the predecessors just jump to the phis' block, they copy
+// into the registers of the phis directly. Otherwise each phi gets an
+// extra register that the predecessors copy into and the block of the phi
+// copies on from: a branching predecessor then writes nothing another path
+// could read, so no edge needs to be split, and a phi reading another phi
+// of the same block still sees the old value.
+class InstructionSelector {
+  private:
+    const ir::Function &m_ir_function;
+    MachineFunction &m_function;
+    const int m_return_label;
+    int &m_next_label;
+
+    // by value id
+    std::vector<int> m_vregs;
+    std::vector<int> m_phi_temps; // kNoReg where copied into directly
+    std::vector<int> m_num_uses;
+    std::vector<std::vector<const ir::Instruction *>> m_users;
+    std::vector<bool> m_fused;     // compares emitted as part of a branch
+    std::vector<bool> m_needs_reg; // constants used as more than immediates
+    // by block id
+    std::vector<std::string> m_labels;
+    // the (source, destination) registers of the phi copies just emitted
+    std::vector<std::pair<int, int>> m_copies;
+    // by slot id, for the arrays mem2reg leaves in the frame
+    std::vector<int> m_slot_offsets;
+    // by value id, the uses of a vector still to be selected
+    std::vector<int> m_vector_uses_left;
+    std::vector<int> m_free_vector_regs;
+    int m_lmul = 1;
+
+    size_t m_num_strength_reduced = 0;
+
+  public:
+    ~InstructionSelector() = default;
+    // p_return_label is the label of the epilogue; new labels are numbered
+    // from p_next_label on, which is advanced past them
+    InstructionSelector(const ir::Function &p_ir_function,
+                        MachineFunction &p_function, const int p_return_label,
+                        int &p_next_label)
+        : m_ir_function(p_ir_function), m_function(p_function),
+          m_return_label(p_return_label), m_next_label(p_next_label) {}
+
+    void run();
+
+    // how many arguments a call can pass, all in registers
+    static size_t getNumArgRegs();
+
+    size_t getNumStrengthReduced() const { return m_num_strength_reduced; }
+
+  private:
+    void analyze();
+    // whether the phis of p_block need the extra registers
+    bool needsPhiTemps(const ir::BasicBlock &p_block) const;
+    // whether the value p_phi receives from p_pred can be computed right
+    // into the register of p_phi, saving the copy
+    bool canComputeIntoPhi(const ir::Instruction &p_phi,
+                           const ir::BasicBlock &p_pred) const;
+    // whether operand p_nth of p_user is a constant it encodes itself
+    bool isImmediateOperand(const ir::Instruction &p_user,
+                            const size_t p_nth) const;
+    // the register holding p_value, x0 for the constant 0
+    int getReg(const ir::Instruction *p_value) const;
+    // p_dst = p_value, with li for a constant
+    void emitCopy(const int p_dst, const ir::Instruction *p_value);
+
+    void select(const ir::Instruction &p_instr, const ir::BasicBlock *p_next);
+    void selectBinary(const ir::Instruction &p_instr);
+    bool selectStrengthReduced(const ir::Instruction &p_instr);
+    void selectCompare(const ir::Instruction &p_instr);
+    void selectCall(const ir::Instruction &p_instr);
+    // the word at operand p_nth of p_instr plus its offset
+    MachineOperand selectAddress(const ir::Instruction &p_instr,
+                                 const size_t p_nth);
+    // adds operand 0 to the profile counter
+    void selectCount(const ir::Instruction &p_instr);
+    void selectVector(const ir::Instruction &p_instr);
+    int allocateVectorReg();
+    // frees the vectors p_instr is the last use of
+    void releaseVectorOperands(const ir::Instruction &p_instr);
+    void selectBranch(const ir::Instruction &p_instr,
+                      const ir::BasicBlock *p_next);
+    void emitPhiCopies(const ir::BasicBlock &p_block);
+
+    void emit(const char *p_opcode,
+              std::initializer_list<MachineOperand> p_operands);
+    void emitJump(const ir::BasicBlock *p_target);
+};
+
+#endif
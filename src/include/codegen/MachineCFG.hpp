@@ -0,0 +1,33 @@
+#ifndef CODEGEN_MACHINE_CFG_H
+#define CODEGEN_MACHINE_CFG_H
+
+#include "codegen/MachineFunction.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// A basic block of a MachineFunction: the instructions [begin, end).
+struct MachineBasicBlock {
+    size_t begin;
+    size_t end;
+    std::vector<size_t> succs;
+    std::vector<size_t> preds;
+};
+
+// Splits the body at labels and after terminators. Jumps to labels outside
+// the body leave the function, so they add no edge; the last block falls
+// off the end of the body into the epilogue.
+std::vector<MachineBasicBlock>
+splitBasicBlocks(const MachineFunction::Instrs &p_instrs);
+
+// dominators[b][d]: whether block d dominates block b. The entry is the
+// first block; blocks it cannot reach are dominated by everything.
+std::vector<std::vector<bool>>
+computeDominators(const std::vector<MachineBasicBlock> &p_blocks);
+
+// The same with the edges reversed, relative to the last block. Blocks that
+// cannot reach the last one are post-dominated by everything.
+std::vector<std::vector<bool>>
+computePostDominators(const std::vector<MachineBasicBlock> &p_blocks);
+
+#endif
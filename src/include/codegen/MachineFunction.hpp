@@ -0,0 +1,73 @@
+#ifndef CODEGEN_MACHINE_FUNCTION_H
+#define CODEGEN_MACHINE_FUNCTION_H
+
+#include "codegen/MachineInstr.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Instructions of one function (the program body is the function "main")
+// together with its frame layout. Offsets in the frame are relative to the
+// caller's sp, which s0 points at when the function keeps a frame pointer.
+// The slots of ra, s0 and the callee-saved registers are allocated last, at
+// the bottom of the frame, and only for the registers that need them.
+class MachineFunction {
+  public:
+    using Instrs = std::vector<MachineInstr>;
+
+  private:
+    std::string m_name;
+    Instrs m_instrs;
+
+    int m_next_vreg = kFirstVirtualReg;
+    bool m_returns_value = false;
+
+    int m_frame_bottom = 0;
+    std::vector<int> m_saved_regs;
+
+  public:
+    ~MachineFunction() = default;
+    MachineFunction(const std::string &p_name, const bool p_returns_value)
+        : m_name(p_name), m_returns_value(p_returns_value) {}
+
+    const std::string &getName() const { return m_name; }
+    bool returnsValue() const { return m_returns_value; }
+
+    Instrs &getInstrs() { return m_instrs; }
+    const Instrs &getInstrs() const { return m_instrs; }
+    void append(const MachineInstr &p_instr) { m_instrs.push_back(p_instr); }
+
+    int createVirtualReg() { return m_next_vreg++; }
+    int getNumRegs() const { return m_next_vreg; }
+
+    // returns the s0-relative offset of a new slot of p_size bytes
+    int allocateStackSlot(const int p_size) {
+        m_frame_bottom -= p_size;
+        return m_frame_bottom;
+    }
+    int getFrameBottom() const { return m_frame_bottom; }
+    // keeps everything above p_offset for slots laid out elsewhere
+    void reserveStackArea(const int p_offset) {
+        m_frame_bottom = std::min(m_frame_bottom, p_offset);
+    }
+
+    // callee-saved registers other than s0 that the body writes
+    const std::vector<int> &getSavedRegs() const { return m_saved_regs; }
+    void addSavedReg(const int p_reg) { m_saved_regs.push_back(p_reg); }
+
+    int getFrameSize() const;
+
+    // Wraps the body with the prologue and the epilogue. Saved registers get
+    // their slots here, so it runs after register allocation. Leaves do not
+    // save ra, slots are addressed from sp unless the body moves sp itself,
+    // and the saves are shrink-wrapped onto the paths that need them. Tail
+    // calls get an epilogue of their own. Slots of frames too large for
+    // 12-bit offsets are addressed through a register.
+    void insertPrologueEpilogue();
+
+    void print(FILE *p_out_file) const;
+};
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef CODEGEN_MACHINE_INSTR_H
+#define CODEGEN_MACHINE_INSTR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Registers are numbered as the hardware does (x0 ~ x31), the vector
+// registers v0 ~ v31 follow. Anything at or above kFirstVirtualReg is a
+// virtual register that still needs a physical register from the register
+// allocator, which only hands out x registers.
+constexpr int kNoReg = -1;
+constexpr int kNumPhysRegs = 32;
+constexpr int kFirstVectorReg = 32;
+constexpr int kNumVectorRegs = 32;
+constexpr int kFirstVirtualReg = 64;
+
+extern const char *kRegisterNames[kNumPhysRegs];
+
+namespace reg {
+constexpr int zero = 0, ra = 1, sp = 2, gp = 3, tp = 4;
+constexpr int t0 = 5, t1 = 6, t2 = 7;
+constexpr int s0 = 8, s1 = 9;
+constexpr int a0 = 10, a1 = 11, a2 = 12, a3 = 13, a4 = 14, a5 = 15, a6 = 16,
+              a7 = 17;
+constexpr int s2 = 18, s3 = 19, s4 = 20, s5 = 21, s6 = 22, s7 = 23, s8 = 24,
+              s9 = 25, s10 = 26, s11 = 27;
+constexpr int t3 = 28, t4 = 29, t5 = 30, t6 = 31;
+} // namespace reg
+
+inline bool isVirtualReg(const int p_reg) { return p_reg >= kFirstVirtualReg; }
+inline bool isVectorReg(const int p_reg) {
+    return p_reg >= kFirstVectorReg && p_reg < kFirstVectorReg + kNumVectorRegs;
+}
+inline bool isCalleeSavedReg(const int p_reg) {
+    return p_reg == reg::s0 || p_reg == reg::s1 ||
+           (p_reg >= reg::s2 && p_reg <= reg::s11);
+}
+int lookupRegister(const std::string &p_name);
+std::string getRegisterName(const int p_reg);
+
+class MachineOperand {
+  public:
+    enum class KindEnum : uint8_t {
+        kRegister,
+        kImmediate,
+        kMemory, // offset(base)
+        kSymbol
+    };
+
+  private:
+    KindEnum m_kind;
+    int m_reg = kNoReg;
+    int64_t m_imm = 0;
+    std::string m_symbol;
+
+    MachineOperand(const KindEnum kind) : m_kind(kind) {}
+
+  public:
+    ~MachineOperand() = default;
+
+    static MachineOperand createReg(const int p_reg);
+    static MachineOperand createImm(const int64_t p_imm);
+    static MachineOperand createMem(const int p_base, const int64_t p_offset);
+    static MachineOperand createSymbol(const std::string &p_symbol);
+
+    KindEnum getKind() const { return m_kind; }
+    bool isReg() const { return m_kind == KindEnum::kRegister; }
+    bool isImm() const { return m_kind == KindEnum::kImmediate; }
+    bool isMem() const { return m_kind == KindEnum::kMemory; }
+    bool isSymbol() const { return m_kind == KindEnum::kSymbol; }
+
+    // register operand, or the base register of a memory operand
+    int getReg() const { return m_reg; }
+    void setReg(const int p_reg) { m_reg = p_reg; }
+
+    // immediate operand, or the offset of a memory operand
+    int64_t getImm() const { return m_imm; }
+    void setImm(const int64_t p_imm) { m_imm = p_imm; }
+
+    const std::string &getSymbol() const { return m_symbol; }
+    void setSymbol(const std::string &p_symbol) { m_symbol = p_symbol; }
+
+    bool operator==(const MachineOperand &p_other) const;
+    bool operator!=(const MachineOperand &p_other) const {
+        return !(*this == p_other);
+    }
+
+    std::string toString() const;
+};
+
+class MachineInstr {
+  public:
+    enum class KindEnum : uint8_t { kInstruction, kLabel, kComment };
+    using Operands = std::vector<MachineOperand>;
+    using Regs = std::vector<int>;
+
+  private:
+    KindEnum m_kind;
+    // opcode mnemonic, label name or comment text
+    std::string m_opcode;
+    Operands m_operands;
+
+    // registers read/written without appearing in the operand list, e.g. the
+    // argument and caller-saved registers of a call
+    Regs m_implicit_uses;
+    Regs m_implicit_defs;
+
+  public:
+    ~MachineInstr() = default;
+    MachineInstr(const std::string &p_opcode, const Operands &p_operands)
+        : m_kind(KindEnum::kInstruction), m_opcode(p_opcode),
+          m_operands(p_operands) {}
+
+    static MachineInstr createLabel(const std::string &p_name);
+    static MachineInstr createComment(const std::string &p_text);
+    static MachineInstr createCall(const std::string &p_callee,
+                                   const Regs &p_arg_regs);
+    // jumps to p_callee, which returns to the caller in place of this
+    // function; the frame has to be gone by then
+    static MachineInstr createTailCall(const std::string &p_callee,
+                                       const Regs &p_arg_regs);
+
+    // Parses one line of assembly text as written by dumpInstrs().
+    static MachineInstr parse(const std::string &p_line);
+
+    KindEnum getKind() const { return m_kind; }
+    bool isInstruction() const { return m_kind == KindEnum::kInstruction; }
+    bool isLabel() const { return m_kind == KindEnum::kLabel; }
+    bool isComment() const { return m_kind == KindEnum::kComment; }
+
+    const std::string &getOpcode() const { return m_opcode; }
+    void setOpcode(const std::string &p_opcode) { m_opcode = p_opcode; }
+    // label name for labels, comment text for comments
+    const std::string &getName() const { return m_opcode; }
+
+    Operands &getOperands() { return m_operands; }
+    const Operands &getOperands() const { return m_operands; }
+    MachineOperand &getOperand(const size_t nth) { return m_operands[nth]; }
+    const MachineOperand &getOperand(const size_t nth) const {
+        return m_operands[nth];
+    }
+
+    const Regs &getImplicitUses() const { return m_implicit_uses; }
+    const Regs &getImplicitDefs() const { return m_implicit_defs; }
+    void setImplicitUses(const Regs &p_regs) { m_implicit_uses = p_regs; }
+    void setImplicitDefs(const Regs &p_regs) { m_implicit_defs = p_regs; }
+
+    bool isCall() const;
+    bool isReturn() const; // tail calls included
+    bool isTailCall() const;
+    bool isBranch() const;         // conditional branch
+    bool isUnconditionalJump() const;
+    bool isTerminator() const {
+        return isBranch() || isUnconditionalJump() || isReturn();
+    }
+    bool isLoad() const;  // vector loads included
+    bool isStore() const; // vector stores included
+    // an instruction of the V extension, which all depend on vl
+    bool isVector() const;
+    // the label this branch or jump goes to, nullptr if none
+    const std::string *getBranchTarget() const;
+    void setBranchTarget(const std::string &p_label);
+
+    // whether operand 0 is a register written by the instruction
+    bool definesFirstOperand() const;
+
+    Regs getUses() const;
+    Regs getDefs() const;
+
+    // Applies p_fn to every register operand (memory bases included).
+    template <typename Fn> void forEachRegOperand(Fn p_fn) {
+        for (auto &operand : m_operands) {
+            if (operand.isReg() || operand.isMem()) {
+                p_fn(operand);
+            }
+        }
+    }
+
+    std::string toString() const;
+};
+
+#endif
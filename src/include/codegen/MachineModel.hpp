@@ -0,0 +1,25 @@
+#ifndef CODEGEN_MACHINE_MODEL_H
+#define CODEGEN_MACHINE_MODEL_H
+
+#include "codegen/MachineInstr.hpp"
+
+#include <string>
+
+// Timing of an in-order, single-issue RV32 pipeline, picked with -mtune.
+// A latency is the number of cycles from issuing an instruction to issuing
+// one that uses its result; anything not listed takes a single cycle.
+struct MachineModel {
+    const char *name;
+    int load_latency;
+    int mul_latency; // mul, mulh...
+    int div_latency; // div, rem...
+
+    int getLatency(const MachineInstr &p_instr) const;
+};
+
+// the model called p_name, nullptr if there is none
+const MachineModel *lookupMachineModel(const std::string &p_name);
+// the names of all models, separated by '|'
+std::string getMachineModelNames();
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef CODEGEN_PEEPHOLE_OPTIMIZER_H
+#define CODEGEN_PEEPHOLE_OPTIMIZER_H
+
+#include "codegen/MachineFunction.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+// Rewrites short instruction sequences of a finished function (registers
+// allocated, prologue and epilogue in place) until none of the rules in
+// kRules applies any more. A rule looks at no more than the window size of
+// instructions, comments not counted.
+class PeepholeOptimizer {
+  public:
+    using Instrs = MachineFunction::Instrs;
+
+    struct Rule {
+        const char *name;
+        // tries to rewrite the sequence starting at p_pos, returns whether it
+        // changed anything
+        bool (*apply)(const PeepholeOptimizer &p_optimizer, Instrs &p_instrs,
+                      const size_t p_pos);
+    };
+
+  private:
+    size_t m_window_size;
+    std::vector<size_t> m_hits; // by rule
+
+  public:
+    ~PeepholeOptimizer() = default;
+    PeepholeOptimizer(const size_t p_window_size);
+
+    void run(MachineFunction &p_function);
+
+    size_t getWindowSize() const { return m_window_size; }
+
+    // Indices of up to window size instructions from p_pos on, skipping
+    // comments. Labels end the window since control may enter there.
+    std::vector<size_t> getWindow(const Instrs &p_instrs,
+                                  const size_t p_pos) const;
+
+    void printStats(FILE *p_out_file) const;
+};
+
+#endif
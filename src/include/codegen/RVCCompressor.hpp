@@ -0,0 +1,43 @@
+#ifndef CODEGEN_RVC_COMPRESSOR_H
+#define CODEGEN_RVC_COMPRESSOR_H
+
+#include "codegen/MachineFunction.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Rewrites the instructions of a finished function into the 16-bit forms
+// of the C extension (c.addi, c.li, c.mv, c.add, c.lw/c.sw, c.lwsp/c.swsp,
+// c.j, c.beqz...) wherever the registers and immediates fit. Most of them
+// need x8 ~ x15 or the destination to be a source as well.
+//
+// c.j and c.beqz/c.bnez reach less far than j and the branches: the
+// offsets are taken from the compressed layout, and the jumps that fall
+// short are given up on until all of them make it.
+class RVCCompressor {
+  public:
+    using Instrs = MachineFunction::Instrs;
+
+  private:
+    struct FunctionSize {
+        std::string name;
+        size_t before;
+        size_t after;
+    };
+    std::vector<FunctionSize> m_sizes;
+
+  public:
+    ~RVCCompressor() = default;
+    RVCCompressor() = default;
+
+    void run(MachineFunction &p_function);
+
+    // bytes of code p_instr assembles to, pseudo-instructions expanded
+    static size_t getSize(const MachineInstr &p_instr);
+
+    void printStats(FILE *p_out_file) const;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef CODEGEN_REGISTER_ALLOCATOR_H
+#define CODEGEN_REGISTER_ALLOCATOR_H
+
+#include "codegen/MachineFunction.hpp"
+
+#include <utility>
+#include <vector>
+
+// Linear scan register allocation (Poletto & Sarkar) over the virtual
+// registers of a MachineFunction.
+//
+// Every instruction i owns two program points: 2i where it reads its
+// operands and 2i + 1 where it writes its results. A virtual register gets
+// the interval from the first to the last point it is live at, but keeps
+// the segments it is really live in, like the physical registers do: a
+// register is free for it if nothing holding the register is live in those
+// segments, so an interval can make use of the holes another leaves, which
+// blocks laid out away from the rest of a loop cause, and a call in a hole
+// does not clobber it.
+class LinearScanRegisterAllocator {
+  private:
+    using Segment = std::pair<int, int>;
+
+    struct LiveInterval {
+        int vreg;
+        int start;
+        int end;
+        int phys = kNoReg;
+        int spill_slot = 0;
+        bool spilled = false;
+    };
+
+    MachineFunction &m_function;
+    // try x8 ~ x15 first, which most compressed instructions need
+    bool m_prefer_compressible;
+    std::vector<std::vector<Segment>> m_segments; // by register number
+    std::vector<LiveInterval> m_intervals;
+    std::vector<int> m_phys_hints;    // by register number
+    std::vector<int> m_virtual_hints; // by register number
+
+    size_t m_num_spilled = 0;
+
+  public:
+    ~LinearScanRegisterAllocator() = default;
+    LinearScanRegisterAllocator(MachineFunction &p_function,
+                                const bool p_prefer_compressible = false)
+        : m_function(p_function),
+          m_prefer_compressible(p_prefer_compressible) {}
+
+    void run();
+
+    size_t getNumSpilled() const { return m_num_spilled; }
+
+  private:
+    void computeLiveSegments();
+    void collectHints();
+    void allocate();
+    void rewrite();
+
+    // whether p_interval is live at p_point
+    bool covers(const LiveInterval &p_interval, const int p_point) const;
+    // whether register p_reg and p_interval are live at a common point
+    bool overlaps(const int p_reg, const LiveInterval &p_interval) const;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef CODEGEN_REGISTER_NEED_H
+#define CODEGEN_REGISTER_NEED_H
+
+#include "visitor/AstNodeVisitor.hpp"
+
+#include <unordered_map>
+
+class AstNode;
+class SymbolManager;
+
+// Sethi-Ullman labels of an expression tree: the number of registers needed
+// to evaluate a subtree without spilling, and what may stop its evaluation
+// order from being swapped with a sibling.
+struct RegisterNeed {
+    int need = 1;
+    bool has_call = false;
+    // reads a global variable that a call may write
+    bool reads_global = false;
+};
+
+class RegisterNeedLabeler final : public AstNodeVisitor {
+  private:
+    const SymbolManager *m_symbol_manager_ptr;
+    std::unordered_map<const AstNode *, RegisterNeed> m_labels;
+
+  public:
+    ~RegisterNeedLabeler() = default;
+    RegisterNeedLabeler(const SymbolManager *const p_symbol_manager)
+        : m_symbol_manager_ptr(p_symbol_manager) {}
+
+    // labels the subtree on first use; the symbols it refers to must be
+    // visible in the symbol manager
+    const RegisterNeed &get(AstNode &p_expr);
+
+    // whether two sibling subtrees may be evaluated in either order
+    static bool canReorder(const RegisterNeed &p_first,
+                           const RegisterNeed &p_second);
+
+    void visit(ConstantValueNode &p_constant_value) override;
+    void visit(BinaryOperatorNode &p_bin_op) override;
+    void visit(UnaryOperatorNode &p_un_op) override;
+    void visit(FunctionInvocationNode &p_func_invocation) override;
+    void visit(VariableReferenceNode &p_variable_ref) override;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef CODEGEN_STRENGTH_REDUCTION_H
+#define CODEGEN_STRENGTH_REDUCTION_H
+
+#include <cstdint>
+#include <vector>
+
+// Replacing multiplication and division by a constant with cheaper
+// instructions: the arithmetic behind it, and the sequences themselves for
+// the code generators to append to a MachineFunction.
+
+class MachineFunction;
+
+// A nonzero digit of the non-adjacent form of a multiplier: the multiplier
+// is the sum of sign * 2^shift over its digits.
+struct ShiftAddDigit {
+    int shift;
+    int sign; // +1 or -1
+};
+
+// Digits of p_multiplier (> 0), most significant first. No two of them are
+// adjacent, which keeps the number of additions minimal.
+std::vector<ShiftAddDigit> computeShiftAddDigits(const uint32_t p_multiplier);
+
+// Instructions that multiply by the digits from the most significant one
+// down: shift by the gap to the next digit, then add or subtract it.
+int getShiftAddCost(const std::vector<ShiftAddDigit> &p_digits);
+
+// Multiply-high constants for signed division by p_divisor (>= 2, not a
+// power of two), after Hacker's Delight, 10-1: n / d is
+// (mulh(n, multiplier) [+ n if multiplier < 0]) >> shift, plus 1 if n < 0.
+struct MagicDivisor {
+    int32_t multiplier;
+    int shift;
+};
+
+MagicDivisor computeMagicDivisor(const int32_t p_divisor);
+
+// log2 of p_value if it is a power of two, -1 otherwise
+int getExactLog2(const uint32_t p_value);
+
+// |p_value| without overflowing on INT_MIN
+uint32_t getMagnitude(const int32_t p_value);
+
+// whether shifts and adds beat mul for p_multiplier
+bool isCheapMultiplier(const int32_t p_multiplier);
+// Whether div and rem by p_divisor are worth replacing, which excludes
+// division by zero and by INT_MIN. p_num_temps receives the number of
+// scratch registers emitDivideByConstant()/emitModuloByConstant() need.
+bool isReducibleDivisor(const int32_t p_divisor, int &p_num_temps);
+
+// p_dst = p_src * p_multiplier, for a cheap multiplier
+void emitMultiplyByConstant(MachineFunction &p_function, const int p_dst,
+                            const int p_src, const int32_t p_multiplier);
+// p_dst = p_src / p_divisor and p_dst = p_src mod p_divisor, for a
+// reducible divisor; p_temp is clobbered if one is needed
+void emitDivideByConstant(MachineFunction &p_function, const int p_dst,
+                          const int p_src, const int32_t p_divisor,
+                          const int p_temp);
+void emitModuloByConstant(MachineFunction &p_function, const int p_dst,
+                          const int p_src, const int32_t p_divisor,
+                          const int p_temp);
+
+#endif
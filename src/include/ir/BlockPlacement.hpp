@@ -0,0 +1,54 @@
+#ifndef IR_BLOCK_PLACEMENT_H
+#define IR_BLOCK_PLACEMENT_H
+
+#include "ir/IR.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace ir {
+
+class DominatorTree;
+class LoopInfo;
+
+// Lays out the blocks of a function with a profile so the hot paths fall
+// through, after Pettis and Hansen: going from the most frequent edge
+// down, an edge whose source ends a chain of blocks and whose target
+// starts another joins the two chains. Back edges are left out; instead a
+// hot loop whose header exits it is rotated, the header going after the
+// latch that ends the chain through the body, so every iteration takes one
+// branch and no jump. The chain of the entry comes first, the others keep
+// their order, and the blocks the profile never saw run go last. If that
+// takes more jumps and taken branches than the layout had, as the greedy
+// choice sometimes does, the layout stays as it was.
+class BlockPlacement {
+  private:
+    Function &m_function;
+
+    // by block id
+    std::vector<size_t> m_chain_of;
+    std::vector<std::vector<BasicBlock *>> m_chains;
+
+    size_t m_num_moved = 0;
+    size_t m_num_cold = 0;
+
+  public:
+    ~BlockPlacement() = default;
+    BlockPlacement(Function &p_function) : m_function(p_function) {}
+
+    void run();
+
+    // blocks now at another position
+    size_t getNumMoved() const { return m_num_moved; }
+    // blocks that never ran, moved to the end
+    size_t getNumCold() const { return m_num_cold; }
+
+  private:
+    void buildChains(const DominatorTree &p_dom_tree,
+                     const std::vector<bool> &p_cold);
+    void rotateLoops(const LoopInfo &p_loop_info);
+};
+
+} // namespace ir
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef IR_DCE_H
+#define IR_DCE_H
+
+#include "ir/IR.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace ir {
+
+class SideEffects;
+
+// Dead code elimination. Starting from what has to happen (output, input,
+// stores, calls that do more than compute a value, terminators), marks the
+// values these need, and removes everything else; a cycle of phis feeding
+// only each other goes too.
+//
+// A store is dead if nothing loads from its slot, if the program never
+// reads its global, or if the same block stores to the same place again
+// before anything could read it.
+class DeadCodeElimination {
+  private:
+    Function &m_function;
+    const SideEffects &m_side_effects;
+
+    // by value id
+    std::vector<bool> m_live;
+    // by slot id
+    std::vector<bool> m_loaded_slots;
+
+    size_t m_num_removed = 0;
+
+  public:
+    ~DeadCodeElimination() = default;
+    DeadCodeElimination(Function &p_function,
+                        const SideEffects &p_side_effects)
+        : m_function(p_function), m_side_effects(p_side_effects) {}
+
+    // returns the number of instructions removed
+    size_t run();
+
+  private:
+    bool isDeadStore(const BasicBlock &p_block, size_t p_index) const;
+    // whether p_instr has to stay even if its value goes unused
+    bool isRoot(const BasicBlock &p_block, size_t p_index) const;
+};
+
+} // namespace ir
+
+#endif
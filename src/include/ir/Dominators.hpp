@@ -0,0 +1,57 @@
+#ifndef IR_DOMINATORS_H
+#define IR_DOMINATORS_H
+
+#include "ir/IR.hpp"
+
+#include <vector>
+
+namespace ir {
+
+// Immediate dominators after Cooper, Harvey and Kennedy, "A Simple, Fast
+// Dominance Algorithm", along with the dominator tree and the dominance
+// frontiers. Only reflects the CFG as it was when constructed; the
+// predecessors have to be up to date then.
+class DominatorTree {
+  private:
+    std::vector<BasicBlock *> m_rpo; // reverse postorder, the entry first
+    // by block id
+    std::vector<int> m_rpo_index;
+    std::vector<BasicBlock *> m_idoms;
+    std::vector<std::vector<BasicBlock *>> m_children;
+    std::vector<std::vector<BasicBlock *>> m_frontiers;
+
+  public:
+    ~DominatorTree() = default;
+    DominatorTree(const Function &p_function);
+
+    const std::vector<BasicBlock *> &getReversePostOrder() const {
+        return m_rpo;
+    }
+    // nullptr for the entry
+    BasicBlock *getIdom(const BasicBlock *p_block) const {
+        return m_idoms[p_block->getId()];
+    }
+    const std::vector<BasicBlock *> &getChildren(const BasicBlock *p_block) const {
+        return m_children[p_block->getId()];
+    }
+    const std::vector<BasicBlock *> &getFrontier(const BasicBlock *p_block) const {
+        return m_frontiers[p_block->getId()];
+    }
+
+    bool isReachable(const BasicBlock *p_block) const {
+        return m_rpo_index[p_block->getId()] >= 0;
+    }
+    // whether every path from the entry to p_b goes through p_a
+    bool dominates(const BasicBlock *p_a, const BasicBlock *p_b) const;
+    // whether the value of p_def is available at p_user; phis use their
+    // operands at the end of the incoming block
+    bool dominates(const Instruction *p_def, const Instruction *p_user,
+                   const size_t p_operand) const;
+
+  private:
+    BasicBlock *intersect(BasicBlock *p_a, BasicBlock *p_b) const;
+};
+
+} // namespace ir
+
+#endif
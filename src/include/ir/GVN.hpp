@@ -0,0 +1,81 @@
+#ifndef IR_GVN_H
+#define IR_GVN_H
+
+#include "ir/IR.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ir {
+
+class DominatorTree;
+class SideEffects;
+
+// Dominator-based global value numbering. Walks the dominator tree keeping
+// the computations of the dominating blocks in a scoped table, and replaces
+// an instruction by the one computing the same thing already. Operands of
+// commutative operators are ordered and a > b is looked up as b < a.
+// Constants stay where they are, as they select into immediates or a single
+// li right where needed, but operands compare by their value.
+//
+// Loads, and calls to pure functions, also depend on the memory, which gets
+// a new version at every store and every other call. A block starts with the
+// version its only predecessor ended with, if that is its immediate
+// dominator, and with a fresh one otherwise. A load after a store to the
+// same place yields the value stored.
+//
+// A compare only the branch right after uses is left alone, as the branch
+// takes it in for free.
+class GVN {
+  private:
+    struct Key {
+        Opcode opcode;
+        int32_t imm;
+        std::string symbol;
+        const Slot *slot;
+        unsigned memory; // the version of the memory, loads and calls only
+        // value ids, (-1, value) for constants
+        std::vector<std::pair<int, int32_t>> operands;
+
+        bool operator<(const Key &p_other) const;
+    };
+
+    Function &m_function;
+    const SideEffects &m_side_effects;
+
+    std::map<Key, Instruction *> m_values;
+    // by value id, what a redundant instruction is replaced with
+    std::vector<Instruction *> m_replacements;
+    // by value id
+    std::vector<int> m_num_uses;
+    // by block id, the memory version at the end of the block
+    std::vector<unsigned> m_exit_memory;
+    unsigned m_memory = 0;
+    unsigned m_next_memory = 0;
+
+    size_t m_num_removed = 0;
+
+  public:
+    ~GVN() = default;
+    GVN(Function &p_function, const SideEffects &p_side_effects)
+        : m_function(p_function), m_side_effects(p_side_effects) {}
+
+    // returns the number of instructions removed
+    size_t run();
+
+  private:
+    // numbers the block, returns the keys added to the table
+    std::vector<Key> visit(BasicBlock *p_block, const DominatorTree &p_dom_tree);
+    // whether p_instr gets a number; the others may still change the memory
+    bool isNumbered(const Instruction &p_instr) const;
+    Key makeKey(const Instruction &p_instr) const;
+    Instruction *resolve(Instruction *p_value) const;
+};
+
+} // namespace ir
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef IR_IR_H
+#define IR_IR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A three-address intermediate representation in SSA form. Every value is a
+// 32-bit integer (booleans are 0 or 1, arrays are passed by their address)
+// or, in a vectorized loop, a vector of them, and is named by the
+// instruction that computes it. IRBuilder lowers the AST into it with locals
+// kept in stack slots; Mem2Reg then promotes the scalar slots into SSA
+// values.
+namespace ir {
+
+class BasicBlock;
+class Function;
+
+enum class Opcode : uint8_t {
+    kConst, // imm
+    kParam, // imm: the index of the parameter
+    kAdd,
+    kSub,
+    kMul,
+    kDiv,
+    kMod,
+    kNeg,
+    kNot,
+    kEq, // comparisons produce 0 or 1
+    kNe,
+    kLt,
+    kLe,
+    kGt,
+    kGe,
+    kLoad,        // slot
+    kStore,       // slot <- operand 0
+    kLoadGlobal,  // symbol
+    kStoreGlobal, // symbol <- operand 0
+    kAddr,        // slot: the address of an array in the frame
+    kAddrGlobal,  // symbol: the address of a global array
+    kLoadPtr,     // the word at operand 0 + imm bytes
+    kStorePtr,    // the word at operand 1 + imm bytes <- operand 0
+    kCall,        // symbol, operands: the arguments
+    kPrint,       // operand 0
+    kRead,
+    kCount,  // imm: a profile counter, which operand 0 is added to
+    kPhi,    // operand i comes in from block i
+    kJump,   // block 0
+    kBranch, // block 0 if operand 0 is nonzero, block 1 otherwise
+    kRet,    // operand 0, if the function returns a value
+    // The V extension, on 32-bit elements. A vector holds as many elements
+    // as the last vsetvl asked for and got, so these stay where they are.
+    kVSetVL,  // imm: the LMUL; takes min(operand 0, VLMAX) elements
+    kVLoad,   // the elements at operand 0
+    kVSplat,  // operand 0 in every element
+    kVStore,  // the elements at operand 1 <- operand 0
+    kVAdd,    // element by element; a scalar operand applies to every one
+    kVSub,
+    kVMul,
+    kVRedSum  // operand 1 + the sum of the elements of operand 0
+};
+
+const char *getOpcodeName(const Opcode p_opcode);
+
+// A local variable living in the frame: what IRBuilder puts every local in
+// and Mem2Reg takes them out of again, unless it is an array.
+struct Slot {
+    int id;
+    std::string name;
+    int size; // bytes
+};
+
+class Instruction {
+  public:
+    using Operands = std::vector<Instruction *>;
+    using Blocks = std::vector<BasicBlock *>;
+
+  private:
+    Opcode m_opcode;
+    int m_id;
+    BasicBlock *m_parent = nullptr;
+    Operands m_operands;
+    Blocks m_blocks;
+    int32_t m_imm = 0;
+    std::string m_symbol;
+    Slot *m_slot = nullptr;
+    bool m_tail_call = false;
+    std::vector<uint64_t> m_counts;
+
+  public:
+    ~Instruction() = default;
+    Instruction(const Opcode p_opcode, const int p_id,
+                const Operands &p_operands)
+        : m_opcode(p_opcode), m_id(p_id), m_operands(p_operands) {}
+
+    Opcode getOpcode() const { return m_opcode; }
+    void setOpcode(const Opcode p_opcode) { m_opcode = p_opcode; }
+    // unique within the function, at most Function::getNumValueIds()
+    int getId() const { return m_id; }
+
+    BasicBlock *getParent() const { return m_parent; }
+    void setParent(BasicBlock *const p_parent) { m_parent = p_parent; }
+
+    Operands &getOperands() { return m_operands; }
+    const Operands &getOperands() const { return m_operands; }
+    Instruction *getOperand(const size_t nth) const { return m_operands[nth]; }
+    void setOperand(const size_t nth, Instruction *const p_value) {
+        m_operands[nth] = p_value;
+    }
+    void addOperand(Instruction *const p_value) {
+        m_operands.push_back(p_value);
+    }
+
+    // jump and branch targets, incoming blocks of a phi
+    Blocks &getBlocks() { return m_blocks; }
+    const Blocks &getBlocks() const { return m_blocks; }
+    BasicBlock *getBlock(const size_t nth) const { return m_blocks[nth]; }
+    void setBlock(const size_t nth, BasicBlock *const p_block) {
+        m_blocks[nth] = p_block;
+    }
+
+    int32_t getImm() const { return m_imm; }
+    void setImm(const int32_t p_imm) { m_imm = p_imm; }
+    const std::string &getSymbol() const { return m_symbol; }
+    void setSymbol(const std::string &p_symbol) { m_symbol = p_symbol; }
+    Slot *getSlot() const { return m_slot; }
+    void setSlot(Slot *const p_slot) { m_slot = p_slot; }
+    // a call the ret right after returns the value of, made by reusing the
+    // frame of the caller
+    bool isTailCall() const { return m_tail_call; }
+    void setTailCall(const bool p_tail_call) { m_tail_call = p_tail_call; }
+    // for a jump or branch, how often the profile saw it go to each of its
+    // blocks; empty without a profile
+    std::vector<uint64_t> &getCounts() { return m_counts; }
+    const std::vector<uint64_t> &getCounts() const { return m_counts; }
+
+    bool isConst() const { return m_opcode == Opcode::kConst; }
+    bool isPhi() const { return m_opcode == Opcode::kPhi; }
+    bool isBinary() const;
+    bool isCompare() const;
+    // whether swapping the two operands keeps the result
+    bool isCommutative() const;
+    bool isTerminator() const;
+    // whether the value is a vector rather than a single word
+    bool isVector() const;
+    // whether the instruction computes a value others may use
+    bool hasResult() const;
+    // whether it has to stay even if its value goes unused
+    bool hasSideEffect() const;
+
+    // the incoming value of a phi for p_block, nullptr if there is none
+    Instruction *getIncomingValue(const BasicBlock *p_block) const;
+    void addIncoming(Instruction *const p_value, BasicBlock *const p_block);
+    void removeIncoming(const BasicBlock *p_block);
+
+    void replaceUsesOfWith(const Instruction *p_from, Instruction *const p_to);
+};
+
+class BasicBlock {
+  public:
+    using Instrs = std::vector<std::unique_ptr<Instruction>>;
+    using Blocks = std::vector<BasicBlock *>;
+
+  private:
+    int m_id;
+    Function *m_parent;
+    Instrs m_instrs;
+    Blocks m_preds; // kept up to date by Function::updatePredecessors()
+
+  public:
+    ~BasicBlock() = default;
+    BasicBlock(const int p_id, Function *const p_parent)
+        : m_id(p_id), m_parent(p_parent) {}
+
+    // unique within the function, at most Function::getNumBlockIds()
+    int getId() const { return m_id; }
+    Function *getParent() const { return m_parent; }
+
+    Instrs &getInstrs() { return m_instrs; }
+    const Instrs &getInstrs() const { return m_instrs; }
+    bool empty() const { return m_instrs.empty(); }
+
+    // the last instruction if it is a terminator, nullptr otherwise
+    Instruction *getTerminator() const;
+    Blocks getSuccessors() const;
+    const Blocks &getPredecessors() const { return m_preds; }
+    // How often the block ran in the profile, the sum of the counts of the
+    // edges into it; -1 if one of them has none. Needs the predecessors.
+    int64_t getCount() const;
+    Blocks &getPredecessors() { return m_preds; }
+
+    // position of p_instr within the block
+    size_t indexOf(const Instruction *p_instr) const;
+    // position of the first instruction that is not a phi
+    size_t getFirstNonPhi() const;
+
+    Instruction *insert(const size_t p_pos,
+                        std::unique_ptr<Instruction> p_instr);
+    Instruction *append(std::unique_ptr<Instruction> p_instr);
+    Instruction *insertBeforeTerminator(std::unique_ptr<Instruction> p_instr);
+    // detaches p_instr, e.g. to move it somewhere else
+    std::unique_ptr<Instruction> remove(Instruction *p_instr);
+    void erase(Instruction *p_instr) { remove(p_instr); }
+};
+
+class Function {
+  public:
+    using Blocks = std::vector<std::unique_ptr<BasicBlock>>;
+    using Slots = std::vector<std::unique_ptr<Slot>>;
+
+  private:
+    std::string m_name;
+    int m_num_params;
+    bool m_returns_value;
+    Blocks m_blocks; // in layout order, the entry first
+    Slots m_slots;
+    int m_next_value_id = 0;
+    int m_next_block_id = 0;
+    int m_next_slot_id = 0;
+    // calls in the profile, -1 without one
+    int64_t m_entry_count = -1;
+
+  public:
+    ~Function() = default;
+    Function(const std::string &p_name, const int p_num_params,
+             const bool p_returns_value)
+        : m_name(p_name), m_num_params(p_num_params),
+          m_returns_value(p_returns_value) {}
+
+    const std::string &getName() const { return m_name; }
+    int getNumParams() const { return m_num_params; }
+    bool returnsValue() const { return m_returns_value; }
+    int64_t getEntryCount() const { return m_entry_count; }
+    void setEntryCount(const int64_t p_count) { m_entry_count = p_count; }
+
+    Blocks &getBlocks() { return m_blocks; }
+    const Blocks &getBlocks() const { return m_blocks; }
+    BasicBlock *getEntry() const { return m_blocks.front().get(); }
+    // the block laid out after p_block, nullptr for the last one
+    BasicBlock *getNextBlock(const BasicBlock *p_block) const;
+
+    Slots &getSlots() { return m_slots; }
+    const Slots &getSlots() const { return m_slots; }
+
+    int getNumValueIds() const { return m_next_value_id; }
+    int getNumBlockIds() const { return m_next_block_id; }
+    int getNumSlotIds() const { return m_next_slot_id; }
+
+    // a new block at the end of the layout
+    BasicBlock *createBlock();
+    // places p_block at the end of the layout
+    void moveBlockToEnd(BasicBlock *p_block);
+    // places p_block right before p_next in the layout
+    void moveBlockBefore(BasicBlock *p_block, const BasicBlock *p_next);
+    void eraseBlock(BasicBlock *p_block);
+
+    Slot *createSlot(const std::string &p_name, const int p_size);
+    void eraseSlot(const Slot *p_slot);
+
+    std::unique_ptr<Instruction>
+    createInstr(const Opcode p_opcode,
+                const Instruction::Operands &p_operands = {});
+
+    void updatePredecessors();
+    // Drops the blocks the entry does not reach, together with the phi
+    // operands flowing out of them. Updates the predecessors.
+    void removeUnreachableBlocks();
+    // A new block on the edge p_from -> p_to, placed before p_to; phis in
+    // p_to now receive their value from it. Updates the predecessors.
+    BasicBlock *splitEdge(BasicBlock *p_from, BasicBlock *p_to);
+
+    void replaceAllUsesWith(const Instruction *p_from, Instruction *p_to);
+};
+
+// The whole program; the program body is the function "main", last.
+class Module {
+  public:
+    using Functions = std::vector<std::unique_ptr<Function>>;
+
+  private:
+    Functions m_functions;
+
+  public:
+    ~Module() = default;
+    Module() = default;
+
+    Functions &getFunctions() { return m_functions; }
+    const Functions &getFunctions() const { return m_functions; }
+
+    Function *createFunction(const std::string &p_name, const int p_num_params,
+                             const bool p_returns_value);
+    Function *lookup(const std::string &p_name) const;
+};
+
+} // namespace ir
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef IR_IR_BUILDER_H
+#define IR_IR_BUILDER_H
+
+#include "ir/IR.hpp"
+#include "visitor/AstNodeVisitor.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+class ExpressionNode;
+class SymbolEntry;
+class SymbolManager;
+class SymbolTable;
+class VariableReferenceNode;
+
+namespace ir {
+
+// Lowers a checked AST into a Module, one Function per function plus
+// "main" for the program body. Every local, parameter and local constant
+// gets a Slot of its own and is accessed with loads and stores, globals
+// with load.global and store.global. An array is reached through its
+// address instead: kAddr or kAddr.global for its own, the slot of a
+// parameter for one passed in, with the elements laid out row by row.
+// Conditions become branches, so the right operand of and/or only runs if
+// it decides the result.
+//
+// A for loop has constant bounds, so its trip count is known: it is entered
+// straight at the body with the test at the bottom, fully unrolled if it
+// runs at most p_max_full_unroll times, and otherwise unrolled
+// p_unroll_factor times with the iterations left over following the loop.
+// Either only as far as the body stays small.
+//
+// With p_vectorize, a loop whose body only assigns element i (plus a
+// constant) of integer arrays, or adds such elements up into a scalar, is
+// strip-mined instead: each strip sets vl to what is left, loads, computes
+// and stores vl elements at once and sums a reduction with kVRedSum.
+class IRBuilder final : public AstNodeVisitor {
+  private:
+    const SymbolManager *m_symbol_manager_ptr;
+    Module &m_module;
+
+    Function *m_function = nullptr;
+    // the block instructions are appended to
+    BasicBlock *m_block = nullptr;
+    // the value of the last visited expression
+    Instruction *m_value = nullptr;
+    std::map<const SymbolEntry *, Slot *> m_slots;
+    const uint32_t m_unroll_factor;
+    const uint32_t m_max_full_unroll;
+    const bool m_vectorize;
+    size_t m_num_vectorized = 0;
+
+  public:
+    ~IRBuilder() = default;
+    IRBuilder(const SymbolManager *const p_symbol_manager, Module &p_module,
+              const uint32_t p_unroll_factor = 1,
+              const uint32_t p_max_full_unroll = 0,
+              const bool p_vectorize = false)
+        : m_symbol_manager_ptr(p_symbol_manager), m_module(p_module),
+          m_unroll_factor(p_unroll_factor),
+          m_max_full_unroll(p_max_full_unroll), m_vectorize(p_vectorize) {}
+
+    size_t getNumVectorized() const { return m_num_vectorized; }
+
+    void visit(ProgramNode &p_program) override;
+    void visit(ConstantValueNode &p_constant_value) override;
+    void visit(FunctionNode &p_function) override;
+    void visit(CompoundStatementNode &p_compound_statement) override;
+    void visit(PrintNode &p_print) override;
+    void visit(BinaryOperatorNode &p_bin_op) override;
+    void visit(UnaryOperatorNode &p_un_op) override;
+    void visit(FunctionInvocationNode &p_func_invocation) override;
+    void visit(VariableReferenceNode &p_variable_ref) override;
+    void visit(AssignmentNode &p_assignment) override;
+    void visit(ReadNode &p_read) override;
+    void visit(IfNode &p_if) override;
+    void visit(WhileNode &p_while) override;
+    void visit(ForNode &p_for) override;
+    void visit(ReturnNode &p_return) override;
+
+  private:
+    void beginFunction(const std::string &p_name, const int p_num_params,
+                       const bool p_returns_value);
+    void endFunction();
+
+    Instruction *emit(const Opcode p_opcode,
+                      const Instruction::Operands &p_operands = {});
+    Instruction *emitConst(const int32_t p_value);
+    void emitJump(BasicBlock *p_target);
+    // continues in p_block, which goes to the end of the layout
+    void startBlock(BasicBlock *p_block);
+
+    Instruction *evaluate(ExpressionNode &p_expr);
+    // Ends the current block with a jump to p_true if p_cond holds and to
+    // p_false otherwise.
+    void branchOnCondition(ExpressionNode &p_cond, BasicBlock *p_true,
+                           BasicBlock *p_false);
+
+    // slots for the locals of p_table, initialized where the language says so
+    void declareLocals(const SymbolTable *p_table);
+    Instruction *loadVar(const SymbolEntry &p_entry);
+    void storeVar(const SymbolEntry &p_entry, Instruction *p_value);
+
+    Instruction *arrayBase(const SymbolEntry &p_entry);
+    // Address of the element or row p_ref names, split into a value and a
+    // constant offset so that loads and stores can take the latter as imm.
+    Instruction *elementAddress(VariableReferenceNode &p_ref,
+                                int32_t &p_offset);
+    // p_value into the variable or element p_ref names
+    void assign(VariableReferenceNode &p_ref, Instruction *p_value);
+
+    // Emits the loop over p_trip_count iterations from p_lower with the V
+    // extension, or nothing if its body doesn't fit the pattern.
+    bool vectorize(ForNode &p_for, const SymbolEntry &p_iter,
+                   int32_t p_lower, uint32_t p_trip_count);
+};
+
+} // namespace ir
+
+#endif
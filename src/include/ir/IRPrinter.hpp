@@ -0,0 +1,24 @@
+#ifndef IR_IR_PRINTER_H
+#define IR_IR_PRINTER_H
+
+#include "ir/IR.hpp"
+
+#include <cstdio>
+
+namespace ir {
+
+// Writes the IR in a human readable form, e.g.
+//
+//   function fib(1) -> value
+//     slots: (none)
+//   bb0:
+//     %0 = param 0
+//     %1 = const 2
+//     %2 = lt %0, %1
+//     branch %2, bb1, bb2
+void printFunction(FILE *p_out_file, const Function &p_function);
+void printModule(FILE *p_out_file, const Module &p_module);
+
+} // namespace ir
+
+#endif
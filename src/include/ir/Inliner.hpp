@@ -0,0 +1,61 @@
+#ifndef IR_INLINER_H
+#define IR_INLINER_H
+
+#include "ir/IR.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <string>
+
+namespace ir {
+
+// Replaces calls with a copy of the callee: the arguments take the place of
+// the parameters, the slots of the callee become slots of the caller named
+// "callee.slot", and each ret jumps to the rest of the calling block, where
+// a phi merges the returned values. A callee is copied if it is at most
+// p_threshold instructions big or called from a single place, unless it
+// calls itself or the caller would grow too big. With a profile, a call
+// made more often than main ran may copy a callee four times as big and a
+// call that never ran is left alone; the copy gets the counts of the
+// callee scaled to those of the call.
+//
+// Functions can only call the ones declared before them or themselves, so
+// going through the module in order inlines into each callee before copying
+// it anywhere.
+class Inliner {
+  private:
+    Module &m_module;
+    const size_t m_threshold;
+    // where each decision is reported, nullptr for nowhere
+    std::FILE *const m_remarks;
+
+    // by function name
+    std::map<std::string, size_t> m_num_call_sites;
+
+    size_t m_num_inlined = 0;
+
+  public:
+    ~Inliner() = default;
+    Inliner(Module &p_module, const size_t p_threshold,
+            std::FILE *const p_remarks = nullptr)
+        : m_module(p_module), m_threshold(p_threshold), m_remarks(p_remarks) {}
+
+    // returns the number of calls inlined
+    size_t run();
+
+    // the instructions p_function costs, leaving out what selects into
+    // nothing
+    static size_t getSize(const Function &p_function);
+
+  private:
+    // whether the call should be replaced, says why on m_remarks
+    bool shouldInline(const Function &p_caller, const Instruction &p_call,
+                      const Function &p_callee, size_t p_caller_size) const;
+    void inlineCall(Function &p_caller, Instruction *p_call,
+                    const Function &p_callee);
+};
+
+} // namespace ir
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef IR_LICM_H
+#define IR_LICM_H
+
+#include "ir/IR.hpp"
+
+#include <cstddef>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ir {
+
+class DominatorTree;
+class Loop;
+class SideEffects;
+
+// Loop-invariant code motion. Gives every loop a preheader, a block that
+// only jumps to the header, and moves the computations whose operands come
+// from outside the loop into it, inner loops first so that a value can
+// travel out of a whole nest. Loads are invariant while the loop stores
+// nothing to their slot or global, or to any array element for a load
+// through an address; calls to pure functions while the loop writes none
+// of what they read.
+//
+// The preheader runs even when the loop body would not, so what might not
+// run is only hoisted if that is harmless: a division by anything but a
+// nonzero constant or a load through an address only if it is bound to run
+// once the loop is entered, a call only to a function that always returns.
+class LICM {
+  private:
+    Function &m_function;
+    const SideEffects &m_side_effects;
+
+    // by value id
+    std::vector<std::vector<const Instruction *>> m_users;
+    // what the loop being processed stores to
+    std::set<const Slot *> m_written_slots;
+    std::set<std::string> m_written_globals;
+    bool m_writes_memory = false; // array elements
+
+    size_t m_num_hoisted = 0;
+
+  public:
+    ~LICM() = default;
+    LICM(Function &p_function, const SideEffects &p_side_effects)
+        : m_function(p_function), m_side_effects(p_side_effects) {}
+
+    // returns the number of instructions hoisted
+    size_t run();
+
+  private:
+    BasicBlock *insertPreheader(const Loop &p_loop);
+    void hoist(const Loop &p_loop, const DominatorTree &p_dom_tree);
+    void collectWrites(const Loop &p_loop);
+    bool isInvariant(const Loop &p_loop, const Instruction &p_instr) const;
+    // whether the loop gets cheaper without p_instr
+    bool isWorthHoisting(const Instruction &p_instr) const;
+    // whether p_instr may run even when it would not have
+    bool isSafeToSpeculate(const Instruction &p_instr) const;
+};
+
+} // namespace ir
+
+#endif
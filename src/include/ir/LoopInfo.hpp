@@ -0,0 +1,73 @@
+#ifndef IR_LOOP_INFO_H
+#define IR_LOOP_INFO_H
+
+#include "ir/IR.hpp"
+
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace ir {
+
+class DominatorTree;
+
+// A natural loop: the header, which dominates the whole loop, and every
+// block that reaches one of the back edges into it without passing it.
+class Loop {
+  private:
+    BasicBlock *m_header;
+    Loop *m_parent = nullptr;
+    std::vector<BasicBlock *> m_blocks; // the header first
+    std::set<const BasicBlock *> m_block_set;
+
+  public:
+    ~Loop() = default;
+    Loop(BasicBlock *p_header) : m_header(p_header) { addBlock(p_header); }
+
+    BasicBlock *getHeader() const { return m_header; }
+    // the innermost loop around this one, nullptr for an outermost loop
+    Loop *getParent() const { return m_parent; }
+    void setParent(Loop *const p_parent) { m_parent = p_parent; }
+    int getDepth() const { return m_parent ? m_parent->getDepth() + 1 : 1; }
+
+    const std::vector<BasicBlock *> &getBlocks() const { return m_blocks; }
+    bool contains(const BasicBlock *p_block) const {
+        return m_block_set.count(p_block) != 0;
+    }
+    bool contains(const Loop *p_loop) const {
+        return contains(p_loop->getHeader());
+    }
+    void addBlock(BasicBlock *p_block);
+
+    // the only block entering the loop if it does nothing but jump to the
+    // header, nullptr if there is none
+    BasicBlock *getPreheader() const;
+    // the blocks in the loop with a back edge to the header
+    std::vector<BasicBlock *> getLatches() const;
+    // the blocks in the loop with a successor outside it
+    std::vector<BasicBlock *> getExitingBlocks() const;
+};
+
+// The natural loops of a function. Loops sharing a header are one loop.
+// Like DominatorTree it only reflects the CFG it was built on, except for
+// blocks added with Loop::addBlock().
+class LoopInfo {
+  private:
+    // inner loops before the loops around them
+    std::vector<std::unique_ptr<Loop>> m_loops;
+
+  public:
+    ~LoopInfo() = default;
+    LoopInfo(const DominatorTree &p_dom_tree);
+
+    const std::vector<std::unique_ptr<Loop>> &getLoops() const {
+        return m_loops;
+    }
+    bool empty() const { return m_loops.empty(); }
+    // the innermost loop containing p_block, nullptr if there is none
+    Loop *getLoopFor(const BasicBlock *p_block) const;
+};
+
+} // namespace ir
+
+#endif
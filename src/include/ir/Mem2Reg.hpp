@@ -0,0 +1,47 @@
+#ifndef IR_MEM2REG_H
+#define IR_MEM2REG_H
+
+#include "ir/IR.hpp"
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace ir {
+
+class DominatorTree;
+
+// Promotes the scalar slots of a function into SSA values (Cytron et al.):
+// phis go to the iterated dominance frontier of the stores, then a walk
+// over the dominator tree replaces each load with the value stored last.
+// Reading a slot before any store yields 0. Phis nothing needs and phis
+// merging a single value are removed again. Arrays stay in their slots.
+class Mem2Reg {
+  private:
+    Function &m_function;
+    std::vector<Slot *> m_promoted;
+    std::vector<int> m_slot_index; // by slot id, -1 if not promoted
+    std::map<const Instruction *, int> m_phi_slots;
+    // by value id, what a removed load reads
+    std::vector<Instruction *> m_replacements;
+    // the 0 read before any store
+    Instruction *m_undef = nullptr;
+
+  public:
+    ~Mem2Reg() = default;
+    Mem2Reg(Function &p_function) : m_function(p_function) {}
+
+    // returns the number of slots promoted
+    size_t run();
+
+  private:
+    void placePhis(const DominatorTree &p_dom_tree);
+    void rename(const DominatorTree &p_dom_tree);
+    bool isUsed(const Instruction *p_value) const;
+    Instruction *resolve(Instruction *p_value) const;
+    void removeUselessPhis();
+};
+
+} // namespace ir
+
+#endif
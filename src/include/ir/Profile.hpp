@@ -0,0 +1,54 @@
+#ifndef IR_PROFILE_H
+#define IR_PROFILE_H
+
+#include "ir/IR.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ir {
+
+// The counters of profile-guided optimization. Every block gets one
+// counting how often it runs, and every block ending in a branch one more
+// counting how often the branch is taken; the counts of the edges follow
+// from these. The counters are numbered through the module in layout order,
+// so instrumenting and reading the profile back have to see the same CFG,
+// which the checksum stands for.
+//
+// The instrumented program keeps the counters in the word array
+// kCounterTable and adds them to the profile file at exit. The file is text:
+// "p-profile", the checksum and the number of counters, then the counts.
+class Profile {
+  public:
+    static const char *const kCounterTable;
+
+  private:
+    struct Counter {
+        BasicBlock *block;
+        bool is_taken; // the branch ending the block, the block otherwise
+    };
+
+    Module &m_module;
+    std::vector<Counter> m_counters;
+    uint32_t m_checksum = 0;
+
+  public:
+    ~Profile() = default;
+    explicit Profile(Module &p_module);
+
+    size_t getNumCounters() const { return m_counters.size(); }
+    uint32_t getChecksum() const { return m_checksum; }
+
+    // adds a count instruction per counter
+    void instrument();
+    // Gives the functions their entry counts and the jumps and branches
+    // their counts from the file at p_path. Returns false, saying why in
+    // p_error, if the file cannot be read or belongs to another CFG.
+    bool annotate(const std::string &p_path, std::string &p_error);
+};
+
+} // namespace ir
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef IR_SCCP_H
+#define IR_SCCP_H
+
+#include "ir/IR.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ir {
+
+// The globals every store of the program stores the same constant to, and
+// main does so in its entry before calling anything: each load reads that
+// constant, except for one in main's entry before the store.
+class ConstantGlobals {
+  private:
+    // the value and the store in main
+    std::map<std::string, std::pair<int32_t, const Instruction *>> m_globals;
+
+  public:
+    ~ConstantGlobals() = default;
+    ConstantGlobals(const Module &p_module);
+
+    // whether p_load reads a known constant, stored in p_value then
+    bool lookup(const Instruction &p_load, int32_t &p_value) const;
+};
+
+// Sparse conditional constant propagation (Wegman and Zadeck): every value
+// starts out unknown and only goes down to a constant and then to
+// overdefined, while the blocks become executable once an executable
+// branch may go there. A phi only merges the values coming in along
+// executable edges, so a constant condition leaves the code it skips out.
+//
+// Afterwards the constant values become consts, the branches on them jumps
+// and the blocks never executed are dropped. A division by zero and the
+// one overflowing are left to run time.
+class SCCP {
+  private:
+    enum class State : uint8_t { kUnknown, kConstant, kOverdefined };
+    struct Lattice {
+        State state = State::kUnknown;
+        int32_t value = 0;
+    };
+
+    Function &m_function;
+    const ConstantGlobals &m_globals;
+
+    // by value id
+    std::vector<Lattice> m_values;
+    std::vector<std::vector<Instruction *>> m_users;
+    // by block id
+    std::vector<bool> m_executable;
+    // (from, to) block ids
+    std::set<std::pair<int, int>> m_executable_edges;
+    std::vector<BasicBlock *> m_block_worklist;
+    std::vector<Instruction *> m_value_worklist;
+
+    size_t m_num_constants = 0;
+    size_t m_num_branches_folded = 0;
+
+  public:
+    ~SCCP() = default;
+    SCCP(Function &p_function, const ConstantGlobals &p_globals)
+        : m_function(p_function), m_globals(p_globals) {}
+
+    void run();
+
+    size_t getNumConstants() const { return m_num_constants; }
+    size_t getNumBranchesFolded() const { return m_num_branches_folded; }
+
+  private:
+    void markEdge(const BasicBlock *p_from, BasicBlock *p_to);
+    bool isEdgeExecutable(const BasicBlock *p_from, const BasicBlock *p_to) const;
+    void visit(Instruction *p_instr);
+    Lattice evaluate(const Instruction &p_instr) const;
+    void update(Instruction *p_instr, const Lattice &p_value);
+    void rewrite();
+};
+
+} // namespace ir
+
+#endif
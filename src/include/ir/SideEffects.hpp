@@ -0,0 +1,46 @@
+#ifndef IR_SIDE_EFFECTS_H
+#define IR_SIDE_EFFECTS_H
+
+#include "ir/IR.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+
+namespace ir {
+
+// What calling a function may do, its callees included.
+struct FunctionEffects {
+    std::set<std::string> reads;  // globals
+    std::set<std::string> writes; // globals
+    // array elements, wherever the address came from
+    bool reads_memory = false;
+    bool writes_memory = false;
+    bool does_io = false;
+    // no loops and no recursion, so a call always returns
+    bool terminates = false;
+
+    // whether a call only computes its value from the arguments and globals
+    bool isPure() const {
+        return !does_io && writes.empty() && !writes_memory;
+    }
+};
+
+// The effects of every function of a module, taking the calls into account.
+// Only reflects the module as it was when constructed.
+class SideEffects {
+  private:
+    std::map<std::string, FunctionEffects> m_effects;
+
+  public:
+    ~SideEffects() = default;
+    SideEffects(const Module &p_module);
+
+    const FunctionEffects &get(const std::string &p_function) const {
+        return m_effects.at(p_function);
+    }
+};
+
+} // namespace ir
+
+#endif
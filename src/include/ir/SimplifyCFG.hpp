@@ -0,0 +1,34 @@
+#ifndef IR_SIMPLIFY_CFG_H
+#define IR_SIMPLIFY_CFG_H
+
+#include "ir/IR.hpp"
+
+#include <cstddef>
+
+namespace ir {
+
+// Cleans up the control flow the other passes leave behind, until nothing
+// changes: drops the unreachable blocks, turns a branch to the same block
+// twice into a jump, sends the jumps to a block that only jumps on to
+// where it goes, and appends each block only a jump leads to to the block
+// of that jump.
+class SimplifyCFG {
+  private:
+    Function &m_function;
+
+  public:
+    ~SimplifyCFG() = default;
+    SimplifyCFG(Function &p_function) : m_function(p_function) {}
+
+    // returns the number of blocks removed
+    size_t run();
+
+  private:
+    bool foldBranches();
+    bool bypassEmptyBlocks();
+    bool mergeStraightLines();
+};
+
+} // namespace ir
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef IR_TAIL_CALLS_H
+#define IR_TAIL_CALLS_H
+
+#include "ir/IR.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace ir {
+
+// Finds the calls whose value the function returns right away, also where
+// only a jump to a ret is in between. A call of
+// the function itself becomes a jump back to the start, where a phi per
+// parameter takes the new arguments, so tail recursion runs in a constant
+// amount of stack. Any other such call with its arguments all in registers
+// is marked as a tail call, which leaves the frame before jumping to the
+// callee. Neither happens in a function with an array in its frame.
+class TailCallElimination {
+  private:
+    Function &m_function;
+    const size_t m_num_arg_regs;
+
+    size_t m_num_recursions_removed = 0;
+    size_t m_num_tail_calls = 0;
+
+  public:
+    ~TailCallElimination() = default;
+    TailCallElimination(Function &p_function, const size_t p_num_arg_regs)
+        : m_function(p_function), m_num_arg_regs(p_num_arg_regs) {}
+
+    void run();
+
+    size_t getNumRecursionsRemoved() const { return m_num_recursions_removed; }
+    size_t getNumTailCalls() const { return m_num_tail_calls; }
+
+  private:
+    // gives the calls that only jump to a ret afterwards a ret of their own
+    void duplicateReturns();
+    // turns the calls into jumps to a loop around the whole body
+    void removeRecursion(const std::vector<Instruction *> &p_calls);
+};
+
+} // namespace ir
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef IR_VERIFIER_H
+#define IR_VERIFIER_H
+
+#include "ir/IR.hpp"
+
+#include <string>
+#include <vector>
+
+namespace ir {
+
+// Checks the invariants the passes rely on: every block ends in its only
+// terminator, targets belong to the function, the entry has no
+// predecessors, phis come first with one value per predecessor, operands
+// have the right count, every value is defined before it is used, vectors
+// only go into vector instructions of their own block, a tail call is
+// followed by the ret returning it and profile counts go one per target.
+class Verifier {
+  private:
+    std::vector<std::string> m_errors;
+
+  public:
+    ~Verifier() = default;
+    Verifier() = default;
+
+    // returns whether p_function passed; the errors add up across calls
+    bool run(const Function &p_function);
+
+    const std::vector<std::string> &getErrors() const { return m_errors; }
+
+  private:
+    void report(const Function &p_function, const BasicBlock *p_block,
+                const std::string &p_message);
+};
+
+} // namespace ir
+
+#endif
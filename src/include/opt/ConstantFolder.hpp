@@ -0,0 +1,51 @@
+#ifndef OPT_CONSTANT_FOLDER_H
+#define OPT_CONSTANT_FOLDER_H
+
+#include "AST/expression.hpp"
+#include "visitor/AstNodeVisitor.hpp"
+
+#include <cstddef>
+#include <memory>
+
+class AstNode;
+
+// Runs between SemanticAnalyzer and CodeGenerator. Folds integer and boolean
+// operators whose operands are constants and drops the operations that an
+// identity makes useless (x + 0, x * 1, not not b, ...). Children are folded
+// before their parent, so whole constant subtrees collapse into one node.
+class ConstantFolder final : public AstNodeVisitor, public ExpressionRewriter {
+  private:
+    size_t m_num_folded = 0;
+
+  public:
+    ~ConstantFolder() = default;
+    ConstantFolder() = default;
+
+    size_t getNumFolded() const { return m_num_folded; }
+
+    void visit(ProgramNode &p_program) override;
+    void visit(DeclNode &p_decl) override;
+    void visit(FunctionNode &p_function) override;
+    void visit(CompoundStatementNode &p_compound_statement) override;
+    void visit(PrintNode &p_print) override;
+    void visit(BinaryOperatorNode &p_bin_op) override;
+    void visit(UnaryOperatorNode &p_un_op) override;
+    void visit(FunctionInvocationNode &p_func_invocation) override;
+    void visit(VariableReferenceNode &p_variable_ref) override;
+    void visit(AssignmentNode &p_assignment) override;
+    void visit(ReadNode &p_read) override;
+    void visit(IfNode &p_if) override;
+    void visit(WhileNode &p_while) override;
+    void visit(ForNode &p_for) override;
+    void visit(ReturnNode &p_return) override;
+
+    void rewrite(std::unique_ptr<ExpressionNode> &p_expr) override;
+
+  private:
+    void foldChildNodes(AstNode &p_node);
+
+    bool foldBinary(std::unique_ptr<ExpressionNode> &p_expr);
+    bool foldUnary(std::unique_ptr<ExpressionNode> &p_expr);
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef VM_BYTECODE_H
+#define VM_BYTECODE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace vm {
+
+// What a register, a global or an element holds. Nothing records which
+// member it is; the instructions using it are typed.
+union Value {
+    int32_t integer; // and a boolean, as 0 or 1
+    float real;
+    const char *string;
+    Value *address; // of an array or a row of one
+};
+
+// The operands are registers of the frame unless they say otherwise; imm is
+// the 32 bits of b and c together, simm the 16 of c alone.
+enum class Opcode : uint8_t {
+    kMove,       // a = b
+    kLoadInt,    // a = imm
+    kLoadConst,  // a = constants[imm]
+    kLoadGlobal, // a = globals[imm]
+    kStoreGlobal,
+    kAddrGlobal, // a = &globals[imm]
+    kAddrLocal,  // a = &frame[imm], an array of the function
+    kIndex,      // a = b + c elements
+    kLoadElem,   // a = b[c]
+    kStoreElem,  // b[c] = a
+
+    // integers, wrapping around, with division as on RV32
+    kAdd,
+    kSub,
+    kMul,
+    kDiv,
+    kMod,
+    kAddImm, // a = b + simm
+    kMulImm, // a = b * simm
+    kNeg,
+    kNot,
+    kEq,
+    kNe,
+    kLt,
+    kLe,
+    kGt,
+    kGe,
+
+    // reals, the comparisons giving an integer
+    kFAdd,
+    kFSub,
+    kFMul,
+    kFDiv,
+    kFNeg,
+    kFEq,
+    kFNe,
+    kFLt,
+    kFLe,
+    kFGt,
+    kFGe,
+    kIntToReal,
+
+    kConcat, // a = b followed by c
+
+    kJump,        // to imm
+    kJumpIfZero,  // to imm if a is 0
+    kJumpIfNonZero,
+    kCall,    // a = functions[b](c, c + 1...)
+    kRet,     // with a
+    kRetVoid,
+
+    kPrintInt,
+    kPrintReal,
+    kPrintString,
+    kReadInt,
+    kReadReal,
+    kReadString,
+
+    kNumOpcodes
+};
+
+const char *getOpcodeName(const Opcode p_opcode);
+
+struct Instruction {
+    Opcode opcode;
+    uint16_t a = 0;
+    uint16_t b = 0;
+    uint16_t c = 0;
+
+    int32_t imm() const {
+        return static_cast<int32_t>(static_cast<uint32_t>(c) << 16 | b);
+    }
+    int16_t simm() const { return static_cast<int16_t>(c); }
+    void setImm(const int32_t p_imm) {
+        b = static_cast<uint32_t>(p_imm) & 0xffff;
+        c = static_cast<uint32_t>(p_imm) >> 16;
+    }
+};
+
+// A frame holds the registers, the parameters first, and after them the
+// arrays of the function.
+struct Function {
+    std::string name;
+    uint16_t num_params = 0;
+    // the types the interpreter doesn't need, a native call does
+    std::vector<bool> real_params;
+    bool returns_real = false;
+    uint16_t num_registers = 0;
+    uint32_t frame_size = 0;
+    // index of the first instruction
+    uint32_t entry = 0;
+};
+
+// The code of all the functions, "main" being the program body; a call
+// names its callee by index into the function table. Reals and strings
+// are loaded from the constant pool.
+struct Program {
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    std::vector<bool> is_string_constant;
+    // the characters of the string constants
+    std::deque<std::string> strings;
+    std::vector<Function> functions;
+    uint32_t num_globals = 0;
+    uint32_t main = 0;
+};
+
+// Writes the functions one instruction a line, e.g.
+//
+//   function fib(1): 6 registers, frame 6
+//         0  load.int r1, 2
+//         1  lt r2, r0, r1
+//         2  jz r2, 5
+void printProgram(FILE *p_out_file, const Program &p_program);
+
+} // namespace vm
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef VM_BYTECODE_GENERATOR_H
+#define VM_BYTECODE_GENERATOR_H
+
+#include "vm/Bytecode.hpp"
+#include "visitor/AstNodeVisitor.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class Constant;
+class ExpressionNode;
+class SymbolEntry;
+class SymbolManager;
+class SymbolTable;
+class VariableReferenceNode;
+
+namespace vm {
+
+// Lowers a checked AST into a Program for the Interpreter, one Function per
+// function plus "main" for the program body. Every local and parameter
+// lives in a register of its own, a global in the globals by index, and an
+// array in the frame or the globals with its elements row by row; one
+// passed in is the address of the caller's. Expressions are computed into
+// temporaries above the locals, or straight into the variable assigned.
+// The operations are typed: an integer meeting a real is converted first,
+// and and/or only evaluate their right operand if it decides the result.
+class BytecodeGenerator final : public AstNodeVisitor {
+  private:
+    const SymbolManager *m_symbol_manager_ptr;
+    Program &m_program;
+
+    std::map<std::string, uint16_t> m_function_index;
+    // which parameters of each function are reals
+    std::map<std::string, std::vector<bool>> m_real_params;
+    std::map<const SymbolEntry *, uint32_t> m_globals;
+    // where in the constant pool each string and real (by its bits) is
+    std::map<std::string, uint32_t> m_string_constants;
+    std::map<uint32_t, uint32_t> m_real_constants;
+
+    // of the function being generated
+    Function *m_function = nullptr;
+    std::map<const SymbolEntry *, uint16_t> m_registers;
+    uint32_t m_num_locals = 0;
+    uint32_t m_next_register = 0;
+    uint32_t m_array_size = 0;
+    // the addr.local to move past the registers once their number is known
+    std::vector<size_t> m_local_addresses;
+
+    // where the expression being visited should leave its value, if
+    // anywhere in particular, and where it did
+    int m_target = -1;
+    uint16_t m_value = 0;
+
+  public:
+    ~BytecodeGenerator() = default;
+    BytecodeGenerator(const SymbolManager *const p_symbol_manager,
+                      Program &p_program)
+        : m_symbol_manager_ptr(p_symbol_manager), m_program(p_program) {}
+
+    void visit(ProgramNode &p_program) override;
+    void visit(ConstantValueNode &p_constant_value) override;
+    void visit(FunctionNode &p_function) override;
+    void visit(CompoundStatementNode &p_compound_statement) override;
+    void visit(PrintNode &p_print) override;
+    void visit(BinaryOperatorNode &p_bin_op) override;
+    void visit(UnaryOperatorNode &p_un_op) override;
+    void visit(FunctionInvocationNode &p_func_invocation) override;
+    void visit(VariableReferenceNode &p_variable_ref) override;
+    void visit(AssignmentNode &p_assignment) override;
+    void visit(ReadNode &p_read) override;
+    void visit(IfNode &p_if) override;
+    void visit(WhileNode &p_while) override;
+    void visit(ForNode &p_for) override;
+    void visit(ReturnNode &p_return) override;
+
+  private:
+    void beginFunction(const std::string &p_name, const uint16_t p_num_params,
+                       const bool p_returns_real);
+    void endFunction();
+
+    size_t emit(const Opcode p_opcode, const uint32_t p_a = 0,
+                const uint32_t p_b = 0, const uint32_t p_c = 0);
+    size_t emitImm(const Opcode p_opcode, const uint32_t p_a,
+                   const int32_t p_imm);
+    // p_dst = p_src op p_imm, with the immediate form if p_imm fits
+    void emitWithImm(const Opcode p_opcode, const Opcode p_imm_opcode,
+                     const uint16_t p_dst, const uint16_t p_src,
+                     const int32_t p_imm);
+    void patch(const std::vector<size_t> &p_jumps, const size_t p_target);
+
+    uint16_t newRegister();
+    // a register kept for the rest of the function
+    uint16_t newLocal();
+    // the register the value is to go to: the target if there is one
+    uint16_t destination();
+
+    // Computes p_expr, into p_target unless it is -1, and returns the
+    // register holding it.
+    uint16_t evaluate(ExpressionNode &p_expr, const int p_target = -1);
+    // the same, converted to a real if p_to_real and p_expr is an integer
+    uint16_t evaluateAs(ExpressionNode &p_expr, const bool p_to_real,
+                        const int p_target = -1);
+    // Emits jumps, added to p_jumps, that are taken if p_cond is p_sense;
+    // otherwise the code goes on.
+    void branch(ExpressionNode &p_cond, const bool p_sense,
+                std::vector<size_t> &p_jumps);
+    void loadConstant(const Constant &p_constant, const uint16_t p_dst);
+
+    void declareGlobals(const SymbolTable *p_table);
+    // registers for the locals of p_table, frame space for their arrays
+    void declareLocals(const SymbolTable *p_table);
+
+    // the address of the array p_entry names
+    uint16_t arrayBase(const SymbolEntry &p_entry);
+    // The address of the array p_ref indexes into and the register with the
+    // index of its element, or its row if some indices are left out.
+    void elementIndex(VariableReferenceNode &p_ref, uint16_t &p_base,
+                      uint16_t &p_index);
+    void assign(VariableReferenceNode &p_ref, const uint16_t p_value);
+};
+
+} // namespace vm
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef VM_HOST_IO_H
+#define VM_HOST_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace vm {
+
+// The read and print statements of a running program, in the formats of
+// the runtime the compiled code links with (io.c): a value a line, reals
+// with "%f". Both directions go through buffers of their own instead of a
+// stdio call per statement; the output is flushed when it fills up, before
+// the input is refilled and at the end.
+class HostIO {
+  private:
+    std::FILE *m_in;
+    std::FILE *m_out;
+    std::vector<char> m_output;
+    std::vector<char> m_input;
+    size_t m_input_pos = 0;
+    bool m_at_eof = false;
+
+  public:
+    HostIO(std::FILE *p_in, std::FILE *p_out);
+    ~HostIO() { flush(); }
+
+    void printInt(const int32_t p_value);
+    void printReal(const float p_value);
+    void printString(const char *p_value);
+
+    // The next whitespace-separated word as scanf would convert it; 0 if
+    // there is none or it isn't a number.
+    int32_t readInt();
+    float readReal();
+    std::string readString();
+
+    void flush();
+
+  private:
+    void write(const char *p_chars, const size_t p_length);
+    // -1 at the end of the input
+    int peek();
+    std::string readWord();
+};
+
+} // namespace vm
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef VM_INTERPRETER_H
+#define VM_INTERPRETER_H
+
+#include "vm/Bytecode.hpp"
+#include "vm/HostIO.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace vm {
+
+// Runs a Program from "main". Every instruction ends by jumping straight to
+// the handler of the next one through a table of label addresses (the
+// computed goto of GCC), so there is no loop around a switch to go back
+// to. The frames are laid out one after the other on a stack of Values
+// and start out zeroed, as do the globals.
+class Interpreter {
+  private:
+    struct CallRecord {
+        const Instruction *return_address;
+        Value *frame;
+        uint32_t frame_size;
+        uint16_t result;
+    };
+
+    const Program &m_program;
+    HostIO &m_io;
+    std::vector<Value> m_stack;
+    std::vector<Value> m_globals;
+    std::vector<CallRecord> m_calls;
+    // the strings concatenated or read
+    std::deque<std::string> m_strings;
+
+  public:
+    ~Interpreter() = default;
+    Interpreter(const Program &p_program, HostIO &p_io);
+
+    // the exit status: 0, or 1 after a runtime error
+    int run();
+};
+
+} // namespace vm
+
+#endif
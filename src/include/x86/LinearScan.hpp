@@ -0,0 +1,154 @@
+#ifndef X86_LINEAR_SCAN_H
+#define X86_LINEAR_SCAN_H
+
+#include "vm/Bytecode.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace x86 {
+
+enum class Reg : uint8_t {
+    kRax,
+    kRcx,
+    kRdx,
+    kRbx,
+    kRsi,
+    kRdi,
+    kR8,
+    kR9,
+    kR10,
+    kR11,
+    kR12,
+    kR13,
+    kR14,
+    kR15,
+    kNone
+};
+
+// the name of the 64, 32 or 8 bits of p_reg
+const char *getRegName(const Reg p_reg, const unsigned p_bits);
+
+// the registers integer arguments are passed in, in order
+constexpr size_t kNumIntArgRegs = 6;
+constexpr size_t kNumRealArgRegs = 8;
+extern const Reg kIntArgRegs[kNumIntArgRegs];
+
+// Where each parameter of a function goes, the System V way.
+struct ArgLocations {
+    // a register of its class, or the stack slot counted from 0
+    std::vector<size_t> slots;
+    std::vector<bool> on_stack;
+    size_t num_stack = 0;
+
+    explicit ArgLocations(const vm::Function &p_function);
+
+    // whether parameter p_param arrives in p_reg
+    bool arrivesIn(const vm::Function &p_function, const uint16_t p_param,
+                   const Reg p_reg) const {
+        return !on_stack[p_param] && !p_function.real_params[p_param] &&
+               kIntArgRegs[slots[p_param]] == p_reg;
+    }
+};
+
+// the registers of p_instr, the arguments of a call included; the one it
+// writes, if any, comes first
+void getRegisterOperands(const vm::Program &p_program,
+                         const vm::Instruction &p_instr,
+                         std::vector<uint16_t> &p_regs);
+// whether p_instr calls a function, of the program or the runtime
+bool isCall(const vm::Instruction &p_instr);
+// whether p_instr writes its register a
+bool writesA(const vm::Instruction &p_instr);
+
+// Puts the registers of a bytecode function in the registers of the
+// machine, the rest staying in frame slots of their own. The temporaries of
+// one statement are reused by the next, so a register is split where it is
+// dead into ranges allocated on their own; ranges joined by a jump it is
+// live across stay together. Those live across a call take the
+// callee-saved rbx and r12 ~ r15, the others r10, r11 and then the
+// argument registers, unless the code written for an instruction in the
+// range overwrites it first. rax, rcx and rdx are left for computing. Code
+// that cannot be reached is left out.
+class LinearScan {
+  private:
+    // a range of instructions relative to the function, and what it is in
+    struct Segment {
+        size_t start;
+        size_t end;
+        size_t group;
+    };
+    struct Interval {
+        size_t group;
+        uint16_t reg;
+        size_t start;
+        size_t end;
+        bool spans_call;
+    };
+
+    const vm::Program &m_program;
+    const vm::Function &m_function;
+    // the code of the function
+    const size_t m_begin;
+    const size_t m_end;
+    // by register, in order
+    std::vector<std::vector<Segment>> m_segments;
+    // by group
+    std::vector<Reg> m_locations;
+    // by instruction
+    std::vector<bool> m_reachable;
+    // by instruction, a bit per register
+    std::vector<std::vector<bool>> m_live_out;
+    std::vector<Reg> m_used_callee_saved;
+    // live on entry but not parameters, so 0 as in the interpreter
+    std::vector<uint16_t> m_uninitialized;
+    // by register, kNoFrameSlot for those always in a register
+    std::vector<uint32_t> m_frame_slots;
+    uint32_t m_num_frame_slots = 0;
+    size_t m_num_spilled = 0;
+
+  public:
+    static constexpr uint32_t kNoFrameSlot = UINT32_MAX;
+
+    ~LinearScan() = default;
+    LinearScan(const vm::Program &p_program, const size_t p_function);
+
+    void run();
+
+    // where p_reg is at instruction p_pc; kNone if in the frame
+    Reg getLocation(const uint16_t p_reg, const size_t p_pc) const;
+    bool isLiveAfter(const uint16_t p_reg, const size_t p_pc) const {
+        return m_live_out[p_pc - m_begin][p_reg];
+    }
+    bool isReachable(const size_t p_pc) const {
+        return m_reachable[p_pc - m_begin];
+    }
+    // the slot p_reg is kept in where it is not in a register
+    uint32_t getFrameSlot(const uint16_t p_reg) const {
+        return m_frame_slots[p_reg];
+    }
+    uint32_t getNumFrameSlots() const { return m_num_frame_slots; }
+    // in the order they are first used
+    const std::vector<Reg> &getUsedCalleeSaved() const {
+        return m_used_callee_saved;
+    }
+    // these have to be zeroed on entry
+    const std::vector<uint16_t> &getUninitialized() const {
+        return m_uninitialized;
+    }
+    size_t getNumSpilled() const { return m_num_spilled; }
+
+  private:
+    void computeReachability();
+    void computeLiveness();
+    std::vector<Interval> buildIntervals();
+    // whether nothing written for the instructions of p_interval overwrites
+    // p_reg while p_interval still needs it
+    bool canHold(const Interval &p_interval, const Reg p_reg) const;
+    void assignFrameSlots();
+};
+
+} // namespace x86
+
+#endif
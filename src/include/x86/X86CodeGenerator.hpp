@@ -0,0 +1,102 @@
+#ifndef X86_X86_CODE_GENERATOR_H
+#define X86_X86_CODE_GENERATOR_H
+
+#include "vm/Bytecode.hpp"
+#include "x86/LinearScan.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace x86 {
+
+// Writes a Program as x86-64 assembly for GNU as, to be linked with the C
+// runtime (test/io_x86_64.c) into a Linux executable. The functions follow
+// the System V ABI: integers, booleans and addresses are passed in rdi,
+// rsi, rdx, rcx, r8 and r9 and returned in eax/rax, reals in xmm0 ~ xmm7
+// and xmm0, and whatever is left over on the stack. Every value takes 8
+// bytes in memory, so an element of an array is at base + 8 * index; the
+// globals are one block in .bss.
+//
+// Each instruction loads what it needs into rax, rcx, rdx, xmm0 and xmm1
+// unless LinearScan put it in a register. Division behaves as on RV32 to
+// give the same results: x / 0 is -1, x mod 0 is x, and INT_MIN / -1 does
+// not trap. A function returning what it gets from calling itself jumps
+// back to the start of its body instead, as tail recursion does on RISC-V,
+// so that it runs in constant stack.
+class X86CodeGenerator {
+  private:
+    const vm::Program &m_program;
+    const bool m_eliminate_tail_calls;
+    std::unique_ptr<FILE, decltype(&fclose)> m_output_file{nullptr, &fclose};
+
+    // of the function being written
+    const LinearScan *m_allocation = nullptr;
+    const vm::Function *m_function = nullptr;
+    size_t m_function_index = 0;
+    // of the instruction being written, which the allocation depends on
+    size_t m_pc = 0;
+    int32_t m_frame_offset = 0;
+    size_t m_num_labels = 0;
+    // by pc
+    std::vector<bool> m_jump_targets;
+
+    size_t m_num_instrs = 0;
+    size_t m_num_spilled = 0;
+
+  public:
+    ~X86CodeGenerator() = default;
+    // writes to the source file name with .s in p_save_path; self tail
+    // calls stay calls unless p_eliminate_tail_calls
+    X86CodeGenerator(const vm::Program &p_program,
+                     const std::string &p_source_file_name,
+                     const std::string &p_save_path,
+                     const bool p_eliminate_tail_calls);
+
+    // false if the file cannot be written
+    bool generate();
+
+    size_t getNumInstrs() const { return m_num_instrs; }
+    size_t getNumSpilled() const { return m_num_spilled; }
+
+  private:
+    void emit(const char *p_format, ...)
+        __attribute__((format(printf, 2, 3)));
+    void emitFunction(const size_t p_index);
+    // true if the next instruction was written along with it
+    bool emitInstruction(const vm::Instruction &p_instr, const size_t p_pc);
+    void emitCall(const vm::Instruction &p_instr);
+    // a call at p_pc of the function itself whose result it returns
+    bool isSelfTailCall(const size_t p_pc) const;
+    void emitSelfTailCall(const vm::Instruction &p_instr);
+    // whether no reachable instruction of the function follows p_pc
+    bool isLastInstruction(const size_t p_pc) const;
+    // p_dst = p_src, through rcx if both are in memory
+    void emitMove(const std::string &p_dst, const std::string &p_src);
+    void emitDivision(const vm::Instruction &p_instr);
+    void emitBinary(const char *p_mnemonic, const vm::Instruction &p_instr);
+    bool emitCompare(const vm::Instruction &p_instr, const size_t p_pc);
+    void emitRealBinary(const char *p_mnemonic,
+                        const vm::Instruction &p_instr);
+    void emitRealCompare(const vm::Instruction &p_instr);
+
+    // where bytecode register p_reg is, as an operand of p_bits
+    std::string home(const uint16_t p_reg, const unsigned p_bits) const;
+    bool inRegister(const uint16_t p_reg) const;
+    // where the interpreter keeps frame[p_index]: a register or an array
+    std::string frameSlot(const uint32_t p_index) const;
+    // p_operand = p_reg and p_reg = p_operand, in p_bits
+    void load(const uint16_t p_reg, const std::string &p_operand,
+              const unsigned p_bits);
+    void store(const std::string &p_operand, const uint16_t p_reg,
+               const unsigned p_bits);
+    void loadReal(const uint16_t p_reg, const char *p_xmm);
+    void storeReal(const char *p_xmm, const uint16_t p_reg);
+};
+
+} // namespace x86
+
+#endif
@@ -6,3 +6,8 @@ void BinaryOperatorNode::visitChildNodes(AstNodeVisitor &p_visitor) {
     visit_ast_node(m_left_operand);
     visit_ast_node(m_right_operand);
 }
+
+void BinaryOperatorNode::rewriteChildExpressions(ExpressionRewriter &p_rewriter) {
+    p_rewriter.rewrite(m_left_operand);
+    p_rewriter.rewrite(m_right_operand);
+}
@@ -7,3 +7,9 @@ void FunctionInvocationNode::visitChildNodes(AstNodeVisitor &p_visitor) {
 
     for_each(m_args.begin(), m_args.end(), visit_ast_node);
 }
+
+void FunctionInvocationNode::rewriteChildExpressions(ExpressionRewriter &p_rewriter) {
+    for (auto &arg : m_args) {
+        p_rewriter.rewrite(arg);
+    }
+}
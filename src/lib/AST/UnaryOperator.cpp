@@ -5,3 +5,7 @@ void UnaryOperatorNode::visitChildNodes(AstNodeVisitor &p_visitor) {
 
     visit_ast_node(m_operand);
 }
+
+void UnaryOperatorNode::rewriteChildExpressions(ExpressionRewriter &p_rewriter) {
+    p_rewriter.rewrite(m_operand);
+}
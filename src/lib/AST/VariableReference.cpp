@@ -7,3 +7,9 @@ void VariableReferenceNode::visitChildNodes(AstNodeVisitor &p_visitor) {
 
     for_each(m_indices.begin(), m_indices.end(), visit_ast_node);
 }
+
+void VariableReferenceNode::rewriteChildExpressions(ExpressionRewriter &p_rewriter) {
+    for (auto &index : m_indices) {
+        p_rewriter.rewrite(index);
+    }
+}
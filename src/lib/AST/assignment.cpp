@@ -4,3 +4,7 @@ void AssignmentNode::visitChildNodes(AstNodeVisitor &p_visitor) {
     m_lvalue->accept(p_visitor);
     m_expr->accept(p_visitor);
 }
+
+void AssignmentNode::rewriteChildExpressions(ExpressionRewriter &p_rewriter) {
+    p_rewriter.rewrite(m_expr);
+}
@@ -26,3 +26,8 @@ const char *Constant::getConstantValueCString() const {
     }
     return m_constant_value_string.c_str();
 }
+
+int32_t Constant::word() const {
+    return m_type->isPrimitiveBool() ? (m_value.boolean ? 1 : 0)
+                                     : static_cast<int32_t>(m_value.integer);
+}
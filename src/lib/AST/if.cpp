@@ -7,3 +7,7 @@ void IfNode::visitChildNodes(AstNodeVisitor &p_visitor) {
         m_else_body->accept(p_visitor);
     }
 }
+
+void IfNode::rewriteChildExpressions(ExpressionRewriter &p_rewriter) {
+    p_rewriter.rewrite(m_condition);
+}
@@ -3,3 +3,7 @@
 void PrintNode::visitChildNodes(AstNodeVisitor &p_visitor) {
     m_target->accept(p_visitor);
 }
+
+void PrintNode::rewriteChildExpressions(ExpressionRewriter &p_rewriter) {
+    p_rewriter.rewrite(m_target);
+}
@@ -3,3 +3,7 @@
 void ReturnNode::visitChildNodes(AstNodeVisitor &p_visitor) {
     m_ret_val->accept(p_visitor);
 }
+
+void ReturnNode::rewriteChildExpressions(ExpressionRewriter &p_rewriter) {
+    p_rewriter.rewrite(m_ret_val);
+}
@@ -4,3 +4,7 @@ void WhileNode::visitChildNodes(AstNodeVisitor &p_visitor) {
     m_condition->accept(p_visitor);
     m_body->accept(p_visitor);
 }
+
+void WhileNode::rewriteChildExpressions(ExpressionRewriter &p_rewriter) {
+    p_rewriter.rewrite(m_condition);
+}
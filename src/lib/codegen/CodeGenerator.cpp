@@ -1,21 +1,47 @@
 #include "codegen/CodeGenerator.hpp"
+#include "codegen/FrameLayout.hpp"
+#include "codegen/InstructionEncoder.hpp"
+#include "codegen/InstructionSelector.hpp"
+#include "codegen/RegisterAllocator.hpp"
+#include "codegen/StrengthReduction.hpp"
+#include "ir/BlockPlacement.hpp"
+#include "ir/DCE.hpp"
+#include "ir/GVN.hpp"
+#include "ir/IRBuilder.hpp"
+#include "ir/IRPrinter.hpp"
+#include "ir/Inliner.hpp"
+#include "ir/LICM.hpp"
+#include "ir/Mem2Reg.hpp"
+#include "ir/Profile.hpp"
+#include "ir/SCCP.hpp"
+#include "ir/SideEffects.hpp"
+#include "ir/SimplifyCFG.hpp"
+#include "ir/TailCalls.hpp"
+#include "ir/Verifier.hpp"
 #include "visitor/AstNodeInclude.hpp"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
+#include <set>
 #include <string>
-#include <iostream>
+#include <vector>
 
 using namespace std;
 
 
 CodeGenerator::CodeGenerator(const std::string source_file_name,
                              const std::string save_path,
-                             const SymbolManager *const p_symbol_manager)
+                             const SymbolManager *const p_symbol_manager,
+                             const CodeGenOptions &p_options)
     : m_symbol_manager_ptr(p_symbol_manager),
-      m_source_file_path(source_file_name) {
+      m_source_file_path(source_file_name), m_options(p_options),
+      m_peephole(p_options.peephole_window),
+      m_scheduler(*lookupMachineModel(p_options.tune),
+                  p_options.schedule_instrs),
+      m_need_labeler(p_symbol_manager) {
     // FIXME: assume that the source file is always xxxx.p
     const std::string &real_path =
         (save_path == "") ? std::string{"."} : save_path;
@@ -27,25 +53,19 @@ CodeGenerator::CodeGenerator(const std::string source_file_name,
     } else {
         slash_pos = 0;
     }
-    std::string output_file_path(
+    const std::string output_path =
         real_path + "/" +
-        source_file_name.substr(slash_pos, dot_pos - slash_pos) + ".S");
-    m_output_file.reset(fopen(output_file_path.c_str(), "w"));
-    assert(m_output_file.get() && "Failed to open output file");
+        source_file_name.substr(slash_pos, dot_pos - slash_pos);
+    if (m_options.emit_assembly) {
+        m_output_file.reset(fopen((output_path + ".S").c_str(), "w"));
+        assert(m_output_file.get() && "Failed to open output file");
+    }
+    if (m_options.emit_object) {
+        m_object.reset(new ELFWriter(source_file_name));
+        m_object_path = output_path + ".o";
+    }
 }
 
-const char* prologue = 
-    "    addi sp, sp, -128\n"
-    "    sw ra, 124(sp)\n"
-    "    sw s0, 120(sp)\n"
-    "    addi s0, sp, 128\n";
-
-const char* epilogue = 
-    "    lw ra, 124(sp)\n"
-    "    lw s0, 120(sp)\n"
-    "    addi sp, sp, 128\n"
-    "    jr ra\n";
-
 const char* argRegs[] = {
         "a0",
         "a1",
@@ -61,9 +81,410 @@ const char* argRegs[] = {
         "t6",
     };
 
-int stkptr = -8;
 int labelId = 0;
 
+// registers Sethi-Ullman mode evaluates expressions in; none of them passes
+// arguments, so moving the arguments in place never overwrites another one
+static const int kSethiUllmanPool[] = {reg::t0, reg::t1, reg::t2};
+static const int kSethiUllmanPoolSize =
+    sizeof(kSethiUllmanPool) / sizeof(kSethiUllmanPool[0]);
+
+static MachineOperand regOp(const int p_reg) {
+    return MachineOperand::createReg(p_reg);
+}
+
+static MachineOperand immOp(const int64_t p_imm) {
+    return MachineOperand::createImm(p_imm);
+}
+
+static MachineOperand memOp(const int p_base, const int64_t p_offset) {
+    return MachineOperand::createMem(p_base, p_offset);
+}
+
+static MachineOperand symOp(const std::string &p_symbol) {
+    return MachineOperand::createSymbol(p_symbol);
+}
+
+static std::string labelName(const int p_id) {
+    return "label" + std::to_string(p_id);
+}
+
+// The branch taken when p_op holds between its operands. RISC-V has only
+// blt and bge, so > and <= compare the operands the other way round.
+static const char *getBranchOpcode(const Operator p_op, bool &p_swap_operands) {
+    p_swap_operands = p_op == Operator::kGreaterOp ||
+                      p_op == Operator::kLessOrEqualOp;
+    switch (p_op) {
+        case Operator::kLessOp:
+        case Operator::kGreaterOp:
+            return "blt";
+        case Operator::kLessOrEqualOp:
+        case Operator::kGreaterOrEqualOp:
+            return "bge";
+        case Operator::kEqualOp:
+            return "beq";
+        case Operator::kNotEqualOp:
+            return "bne";
+        default:
+            return nullptr;
+    }
+}
+
+static Operator negateRelation(const Operator p_op) {
+    switch (p_op) {
+        case Operator::kLessOp:
+            return Operator::kGreaterOrEqualOp;
+        case Operator::kLessOrEqualOp:
+            return Operator::kGreaterOp;
+        case Operator::kGreaterOp:
+            return Operator::kLessOrEqualOp;
+        case Operator::kGreaterOrEqualOp:
+            return Operator::kLessOp;
+        case Operator::kEqualOp:
+            return Operator::kNotEqualOp;
+        case Operator::kNotEqualOp:
+            return Operator::kEqualOp;
+        default:
+            return p_op;
+    }
+}
+
+void CodeGenerator::dumpInstrs(const char* format, ...) {
+    va_list args, args_copy;
+    va_start(args, format);
+    va_copy(args_copy, args);
+    const int length = vsnprintf(nullptr, 0, format, args_copy);
+    va_end(args_copy);
+    std::vector<char> buffer(length + 1);
+    vsnprintf(buffer.data(), buffer.size(), format, args);
+    va_end(args);
+
+    if (!m_function) {
+        // directives outside of any function go straight to the output
+        if (m_output_file) {
+            fputs(buffer.data(), m_output_file.get());
+        }
+        return;
+    }
+
+    const std::string text(buffer.data());
+    size_t begin = 0;
+    while (begin < text.size()) {
+        auto end = text.find('\n', begin);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        const std::string line = text.substr(begin, end - begin);
+        if (line.find_first_not_of(" \t") != std::string::npos) {
+            m_function->append(MachineInstr::parse(line));
+        }
+        begin = end + 1;
+    }
+}
+
+void CodeGenerator::emit(const char *p_opcode,
+                         std::initializer_list<MachineOperand> p_operands) {
+    m_function->append(MachineInstr(p_opcode, p_operands));
+}
+
+int CodeGenerator::evaluate(ExpressionNode &p_expr) {
+    p_expr.accept(*this);
+    return m_value;
+}
+
+void CodeGenerator::branchOnCondition(ExpressionNode &p_cond,
+                                      const bool p_jump_if, const int p_label) {
+    if (auto *const constant = dynamic_cast<ConstantValueNode *>(&p_cond)) {
+        if (constant->getConstantPtr()->boolean() == p_jump_if) {
+            dumpGoto(p_label);
+        }
+        return;
+    }
+    if (auto *const un_op = dynamic_cast<UnaryOperatorNode *>(&p_cond)) {
+        if (un_op->getOp() == Operator::kNotOp) {
+            branchOnCondition(*un_op->getVal(), !p_jump_if, p_label);
+            return;
+        }
+    }
+
+    auto *const bin_op = dynamic_cast<BinaryOperatorNode *>(&p_cond);
+    if (bin_op && (bin_op->getOp() == Operator::kAndOp ||
+                   bin_op->getOp() == Operator::kOrOp)) {
+        // a and b is false as soon as a is, a or b true as soon as a is
+        const bool decisive = bin_op->getOp() == Operator::kOrOp;
+        if (p_jump_if == decisive) {
+            branchOnCondition(*bin_op->getL(), p_jump_if, p_label);
+            branchOnCondition(*bin_op->getR(), p_jump_if, p_label);
+        } else {
+            const int skip_label = labelId++;
+            branchOnCondition(*bin_op->getL(), decisive, skip_label);
+            branchOnCondition(*bin_op->getR(), p_jump_if, p_label);
+            dumpLabel(skip_label);
+        }
+        return;
+    }
+    bool swap_operands = false;
+    const char *opcode =
+        bin_op ? getBranchOpcode(p_jump_if ? bin_op->getOp()
+                                           : negateRelation(bin_op->getOp()),
+                                 swap_operands)
+               : nullptr;
+
+    if (useStackMachine()) {
+        if (!opcode) {
+            p_cond.accept(*this);
+            pop2Reg("t0");
+            dumpInstrs("    %s t0, zero, label%d\n", p_jump_if ? "bne" : "beq",
+                       p_label);
+            return;
+        }
+        bin_op->getL()->accept(*this);
+        bin_op->getR()->accept(*this);
+        pop2Reg("t1");
+        pop2Reg("t0");
+        dumpInstrs("    %s %s, %s, label%d\n", opcode, swap_operands ? "t1" : "t0",
+                   swap_operands ? "t0" : "t1", p_label);
+        return;
+    }
+
+    if (!opcode) {
+        const int value = evaluate(p_cond);
+        emit(p_jump_if ? "bne" : "beq",
+             {regOp(value), regOp(reg::zero), symOp(labelName(p_label))});
+        releaseValue(value);
+        return;
+    }
+    int lhs_value, rhs_value;
+    evaluateOperands(*bin_op->getL(), *bin_op->getR(), lhs_value, rhs_value);
+    emit(opcode, {regOp(swap_operands ? rhs_value : lhs_value),
+                  regOp(swap_operands ? lhs_value : rhs_value),
+                  symOp(labelName(p_label))});
+    releaseValue(lhs_value);
+    releaseValue(rhs_value);
+}
+
+void CodeGenerator::materializeCondition(ExpressionNode &p_cond) {
+    const int false_label = labelId++;
+    const int done_label = labelId++;
+    branchOnCondition(p_cond, false, false_label);
+
+    if (useStackMachine()) {
+        dumpInstrs("    li t0, 1\n");
+        dumpGoto(done_label);
+        dumpLabel(false_label);
+        dumpInstrs("    li t0, 0\n");
+        dumpLabel(done_label);
+        pushReg("t0");
+        return;
+    }
+    // both paths leave the value in the same register
+    m_value = newValue();
+    emit("li", {regOp(m_value), immOp(1)});
+    dumpGoto(done_label);
+    dumpLabel(false_label);
+    emit("li", {regOp(m_value), immOp(0)});
+    dumpLabel(done_label);
+}
+
+void CodeGenerator::evaluateOperands(ExpressionNode &p_lhs,
+                                     ExpressionNode &p_rhs, int &p_lhs_value,
+                                     int &p_rhs_value) {
+    if (!useSethiUllman()) {
+        p_lhs_value = evaluate(p_lhs);
+        p_rhs_value = evaluate(p_rhs);
+        return;
+    }
+
+    const auto lhs_need = m_need_labeler.get(p_lhs);
+    const auto rhs_need = m_need_labeler.get(p_rhs);
+    const bool rhs_first = rhs_need.need > lhs_need.need &&
+                           RegisterNeedLabeler::canReorder(lhs_need, rhs_need);
+    ExpressionNode &first = rhs_first ? p_rhs : p_lhs;
+    ExpressionNode &second = rhs_first ? p_lhs : p_rhs;
+    const int second_need = rhs_first ? lhs_need.need : rhs_need.need;
+
+    int first_value = evaluate(first);
+    int second_value;
+    if (getNumFreeRegs() >= second_need) {
+        second_value = evaluate(second);
+    } else {
+        // the second operand needs the whole pool
+        const int slot = spillValue(first_value);
+        second_value = evaluate(second);
+        first_value = reloadValue(slot);
+    }
+    p_lhs_value = rhs_first ? second_value : first_value;
+    p_rhs_value = rhs_first ? first_value : second_value;
+}
+
+int CodeGenerator::newValue() {
+    if (!useSethiUllman()) {
+        return m_function->createVirtualReg();
+    }
+    for (int i = 0; i < kSethiUllmanPoolSize; ++i) {
+        if (!m_pool_in_use[i]) {
+            m_pool_in_use[i] = true;
+            return kSethiUllmanPool[i];
+        }
+    }
+    assert(false && "register pool exhausted");
+    return kNoReg;
+}
+
+void CodeGenerator::releaseValue(const int p_value) {
+    if (!useSethiUllman()) {
+        return;
+    }
+    for (int i = 0; i < kSethiUllmanPoolSize; ++i) {
+        if (kSethiUllmanPool[i] == p_value) {
+            m_pool_in_use[i] = false;
+        }
+    }
+}
+
+int CodeGenerator::getNumFreeRegs() const {
+    return std::count(m_pool_in_use.begin(), m_pool_in_use.end(), false);
+}
+
+int CodeGenerator::spillValue(const int p_value) {
+    int slot;
+    if (m_free_spill_slots.empty()) {
+        slot = m_function->allocateStackSlot(4);
+    } else {
+        slot = m_free_spill_slots.back();
+        m_free_spill_slots.pop_back();
+    }
+    emit("sw", {regOp(p_value), memOp(reg::s0, slot)});
+    releaseValue(p_value);
+    return slot;
+}
+
+int CodeGenerator::reloadValue(const int p_slot) {
+    const int value = newValue();
+    emit("lw", {regOp(value), memOp(reg::s0, p_slot)});
+    m_free_spill_slots.push_back(p_slot);
+    return value;
+}
+
+void CodeGenerator::saveRegs() {
+    m_saved_pool_regs.clear();
+    for (int i = 0; i < kSethiUllmanPoolSize; ++i) {
+        if (m_pool_in_use[i]) {
+            m_saved_pool_regs.push_back(kSethiUllmanPool[i]);
+            pushReg(kRegisterNames[kSethiUllmanPool[i]]);
+        }
+    }
+}
+
+void CodeGenerator::loadRegs() {
+    for (auto it = m_saved_pool_regs.rbegin(); it != m_saved_pool_regs.rend();
+         ++it) {
+        pop2Reg(kRegisterNames[*it]);
+    }
+    m_saved_pool_regs.clear();
+}
+
+void CodeGenerator::beginFunction(const std::string &p_name,
+                                  const bool p_returns_value) {
+    m_function.reset(new MachineFunction(p_name, p_returns_value));
+    m_return_label = labelId++;
+    m_pool_in_use.assign(kSethiUllmanPoolSize, false);
+    m_free_spill_slots.clear();
+}
+
+void CodeGenerator::layoutFrame(AstNode &p_scope) {
+    FrameLayout layout(m_function->getFrameBottom());
+    p_scope.accept(layout);
+    m_function->reserveStackArea(layout.getLowestOffset());
+}
+
+void CodeGenerator::endFunction() {
+    dumpLabel(m_return_label);
+
+    if (m_options.regalloc == RegAllocKind::kLinearScan) {
+        LinearScanRegisterAllocator allocator(*m_function,
+                                              m_options.compress_instrs);
+        allocator.run();
+    }
+    m_function->insertPrologueEpilogue();
+    m_peephole.run(*m_function);
+    m_scheduler.run(*m_function);
+    m_functions.push_back(std::move(m_function));
+}
+
+void CodeGenerator::emitFunctions() {
+    std::set<std::string> called = {"main"};
+    if (m_options.eliminate_dead_code) {
+        // callees only ever come before their callers
+        for (auto it = m_functions.rbegin(); it != m_functions.rend(); ++it) {
+            if (!called.count((*it)->getName())) {
+                continue;
+            }
+            for (const auto &instr : (*it)->getInstrs()) {
+                if (instr.isCall() || instr.isTailCall()) {
+                    called.insert(instr.getOperands().back().getSymbol());
+                }
+            }
+        }
+    }
+    for (const auto &function : m_functions) {
+        if (m_options.eliminate_dead_code &&
+            !called.count(function->getName())) {
+            ++m_num_dead_functions;
+            continue;
+        }
+        if (m_options.compress_instrs) {
+            m_compressor.run(*function);
+        }
+        if (m_output_file) {
+            dumpFunctionHeader(function->getName());
+            function->print(m_output_file.get());
+        }
+        if (m_object) {
+            InstructionEncoder(*m_object)
+                .encode(*function, function->getName() == "main");
+        }
+    }
+    m_functions.clear();
+}
+
+void CodeGenerator::emitCommon(const std::string &p_name, const size_t p_size) {
+    dumpInstrs(".comm %s, %zu, 4\n", p_name.c_str(), p_size);
+    if (m_object) {
+        using SectionKind = ELFWriter::SectionKind;
+        m_object->align(SectionKind::kBss, 4);
+        m_object->defineSymbol(p_name, SectionKind::kBss,
+                               m_object->getSize(SectionKind::kBss), p_size,
+                               ELFWriter::SymbolKind::kObject, true);
+        m_object->reserve(p_size);
+    }
+}
+
+int CodeGenerator::loadVar(const SymbolEntry &p_entry) {
+    const int value = newValue();
+    if (p_entry.getKind() == SymbolEntry::KindEnum::kConstantKind) {
+        emit("li",
+             {regOp(value), immOp(p_entry.getAttribute().constant()->word())});
+    } else if (p_entry.getLevel() == 0) {
+        emit("la", {regOp(value), symOp(p_entry.getName())});
+        emit("lw", {regOp(value), memOp(value, 0)});
+    } else {
+        emit("lw", {regOp(value), memOp(reg::s0, p_entry.stkLoc)});
+    }
+    return value;
+}
+
+void CodeGenerator::storeVar(const SymbolEntry &p_entry, const int p_value) {
+    if (p_entry.getLevel() == 0) {
+        const int addr = newValue();
+        emit("la", {regOp(addr), symOp(p_entry.getName())});
+        emit("sw", {regOp(p_value), memOp(addr, 0)});
+        releaseValue(addr);
+    } else {
+        emit("sw", {regOp(p_value), memOp(reg::s0, p_entry.stkLoc)});
+    }
+}
+
 void CodeGenerator::pushVarAddr(const VariableReferenceNode &var) {
     auto *entry = m_symbol_manager_ptr -> lookup(var.getName());
     dumpInstrs("// push %s\n", entry -> getName().c_str());
@@ -75,11 +496,6 @@ void CodeGenerator::pushVarAddr(const VariableReferenceNode &var) {
 	pushReg("t0");
 }
 
-void CodeGenerator::pushVar(SymbolEntry& symbol, int size) {
-    stkptr -= size;
-    symbol.stkLoc = stkptr;
-}
-
 void CodeGenerator::pushReg(const char* reg) {
     dumpInstrs("// push %s\n", reg);
     dumpInstrs("    addi sp, sp, -4\n");
@@ -105,20 +521,9 @@ void CodeGenerator::initLocal(const SymbolTable *table) {
 
     int cnt = 0;
 
+    // the slots come from layoutFrame()
     for (const auto &ptr : table -> getEntries()) {
-        auto type = ptr -> getTypePtr();
-        int space;
-
-        // if (type -> isPrimitiveInteger() || type -> isPrimitiveBool()) 
-            space = 4;
-        
-        pushVar(*ptr, space);	
-        
-        if(ptr -> getKind() == SymbolEntry::KindEnum::kConstantKind) {
-            dumpInstrs("// local constant\n");
-            dumpInstrs("    li t0, %d\n", ptr -> getAttribute().constant() -> integer());
-            dumpInstrs("    sw t0, %d(s0)\n", ptr -> stkLoc);
-        } else if(ptr -> getKind() == SymbolEntry::KindEnum::kParameterKind) {
+        if(ptr -> getKind() == SymbolEntry::KindEnum::kParameterKind) {
             dumpInstrs("// passing parameters\n");
             dumpInstrs("    sw %s, %d(s0)\n", argRegs[cnt++], ptr -> stkLoc);
         }
@@ -131,16 +536,16 @@ void CodeGenerator::visit(ProgramNode &p_program) {
     const char* riscv_assembly_file_prologue =
         "    .file \"%s\"\n"
         "    .option nopic\n";
-
-	const char* mainPrologue = 
-        ".section    .text\n"
-        "    .align 2\n"
-        "    .globl main\n"
-        "    .type main, @function\n"
-        "main:\n";
     // clang-format on
     dumpInstructions(m_output_file.get(), riscv_assembly_file_prologue,
                      m_source_file_path.c_str());
+    if (m_options.compress_instrs) {
+        // the c. mnemonics assemble whatever -march says
+        dumpInstructions(m_output_file.get(), "    .option rvc\n");
+    }
+    if (m_options.vectorize_loops && useIR()) {
+        dumpInstructions(m_output_file.get(), "    .option arch, +v\n");
+    }
 
     // Reconstruct the hash table for looking up the symbol entry
     // Hint: Use symbol_manager->lookup(symbol_name) to get the symbol entry.
@@ -151,37 +556,277 @@ void CodeGenerator::visit(ProgramNode &p_program) {
 
     for (const auto &ptr : p_program.getSymbolTable() -> getEntries()) {
 		const auto &symbol = *ptr;
+        // constants are used as immediates; sema rejects reading into one,
+        // so nothing ever needs their address
         if(ptr -> getKind() == SymbolEntry::KindEnum::kVariableKind)
-			dumpInstrs(".comm %s, 4, 4\n", symbol.getName().c_str());
-        else if(ptr -> getKind() == SymbolEntry::KindEnum::kConstantKind){
-			const Constant &cnst = *symbol.getAttribute().constant();
-			dumpInstrs(".section    .rodata\n"
-					   "    .align 2\n"
-					   "    .globl %s\n"
-					   "    .type %s, @object\n"
-                       "%s:\n"
-                       "    .word %d\n", 
-						ptr -> getName().c_str(), 
-						ptr -> getName().c_str(), 
-						ptr -> getName().c_str(), cnst.integer());
-		}
-    }
-
-    for_each(p_program.getDeclNodes().begin(), p_program.getDeclNodes().end(),
-             visit_ast_node);
-    for_each(p_program.getFuncNodes().begin(), p_program.getFuncNodes().end(),
-             visit_ast_node);
-
-    dumpInstructions(m_output_file.get(), mainPrologue);    
-	dumpInstructions(m_output_file.get(), prologue);
-    const_cast<CompoundStatementNode &>(p_program.getBody()).accept(*this);
-    dumpInstructions(m_output_file.get(), epilogue);
+			emitCommon(symbol.getName(),
+                       FrameLayout::getSlotSize(*symbol.getTypePtr()));
+    }
 
+    if (useIR()) {
+        generateFromIR(p_program);
+    } else {
+        for_each(p_program.getDeclNodes().begin(),
+                 p_program.getDeclNodes().end(), visit_ast_node);
+        for_each(p_program.getFuncNodes().begin(),
+                 p_program.getFuncNodes().end(), visit_ast_node);
+
+        beginFunction("main", false);
+        layoutFrame(const_cast<CompoundStatementNode &>(p_program.getBody()));
+        const_cast<CompoundStatementNode &>(p_program.getBody()).accept(*this);
+        endFunction();
+    }
+    emitFunctions();
+    if (!m_options.profile_generate.empty()) {
+        emitProfileWriter();
+    }
+    if (m_object && !m_object->write(m_object_path)) {
+        fprintf(stderr, "error: cannot write %s\n", m_object_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    if (m_options.print_stats) {
+        if (useIR()) {
+            if (m_options.vectorize_loops) {
+                fprintf(stderr, "vectorize: %zu loops vectorized\n",
+                        m_num_vectorized);
+            }
+            fprintf(stderr, "mem2reg: %zu slots promoted\n", m_num_promoted);
+            fprintf(stderr, "inliner: %zu calls inlined\n", m_num_inlined);
+            fprintf(stderr,
+                    "sccp: %zu values made constant, %zu branches folded, %zu "
+                    "blocks removed\n",
+                    m_num_constants, m_num_branches_folded, m_num_blocks_removed);
+            fprintf(stderr,
+                    "tail calls: %zu recursions turned into loops, %zu calls "
+                    "reusing the frame\n",
+                    m_num_recursions_removed, m_num_tail_calls);
+            fprintf(stderr, "gvn: %zu redundant instructions removed\n",
+                    m_num_redundant);
+            fprintf(stderr, "licm: %zu instructions hoisted\n", m_num_hoisted);
+            fprintf(stderr, "dce: %zu instructions removed\n", m_num_dead);
+            if (!m_options.profile_generate.empty()) {
+                fprintf(stderr, "profile: %zu counters\n", m_num_counters);
+            }
+            if (!m_options.profile_use.empty()) {
+                fprintf(stderr,
+                        "block placement: %zu blocks moved, %zu of them cold\n",
+                        m_num_blocks_moved, m_num_cold_blocks);
+            }
+        }
+        fprintf(stderr, "strength reduction: %zu operations rewritten\n",
+                m_num_strength_reduced);
+        fprintf(stderr, "dead functions: %zu stripped\n", m_num_dead_functions);
+        m_peephole.printStats(stderr);
+        m_scheduler.printStats(stderr);
+        if (m_options.compress_instrs) {
+            m_compressor.printStats(stderr);
+        }
+        if (m_object) {
+            fprintf(stderr, "object: %zu bytes of code, %zu relocations\n",
+                    m_object->getSize(ELFWriter::SectionKind::kText),
+                    m_object->getNumRelocations());
+        }
+    }
 
     // Remove the entries in the hash table
     m_symbol_manager_ptr->removeSymbolsFromHashTable(p_program.getSymbolTable());
 }
 
+void CodeGenerator::generateFromIR(ProgramNode &p_program) {
+    ir::Module module;
+    ir::IRBuilder builder(m_symbol_manager_ptr, module, m_options.unroll_factor,
+                          m_options.max_full_unroll, m_options.vectorize_loops);
+    p_program.accept(builder);
+    m_num_vectorized += builder.getNumVectorized();
+
+    for (auto &function : module.getFunctions()) {
+        m_num_promoted += ir::Mem2Reg(*function).run();
+    }
+    // the counters go in before anything depends on the profile, which
+    // is read back where they went in
+    bool has_profile = false;
+    if (!m_options.profile_generate.empty()) {
+        ir::Profile profile(module);
+        profile.instrument();
+        m_num_counters = profile.getNumCounters();
+        m_profile_checksum = profile.getChecksum();
+    } else if (!m_options.profile_use.empty()) {
+        std::string error;
+        has_profile =
+            ir::Profile(module).annotate(m_options.profile_use, error);
+        if (!has_profile) {
+            fprintf(stderr, "warning: %s; compiling without the profile\n",
+                    error.c_str());
+        }
+    }
+    if (m_options.inline_threshold > 0) {
+        m_num_inlined += ir::Inliner(module, m_options.inline_threshold,
+                                     m_options.opt_remarks ? stderr : nullptr)
+                             .run();
+    }
+    if (m_options.propagate_constants) {
+        const ir::ConstantGlobals constant_globals(module);
+        for (auto &function : module.getFunctions()) {
+            ir::SCCP sccp(*function, constant_globals);
+            sccp.run();
+            m_num_constants += sccp.getNumConstants();
+            m_num_branches_folded += sccp.getNumBranchesFolded();
+            m_num_blocks_removed += ir::SimplifyCFG(*function).run();
+        }
+    }
+    for (auto &function : module.getFunctions()) {
+        if (m_options.eliminate_tail_calls) {
+            ir::TailCallElimination tail_calls(
+                *function, InstructionSelector::getNumArgRegs());
+            tail_calls.run();
+            m_num_recursions_removed += tail_calls.getNumRecursionsRemoved();
+            m_num_tail_calls += tail_calls.getNumTailCalls();
+        }
+    }
+    const ir::SideEffects side_effects(module);
+    if (m_options.number_values) {
+        const ir::ConstantGlobals constant_globals(module);
+        for (auto &function : module.getFunctions()) {
+            const size_t num_redundant =
+                ir::GVN(*function, side_effects).run();
+            m_num_redundant += num_redundant;
+            // a load may have become the constant stored before it, so
+            // fold what is computed from it now
+            if (num_redundant > 0 && m_options.propagate_constants) {
+                ir::SCCP sccp(*function, constant_globals);
+                sccp.run();
+                m_num_constants += sccp.getNumConstants();
+                m_num_branches_folded += sccp.getNumBranchesFolded();
+                m_num_blocks_removed += ir::SimplifyCFG(*function).run();
+            }
+        }
+    }
+    if (m_options.hoist_invariants) {
+        for (auto &function : module.getFunctions()) {
+            m_num_hoisted += ir::LICM(*function, side_effects).run();
+        }
+    }
+    if (m_options.eliminate_dead_code) {
+        for (auto &function : module.getFunctions()) {
+            m_num_dead +=
+                ir::DeadCodeElimination(*function, side_effects).run();
+        }
+    }
+    if (has_profile) {
+        for (auto &function : module.getFunctions()) {
+            ir::BlockPlacement placement(*function);
+            placement.run();
+            m_num_blocks_moved += placement.getNumMoved();
+            m_num_cold_blocks += placement.getNumCold();
+        }
+    }
+    ir::Verifier verifier;
+    for (auto &function : module.getFunctions()) {
+        verifier.run(*function);
+    }
+    if (!verifier.getErrors().empty()) {
+        for (const auto &error : verifier.getErrors()) {
+            fprintf(stderr, "internal error: invalid IR: %s\n", error.c_str());
+        }
+        exit(EXIT_FAILURE);
+    }
+    if (m_options.dump_ir) {
+        ir::printModule(stdout, module);
+    }
+
+    for (auto &function : module.getFunctions()) {
+        beginFunction(function->getName(), function->returnsValue());
+        InstructionSelector selector(*function, *m_function, m_return_label,
+                                     labelId);
+        selector.run();
+        m_num_strength_reduced += selector.getNumStrengthReduced();
+        endFunction();
+    }
+}
+
+void CodeGenerator::emitProfileWriter() {
+    static const char *const kPathName = "__p_profile_path";
+    static const char *const kExitName = "__p_profile_exit";
+    MachineFunction writer(kExitName, false);
+    auto append = [&](const char *p_opcode,
+                      const MachineInstr::Operands &p_operands) {
+        writer.append(MachineInstr(p_opcode, p_operands));
+    };
+    append("la", {regOp(reg::a0), symOp(kPathName)});
+    append("li",
+           {regOp(reg::a1), immOp(static_cast<int32_t>(m_profile_checksum))});
+    append("la", {regOp(reg::a2), symOp(ir::Profile::kCounterTable)});
+    append("li", {regOp(reg::a3), immOp(m_num_counters)});
+    writer.append(MachineInstr::createTailCall("__p_profile_write", {}));
+
+    emitCommon(ir::Profile::kCounterTable, m_num_counters * 4);
+    std::string path;
+    for (const char c : m_options.profile_generate) {
+        if (c == '"' || c == '\\') {
+            path += '\\';
+        }
+        path += c;
+    }
+    // clang-format off
+    dumpInstructions(m_output_file.get(),
+        ".section    .rodata\n"
+        "    .align 2\n"
+        "%s:\n"
+        "    .string \"%s\"\n"
+        ".section    .text\n"
+        "    .align 2\n"
+        "    .type %s, @function\n"
+        "%s:\n",
+        kPathName, path.c_str(), kExitName, kExitName);
+    // clang-format on
+    if (m_output_file) {
+        writer.print(m_output_file.get());
+    }
+    dumpInstructions(m_output_file.get(), ".section    .fini_array, \"aw\"\n"
+                                          "    .align 2\n"
+                                          "    .word %s\n",
+                     kExitName);
+
+    if (m_object) {
+        using SectionKind = ELFWriter::SectionKind;
+        std::vector<uint8_t> &rodata = m_object->getBytes(SectionKind::kRodata);
+        m_object->align(SectionKind::kRodata, 4);
+        m_object->defineSymbol(kPathName, SectionKind::kRodata, rodata.size(),
+                               m_options.profile_generate.size() + 1,
+                               ELFWriter::SymbolKind::kObject, false);
+        rodata.insert(rodata.end(), m_options.profile_generate.begin(),
+                      m_options.profile_generate.end());
+        rodata.push_back('\0');
+        InstructionEncoder(*m_object).encode(writer, false);
+        m_object->addRelocation(
+            SectionKind::kFiniArray,
+            {static_cast<uint32_t>(m_object->getSize(SectionKind::kFiniArray)),
+             reloc::kAbs32, kExitName, 0});
+        m_object->getBytes(SectionKind::kFiniArray).resize(
+            m_object->getSize(SectionKind::kFiniArray) + 4, 0);
+    }
+}
+
+void CodeGenerator::dumpFunctionHeader(const std::string &p_name) {
+    // clang-format off
+	const char* mainPrologue =
+        ".section    .text\n"
+        "    .align 2\n"
+        "    .globl main\n"
+        "    .type main, @function\n"
+        "main:\n";
+    // clang-format on
+    if (p_name == "main") {
+        dumpInstructions(m_output_file.get(), mainPrologue);
+        return;
+    }
+	dumpInstrs(".section    .text\n");
+	dumpInstrs("    .align 2\n");
+	dumpInstrs("    .type %s, @function\n", p_name.c_str());
+	dumpInstrs("%s:\n", p_name.c_str());
+}
+
 void CodeGenerator::visit(DeclNode &p_decl) {
     p_decl.visitChildNodes(*this);
 }
@@ -193,9 +838,22 @@ void CodeGenerator::visit(ConstantValueNode &p_constant_value) {
     auto type = p_constant_value.getTypePtr();
     auto cnst = p_constant_value.getConstantPtr();
 
-    if(type -> isPrimitiveInteger()) {
-        dumpInstrs("    li t0, %s\n", p_constant_value.getConstantValueCString());
-        pushReg("t0");
+    if (useStackMachine()) {
+        if(type -> isPrimitiveInteger()) {
+            dumpInstrs("    li t0, %s\n", p_constant_value.getConstantValueCString());
+            pushReg("t0");
+        } else if(type -> isPrimitiveBool()) {
+            dumpInstrs("    li t0, %d\n", cnst -> boolean() ? 1 : 0);
+            pushReg("t0");
+        }
+        return;
+    }
+
+    m_value = newValue();
+    if(type -> isPrimitiveBool()) {
+        emit("li", {regOp(m_value), immOp(cnst -> boolean() ? 1 : 0)});
+    } else {
+        emit("li", {regOp(m_value), immOp(cnst -> integer())});
     }
 }
 
@@ -204,16 +862,12 @@ void CodeGenerator::visit(FunctionNode &p_function) {
     m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
         p_function.getSymbolTable());
 
-	dumpInstrs(".section    .text\n");
-	dumpInstrs("    .align 2\n");
-	dumpInstrs("    .type %s, @function\n", p_function.getName().c_str());
-	dumpInstrs("%s:\n", p_function.getName().c_str());
-    
-    dumpInstructions(m_output_file.get(), prologue);
-    stkptr = -8;
+    beginFunction(p_function.getName(),
+                  !p_function.getTypePtr() -> isVoid());
+    layoutFrame(p_function);
     initLocal(p_function.getSymbolTable());
     p_function.visitChildNodes(*this);
-    dumpInstructions(m_output_file.get(), epilogue);
+    endFunction();
 
     // Remove the entries in the hash table
     m_symbol_manager_ptr->removeSymbolsFromHashTable(p_function.getSymbolTable());
@@ -228,7 +882,25 @@ void CodeGenerator::visit(CompoundStatementNode &p_compound_statement) {
 	if(p_compound_statement.getSymbolTable() != NULL)
         initLocal(p_compound_statement.getSymbolTable());
 
-    p_compound_statement.visitChildNodes(*this);
+    for (const auto &decl : p_compound_statement.getDeclNodes()) {
+        decl->accept(*this);
+    }
+    for (const auto &stmt : p_compound_statement.getStmtNodes()) {
+        stmt->accept(*this);
+        // nothing after a return runs
+        if (m_options.eliminate_dead_code &&
+            dynamic_cast<ReturnNode *>(stmt.get())) {
+            break;
+        }
+        // the result of a procedure call statement goes unused
+        if (dynamic_cast<FunctionInvocationNode *>(stmt.get())) {
+            if (useStackMachine()) {
+                dumpInstrs("    addi sp, sp, 4\n");
+            } else {
+                releaseValue(m_value);
+            }
+        }
+    }
 
     // Remove the entries in the hash table
     m_symbol_manager_ptr->removeSymbolsFromHashTable(
@@ -237,176 +909,343 @@ void CodeGenerator::visit(CompoundStatementNode &p_compound_statement) {
 
 void CodeGenerator::visit(PrintNode &p_print) {
     dumpInstrs("// print\n");
-    p_print.visitChildNodes(*this);
-    pop2Reg("a0");
-    // dumpInstrs("    lw a0, 0(t0)\n");
-    dumpInstrs("    jal ra, printInt\n");
+    if (useStackMachine()) {
+        p_print.visitChildNodes(*this);
+        pop2Reg("a0");
+        dumpInstrs("    jal ra, printInt\n");
+        return;
+    }
+
+    const int value =
+        evaluate(const_cast<ExpressionNode &>(p_print.getTarget()));
+    emit("mv", {regOp(reg::a0), regOp(value)});
+    releaseValue(value);
+    saveRegs();
+    m_function->append(MachineInstr::createCall("printInt", {reg::a0}));
+    loadRegs();
+}
+
+static const ConstantValueNode *asIntegerConstant(const ExpressionNode *p_expr) {
+    const auto *constant = dynamic_cast<const ConstantValueNode *>(p_expr);
+    return constant && constant->getTypePtr()->isInteger() ? constant : nullptr;
+}
+
+bool CodeGenerator::reduceStrength(BinaryOperatorNode &p_bin_op) {
+    const Operator op = p_bin_op.getOp();
+    if (op != Operator::kMultiplyOp && op != Operator::kDivideOp &&
+        op != Operator::kModOp) {
+        return false;
+    }
+    ExpressionNode *operand = p_bin_op.getL();
+    const ConstantValueNode *constant = asIntegerConstant(p_bin_op.getR());
+    if (!constant && op == Operator::kMultiplyOp) {
+        operand = p_bin_op.getR();
+        constant = asIntegerConstant(p_bin_op.getL());
+    }
+    if (!constant) {
+        return false;
+    }
+    const auto value =
+        static_cast<int32_t>(constant->getConstantPtr()->integer());
+
+    int num_temps = 0;
+    if (op == Operator::kMultiplyOp ? !isCheapMultiplier(value)
+                                    : !isReducibleDivisor(value, num_temps)) {
+        return false;
+    }
+    // the pool has to hold the operand, the result and the temporaries
+    if (useSethiUllman() && getNumFreeRegs() < 2 + num_temps) {
+        return false;
+    }
+
+    const int src = evaluate(*operand);
+    const int dst = newValue();
+    const int temp = num_temps > 0 ? newValue() : kNoReg;
+    switch (op) {
+        case Operator::kMultiplyOp:
+            emitMultiplyByConstant(*m_function, dst, src, value);
+            break;
+        case Operator::kDivideOp:
+            emitDivideByConstant(*m_function, dst, src, value, temp);
+            break;
+        case Operator::kModOp:
+            emitModuloByConstant(*m_function, dst, src, value, temp);
+            break;
+        default:
+            break;
+    }
+    releaseValue(src);
+    if (temp != kNoReg) {
+        releaseValue(temp);
+    }
+    m_value = dst;
+    ++m_num_strength_reduced;
+    return true;
 }
 
 void CodeGenerator::visit(BinaryOperatorNode &p_bin_op) {
+    if (p_bin_op.getOp() == Operator::kAndOp ||
+        p_bin_op.getOp() == Operator::kOrOp) {
+        materializeCondition(p_bin_op);
+        return;
+    }
+    if (!useStackMachine() && reduceStrength(p_bin_op)) {
+        return;
+    }
 
-    p_bin_op.getL() -> accept(*this);
-    p_bin_op.getR() -> accept(*this);
+    // operand registers as text; the stack machine works on t0 and t1
+    const char *dst = "t0";
+    const char *lhs = "t0";
+    const char *rhs = "t1";
+    std::string dst_name, lhs_name, rhs_name;
+    int rhs_value = kNoReg;
 
-    pop2Reg("t1");
-    pop2Reg("t0");
-        
-    dumpInstrs("// t0 = t0 {OPR} t1\n");
+    if (useStackMachine()) {
+        p_bin_op.getL() -> accept(*this);
+        p_bin_op.getR() -> accept(*this);
+
+        pop2Reg("t1");
+        pop2Reg("t0");
+
+        dumpInstrs("// t0 = t0 {OPR} t1\n");
+    } else {
+        int lhs_value;
+        evaluateOperands(*p_bin_op.getL(), *p_bin_op.getR(), lhs_value,
+                         rhs_value);
+        // the pool register of the left operand takes the result
+        m_value = useSethiUllman() ? lhs_value : newValue();
+        dst_name = getRegisterName(m_value);
+        lhs_name = getRegisterName(lhs_value);
+        rhs_name = getRegisterName(rhs_value);
+        dst = dst_name.c_str();
+        lhs = lhs_name.c_str();
+        rhs = rhs_name.c_str();
+    }
 
 	switch (p_bin_op.getOp()) {
         case Operator::kPlusOp:
-            dumpInstrs("    add t0, t0, t1\n");
+            dumpInstrs("    add %s, %s, %s\n", dst, lhs, rhs);
             break;
         case Operator::kMultiplyOp:
-            dumpInstrs("    mul t0, t0, t1\n");
+            dumpInstrs("    mul %s, %s, %s\n", dst, lhs, rhs);
             break;
         case Operator::kMinusOp:
-            dumpInstrs("    sub t0, t0, t1\n");
+            dumpInstrs("    sub %s, %s, %s\n", dst, lhs, rhs);
             break;
         case Operator::kDivideOp:
-            dumpInstrs("    div t0, t0, t1\n");
+            dumpInstrs("    div %s, %s, %s\n", dst, lhs, rhs);
             break;
         case Operator::kModOp:
-            dumpInstrs("    rem t0, t0, t1\n");
-            break;
-        case Operator::kAndOp:
-            dumpInstrs("    and t0, t0, t1\n");
-            break;
-        case Operator::kOrOp:
-            dumpInstrs("    or t0, t0, t1\n");
+            dumpInstrs("    rem %s, %s, %s\n", dst, lhs, rhs);
             break;
+        // compare directly; the sign of lhs - rhs is wrong once it overflows
         case Operator::kEqualOp:
-            dumpInstrs("    sub t0, t0, t1\n");
-            dumpInstrs("    seqz t0, t0\n");
+            dumpInstrs("    xor %s, %s, %s\n", dst, lhs, rhs);
+            dumpInstrs("    seqz %s, %s\n", dst, dst);
             break;
         case Operator::kNotEqualOp:
-            dumpInstrs("    sub t0, t0, t1\n");
-            dumpInstrs("    snez t0, t0\n");
+            dumpInstrs("    xor %s, %s, %s\n", dst, lhs, rhs);
+            dumpInstrs("    snez %s, %s\n", dst, dst);
             break;
         case Operator::kLessOp:
-            dumpInstrs("    sub t0, t0, t1\n");
-            dumpInstrs("    sltz t0, t0\n");
+            dumpInstrs("    slt %s, %s, %s\n", dst, lhs, rhs);
             break;
         case Operator::kGreaterOp:
-            dumpInstrs("    sub t0, t0, t1\n");
-            dumpInstrs("    sgtz t0, t0\n");
+            dumpInstrs("    slt %s, %s, %s\n", dst, rhs, lhs);
             break;
         case Operator::kLessOrEqualOp:
-            dumpInstrs("    sub t0, t0, t1\n");
-            dumpInstrs("    mv t1, t0\n");
-            dumpInstrs("    sltz t0, t0\n");
-            dumpInstrs("    seqz t1, t1\n");
-            dumpInstrs("    or t0, t0, t1\n");
+            dumpInstrs("    slt %s, %s, %s\n", dst, rhs, lhs);
+            dumpInstrs("    xori %s, %s, 1\n", dst, dst);
             break;
         case Operator::kGreaterOrEqualOp:
-            dumpInstrs("    sub t0, t0, t1\n");
-            dumpInstrs("    mv t1, t0\n");
-            dumpInstrs("    sgtz t0, t0\n");
-            dumpInstrs("    seqz t1, t1\n");
-            dumpInstrs("    or t0, t0, t1\n");
+            dumpInstrs("    slt %s, %s, %s\n", dst, lhs, rhs);
+            dumpInstrs("    xori %s, %s, 1\n", dst, dst);
             break;
+        default:
+            break;
+    }
+    if (useStackMachine()) {
+        pushReg("t0");
+    } else {
+        releaseValue(rhs_value);
     }
-    pushReg("t0");
 }
 
 void CodeGenerator::visit(UnaryOperatorNode &p_un_op) {
-    p_un_op.getVal() -> accept(*this);
-    pop2Reg("t0");
+    if (useStackMachine()) {
+        p_un_op.getVal() -> accept(*this);
+        pop2Reg("t0");
+
+        switch (p_un_op.getOp()) {
+            case Operator::kNegOp:
+                dumpInstrs("    neg t0, t0\n");
+                break;
+            case Operator::kNotOp:
+                dumpInstrs("    xori t0, t0, 1\n");
+                break;
+            default:
+                break;
+        }
+        pushReg("t0");
+        return;
+    }
 
+    const int operand = evaluate(*p_un_op.getVal());
+    m_value = useSethiUllman() ? operand : newValue();
     switch (p_un_op.getOp()) {
         case Operator::kNegOp:
-            dumpInstrs("    li  t1, -1\n");
-            dumpInstrs("    mul t0, t0, t1\n");
+            emit("neg", {regOp(m_value), regOp(operand)});
             break;
         case Operator::kNotOp:
-            dumpInstrs("    li   t0, 1\n");
-            dumpInstrs("    addi t0, t0, -1\n");
+            emit("xori", {regOp(m_value), regOp(operand), immOp(1)});
+            break;
+        default:
             break;
     }
-    pushReg("t0");
 }
 
 void CodeGenerator::visit(FunctionInvocationNode &p_func_invocation) {
     auto &args = p_func_invocation.getArguments();
-    for (int i = 0; i < args.size(); i++) {
-        dumpInstrs("//// %dth arg\n", i);
-        auto &arg = *args[i];
-        arg.accept(*this);
+    if (useStackMachine()) {
+        for (int i = 0; i < args.size(); i++) {
+            dumpInstrs("//// %dth arg\n", i);
+            auto &arg = *args[i];
+            arg.accept(*this);
+        }
+        for(int i = args.size() - 1; i >= 0; i--)
+            pop2Reg(argRegs[i]);
+        dumpInstrs("// Calling %s\n", p_func_invocation.getNameCString());
+        dumpInstrs("    jal ra, %s\n", p_func_invocation.getNameCString());
+        pushReg("a0");
+        return;
+    }
+
+    // evaluate every argument before any argument register is written, since
+    // nested calls clobber them
+    std::vector<int> values;
+    // spill slots of the arguments that had to leave the pool
+    std::vector<int> slots;
+    for (auto &arg : args) {
+        if (useSethiUllman()) {
+            const int need = std::min(m_need_labeler.get(*arg).need,
+                                      kSethiUllmanPoolSize);
+            for (size_t i = 0; i < values.size() && getNumFreeRegs() < need;
+                 ++i) {
+                if (slots[i] == kNoReg) {
+                    slots[i] = spillValue(values[i]);
+                }
+            }
+        }
+        values.push_back(evaluate(*arg));
+        slots.push_back(kNoReg);
+    }
+    MachineInstr::Regs arg_regs;
+    for (size_t i = 0; i < values.size(); ++i) {
+        arg_regs.push_back(lookupRegister(argRegs[i]));
+        if (slots[i] != kNoReg) {
+            emit("lw", {regOp(arg_regs.back()), memOp(reg::s0, slots[i])});
+            m_free_spill_slots.push_back(slots[i]);
+        } else {
+            emit("mv", {regOp(arg_regs.back()), regOp(values[i])});
+            releaseValue(values[i]);
+        }
     }
-    for(int i = args.size() - 1; i >= 0; i--)
-        pop2Reg(argRegs[i]);
     dumpInstrs("// Calling %s\n", p_func_invocation.getNameCString());
-    dumpInstrs("    jal ra, %s\n", p_func_invocation.getNameCString());
-    pushReg("a0");
+    saveRegs();
+    m_function->append(
+        MachineInstr::createCall(p_func_invocation.getName(), arg_regs));
+    loadRegs();
+    m_value = newValue();
+    emit("mv", {regOp(m_value), regOp(reg::a0)});
 }
 
 void CodeGenerator::visit(VariableReferenceNode &p_variable_ref) {
-    pushVarAddr(p_variable_ref);
-    pop2Reg("t0");
-    dumpInstrs("    lw t0, 0(t0)\n");
-    pushReg("t0");
+    if (useStackMachine()) {
+        const auto *entry =
+            m_symbol_manager_ptr->lookup(p_variable_ref.getName());
+        if (entry->getKind() == SymbolEntry::KindEnum::kConstantKind) {
+            dumpInstrs("    li t0, %d\n",
+                       entry->getAttribute().constant()->word());
+        } else {
+            pushVarAddr(p_variable_ref);
+            pop2Reg("t0");
+            dumpInstrs("    lw t0, 0(t0)\n");
+        }
+        pushReg("t0");
+        return;
+    }
+
+    m_value = loadVar(*m_symbol_manager_ptr->lookup(p_variable_ref.getName()));
 }
 
 void CodeGenerator::visit(AssignmentNode &p_assignment) {
     dumpInstrs("// assignment\n");
     VariableReferenceNode *lvalue = p_assignment.getL();
-    pushVarAddr(*lvalue);
-    p_assignment.getR() -> accept(*this);
-    pop2Reg("t1"); // pop the value
-    pop2Reg("t0"); // pop the address
-    dumpInstrs("// *t0 = t1; \n");
-    dumpInstrs("    sw t1, 0(t0)\n");
+    if (useStackMachine()) {
+        pushVarAddr(*lvalue);
+        p_assignment.getR() -> accept(*this);
+        pop2Reg("t1"); // pop the value
+        pop2Reg("t0"); // pop the address
+        dumpInstrs("// *t0 = t1; \n");
+        dumpInstrs("    sw t1, 0(t0)\n");
+        return;
+    }
+
+    const int value = evaluate(*p_assignment.getR());
+    storeVar(*m_symbol_manager_ptr->lookup(lvalue -> getName()), value);
+    releaseValue(value);
 }
 
 void CodeGenerator::visit(ReadNode &p_read) {
     dumpInstrs("// read\n");
     auto var = p_read.getVar();
-    pushVarAddr(*var);
-    dumpInstrs("    jal ra, readInt\n");
-    pop2Reg("t0");
-    dumpInstrs("    sw a0, 0(t0)\n");
-    // dumpInstrs("    lw a0, 0(t0)\n");
+    if (useStackMachine()) {
+        pushVarAddr(*var);
+        dumpInstrs("    jal ra, readInt\n");
+        pop2Reg("t0");
+        dumpInstrs("    sw a0, 0(t0)\n");
+        return;
+    }
+
+    saveRegs();
+    m_function->append(MachineInstr::createCall("readInt", {}));
+    loadRegs();
+    const int value = newValue();
+    emit("mv", {regOp(value), regOp(reg::a0)});
+    storeVar(*m_symbol_manager_ptr->lookup(var -> getName()), value);
+    releaseValue(value);
 }
 
 void CodeGenerator::visit(IfNode &p_if) {
     auto cond = p_if.getCond();
     auto body = p_if.getBody();
     auto elseBody = p_if.getElse();
-    
+
     int elseLabel = labelId++;
     int doneLabel = labelId++;
 
-    dumpInstrs("// OAO\n");
-    cond->accept(*this);
-    dumpInstrs("// QAQ\n");
-    pop2Reg("t0");
-    dumpInstrs("    beq t0, zero, label%d\n", elseLabel);
+    branchOnCondition(*cond, false, elseLabel);
     body -> accept(*this);
     dumpGoto(doneLabel);
     dumpLabel(elseLabel);
-    if(elseBody) 
+    if(elseBody)
         elseBody -> accept(*this);
     dumpLabel(doneLabel);
 }
 
 void CodeGenerator::visit(WhileNode &p_while) {
-    
+
     auto cond = p_while.getCond();
     auto body = p_while.getBody();
 
     int bodyLabel = labelId++;
     int doneLabel = labelId++;
 
-    
-    
+
+
     dumpLabel(bodyLabel);
-    
-    dumpInstrs("// OAO\n");
-    cond->accept(*this);
-    dumpInstrs("// QAQ\n");
-    pop2Reg("t0");
-    
-    dumpInstrs("    beq t0, zero, label%d\n", doneLabel);
+
+    branchOnCondition(*cond, false, doneLabel);
 
     body -> accept(*this);
     dumpGoto(bodyLabel);
@@ -418,7 +1257,7 @@ void CodeGenerator::visit(ForNode &p_for) {
     // Reconstruct the hash table for looking up the symbol entry
     m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
         p_for.getSymbolTable());
-    
+
     initLocal(p_for.getSymbolTable());
 
     int bodyLabel = labelId++;
@@ -429,26 +1268,50 @@ void CodeGenerator::visit(ForNode &p_for) {
     auto iter = p_for.getInit() -> getLvalue().getNameCString();
     auto symbol = m_symbol_manager_ptr->lookup(iter);
 
-    cout << symbol -> getName() << ": " << symbol -> stkLoc << endl;
+    if (useStackMachine()) {
+        dumpInstrs("// init loop variable\n");
 
-    dumpInstrs("// init loop variable\n");
-    
-    dumpInstrs("    li t0, %d\n", lower);
-    dumpInstrs("    sw t0, %d(s0)\n", symbol -> stkLoc);
+        dumpInstrs("    li t0, %d\n", lower);
+        dumpInstrs("    sw t0, %d(s0)\n", symbol -> stkLoc);
 
-    dumpInstrs("// begin for loop\n");
-    
-    dumpLabel(bodyLabel);
+        dumpInstrs("// begin for loop\n");
+
+        dumpLabel(bodyLabel);
+
+        dumpInstrs("    lw t0, %d(s0)\n", symbol -> stkLoc);
+        dumpInstrs("    li t1, %d\n", upper);
+        dumpInstrs("    beq t0, t1, label%d\n", doneLabel);
 
-    dumpInstrs("    lw t0, %d(s0)\n", symbol -> stkLoc);
-    dumpInstrs("    li t1, %d\n", upper);
-    dumpInstrs("    beq t0, t1, label%d\n", doneLabel);
+        p_for.getBody() -> accept(*this);
 
-    p_for.getBody() -> accept(*this);
-    
-    dumpInstrs("    lw t0, %d(s0)\n", symbol -> stkLoc);
-    dumpInstrs("    addi t0, t0, 1\n");
-    dumpInstrs("    sw t0, %d(s0)\n", symbol -> stkLoc);
+        dumpInstrs("    lw t0, %d(s0)\n", symbol -> stkLoc);
+        dumpInstrs("    addi t0, t0, 1\n");
+        dumpInstrs("    sw t0, %d(s0)\n", symbol -> stkLoc);
+    } else {
+        const int init = newValue();
+        emit("li", {regOp(init), immOp(lower)});
+        storeVar(*symbol, init);
+        releaseValue(init);
+
+        dumpLabel(bodyLabel);
+
+        const int iter_value = loadVar(*symbol);
+        const int upper_value = newValue();
+        emit("li", {regOp(upper_value), immOp(upper)});
+        emit("beq", {regOp(iter_value), regOp(upper_value),
+                     symOp(labelName(doneLabel))});
+        releaseValue(iter_value);
+        releaseValue(upper_value);
+
+        p_for.getBody() -> accept(*this);
+
+        const int current = loadVar(*symbol);
+        const int next = newValue();
+        emit("addi", {regOp(next), regOp(current), immOp(1)});
+        releaseValue(current);
+        storeVar(*symbol, next);
+        releaseValue(next);
+    }
     dumpGoto(bodyLabel);
     dumpLabel(doneLabel);
 
@@ -457,7 +1320,14 @@ void CodeGenerator::visit(ForNode &p_for) {
 }
 
 void CodeGenerator::visit(ReturnNode &p_return) {
-    dumpInstrs("// return from stack\n");
-    p_return.getRetVal() -> accept(*this);
-    pop2Reg("a0");
+    if (useStackMachine()) {
+        dumpInstrs("// return from stack\n");
+        p_return.getRetVal() -> accept(*this);
+        pop2Reg("a0");
+    } else {
+        const int value = evaluate(*p_return.getRetVal());
+        emit("mv", {regOp(reg::a0), regOp(value)});
+        releaseValue(value);
+    }
+    dumpGoto(m_return_label);
 }
@@ -0,0 +1,310 @@
+#include "codegen/ELFWriter.hpp"
+
+#include <cstdio>
+
+using SectionKind = ELFWriter::SectionKind;
+
+static constexpr uint16_t kRelocatable = 1; // ET_REL
+static constexpr uint16_t kMachineRiscv = 243;
+static constexpr uint32_t kFlagRvc = 0x1;
+static constexpr uint32_t kFlagDoubleFloatAbi = 0x4;
+static constexpr uint32_t kHeaderSize = 52;
+static constexpr uint32_t kSectionHeaderSize = 40;
+static constexpr uint32_t kSymbolSize = 16;
+static constexpr uint32_t kRelocationSize = 12;
+
+// section types and flags
+static constexpr uint32_t kProgBits = 1;
+static constexpr uint32_t kSymTab = 2;
+static constexpr uint32_t kStrTab = 3;
+static constexpr uint32_t kRela = 4;
+static constexpr uint32_t kNoBits = 8;
+static constexpr uint32_t kFiniArray = 15;
+static constexpr uint32_t kWrite = 0x1;
+static constexpr uint32_t kAlloc = 0x2;
+static constexpr uint32_t kExecInstr = 0x4;
+static constexpr uint32_t kInfoLink = 0x40;
+
+// symbol bindings, types and the special section indices
+static constexpr uint8_t kLocal = 0;
+static constexpr uint8_t kGlobal = 1;
+static constexpr uint8_t kNoType = 0;
+static constexpr uint8_t kObject = 1;
+static constexpr uint8_t kFunc = 2;
+static constexpr uint8_t kFile = 4;
+static constexpr uint16_t kUndefined = 0;
+static constexpr uint16_t kAbsolute = 0xfff1;
+
+namespace {
+
+struct SectionHeader {
+    std::string name;
+    uint32_t type;
+    uint32_t flags;
+    uint32_t align;
+    uint32_t entry_size = 0;
+    uint32_t link = 0;
+    uint32_t info = 0;
+    // the bytes in the file; .bss has a size instead
+    const std::vector<uint8_t> *bytes = nullptr;
+    uint32_t size = 0;
+    uint32_t offset = 0;
+};
+
+struct Properties {
+    const char *name;
+    uint32_t type;
+    uint32_t flags;
+};
+
+} // namespace
+
+// by SectionKind
+static const Properties kSectionProperties[] = {
+    {".text", kProgBits, kAlloc | kExecInstr},
+    {".rodata", kProgBits, kAlloc},
+    {".bss", kNoBits, kAlloc | kWrite},
+    {".fini_array", kFiniArray, kAlloc | kWrite},
+};
+
+static void append16(std::vector<uint8_t> &p_bytes, const uint32_t p_value) {
+    p_bytes.push_back(p_value & 0xff);
+    p_bytes.push_back((p_value >> 8) & 0xff);
+}
+
+static void append32(std::vector<uint8_t> &p_bytes, const uint32_t p_value) {
+    append16(p_bytes, p_value & 0xffff);
+    append16(p_bytes, p_value >> 16);
+}
+
+// adds p_string to the string table p_table, returning its offset
+static uint32_t addString(std::vector<uint8_t> &p_table,
+                          const std::string &p_string) {
+    const uint32_t offset = p_table.size();
+    p_table.insert(p_table.end(), p_string.begin(), p_string.end());
+    p_table.push_back('\0');
+    return offset;
+}
+
+size_t ELFWriter::getSize(const SectionKind p_section) const {
+    const Section &section = m_sections[static_cast<size_t>(p_section)];
+    return p_section == SectionKind::kBss ? section.size
+                                          : section.bytes.size();
+}
+
+void ELFWriter::align(const SectionKind p_section, const uint32_t p_align,
+                      const uint32_t p_fill, const uint32_t p_fill_size) {
+    Section &section = m_sections[static_cast<size_t>(p_section)];
+    if (p_section == SectionKind::kBss) {
+        section.size = (section.size + p_align - 1) / p_align * p_align;
+        return;
+    }
+    while (section.bytes.size() % p_align != 0) {
+        for (uint32_t i = 0; i < p_fill_size; ++i) {
+            section.bytes.push_back((p_fill >> (8 * i)) & 0xff);
+        }
+    }
+}
+
+void ELFWriter::addRelocation(const SectionKind p_section,
+                              const Relocation &p_relocation) {
+    m_sections[static_cast<size_t>(p_section)].relocations.push_back(
+        p_relocation);
+}
+
+void ELFWriter::defineSymbol(const std::string &p_name,
+                             const SectionKind p_section,
+                             const uint32_t p_value, const uint32_t p_size,
+                             const SymbolKind p_kind, const bool p_is_global) {
+    m_symbol_index[p_name] = m_symbols.size();
+    m_symbols.push_back(
+        {p_name, p_section, p_value, p_size, p_kind, p_is_global});
+}
+
+size_t ELFWriter::getNumRelocations() const {
+    size_t num = 0;
+    for (const Section &section : m_sections) {
+        num += section.relocations.size();
+    }
+    return num;
+}
+
+bool ELFWriter::write(const std::string &p_path) const {
+    // .text and .bss are always there, the others only with contents
+    std::vector<SectionHeader> headers(1);
+    size_t section_index[4] = {};
+    for (size_t kind = 0; kind < 4; ++kind) {
+        const Section &section = m_sections[kind];
+        if (kind != static_cast<size_t>(SectionKind::kText) &&
+            kind != static_cast<size_t>(SectionKind::kBss) &&
+            section.bytes.empty()) {
+            continue;
+        }
+        section_index[kind] = headers.size();
+        SectionHeader header;
+        header.name = kSectionProperties[kind].name;
+        header.type = kSectionProperties[kind].type;
+        header.flags = kSectionProperties[kind].flags;
+        header.align = 4;
+        if (kind == static_cast<size_t>(SectionKind::kBss)) {
+            header.size = section.size;
+        } else {
+            header.bytes = &section.bytes;
+        }
+        headers.push_back(header);
+        if (!section.relocations.empty()) {
+            SectionHeader rela;
+            rela.name = std::string(".rela") + header.name;
+            rela.type = kRela;
+            rela.flags = kInfoLink;
+            rela.align = 4;
+            rela.entry_size = kRelocationSize;
+            rela.info = section_index[kind];
+            headers.push_back(rela);
+        }
+    }
+    const uint32_t symtab_index = headers.size();
+    const uint32_t strtab_index = symtab_index + 1;
+    const uint32_t shstrtab_index = symtab_index + 2;
+
+    // the locals have to come first; the symbols only referred to are
+    // global and undefined
+    std::vector<uint8_t> strtab(1, '\0');
+    std::vector<uint8_t> symtab(kSymbolSize, 0);
+    std::map<std::string, uint32_t> symbol_index;
+    auto add_symbol = [&](const std::string &p_name, const uint32_t p_value,
+                          const uint32_t p_size, const uint8_t p_info,
+                          const uint16_t p_section) {
+        symbol_index[p_name] = symtab.size() / kSymbolSize;
+        append32(symtab, addString(strtab, p_name));
+        append32(symtab, p_value);
+        append32(symtab, p_size);
+        symtab.push_back(p_info);
+        symtab.push_back(0);
+        append16(symtab, p_section);
+    };
+    add_symbol(m_source_name, 0, 0, kLocal << 4 | kFile, kAbsolute);
+    for (const bool is_global : {false, true}) {
+        for (const Symbol &symbol : m_symbols) {
+            if (symbol.is_global != is_global) {
+                continue;
+            }
+            const uint8_t type =
+                symbol.kind == SymbolKind::kFunction ? kFunc : kObject;
+            add_symbol(symbol.name, symbol.value, symbol.size,
+                       (is_global ? kGlobal : kLocal) << 4 | type,
+                       section_index[static_cast<size_t>(symbol.section)]);
+        }
+        if (!is_global) {
+            headers.push_back({".symtab", kSymTab, 0, 4, kSymbolSize,
+                               strtab_index, static_cast<uint32_t>(
+                                                 symtab.size() / kSymbolSize)});
+        }
+    }
+    for (const Section &section : m_sections) {
+        for (const Relocation &relocation : section.relocations) {
+            if (!symbol_index.count(relocation.symbol)) {
+                add_symbol(relocation.symbol, 0, 0, kGlobal << 4 | kNoType,
+                           kUndefined);
+            }
+        }
+    }
+
+    // the relocations refer to the symbols by index
+    std::vector<std::vector<uint8_t>> relas;
+    for (size_t kind = 0; kind < 4; ++kind) {
+        if (m_sections[kind].relocations.empty()) {
+            continue;
+        }
+        relas.emplace_back();
+        for (const Relocation &relocation : m_sections[kind].relocations) {
+            append32(relas.back(), relocation.offset);
+            append32(relas.back(),
+                     symbol_index[relocation.symbol] << 8 | relocation.type);
+            append32(relas.back(), relocation.addend);
+        }
+    }
+    size_t nth_rela = 0;
+    for (SectionHeader &header : headers) {
+        if (header.type == kRela) {
+            header.link = symtab_index;
+            header.bytes = &relas[nth_rela++];
+        }
+    }
+    headers[symtab_index].bytes = &symtab;
+    headers.push_back({".strtab", kStrTab, 0, 1});
+    headers.back().bytes = &strtab;
+    std::vector<uint8_t> shstrtab(1, '\0');
+    headers.push_back({".shstrtab", kStrTab, 0, 1});
+    headers.back().bytes = &shstrtab;
+    std::vector<uint32_t> name_offsets(headers.size(), 0);
+    for (size_t i = 1; i < headers.size(); ++i) {
+        name_offsets[i] = addString(shstrtab, headers[i].name);
+    }
+
+    // the contents follow the ELF header, the section headers come last
+    std::vector<uint8_t> contents;
+    for (size_t i = 1; i < headers.size(); ++i) {
+        SectionHeader &header = headers[i];
+        if (!header.bytes) {
+            header.offset = kHeaderSize + contents.size();
+            continue;
+        }
+        while ((kHeaderSize + contents.size()) % header.align != 0) {
+            contents.push_back(0);
+        }
+        header.offset = kHeaderSize + contents.size();
+        header.size = header.bytes->size();
+        contents.insert(contents.end(), header.bytes->begin(),
+                        header.bytes->end());
+    }
+    while (contents.size() % 4 != 0) {
+        contents.push_back(0);
+    }
+
+    std::vector<uint8_t> file = {0x7f, 'E', 'L', 'F',
+                                 1,    // 32-bit
+                                 1,    // little-endian
+                                 1};   // version 1
+    file.resize(16, 0);
+    append16(file, kRelocatable);
+    append16(file, kMachineRiscv);
+    append32(file, 1);
+    append32(file, 0); // entry
+    append32(file, 0); // program headers
+    append32(file, kHeaderSize + contents.size());
+    append32(file, kFlagRvc | kFlagDoubleFloatAbi);
+    append16(file, kHeaderSize);
+    append16(file, 0);
+    append16(file, 0);
+    append16(file, kSectionHeaderSize);
+    append16(file, headers.size());
+    append16(file, shstrtab_index);
+    file.insert(file.end(), contents.begin(), contents.end());
+
+    for (size_t i = 0; i < headers.size(); ++i) {
+        const SectionHeader &header = headers[i];
+        if (i == 0) {
+            file.resize(file.size() + kSectionHeaderSize, 0);
+            continue;
+        }
+        append32(file, name_offsets[i]);
+        append32(file, header.type);
+        append32(file, header.flags);
+        append32(file, 0); // address
+        append32(file, header.offset);
+        append32(file, header.size);
+        append32(file, header.link);
+        append32(file, header.info);
+        append32(file, header.align);
+        append32(file, header.entry_size);
+    }
+
+    std::FILE *out = std::fopen(p_path.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    const bool written =
+        std::fwrite(file.data(), 1, file.size(), out) == file.size();
+    return std::fclose(out) == 0 && written;
+}
@@ -0,0 +1,52 @@
+#include "codegen/FrameLayout.hpp"
+#include "sema/SymbolTable.hpp"
+#include "visitor/AstNodeInclude.hpp"
+
+#include <algorithm>
+
+int FrameLayout::getSlotSize(const PType &p_type) {
+    // every scalar (integer, real, boolean, string pointer) takes a word
+    int size = 4;
+    for (auto dimension : p_type.getDimensions()) {
+        size *= dimension;
+    }
+    return size;
+}
+
+void FrameLayout::layoutScope(const SymbolTable *p_table) {
+    if (!p_table) {
+        return;
+    }
+    for (const auto &entry : p_table->getEntries()) {
+        // constants are used as immediates
+        if (entry->getKind() == SymbolEntry::KindEnum::kConstantKind) {
+            continue;
+        }
+        m_offset -= getSlotSize(*entry->getTypePtr());
+        entry->stkLoc = m_offset;
+    }
+    m_lowest = std::min(m_lowest, m_offset);
+}
+
+void FrameLayout::visit(FunctionNode &p_function) {
+    layoutScope(p_function.getSymbolTable());
+    p_function.visitChildNodes(*this);
+}
+
+void FrameLayout::visit(CompoundStatementNode &p_compound_statement) {
+    const int scope_top = m_offset;
+    layoutScope(p_compound_statement.getSymbolTable());
+    p_compound_statement.visitChildNodes(*this);
+    m_offset = scope_top;
+}
+
+void FrameLayout::visit(IfNode &p_if) { p_if.visitChildNodes(*this); }
+
+void FrameLayout::visit(WhileNode &p_while) { p_while.visitChildNodes(*this); }
+
+void FrameLayout::visit(ForNode &p_for) {
+    const int scope_top = m_offset;
+    layoutScope(p_for.getSymbolTable());
+    p_for.visitChildNodes(*this);
+    m_offset = scope_top;
+}
@@ -0,0 +1,836 @@
+#include "codegen/InstructionEncoder.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using Operands = MachineInstr::Operands;
+using Relocation = ELFWriter::Relocation;
+using SectionKind = ELFWriter::SectionKind;
+
+static constexpr uint32_t kCNop = 0x0001;
+
+namespace {
+
+// how the operands go into the fixed bits of an instruction
+enum class Format : uint8_t {
+    kR,      // rd, rs1, rs2
+    kI,      // rd, rs1, imm
+    kShift,  // rd, rs1, shamt
+    kLoad,   // rd, offset(rs1); jalr as well
+    kStore,  // rs2, offset(rs1)
+    kBranch, // rs1, rs2, label
+    kU,      // rd, upper immediate
+    kJal,    // rd, label
+    // C extension; the primed registers are x8 ~ x15
+    kCR,         // c.add, c.mv: rd, rs2
+    kCJr,        // rs1
+    kCI,         // c.addi, c.li: rd, imm
+    kCShift,     // c.slli: rd, shamt
+    kCAddi16sp,  // sp, imm
+    kCAddi4spn,  // rd', sp, imm
+    kCLwsp,      // rd, offset(sp)
+    kCSwsp,      // rs2, offset(sp)
+    kCLw,        // rd', offset(rs1')
+    kCSw,        // rs2', offset(rs1')
+    kCA,         // c.sub, c.and...: rd', rs2'
+    kCBShift,    // c.srli, c.srai: rd', shamt
+    kCBImm,      // c.andi: rd', imm
+    kCBranch,    // rs1', label
+    kCJ,         // label
+    // V extension
+    kVSetVli, // rd, rs1, vtype
+    kVLoad,   // vd, (rs1)
+    kVStore,  // vs3, (rs1)
+    kVV,      // vd, vs2, vs1
+    kVX,      // vd, vs2, rs1
+    kVI,      // vd, vs2, simm5
+    kVMvXS,   // rd, vs2
+    kVMvV,    // vd, vs1
+    kVMvX,    // vd, rs1
+    kVMvI,    // vd, simm5
+};
+
+struct Encoding {
+    const char *mnemonic;
+    Format format;
+    uint32_t match; // the fixed bits
+};
+
+// the branch or jump a MachineInstr stands for
+struct Branch {
+    const char *opcode; // B-type, nullptr for a jump
+    int rs1;
+    int rs2;
+    const std::string *label;
+    bool is_compressed;
+};
+
+} // namespace
+
+static constexpr Encoding kEncodings[] = {
+    // RV32I
+    {"lui", Format::kU, 0x00000037},
+    {"auipc", Format::kU, 0x00000017},
+    {"jal", Format::kJal, 0x0000006f},
+    {"jalr", Format::kLoad, 0x00000067},
+    {"beq", Format::kBranch, 0x00000063},
+    {"bne", Format::kBranch, 0x00001063},
+    {"blt", Format::kBranch, 0x00004063},
+    {"bge", Format::kBranch, 0x00005063},
+    {"bltu", Format::kBranch, 0x00006063},
+    {"bgeu", Format::kBranch, 0x00007063},
+    {"lb", Format::kLoad, 0x00000003},
+    {"lh", Format::kLoad, 0x00001003},
+    {"lw", Format::kLoad, 0x00002003},
+    {"lbu", Format::kLoad, 0x00004003},
+    {"lhu", Format::kLoad, 0x00005003},
+    {"sb", Format::kStore, 0x00000023},
+    {"sh", Format::kStore, 0x00001023},
+    {"sw", Format::kStore, 0x00002023},
+    {"addi", Format::kI, 0x00000013},
+    {"slti", Format::kI, 0x00002013},
+    {"sltiu", Format::kI, 0x00003013},
+    {"xori", Format::kI, 0x00004013},
+    {"ori", Format::kI, 0x00006013},
+    {"andi", Format::kI, 0x00007013},
+    {"slli", Format::kShift, 0x00001013},
+    {"srli", Format::kShift, 0x00005013},
+    {"srai", Format::kShift, 0x40005013},
+    {"add", Format::kR, 0x00000033},
+    {"sub", Format::kR, 0x40000033},
+    {"sll", Format::kR, 0x00001033},
+    {"slt", Format::kR, 0x00002033},
+    {"sltu", Format::kR, 0x00003033},
+    {"xor", Format::kR, 0x00004033},
+    {"srl", Format::kR, 0x00005033},
+    {"sra", Format::kR, 0x40005033},
+    {"or", Format::kR, 0x00006033},
+    {"and", Format::kR, 0x00007033},
+    // RV32M
+    {"mul", Format::kR, 0x02000033},
+    {"mulh", Format::kR, 0x02001033},
+    {"mulhsu", Format::kR, 0x02002033},
+    {"mulhu", Format::kR, 0x02003033},
+    {"div", Format::kR, 0x02004033},
+    {"divu", Format::kR, 0x02005033},
+    {"rem", Format::kR, 0x02006033},
+    {"remu", Format::kR, 0x02007033},
+    // RV32C
+    {"c.addi4spn", Format::kCAddi4spn, 0x0000},
+    {"c.lw", Format::kCLw, 0x4000},
+    {"c.sw", Format::kCSw, 0xc000},
+    {"c.addi", Format::kCI, 0x0001},
+    {"c.li", Format::kCI, 0x4001},
+    {"c.addi16sp", Format::kCAddi16sp, 0x6101},
+    {"c.srli", Format::kCBShift, 0x8001},
+    {"c.srai", Format::kCBShift, 0x8401},
+    {"c.andi", Format::kCBImm, 0x8801},
+    {"c.sub", Format::kCA, 0x8c01},
+    {"c.xor", Format::kCA, 0x8c21},
+    {"c.or", Format::kCA, 0x8c41},
+    {"c.and", Format::kCA, 0x8c61},
+    {"c.j", Format::kCJ, 0xa001},
+    {"c.beqz", Format::kCBranch, 0xc001},
+    {"c.bnez", Format::kCBranch, 0xe001},
+    {"c.slli", Format::kCShift, 0x0002},
+    {"c.lwsp", Format::kCLwsp, 0x4002},
+    {"c.jr", Format::kCJr, 0x8002},
+    {"c.mv", Format::kCR, 0x8002},
+    {"c.jalr", Format::kCJr, 0x9002},
+    {"c.add", Format::kCR, 0x9002},
+    {"c.swsp", Format::kCSwsp, 0xc002},
+    // RVV 1.0, unmasked
+    {"vsetvli", Format::kVSetVli, 0x00007057},
+    {"vle32.v", Format::kVLoad, 0x02006007},
+    {"vse32.v", Format::kVStore, 0x02006027},
+    {"vadd.vv", Format::kVV, 0x02000057},
+    {"vadd.vx", Format::kVX, 0x02004057},
+    {"vadd.vi", Format::kVI, 0x02003057},
+    {"vsub.vv", Format::kVV, 0x0a000057},
+    {"vsub.vx", Format::kVX, 0x0a004057},
+    {"vrsub.vx", Format::kVX, 0x0e004057},
+    {"vrsub.vi", Format::kVI, 0x0e003057},
+    {"vmul.vv", Format::kVV, 0x96002057},
+    {"vmul.vx", Format::kVX, 0x96006057},
+    {"vredsum.vs", Format::kVV, 0x02002057},
+    {"vmv.x.s", Format::kVMvXS, 0x42002057},
+    {"vmv.s.x", Format::kVMvX, 0x42006057},
+    {"vmv.v.v", Format::kVMvV, 0x5e000057},
+    {"vmv.v.x", Format::kVMvX, 0x5e004057},
+    {"vmv.v.i", Format::kVMvI, 0x5e003057},
+};
+
+// Operand kinds by format: x an x register, c one of x8 ~ x15, v a vector
+// register, i an immediate, m offset(base) and s a symbol.
+static const char *getSignature(const Format p_format) {
+    switch (p_format) {
+    case Format::kR:
+        return "xxx";
+    case Format::kI:
+    case Format::kShift:
+        return "xxi";
+    case Format::kLoad:
+    case Format::kStore:
+    case Format::kCLwsp:
+    case Format::kCSwsp:
+        return "xm";
+    case Format::kBranch:
+        return "xxs";
+    case Format::kU:
+    case Format::kCI:
+    case Format::kCShift:
+    case Format::kCAddi16sp:
+        return "xi";
+    case Format::kJal:
+        return "xs";
+    case Format::kCR:
+        return "xx";
+    case Format::kCJr:
+        return "x";
+    case Format::kCAddi4spn:
+        return "cxi";
+    case Format::kCLw:
+    case Format::kCSw:
+        return "cm";
+    case Format::kCA:
+        return "cc";
+    case Format::kCBShift:
+    case Format::kCBImm:
+        return "ci";
+    case Format::kCBranch:
+        return "cs";
+    case Format::kCJ:
+        return "s";
+    case Format::kVSetVli:
+        return "xxssss";
+    case Format::kVLoad:
+    case Format::kVStore:
+        return "vm";
+    case Format::kVV:
+        return "vvv";
+    case Format::kVX:
+        return "vvx";
+    case Format::kVI:
+        return "vvi";
+    case Format::kVMvXS:
+        return "xv";
+    case Format::kVMvV:
+        return "vv";
+    case Format::kVMvX:
+        return "vx";
+    case Format::kVMvI:
+        return "vi";
+    }
+    return "";
+}
+
+static const Encoding *lookupEncoding(const std::string &p_mnemonic) {
+    for (const auto &encoding : kEncodings) {
+        if (p_mnemonic == encoding.mnemonic) {
+            return &encoding;
+        }
+    }
+    return nullptr;
+}
+
+static void reportError(const MachineInstr &p_instr, const char *p_what) {
+    std::string text = p_instr.toString();
+    text.erase(0, text.find_first_not_of(' '));
+    fprintf(stderr, "internal error: cannot encode '%s': %s\n", text.c_str(),
+            p_what);
+    exit(EXIT_FAILURE);
+}
+
+static bool fitsSigned(const int64_t p_imm, const int p_bits) {
+    return p_imm >= -(int64_t{1} << (p_bits - 1)) &&
+           p_imm < (int64_t{1} << (p_bits - 1));
+}
+
+static bool fitsUnsigned(const int64_t p_imm, const int p_bits) {
+    return p_imm >= 0 && p_imm < (int64_t{1} << p_bits);
+}
+
+// bits p_hi ~ p_lo of p_value, shifted down
+static uint32_t getBits(const int64_t p_value, const int p_hi, const int p_lo) {
+    return (p_value >> p_lo) & ((uint32_t{1} << (p_hi - p_lo + 1)) - 1);
+}
+
+static bool isCompressibleReg(const int p_reg) {
+    return p_reg >= reg::s0 && p_reg <= reg::a5;
+}
+
+static bool matches(const Operands &p_operands, const char *p_kinds) {
+    if (p_operands.size() != strlen(p_kinds)) {
+        return false;
+    }
+    for (size_t i = 0; i < p_operands.size(); ++i) {
+        const MachineOperand &operand = p_operands[i];
+        const int reg = operand.getReg();
+        bool ok = false;
+        switch (p_kinds[i]) {
+        case 'x':
+            ok = operand.isReg() && reg >= 0 && reg < kNumPhysRegs;
+            break;
+        case 'c':
+            ok = operand.isReg() && isCompressibleReg(reg);
+            break;
+        case 'v':
+            ok = operand.isReg() && isVectorReg(reg);
+            break;
+        case 'i':
+            ok = operand.isImm();
+            break;
+        case 'm':
+            ok = operand.isMem() && reg >= 0 && reg < kNumPhysRegs;
+            break;
+        case 's':
+            ok = operand.isSymbol();
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the vtype immediate of vsetvli from e32, m1, ta, ma and the like
+static bool getVectorType(const Operands &p_operands, uint32_t &p_vtype) {
+    static const char *const kLmuls[] = {"m1", "m2", "m4", "m8",
+                                         "",   "mf8", "mf4", "mf2"};
+    static const char *const kSews[] = {"e8", "e16", "e32", "e64"};
+    uint32_t lmul = 8, sew = 4;
+    for (uint32_t i = 0; i < 8; ++i) {
+        if (p_operands[3].getSymbol() == kLmuls[i] && i != 4) {
+            lmul = i;
+        }
+        if (i < 4 && p_operands[2].getSymbol() == kSews[i]) {
+            sew = i;
+        }
+    }
+    const std::string &tail = p_operands[4].getSymbol();
+    const std::string &mask = p_operands[5].getSymbol();
+    if (lmul == 8 || sew == 4 || (tail != "ta" && tail != "tu") ||
+        (mask != "ma" && mask != "mu")) {
+        return false;
+    }
+    p_vtype = lmul | sew << 3 | (tail == "ta") << 6 | (mask == "ma") << 7;
+    return true;
+}
+
+// Encodes a machine instruction of the table; p_offset is how far the
+// label of a branch or jump is. Returns the bytes it takes in p_size.
+static uint32_t encodeReal(const MachineInstr &p_instr, const int64_t p_offset,
+                           size_t &p_size) {
+    const Encoding *encoding = lookupEncoding(p_instr.getOpcode());
+    if (!encoding) {
+        reportError(p_instr, "unknown instruction");
+    }
+    const Operands &ops = p_instr.getOperands();
+    if (!matches(ops, getSignature(encoding->format))) {
+        reportError(p_instr, "unexpected operands");
+    }
+    auto reg = [&](const size_t nth) -> uint32_t {
+        const int number = ops[nth].getReg();
+        return isVectorReg(number) ? number - kFirstVectorReg : number;
+    };
+    // the 3-bit field of x8 ~ x15
+    auto creg = [&](const size_t nth) -> uint32_t {
+        return ops[nth].getReg() - reg::s0;
+    };
+    auto check = [&](const bool p_ok, const char *p_what) {
+        if (!p_ok) {
+            reportError(p_instr, p_what);
+        }
+    };
+    const int64_t imm = ops.empty() ? 0 : ops.back().getImm();
+    const uint32_t match = encoding->match;
+    p_size = 4;
+
+    switch (encoding->format) {
+    case Format::kR:
+        return match | reg(2) << 20 | reg(1) << 15 | reg(0) << 7;
+    case Format::kI:
+        check(fitsSigned(imm, 12), "immediate out of range");
+        return match | getBits(imm, 11, 0) << 20 | reg(1) << 15 | reg(0) << 7;
+    case Format::kShift:
+        check(fitsUnsigned(imm, 5), "shift amount out of range");
+        return match | getBits(imm, 4, 0) << 20 | reg(1) << 15 | reg(0) << 7;
+    case Format::kLoad:
+        check(fitsSigned(imm, 12), "offset out of range");
+        return match | getBits(imm, 11, 0) << 20 | reg(1) << 15 | reg(0) << 7;
+    case Format::kStore:
+        check(fitsSigned(imm, 12), "offset out of range");
+        return match | getBits(imm, 11, 5) << 25 | reg(0) << 20 |
+               reg(1) << 15 | getBits(imm, 4, 0) << 7;
+    case Format::kBranch:
+        check(fitsSigned(p_offset, 13), "branch out of range");
+        return match | getBits(p_offset, 12, 12) << 31 |
+               getBits(p_offset, 10, 5) << 25 | reg(1) << 20 | reg(0) << 15 |
+               getBits(p_offset, 4, 1) << 8 | getBits(p_offset, 11, 11) << 7;
+    case Format::kU:
+        check(fitsUnsigned(imm, 20), "immediate out of range");
+        return match | getBits(imm, 19, 0) << 12 | reg(0) << 7;
+    case Format::kJal:
+        check(fitsSigned(p_offset, 21), "jump out of range");
+        return match | getBits(p_offset, 20, 20) << 31 |
+               getBits(p_offset, 10, 1) << 21 |
+               getBits(p_offset, 11, 11) << 20 |
+               getBits(p_offset, 19, 12) << 12 | reg(0) << 7;
+    default:
+        break;
+    }
+
+    p_size = 2;
+    switch (encoding->format) {
+    case Format::kCR:
+        return match | reg(0) << 7 | reg(1) << 2;
+    case Format::kCJr:
+        return match | reg(0) << 7;
+    case Format::kCI:
+        check(fitsSigned(imm, 6), "immediate out of range");
+        return match | getBits(imm, 5, 5) << 12 | reg(0) << 7 |
+               getBits(imm, 4, 0) << 2;
+    case Format::kCShift:
+        check(fitsUnsigned(imm, 5) && imm != 0, "shift amount out of range");
+        return match | reg(0) << 7 | getBits(imm, 4, 0) << 2;
+    case Format::kCAddi16sp:
+        check(reg(0) == reg::sp && imm != 0 && imm % 16 == 0 &&
+                  fitsSigned(imm, 10),
+              "immediate out of range");
+        return match | getBits(imm, 9, 9) << 12 | getBits(imm, 4, 4) << 6 |
+               getBits(imm, 6, 6) << 5 | getBits(imm, 8, 7) << 3 |
+               getBits(imm, 5, 5) << 2;
+    case Format::kCAddi4spn:
+        check(reg(1) == reg::sp && imm != 0 && imm % 4 == 0 &&
+                  fitsUnsigned(imm, 10),
+              "immediate out of range");
+        return match | getBits(imm, 5, 4) << 11 | getBits(imm, 9, 6) << 7 |
+               getBits(imm, 2, 2) << 6 | getBits(imm, 3, 3) << 5 |
+               creg(0) << 2;
+    case Format::kCLwsp:
+        check(reg(1) == reg::sp && imm % 4 == 0 && fitsUnsigned(imm, 8),
+              "offset out of range");
+        return match | getBits(imm, 5, 5) << 12 | reg(0) << 7 |
+               getBits(imm, 4, 2) << 4 | getBits(imm, 7, 6) << 2;
+    case Format::kCSwsp:
+        check(reg(1) == reg::sp && imm % 4 == 0 && fitsUnsigned(imm, 8),
+              "offset out of range");
+        return match | getBits(imm, 5, 2) << 9 | getBits(imm, 7, 6) << 7 |
+               reg(0) << 2;
+    case Format::kCLw:
+    case Format::kCSw:
+        check(isCompressibleReg(ops[1].getReg()) && imm % 4 == 0 &&
+                  fitsUnsigned(imm, 7),
+              "offset out of range");
+        return match | getBits(imm, 5, 3) << 10 | creg(1) << 7 |
+               getBits(imm, 2, 2) << 6 | getBits(imm, 6, 6) << 5 |
+               creg(0) << 2;
+    case Format::kCA:
+        return match | creg(0) << 7 | creg(1) << 2;
+    case Format::kCBShift:
+        check(fitsUnsigned(imm, 5) && imm != 0, "shift amount out of range");
+        return match | creg(0) << 7 | getBits(imm, 4, 0) << 2;
+    case Format::kCBImm:
+        check(fitsSigned(imm, 6), "immediate out of range");
+        return match | getBits(imm, 5, 5) << 12 | creg(0) << 7 |
+               getBits(imm, 4, 0) << 2;
+    case Format::kCBranch:
+        check(fitsSigned(p_offset, 9), "branch out of range");
+        return match | getBits(p_offset, 8, 8) << 12 |
+               getBits(p_offset, 4, 3) << 10 | creg(0) << 7 |
+               getBits(p_offset, 7, 6) << 5 | getBits(p_offset, 2, 1) << 3 |
+               getBits(p_offset, 5, 5) << 2;
+    case Format::kCJ:
+        check(fitsSigned(p_offset, 12), "jump out of range");
+        return match | getBits(p_offset, 11, 11) << 12 |
+               getBits(p_offset, 4, 4) << 11 | getBits(p_offset, 9, 8) << 9 |
+               getBits(p_offset, 10, 10) << 8 | getBits(p_offset, 6, 6) << 7 |
+               getBits(p_offset, 7, 7) << 6 | getBits(p_offset, 3, 1) << 3 |
+               getBits(p_offset, 5, 5) << 2;
+    default:
+        break;
+    }
+
+    p_size = 4;
+    switch (encoding->format) {
+    case Format::kVSetVli: {
+        uint32_t vtype = 0;
+        check(getVectorType(ops, vtype), "unknown vector type");
+        return match | vtype << 20 | reg(1) << 15 | reg(0) << 7;
+    }
+    case Format::kVLoad:
+    case Format::kVStore:
+        check(imm == 0, "vector loads and stores take no offset");
+        return match | reg(1) << 15 | reg(0) << 7;
+    case Format::kVV:
+    case Format::kVX:
+        return match | reg(1) << 20 | reg(2) << 15 | reg(0) << 7;
+    case Format::kVI:
+        check(fitsSigned(imm, 5), "immediate out of range");
+        return match | reg(1) << 20 | getBits(imm, 4, 0) << 15 | reg(0) << 7;
+    case Format::kVMvXS:
+        return match | reg(1) << 20 | reg(0) << 7;
+    case Format::kVMvV:
+    case Format::kVMvX:
+        return match | reg(1) << 15 | reg(0) << 7;
+    case Format::kVMvI:
+        check(fitsSigned(imm, 5), "immediate out of range");
+        return match | getBits(imm, 4, 0) << 15 | reg(0) << 7;
+    default:
+        break;
+    }
+    reportError(p_instr, "unknown format");
+    return 0;
+}
+
+static bool getBranch(const MachineInstr &p_instr, Branch &p_branch) {
+    static const char *const kBranches[] = {"beq", "bne",  "blt",
+                                            "bge", "bltu", "bgeu"};
+    // the pseudo-instructions with the operands swapped
+    static const char *const kSwapped[][2] = {
+        {"bgt", "blt"}, {"ble", "bge"}, {"bgtu", "bltu"}, {"bleu", "bgeu"}};
+    // and the ones comparing with zero, the register going first or last
+    static const char *const kZero[][3] = {
+        {"beqz", "beq", "r"}, {"bnez", "bne", "r"},  {"bltz", "blt", "r"},
+        {"bgez", "bge", "r"}, {"blez", "bge", "0"},  {"bgtz", "blt", "0"},
+        {"c.beqz", "beq", "r"}, {"c.bnez", "bne", "r"}};
+
+    const std::string &opcode = p_instr.getOpcode();
+    const Operands &ops = p_instr.getOperands();
+    if (!p_instr.isInstruction() || ops.empty() || !ops.back().isSymbol()) {
+        return false;
+    }
+    p_branch = {nullptr, reg::zero, reg::zero, &ops.back().getSymbol(),
+                opcode.compare(0, 2, "c.") == 0};
+    if (opcode == "j" || opcode == "c.j") {
+        return ops.size() == 1;
+    }
+    if (ops.size() == 3 && ops[0].isReg() && ops[1].isReg()) {
+        for (const char *branch : kBranches) {
+            if (opcode == branch) {
+                p_branch.opcode = branch;
+                p_branch.rs1 = ops[0].getReg();
+                p_branch.rs2 = ops[1].getReg();
+                return true;
+            }
+        }
+        for (const auto &swapped : kSwapped) {
+            if (opcode == swapped[0]) {
+                p_branch.opcode = swapped[1];
+                p_branch.rs1 = ops[1].getReg();
+                p_branch.rs2 = ops[0].getReg();
+                return true;
+            }
+        }
+    }
+    if (ops.size() == 2 && ops[0].isReg()) {
+        for (const auto &zero : kZero) {
+            if (opcode == zero[0]) {
+                p_branch.opcode = zero[1];
+                (zero[2][0] == 'r' ? p_branch.rs1 : p_branch.rs2) =
+                    ops[0].getReg();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static const char *invertBranch(const char *p_opcode) {
+    static const char *const kInverses[][2] = {
+        {"beq", "bne"}, {"blt", "bge"}, {"bltu", "bgeu"}};
+    for (const auto &pair : kInverses) {
+        if (strcmp(p_opcode, pair[0]) == 0) {
+            return pair[1];
+        }
+        if (strcmp(p_opcode, pair[1]) == 0) {
+            return pair[0];
+        }
+    }
+    return p_opcode;
+}
+
+// A branch goes from level 0, the 16-bit form, through 1, the 32-bit one,
+// to 2, the inverted branch over a jal. These are its size and reach.
+static size_t getBranchSize(const uint8_t p_level) {
+    return p_level == 0 ? 2 : p_level == 1 ? 4 : 8;
+}
+
+static bool reaches(const Branch &p_branch, const uint8_t p_level,
+                    const int64_t p_offset) {
+    if (!p_branch.opcode || p_level == 2) {
+        return fitsSigned(p_offset, p_level == 0 ? 12 : 21);
+    }
+    return fitsSigned(p_offset, p_level == 0 ? 9 : 13);
+}
+
+static MachineOperand regOp(const int p_reg) {
+    return MachineOperand::createReg(p_reg);
+}
+
+static MachineOperand immOp(const int64_t p_imm) {
+    return MachineOperand::createImm(p_imm);
+}
+
+static MachineOperand memOp(const int p_base, const int64_t p_offset) {
+    return MachineOperand::createMem(p_base, p_offset);
+}
+
+void InstructionEncoder::encode(const MachineFunction &p_function,
+                                const bool p_is_global) {
+    // .align 2; a compressed function may end halfway into a word
+    m_writer.align(SectionKind::kText, 4, kCNop, 2);
+    Layout layout;
+    layOut(p_function, layout);
+
+    const MachineFunction::Instrs &instrs = p_function.getInstrs();
+    std::vector<uint8_t> code;
+    std::vector<Relocation> relocations;
+    for (size_t i = 0; i < instrs.size(); ++i) {
+        encodeInstr(instrs[i], code.size(), layout.levels[i], layout, code,
+                    relocations);
+    }
+
+    std::vector<uint8_t> &text = m_writer.getBytes(SectionKind::kText);
+    const uint32_t base = text.size();
+    text.insert(text.end(), code.begin(), code.end());
+    for (Relocation &relocation : relocations) {
+        relocation.offset += base;
+        m_writer.addRelocation(SectionKind::kText, relocation);
+    }
+    m_writer.defineSymbol(p_function.getName(), SectionKind::kText, base,
+                          code.size(), ELFWriter::SymbolKind::kFunction,
+                          p_is_global);
+}
+
+void InstructionEncoder::layOut(const MachineFunction &p_function,
+                                Layout &p_layout) const {
+    const MachineFunction::Instrs &instrs = p_function.getInstrs();
+    std::vector<size_t> sizes(instrs.size(), 0);
+    std::vector<Branch> branches(instrs.size());
+    std::vector<bool> is_branch(instrs.size(), false);
+    std::vector<uint8_t> scratch;
+    std::vector<Relocation> scratch_relocations;
+    for (size_t i = 0; i < instrs.size(); ++i) {
+        is_branch[i] = getBranch(instrs[i], branches[i]);
+        if (!is_branch[i]) {
+            scratch.clear();
+            encodeInstr(instrs[i], 0, 0, p_layout, scratch,
+                        scratch_relocations);
+            sizes[i] = scratch.size();
+        }
+    }
+    for (size_t i = 0; i < instrs.size(); ++i) {
+        if (instrs[i].isLabel()) {
+            p_layout.labels[instrs[i].getName()] = 0;
+        }
+    }
+    p_layout.levels.assign(instrs.size(), 0);
+    for (size_t i = 0; i < instrs.size(); ++i) {
+        // what goes to another function is relocated in the 32-bit form
+        if (is_branch[i] && (!branches[i].is_compressed ||
+                             !p_layout.labels.count(*branches[i].label))) {
+            p_layout.levels[i] = 1;
+        }
+    }
+
+    // widening a branch only makes the code longer, so this ends
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        p_layout.addresses.assign(instrs.size() + 1, 0);
+        int64_t address = 0;
+        for (size_t i = 0; i < instrs.size(); ++i) {
+            p_layout.addresses[i] = address;
+            if (instrs[i].isLabel()) {
+                p_layout.labels[instrs[i].getName()] = address;
+            }
+            address += is_branch[i] ? getBranchSize(p_layout.levels[i])
+                                    : sizes[i];
+        }
+        p_layout.addresses[instrs.size()] = address;
+
+        for (size_t i = 0; i < instrs.size(); ++i) {
+            if (!is_branch[i]) {
+                continue;
+            }
+            const Branch &branch = branches[i];
+            uint8_t &level = p_layout.levels[i];
+            auto it = p_layout.labels.find(*branch.label);
+            if (it == p_layout.labels.end()) {
+                continue;
+            }
+            // the jal of a widened branch comes after the branch
+            const int64_t offset = it->second - p_layout.addresses[i] -
+                                   (level == 2 ? 4 : 0);
+            if (reaches(branch, level, offset)) {
+                continue;
+            }
+            if (level == 2 || (level == 1 && !branch.opcode)) {
+                reportError(instrs[i], "jump out of range");
+            }
+            ++level;
+            changed = true;
+        }
+    }
+}
+
+void InstructionEncoder::encodeInstr(
+    const MachineInstr &p_instr, const int64_t p_address,
+    const uint8_t p_level, const Layout &p_layout,
+    std::vector<uint8_t> &p_code,
+    std::vector<Relocation> &p_relocations) const {
+    if (!p_instr.isInstruction()) {
+        return;
+    }
+    auto put = [&](const MachineInstr &p_real, const int64_t p_offset) {
+        size_t size = 0;
+        const uint32_t word = encodeReal(p_real, p_offset, size);
+        for (size_t i = 0; i < size; ++i) {
+            p_code.push_back((word >> (8 * i)) & 0xff);
+        }
+    };
+    auto relocate = [&](const uint32_t p_type, const std::string &p_symbol) {
+        p_relocations.push_back(
+            {static_cast<uint32_t>(p_code.size()), p_type, p_symbol, 0});
+    };
+    // how far p_label is from the code put next, 0 if it is not in here
+    const int64_t start = p_code.size();
+    auto offsetTo = [&](const std::string &p_label) -> int64_t {
+        auto it = p_layout.labels.find(p_label);
+        if (it == p_layout.labels.end()) {
+            return 0;
+        }
+        return it->second - (p_address + static_cast<int64_t>(p_code.size()) -
+                             start);
+    };
+    const std::string &opcode = p_instr.getOpcode();
+    const Operands &ops = p_instr.getOperands();
+    const MachineOperand zero = regOp(reg::zero);
+
+    Branch branch;
+    if (getBranch(p_instr, branch)) {
+        const std::string &label = *branch.label;
+        const bool is_local = p_layout.labels.count(label) != 0;
+        if (branch.opcode && p_level == 2) {
+            put(MachineInstr(invertBranch(branch.opcode),
+                             {regOp(branch.rs1), regOp(branch.rs2),
+                              MachineOperand::createSymbol(label)}),
+                8);
+            put(MachineInstr("jal", {zero, ops.back()}), offsetTo(label));
+        } else if (p_level == 0) {
+            put(MachineInstr(branch.opcode ? (strcmp(branch.opcode, "beq") == 0
+                                                  ? "c.beqz"
+                                                  : "c.bnez")
+                                           : "c.j",
+                             branch.opcode
+                                 ? Operands{regOp(branch.rs1), ops.back()}
+                                 : Operands{ops.back()}),
+                offsetTo(label));
+        } else {
+            if (!is_local) {
+                relocate(branch.opcode ? reloc::kBranch : reloc::kJal, label);
+            }
+            put(branch.opcode
+                    ? MachineInstr(branch.opcode,
+                                   {regOp(branch.rs1), regOp(branch.rs2),
+                                    ops.back()})
+                    : MachineInstr("jal", {zero, ops.back()}),
+                offsetTo(label));
+        }
+        return;
+    }
+
+    if (opcode == "li" && matches(ops, "xi")) {
+        // lui and addi add up to the value in 32 bits
+        const int32_t value = static_cast<int32_t>(ops[1].getImm());
+        const int32_t low = static_cast<int32_t>(
+            static_cast<uint32_t>(value) << 20) >> 20;
+        if (fitsSigned(value, 12)) {
+            put(MachineInstr("addi", {ops[0], zero, immOp(value)}), 0);
+            return;
+        }
+        put(MachineInstr("lui", {ops[0], immOp(getBits(
+                                             int64_t{value} - low, 31, 12))}),
+            0);
+        if (low != 0) {
+            put(MachineInstr("addi", {ops[0], ops[0], immOp(low)}), 0);
+        }
+        return;
+    }
+    if (opcode == "la" && matches(ops, "xs")) {
+        relocate(reloc::kHi20, ops[1].getSymbol());
+        put(MachineInstr("lui", {ops[0], immOp(0)}), 0);
+        relocate(reloc::kLo12I, ops[1].getSymbol());
+        put(MachineInstr("addi", {ops[0], ops[0], immOp(0)}), 0);
+        return;
+    }
+    if ((opcode == "call" || opcode == "tail") && matches(ops, "s")) {
+        // a tail call must not overwrite ra, so it goes through t1
+        const int link = opcode == "call" ? reg::ra : reg::zero;
+        const int temp = opcode == "call" ? reg::ra : reg::t1;
+        relocate(reloc::kCall, ops[0].getSymbol());
+        put(MachineInstr("auipc", {regOp(temp), immOp(0)}), 0);
+        put(MachineInstr("jalr", {regOp(link), memOp(temp, 0)}), 0);
+        return;
+    }
+    if (opcode == "jal" && (matches(ops, "s") || matches(ops, "xs"))) {
+        const MachineOperand link = ops.size() == 1 ? regOp(reg::ra) : ops[0];
+        if (!p_layout.labels.count(ops.back().getSymbol())) {
+            relocate(reloc::kJal, ops.back().getSymbol());
+        }
+        put(MachineInstr("jal", {link, ops.back()}),
+            offsetTo(ops.back().getSymbol()));
+        return;
+    }
+    if (opcode == "ret" && ops.empty()) {
+        put(MachineInstr("jalr", {zero, memOp(reg::ra, 0)}), 0);
+        return;
+    }
+    if ((opcode == "jr" || opcode == "jalr") && matches(ops, "x")) {
+        const int link = opcode == "jr" ? reg::zero : reg::ra;
+        put(MachineInstr("jalr", {regOp(link), memOp(ops[0].getReg(), 0)}),
+            0);
+        return;
+    }
+    if (opcode == "jalr" && matches(ops, "xxi")) {
+        put(MachineInstr("jalr",
+                         {ops[0], memOp(ops[1].getReg(), ops[2].getImm())}),
+            0);
+        return;
+    }
+    if (opcode == "nop" && ops.empty()) {
+        put(MachineInstr("addi", {zero, zero, immOp(0)}), 0);
+        return;
+    }
+
+    // the rest of the pseudo-instructions with two registers
+    static const struct {
+        const char *pseudo;
+        const char *opcode;
+        const char *operands; // d the destination, s the source, 0 x0
+        int64_t imm;
+    } kPseudos[] = {
+        {"mv", "addi", "dsi", 0},   {"not", "xori", "dsi", -1},
+        {"neg", "sub", "d0s", 0},   {"seqz", "sltiu", "dsi", 1},
+        {"snez", "sltu", "d0s", 0}, {"sltz", "slt", "ds0", 0},
+        {"sgtz", "slt", "d0s", 0},
+    };
+    for (const auto &pseudo : kPseudos) {
+        if (opcode != pseudo.pseudo || !matches(ops, "xx")) {
+            continue;
+        }
+        Operands real;
+        for (const char *kind = pseudo.operands; *kind != '\0'; ++kind) {
+            real.push_back(*kind == 'd'   ? ops[0]
+                           : *kind == 's' ? ops[1]
+                           : *kind == '0' ? zero
+                                          : immOp(pseudo.imm));
+        }
+        put(MachineInstr(pseudo.opcode, real), 0);
+        return;
+    }
+    put(p_instr, 0);
+}
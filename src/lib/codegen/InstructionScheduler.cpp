@@ -0,0 +1,232 @@
+#include "codegen/InstructionScheduler.hpp"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+using Instrs = InstructionScheduler::Instrs;
+
+// labels, comments, calls and terminators stay where they are, as do the
+// vector instructions, which depend on the vl of the vsetvli before them
+static bool isBarrier(const MachineInstr &p_instr) {
+    return !p_instr.isInstruction() || p_instr.isCall() ||
+           p_instr.isTerminator() || p_instr.isVector();
+}
+
+static bool contains(const MachineInstr::Regs &p_regs, const int p_reg) {
+    return std::find(p_regs.begin(), p_regs.end(), p_reg) != p_regs.end();
+}
+
+// whether a register of p_lhs other than x0 is in p_rhs
+static bool overlaps(const MachineInstr::Regs &p_lhs,
+                     const MachineInstr::Regs &p_rhs) {
+    for (int reg : p_lhs) {
+        if (reg != reg::zero && contains(p_rhs, reg)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// cycles until the last of p_instrs has issued, every register ready at first
+static size_t countCycles(const MachineModel &p_model,
+                          const std::vector<const MachineInstr *> &p_instrs) {
+    std::map<int, size_t> ready;
+    size_t cycle = 0;
+    for (const MachineInstr *instr : p_instrs) {
+        size_t issue = cycle;
+        for (int reg : instr->getUses()) {
+            auto it = ready.find(reg);
+            if (it != ready.end()) {
+                issue = std::max(issue, it->second);
+            }
+        }
+        for (int reg : instr->getDefs()) {
+            ready[reg] = issue + p_model.getLatency(*instr);
+        }
+        cycle = issue + 1;
+    }
+    return cycle;
+}
+
+size_t InstructionScheduler::estimateCycles(const Instrs &p_instrs) const {
+    size_t cycles = 0;
+    std::vector<const MachineInstr *> block;
+    for (const auto &instr : p_instrs) {
+        if (instr.isLabel()) {
+            cycles += countCycles(m_model, block);
+            block.clear();
+        } else if (instr.isInstruction()) {
+            block.push_back(&instr);
+        }
+    }
+    return cycles + countCycles(m_model, block);
+}
+
+namespace {
+
+// where a load or store goes: the base register, how many times it has been
+// written before in the region, and the bytes accessed
+struct MemoryAccess {
+    int base;
+    int version;
+    int64_t offset;
+    int64_t size;
+    bool is_store;
+};
+
+struct Node {
+    // (node, latency)
+    std::vector<std::pair<size_t, int>> succs;
+    size_t num_preds = 0;
+    // the longest latency path from here to the end of the region
+    int height = 0;
+    // the first cycle the operands are ready in
+    int earliest = 0;
+};
+
+} // namespace
+
+static bool mayAlias(const MemoryAccess &p_lhs, const MemoryAccess &p_rhs) {
+    if (p_lhs.base != p_rhs.base || p_lhs.version != p_rhs.version) {
+        return true;
+    }
+    return p_lhs.offset < p_rhs.offset + p_rhs.size &&
+           p_rhs.offset < p_lhs.offset + p_lhs.size;
+}
+
+void InstructionScheduler::scheduleRegion(Instrs &p_instrs, const size_t p_begin,
+                                          const size_t p_end) {
+    const size_t num_instrs = p_end - p_begin;
+    std::vector<MachineInstr::Regs> uses, defs;
+    std::vector<MemoryAccess> accesses;
+    std::map<int, int> num_writes;
+    for (size_t i = p_begin; i < p_end; ++i) {
+        const MachineInstr &instr = p_instrs[i];
+        uses.push_back(instr.getUses());
+        defs.push_back(instr.getDefs());
+        MemoryAccess access = {kNoReg, 0, 0, 0, instr.isStore()};
+        if (instr.isLoad() || instr.isStore()) {
+            const MachineOperand &address = instr.getOperands().back();
+            const char width = instr.getOpcode()[1]; // lw, sh, lbu...
+            access.base = address.getReg();
+            access.version = num_writes[access.base];
+            access.offset = address.getImm();
+            access.size = width == 'w' ? 4 : width == 'h' ? 2 : 1;
+        }
+        accesses.push_back(access);
+        for (int reg : defs.back()) {
+            ++num_writes[reg];
+        }
+    }
+
+    std::vector<Node> nodes(num_instrs);
+    for (size_t i = 0; i < num_instrs; ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            int latency = -1;
+            if (overlaps(defs[j], uses[i])) {
+                latency = m_model.getLatency(p_instrs[p_begin + j]);
+            } else if (overlaps(defs[j], defs[i]) || overlaps(uses[j], defs[i])) {
+                latency = 0;
+            } else if (accesses[i].base != kNoReg && accesses[j].base != kNoReg &&
+                       (accesses[i].is_store || accesses[j].is_store) &&
+                       mayAlias(accesses[i], accesses[j])) {
+                latency = 0;
+            }
+            if (latency >= 0) {
+                nodes[j].succs.emplace_back(i, latency);
+                ++nodes[i].num_preds;
+            }
+        }
+    }
+    for (size_t i = num_instrs; i-- > 0;) {
+        // a result used past the region still has to be ready by then
+        nodes[i].height = m_model.getLatency(p_instrs[p_begin + i]);
+        for (const auto &succ : nodes[i].succs) {
+            nodes[i].height =
+                std::max(nodes[i].height, succ.second + nodes[succ.first].height);
+        }
+    }
+
+    std::vector<size_t> ready, order;
+    for (size_t i = 0; i < num_instrs; ++i) {
+        if (nodes[i].num_preds == 0) {
+            ready.push_back(i);
+        }
+    }
+    int cycle = 0;
+    while (!ready.empty()) {
+        // what can issue now, the longest path first, else the least stall
+        auto better = [&](const size_t p_lhs, const size_t p_rhs) {
+            const Node &lhs = nodes[p_lhs], &rhs = nodes[p_rhs];
+            const int lhs_start = std::max(lhs.earliest, cycle);
+            const int rhs_start = std::max(rhs.earliest, cycle);
+            if (lhs_start != rhs_start) {
+                return lhs_start < rhs_start;
+            }
+            if (lhs.height != rhs.height) {
+                return lhs.height > rhs.height;
+            }
+            return p_lhs < p_rhs;
+        };
+        auto it = std::min_element(ready.begin(), ready.end(), better);
+        const size_t next = *it;
+        ready.erase(it);
+        order.push_back(next);
+        cycle = std::max(cycle, nodes[next].earliest);
+        for (const auto &succ : nodes[next].succs) {
+            Node &node = nodes[succ.first];
+            node.earliest = std::max(node.earliest, cycle + succ.second);
+            if (--node.num_preds == 0) {
+                ready.push_back(succ.first);
+            }
+        }
+        ++cycle;
+    }
+
+    // keep the order as written unless the new one is faster, the
+    // terminator after the region included
+    std::vector<const MachineInstr *> before, after;
+    for (size_t i = 0; i < num_instrs; ++i) {
+        before.push_back(&p_instrs[p_begin + i]);
+        after.push_back(&p_instrs[p_begin + order[i]]);
+    }
+    if (p_end < p_instrs.size() && p_instrs[p_end].isInstruction()) {
+        before.push_back(&p_instrs[p_end]);
+        after.push_back(&p_instrs[p_end]);
+    }
+    if (countCycles(m_model, after) >= countCycles(m_model, before)) {
+        return;
+    }
+    Instrs scheduled;
+    for (size_t i = 0; i < num_instrs; ++i) {
+        scheduled.push_back(p_instrs[p_begin + order[i]]);
+        m_num_moved += order[i] != i;
+    }
+    std::copy(scheduled.begin(), scheduled.end(), p_instrs.begin() + p_begin);
+}
+
+void InstructionScheduler::run(MachineFunction &p_function) {
+    auto &instrs = p_function.getInstrs();
+    m_cycles_before += estimateCycles(instrs);
+    if (m_enabled) {
+        size_t begin = 0;
+        for (size_t i = 0; i <= instrs.size(); ++i) {
+            if (i == instrs.size() || isBarrier(instrs[i])) {
+                if (i > begin + 1) {
+                    scheduleRegion(instrs, begin, i);
+                }
+                begin = i + 1;
+            }
+        }
+    }
+    m_cycles_after += estimateCycles(instrs);
+}
+
+void InstructionScheduler::printStats(FILE *p_out_file) const {
+    fprintf(p_out_file,
+            "schedule (-mtune=%s): %zu instructions moved, estimated %zu -> "
+            "%zu cycles\n",
+            m_model.name, m_num_moved, m_cycles_before, m_cycles_after);
+}
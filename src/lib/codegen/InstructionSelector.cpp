@@ -0,0 +1,787 @@
+#include "codegen/InstructionSelector.hpp"
+#include "codegen/StrengthReduction.hpp"
+#include "ir/Profile.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+using ir::Opcode;
+
+// the calling convention of CodeGenerator: a0 ~ a7, then t3 ~ t6
+static const int kArgRegs[] = {reg::a0, reg::a1, reg::a2, reg::a3,
+                               reg::a4, reg::a5, reg::a6, reg::a7,
+                               reg::t3, reg::t4, reg::t5, reg::t6};
+
+static MachineOperand regOp(const int p_reg) {
+    return MachineOperand::createReg(p_reg);
+}
+
+static MachineOperand immOp(const int64_t p_imm) {
+    return MachineOperand::createImm(p_imm);
+}
+
+static MachineOperand memOp(const int p_base, const int64_t p_offset) {
+    return MachineOperand::createMem(p_base, p_offset);
+}
+
+static MachineOperand symOp(const std::string &p_symbol) {
+    return MachineOperand::createSymbol(p_symbol);
+}
+
+static std::string labelName(const int p_id) {
+    return "label" + std::to_string(p_id);
+}
+
+static bool fitsImm12(const int64_t p_value) {
+    return p_value >= -2048 && p_value <= 2047;
+}
+
+// what vadd.vi and vrsub.vi encode
+static bool fitsImm5(const int64_t p_value) {
+    return p_value >= -16 && p_value <= 15;
+}
+
+// The branch taken when p_opcode holds between its operands. RISC-V has
+// only blt and bge, so > and <= compare the operands the other way round.
+static const char *getBranchOpcode(const Opcode p_opcode,
+                                   bool &p_swap_operands) {
+    p_swap_operands = p_opcode == Opcode::kGt || p_opcode == Opcode::kLe;
+    switch (p_opcode) {
+    case Opcode::kLt:
+    case Opcode::kGt:
+        return "blt";
+    case Opcode::kLe:
+    case Opcode::kGe:
+        return "bge";
+    case Opcode::kEq:
+        return "beq";
+    default:
+        return "bne";
+    }
+}
+
+static Opcode negateCompare(const Opcode p_opcode) {
+    switch (p_opcode) {
+    case Opcode::kLt:
+        return Opcode::kGe;
+    case Opcode::kLe:
+        return Opcode::kGt;
+    case Opcode::kGt:
+        return Opcode::kLe;
+    case Opcode::kGe:
+        return Opcode::kLt;
+    case Opcode::kEq:
+        return Opcode::kNe;
+    default:
+        return Opcode::kEq;
+    }
+}
+
+void InstructionSelector::emit(const char *p_opcode,
+                               std::initializer_list<MachineOperand> p_operands) {
+    m_function.append(MachineInstr(p_opcode, p_operands));
+}
+
+void InstructionSelector::emitJump(const ir::BasicBlock *p_target) {
+    emit("j", {symOp(m_labels[p_target->getId()])});
+}
+
+void InstructionSelector::run() {
+    analyze();
+
+    m_slot_offsets.assign(m_ir_function.getNumSlotIds(), 0);
+    for (auto &slot : m_ir_function.getSlots()) {
+        m_slot_offsets[slot->id] = m_function.allocateStackSlot(slot->size);
+    }
+    m_labels.assign(m_ir_function.getNumBlockIds(), "");
+    for (auto &block : m_ir_function.getBlocks()) {
+        m_labels[block->getId()] = labelName(m_next_label++);
+    }
+
+    const auto &blocks = m_ir_function.getBlocks();
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const ir::BasicBlock &block = *blocks[i];
+        const ir::BasicBlock *next =
+            i + 1 < blocks.size() ? blocks[i + 1].get() : nullptr;
+        // nothing jumps to the entry
+        if (i > 0) {
+            m_function.append(MachineInstr::createLabel(m_labels[block.getId()]));
+        }
+        for (auto &instr : block.getInstrs()) {
+            if (instr->isPhi()) {
+                if (m_phi_temps[instr->getId()] != kNoReg) {
+                    emit("mv", {regOp(m_vregs[instr->getId()]),
+                                regOp(m_phi_temps[instr->getId()])});
+                }
+                continue;
+            }
+            if (instr->isTerminator()) {
+                emitPhiCopies(block);
+            }
+            select(*instr, next);
+        }
+    }
+}
+
+void InstructionSelector::analyze() {
+    const int num_values = m_ir_function.getNumValueIds();
+    m_vregs.assign(num_values, kNoReg);
+    m_phi_temps.assign(num_values, kNoReg);
+    m_num_uses.assign(num_values, 0);
+    m_users.assign(num_values, {});
+    m_fused.assign(num_values, false);
+    m_needs_reg.assign(num_values, false);
+
+    for (auto &block : m_ir_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            // vectors get theirs as they are selected
+            if (instr->hasResult() && !instr->isVector()) {
+                m_vregs[instr->getId()] = m_function.createVirtualReg();
+            }
+            for (const ir::Instruction *operand : instr->getOperands()) {
+                ++m_num_uses[operand->getId()];
+                m_users[operand->getId()].push_back(instr.get());
+            }
+        }
+    }
+
+    m_vector_uses_left = m_num_uses;
+
+    for (auto &block : m_ir_function.getBlocks()) {
+        const ir::Instruction *terminator = block->getTerminator();
+        if (terminator->getOpcode() != Opcode::kBranch) {
+            continue;
+        }
+        const ir::Instruction *cond = terminator->getOperand(0);
+        if (cond->isCompare() && cond->getParent() == block.get() &&
+            m_num_uses[cond->getId()] == 1) {
+            m_fused[cond->getId()] = true;
+        }
+    }
+
+    for (auto &block : m_ir_function.getBlocks()) {
+        if (needsPhiTemps(*block)) {
+            for (auto &instr : block->getInstrs()) {
+                if (!instr->isPhi()) {
+                    break;
+                }
+                m_phi_temps[instr->getId()] = m_function.createVirtualReg();
+            }
+        }
+    }
+
+    for (auto &block : m_ir_function.getBlocks()) {
+        for (const ir::BasicBlock *succ : block->getSuccessors()) {
+            for (auto &instr : succ->getInstrs()) {
+                if (!instr->isPhi()) {
+                    break;
+                }
+                if (canComputeIntoPhi(*instr, *block)) {
+                    m_vregs[instr->getIncomingValue(block.get())->getId()] =
+                        m_vregs[instr->getId()];
+                }
+            }
+        }
+    }
+
+    for (auto &block : m_ir_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            for (size_t i = 0; i < instr->getOperands().size(); ++i) {
+                const ir::Instruction *operand = instr->getOperand(i);
+                if (operand->isConst() && operand->getImm() != 0 &&
+                    !isImmediateOperand(*instr, i)) {
+                    m_needs_reg[operand->getId()] = true;
+                }
+            }
+        }
+    }
+}
+
+bool InstructionSelector::needsPhiTemps(const ir::BasicBlock &p_block) const {
+    const auto &instrs = p_block.getInstrs();
+    if (instrs.empty() || !instrs.front()->isPhi()) {
+        return false;
+    }
+    for (const ir::BasicBlock *pred : instrs.front()->getBlocks()) {
+        const bool branches =
+            pred->getTerminator()->getOpcode() != Opcode::kJump;
+        for (auto &instr : instrs) {
+            if (!instr->isPhi()) {
+                break;
+            }
+            const ir::Instruction *incoming = instr->getIncomingValue(pred);
+            if (incoming->isPhi() && incoming->getParent() == &p_block) {
+                return true;
+            }
+            if (!branches) {
+                continue;
+            }
+            // The other way out of the predecessor must not need the old
+            // value, and neither must the branch. That is only sure if
+            // the phi's own block is the only one using it.
+            for (const ir::Instruction *user : m_users[instr->getId()]) {
+                if (user->isPhi() || user->getParent() != &p_block ||
+                    (pred == &p_block && (user->isTerminator() ||
+                                          m_fused[user->getId()]))) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool InstructionSelector::canComputeIntoPhi(const ir::Instruction &p_phi,
+                                            const ir::BasicBlock &p_pred) const {
+    const ir::Instruction *value = p_phi.getIncomingValue(&p_pred);
+    if (m_phi_temps[p_phi.getId()] != kNoReg || value->getParent() != &p_pred ||
+        value->isPhi() || value->isConst()) {
+        return false;
+    }
+    // nothing but the copy and the branch reads the value, and the branch
+    // reads the copy
+    for (const ir::Instruction *user : m_users[value->getId()]) {
+        if (user != &p_phi &&
+            !(m_fused[user->getId()] && user->getParent() == &p_pred)) {
+            return false;
+        }
+    }
+    if (std::count(p_phi.getOperands().begin(), p_phi.getOperands().end(),
+                   value) != 1) {
+        return false;
+    }
+    // the old value of the phi is dead once the new one is computed
+    const size_t pos = p_pred.indexOf(value);
+    for (const ir::Instruction *user : m_users[p_phi.getId()]) {
+        if (user->getParent() == &p_pred && p_pred.indexOf(user) > pos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool InstructionSelector::isImmediateOperand(const ir::Instruction &p_user,
+                                             const size_t p_nth) const {
+    const ir::Instruction *operand = p_user.getOperand(p_nth);
+    if (!operand->isConst()) {
+        return false;
+    }
+    const int32_t imm = operand->getImm();
+    int num_temps = 0;
+    switch (p_user.getOpcode()) {
+    // loaded straight into the argument, return value or phi register
+    case Opcode::kCall:
+    case Opcode::kPrint:
+    case Opcode::kRet:
+    case Opcode::kPhi:
+        return true;
+    // commutative; the right operand goes first
+    case Opcode::kAdd:
+    case Opcode::kEq:
+    case Opcode::kNe:
+        if (m_fused[p_user.getId()] || !fitsImm12(imm)) {
+            return false;
+        }
+        return p_nth == 1 || !isImmediateOperand(p_user, 1);
+    case Opcode::kMul:
+        if (!isCheapMultiplier(imm)) {
+            return false;
+        }
+        return p_nth == 1 || !isImmediateOperand(p_user, 1);
+    case Opcode::kSub:
+        return p_nth == 1 && fitsImm12(-static_cast<int64_t>(imm));
+    case Opcode::kDiv:
+    case Opcode::kMod:
+        return p_nth == 1 && isReducibleDivisor(imm, num_temps);
+    case Opcode::kLt:
+    case Opcode::kGe:
+        return !m_fused[p_user.getId()] && p_nth == 1 && fitsImm12(imm);
+    case Opcode::kCount:
+        return fitsImm12(imm);
+    case Opcode::kVSplat:
+    // v - c is added as -c, c - v is vrsub
+    case Opcode::kVAdd:
+        return fitsImm5(imm);
+    case Opcode::kVSub:
+        return fitsImm5(p_nth == 1 ? -static_cast<int64_t>(imm) : imm);
+    default:
+        return false;
+    }
+}
+
+int InstructionSelector::getReg(const ir::Instruction *p_value) const {
+    if (p_value->isConst() && p_value->getImm() == 0) {
+        return reg::zero;
+    }
+    return m_vregs[p_value->getId()];
+}
+
+void InstructionSelector::emitCopy(const int p_dst,
+                                   const ir::Instruction *p_value) {
+    if (getReg(p_value) == p_dst) {
+        return;
+    }
+    if (p_value->isConst()) {
+        emit("li", {regOp(p_dst), immOp(p_value->getImm())});
+    } else {
+        emit("mv", {regOp(p_dst), regOp(getReg(p_value))});
+    }
+}
+
+void InstructionSelector::select(const ir::Instruction &p_instr,
+                                 const ir::BasicBlock *p_next) {
+    const int dst = p_instr.hasResult() ? m_vregs[p_instr.getId()] : kNoReg;
+    switch (p_instr.getOpcode()) {
+    case Opcode::kConst:
+        if (m_needs_reg[p_instr.getId()]) {
+            emit("li", {regOp(dst), immOp(p_instr.getImm())});
+        }
+        break;
+    case Opcode::kParam:
+        emit("mv", {regOp(dst), regOp(kArgRegs[p_instr.getImm()])});
+        break;
+    case Opcode::kAdd:
+    case Opcode::kSub:
+    case Opcode::kMul:
+    case Opcode::kDiv:
+    case Opcode::kMod:
+        selectBinary(p_instr);
+        break;
+    case Opcode::kEq:
+    case Opcode::kNe:
+    case Opcode::kLt:
+    case Opcode::kLe:
+    case Opcode::kGt:
+    case Opcode::kGe:
+        // a fused compare is emitted by its branch
+        if (!m_fused[p_instr.getId()]) {
+            selectCompare(p_instr);
+        }
+        break;
+    case Opcode::kNeg:
+        emit("neg", {regOp(dst), regOp(getReg(p_instr.getOperand(0)))});
+        break;
+    case Opcode::kNot:
+        emit("xori",
+             {regOp(dst), regOp(getReg(p_instr.getOperand(0))), immOp(1)});
+        break;
+    case Opcode::kLoad:
+        emit("lw", {regOp(dst),
+                    memOp(reg::s0, m_slot_offsets[p_instr.getSlot()->id])});
+        break;
+    case Opcode::kStore:
+        emit("sw", {regOp(getReg(p_instr.getOperand(0))),
+                    memOp(reg::s0, m_slot_offsets[p_instr.getSlot()->id])});
+        break;
+    case Opcode::kLoadGlobal:
+        emit("la", {regOp(dst), symOp(p_instr.getSymbol())});
+        emit("lw", {regOp(dst), memOp(dst, 0)});
+        break;
+    case Opcode::kStoreGlobal: {
+        const int addr = m_function.createVirtualReg();
+        emit("la", {regOp(addr), symOp(p_instr.getSymbol())});
+        emit("sw", {regOp(getReg(p_instr.getOperand(0))), memOp(addr, 0)});
+        break;
+    }
+    case Opcode::kAddr:
+        emit("addi", {regOp(dst), regOp(reg::s0),
+                      immOp(m_slot_offsets[p_instr.getSlot()->id])});
+        break;
+    case Opcode::kAddrGlobal:
+        emit("la", {regOp(dst), symOp(p_instr.getSymbol())});
+        break;
+    case Opcode::kLoadPtr: {
+        const MachineOperand address = selectAddress(p_instr, 0);
+        emit("lw", {regOp(dst), address});
+        break;
+    }
+    case Opcode::kStorePtr: {
+        const MachineOperand address = selectAddress(p_instr, 1);
+        emit("sw", {regOp(getReg(p_instr.getOperand(0))), address});
+        break;
+    }
+    case Opcode::kCall:
+        selectCall(p_instr);
+        break;
+    case Opcode::kPrint:
+        emitCopy(reg::a0, p_instr.getOperand(0));
+        m_function.append(MachineInstr::createCall("printInt", {reg::a0}));
+        break;
+    case Opcode::kRead:
+        m_function.append(MachineInstr::createCall("readInt", {}));
+        if (m_num_uses[p_instr.getId()] > 0) {
+            emit("mv", {regOp(dst), regOp(reg::a0)});
+        }
+        break;
+    case Opcode::kCount:
+        selectCount(p_instr);
+        break;
+    case Opcode::kPhi:
+        break;
+    case Opcode::kJump:
+        if (p_instr.getBlock(0) != p_next) {
+            emitJump(p_instr.getBlock(0));
+        }
+        break;
+    case Opcode::kBranch:
+        selectBranch(p_instr, p_next);
+        break;
+    case Opcode::kRet:
+        // the callee returns for it
+        if (p_instr.getParent()->getInstrs().size() > 1 &&
+            p_instr.getParent()->getInstrs().rbegin()[1]->isTailCall()) {
+            break;
+        }
+        if (!p_instr.getOperands().empty()) {
+            emitCopy(reg::a0, p_instr.getOperand(0));
+        }
+        // the epilogue follows the last block
+        if (p_next) {
+            emit("j", {symOp(labelName(m_return_label))});
+        }
+        break;
+    case Opcode::kVSetVL:
+    case Opcode::kVLoad:
+    case Opcode::kVSplat:
+    case Opcode::kVStore:
+    case Opcode::kVAdd:
+    case Opcode::kVSub:
+    case Opcode::kVMul:
+    case Opcode::kVRedSum:
+        selectVector(p_instr);
+        break;
+    }
+}
+
+MachineOperand InstructionSelector::selectAddress(const ir::Instruction &p_instr,
+                                                  const size_t p_nth) {
+    const int base = getReg(p_instr.getOperand(p_nth));
+    const int32_t offset = p_instr.getImm();
+    if (fitsImm12(offset)) {
+        return memOp(base, offset);
+    }
+    const int addr = m_function.createVirtualReg();
+    emit("li", {regOp(addr), immOp(offset)});
+    emit("add", {regOp(addr), regOp(addr), regOp(base)});
+    return memOp(addr, 0);
+}
+
+void InstructionSelector::selectCount(const ir::Instruction &p_instr) {
+    int addr = m_function.createVirtualReg();
+    emit("la", {regOp(addr), symOp(ir::Profile::kCounterTable)});
+    int32_t offset = p_instr.getImm() * 4;
+    if (!fitsImm12(offset)) {
+        const int base = addr;
+        addr = m_function.createVirtualReg();
+        emit("li", {regOp(addr), immOp(offset)});
+        emit("add", {regOp(addr), regOp(addr), regOp(base)});
+        offset = 0;
+    }
+    const int count = m_function.createVirtualReg();
+    emit("lw", {regOp(count), memOp(addr, offset)});
+    if (isImmediateOperand(p_instr, 0)) {
+        emit("addi", {regOp(count), regOp(count),
+                      immOp(p_instr.getOperand(0)->getImm())});
+    } else {
+        emit("add", {regOp(count), regOp(count),
+                     regOp(getReg(p_instr.getOperand(0)))});
+    }
+    emit("sw", {regOp(count), memOp(addr, offset)});
+}
+
+int InstructionSelector::allocateVectorReg() {
+    assert(!m_free_vector_regs.empty() && "out of vector registers");
+    const int reg = m_free_vector_regs.back();
+    m_free_vector_regs.pop_back();
+    return reg;
+}
+
+void InstructionSelector::releaseVectorOperands(const ir::Instruction &p_instr) {
+    for (const ir::Instruction *operand : p_instr.getOperands()) {
+        if (operand->isVector() && --m_vector_uses_left[operand->getId()] == 0) {
+            m_free_vector_regs.push_back(m_vregs[operand->getId()]);
+        }
+    }
+}
+
+void InstructionSelector::selectVector(const ir::Instruction &p_instr) {
+    const Opcode opcode = p_instr.getOpcode();
+    const int id = p_instr.getId();
+    if (opcode == Opcode::kVSetVL) {
+        // no vector lives across it, so every register group is free
+        m_lmul = p_instr.getImm();
+        m_free_vector_regs.clear();
+        for (int group = kNumVectorRegs - m_lmul; group > 0; group -= m_lmul) {
+            m_free_vector_regs.push_back(kFirstVectorReg + group);
+        }
+        const int vl = m_num_uses[id] > 0 ? m_vregs[id] : reg::zero;
+        emit("vsetvli", {regOp(vl), regOp(getReg(p_instr.getOperand(0))),
+                         symOp("e32"), symOp("m" + std::to_string(m_lmul)),
+                         symOp("ta"), symOp("ma")});
+        return;
+    }
+    if (opcode == Opcode::kVRedSum) {
+        // the sum goes through element 0 of a register of its own
+        const int temp = allocateVectorReg();
+        emit("vmv.s.x", {regOp(temp), regOp(getReg(p_instr.getOperand(1)))});
+        emit("vredsum.vs", {regOp(temp),
+                            regOp(m_vregs[p_instr.getOperand(0)->getId()]),
+                            regOp(temp)});
+        emit("vmv.x.s", {regOp(m_vregs[id]), regOp(temp)});
+        m_free_vector_regs.push_back(temp);
+        releaseVectorOperands(p_instr);
+        return;
+    }
+
+    // the result may take the register of an operand
+    releaseVectorOperands(p_instr);
+    if (opcode == Opcode::kVStore) {
+        emit("vse32.v", {regOp(m_vregs[p_instr.getOperand(0)->getId()]),
+                         memOp(getReg(p_instr.getOperand(1)), 0)});
+        return;
+    }
+    const int dst = m_vregs[id] = allocateVectorReg();
+    if (opcode == Opcode::kVLoad) {
+        emit("vle32.v", {regOp(dst), memOp(getReg(p_instr.getOperand(0)), 0)});
+        return;
+    }
+    if (opcode == Opcode::kVSplat) {
+        if (isImmediateOperand(p_instr, 0)) {
+            emit("vmv.v.i", {regOp(dst), immOp(p_instr.getOperand(0)->getImm())});
+        } else {
+            emit("vmv.v.x", {regOp(dst), regOp(getReg(p_instr.getOperand(0)))});
+        }
+        return;
+    }
+
+    const ir::Instruction *lhs = p_instr.getOperand(0);
+    const ir::Instruction *rhs = p_instr.getOperand(1);
+    std::string mnemonic = opcode == Opcode::kVAdd   ? "vadd"
+                           : opcode == Opcode::kVSub ? "vsub"
+                                                     : "vmul";
+    if (lhs->isVector() && rhs->isVector()) {
+        emit((mnemonic + ".vv").c_str(),
+             {regOp(dst), regOp(m_vregs[lhs->getId()]),
+              regOp(m_vregs[rhs->getId()])});
+        return;
+    }
+    // the vector comes first, so a scalar minus a vector is reversed
+    const size_t scalar_nth = lhs->isVector() ? 1 : 0;
+    const ir::Instruction *scalar = p_instr.getOperand(scalar_nth);
+    const int vector = m_vregs[p_instr.getOperand(1 - scalar_nth)->getId()];
+    if (opcode == Opcode::kVSub && scalar_nth == 0) {
+        mnemonic = "vrsub";
+    }
+    if (isImmediateOperand(p_instr, scalar_nth)) {
+        int64_t imm = scalar->getImm();
+        if (mnemonic == "vsub") {
+            mnemonic = "vadd";
+            imm = -imm;
+        }
+        emit((mnemonic + ".vi").c_str(), {regOp(dst), regOp(vector), immOp(imm)});
+    } else {
+        emit((mnemonic + ".vx").c_str(),
+             {regOp(dst), regOp(vector), regOp(getReg(scalar))});
+    }
+}
+
+void InstructionSelector::selectBinary(const ir::Instruction &p_instr) {
+    if (selectStrengthReduced(p_instr)) {
+        return;
+    }
+    const int dst = m_vregs[p_instr.getId()];
+    const ir::Instruction *lhs = p_instr.getOperand(0);
+    const ir::Instruction *rhs = p_instr.getOperand(1);
+    switch (p_instr.getOpcode()) {
+    case Opcode::kAdd:
+        if (isImmediateOperand(p_instr, 1)) {
+            emit("addi", {regOp(dst), regOp(getReg(lhs)), immOp(rhs->getImm())});
+        } else if (isImmediateOperand(p_instr, 0)) {
+            emit("addi", {regOp(dst), regOp(getReg(rhs)), immOp(lhs->getImm())});
+        } else {
+            emit("add", {regOp(dst), regOp(getReg(lhs)), regOp(getReg(rhs))});
+        }
+        break;
+    case Opcode::kSub:
+        if (isImmediateOperand(p_instr, 1)) {
+            emit("addi",
+                 {regOp(dst), regOp(getReg(lhs)),
+                  immOp(-static_cast<int64_t>(rhs->getImm()))});
+        } else {
+            emit("sub", {regOp(dst), regOp(getReg(lhs)), regOp(getReg(rhs))});
+        }
+        break;
+    case Opcode::kMul:
+        emit("mul", {regOp(dst), regOp(getReg(lhs)), regOp(getReg(rhs))});
+        break;
+    case Opcode::kDiv:
+        emit("div", {regOp(dst), regOp(getReg(lhs)), regOp(getReg(rhs))});
+        break;
+    case Opcode::kMod:
+        emit("rem", {regOp(dst), regOp(getReg(lhs)), regOp(getReg(rhs))});
+        break;
+    default:
+        break;
+    }
+}
+
+bool InstructionSelector::selectStrengthReduced(const ir::Instruction &p_instr) {
+    const Opcode opcode = p_instr.getOpcode();
+    if (opcode != Opcode::kMul && opcode != Opcode::kDiv &&
+        opcode != Opcode::kMod) {
+        return false;
+    }
+    size_t constant = 1;
+    if (!isImmediateOperand(p_instr, constant)) {
+        constant = 0;
+        if (!isImmediateOperand(p_instr, constant)) {
+            return false;
+        }
+    }
+    const int dst = m_vregs[p_instr.getId()];
+    const int src = getReg(p_instr.getOperand(1 - constant));
+    const int32_t value = p_instr.getOperand(constant)->getImm();
+    int num_temps = 0;
+    if (opcode == Opcode::kMul) {
+        emitMultiplyByConstant(m_function, dst, src, value);
+    } else {
+        isReducibleDivisor(value, num_temps);
+        const int temp = num_temps > 0 ? m_function.createVirtualReg() : kNoReg;
+        if (opcode == Opcode::kDiv) {
+            emitDivideByConstant(m_function, dst, src, value, temp);
+        } else {
+            emitModuloByConstant(m_function, dst, src, value, temp);
+        }
+    }
+    ++m_num_strength_reduced;
+    return true;
+}
+
+void InstructionSelector::selectCompare(const ir::Instruction &p_instr) {
+    const int dst = m_vregs[p_instr.getId()];
+    const ir::Instruction *lhs = p_instr.getOperand(0);
+    const ir::Instruction *rhs = p_instr.getOperand(1);
+    switch (p_instr.getOpcode()) {
+    case Opcode::kEq:
+    case Opcode::kNe: {
+        const char *test = p_instr.getOpcode() == Opcode::kEq ? "seqz" : "snez";
+        // x == c is (x ^ c) == 0, and x == 0 needs no xor at all
+        int operand = kNoReg;
+        if (isImmediateOperand(p_instr, 1) || isImmediateOperand(p_instr, 0)) {
+            const bool rhs_imm = isImmediateOperand(p_instr, 1);
+            const ir::Instruction *value = rhs_imm ? lhs : rhs;
+            const int32_t imm = (rhs_imm ? rhs : lhs)->getImm();
+            operand = getReg(value);
+            if (imm != 0) {
+                emit("xori", {regOp(dst), regOp(operand), immOp(imm)});
+                operand = dst;
+            }
+        } else {
+            emit("xor", {regOp(dst), regOp(getReg(lhs)), regOp(getReg(rhs))});
+            operand = dst;
+        }
+        emit(test, {regOp(dst), regOp(operand)});
+        break;
+    }
+    case Opcode::kLt:
+    case Opcode::kGe:
+        if (isImmediateOperand(p_instr, 1)) {
+            emit("slti", {regOp(dst), regOp(getReg(lhs)), immOp(rhs->getImm())});
+        } else {
+            emit("slt", {regOp(dst), regOp(getReg(lhs)), regOp(getReg(rhs))});
+        }
+        if (p_instr.getOpcode() == Opcode::kGe) {
+            emit("xori", {regOp(dst), regOp(dst), immOp(1)});
+        }
+        break;
+    case Opcode::kGt:
+    case Opcode::kLe:
+        emit("slt", {regOp(dst), regOp(getReg(rhs)), regOp(getReg(lhs))});
+        if (p_instr.getOpcode() == Opcode::kLe) {
+            emit("xori", {regOp(dst), regOp(dst), immOp(1)});
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+size_t InstructionSelector::getNumArgRegs() {
+    return sizeof(kArgRegs) / sizeof(kArgRegs[0]);
+}
+
+void InstructionSelector::selectCall(const ir::Instruction &p_instr) {
+    // every argument is already in a register of its own, so filling the
+    // argument registers in order overwrites nothing still needed
+    MachineInstr::Regs arg_regs;
+    for (size_t i = 0; i < p_instr.getOperands().size(); ++i) {
+        arg_regs.push_back(kArgRegs[i]);
+        emitCopy(kArgRegs[i], p_instr.getOperand(i));
+    }
+    if (p_instr.isTailCall()) {
+        m_function.append(
+            MachineInstr::createTailCall(p_instr.getSymbol(), arg_regs));
+        return;
+    }
+    m_function.append(MachineInstr::createCall(p_instr.getSymbol(), arg_regs));
+    if (m_num_uses[p_instr.getId()] > 0) {
+        emit("mv", {regOp(m_vregs[p_instr.getId()]), regOp(reg::a0)});
+    }
+}
+
+void InstructionSelector::selectBranch(const ir::Instruction &p_instr,
+                                       const ir::BasicBlock *p_next) {
+    const ir::Instruction *cond = p_instr.getOperand(0);
+    Opcode relation = Opcode::kNe;
+    int lhs = getReg(cond), rhs = reg::zero;
+    if (m_fused[cond->getId()]) {
+        relation = cond->getOpcode();
+        lhs = getReg(cond->getOperand(0));
+        rhs = getReg(cond->getOperand(1));
+    }
+    // read the copies instead, so the originals may die at the copy and
+    // share their registers
+    for (const auto &copy : m_copies) {
+        lhs = lhs == copy.first ? copy.second : lhs;
+        rhs = rhs == copy.first ? copy.second : rhs;
+    }
+    const ir::BasicBlock *taken = p_instr.getBlock(0);
+    const ir::BasicBlock *not_taken = p_instr.getBlock(1);
+    // fall through into whichever target comes next
+    if (taken == p_next) {
+        std::swap(taken, not_taken);
+        relation = negateCompare(relation);
+    }
+    bool swap_operands = false;
+    const char *opcode = getBranchOpcode(relation, swap_operands);
+    emit(opcode, {regOp(swap_operands ? rhs : lhs),
+                  regOp(swap_operands ? lhs : rhs),
+                  symOp(m_labels[taken->getId()])});
+    if (not_taken != p_next) {
+        emitJump(not_taken);
+    }
+}
+
+void InstructionSelector::emitPhiCopies(const ir::BasicBlock &p_block) {
+    m_copies.clear();
+    std::vector<const ir::BasicBlock *> visited;
+    for (const ir::BasicBlock *succ : p_block.getSuccessors()) {
+        if (std::find(visited.begin(), visited.end(), succ) != visited.end()) {
+            continue;
+        }
+        visited.push_back(succ);
+        for (auto &instr : succ->getInstrs()) {
+            if (!instr->isPhi()) {
+                break;
+            }
+            const int temp = m_phi_temps[instr->getId()];
+            const int dst = temp != kNoReg ? temp : m_vregs[instr->getId()];
+            const ir::Instruction *incoming = instr->getIncomingValue(&p_block);
+            emitCopy(dst, incoming);
+            if (!incoming->isConst()) {
+                m_copies.emplace_back(getReg(incoming), dst);
+            }
+        }
+    }
+}
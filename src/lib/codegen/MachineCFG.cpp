@@ -0,0 +1,111 @@
+#include "codegen/MachineCFG.hpp"
+
+#include <map>
+#include <string>
+
+std::vector<MachineBasicBlock>
+splitBasicBlocks(const MachineFunction::Instrs &p_instrs) {
+    std::vector<MachineBasicBlock> blocks;
+    std::map<std::string, size_t> label_to_block;
+
+    for (size_t i = 0; i < p_instrs.size(); ++i) {
+        const bool is_leader = i == 0 || p_instrs[i].isLabel() ||
+                               p_instrs[i - 1].isTerminator();
+        if (is_leader) {
+            if (!blocks.empty()) {
+                blocks.back().end = i;
+            }
+            blocks.push_back(MachineBasicBlock{i, p_instrs.size(), {}, {}});
+        }
+        if (p_instrs[i].isLabel()) {
+            label_to_block[p_instrs[i].getName()] = blocks.size() - 1;
+        }
+    }
+
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        auto &block = blocks[b];
+        const MachineInstr *last = nullptr;
+        for (size_t i = block.begin; i < block.end; ++i) {
+            if (p_instrs[i].isInstruction()) {
+                last = &p_instrs[i];
+            }
+        }
+
+        auto add_target = [&](const std::string &p_label) {
+            auto result = label_to_block.find(p_label);
+            // jumps out of the body (e.g. to the epilogue) leave the function
+            if (result != label_to_block.end()) {
+                block.succs.push_back(result->second);
+            }
+        };
+
+        if (last && last->isReturn()) {
+            continue;
+        }
+        if (last && (last->isBranch() || last->isUnconditionalJump())) {
+            add_target(*last->getBranchTarget());
+            if (last->isUnconditionalJump()) {
+                continue;
+            }
+        }
+        if (b + 1 < blocks.size()) {
+            block.succs.push_back(b + 1);
+        }
+    }
+
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (auto succ : blocks[b].succs) {
+            blocks[succ].preds.push_back(b);
+        }
+    }
+    return blocks;
+}
+
+// the iterative data-flow formulation: dom(b) = {b} + the meet of dom(p)
+// over the predecessors p of b
+static std::vector<std::vector<bool>>
+solveDominators(const std::vector<MachineBasicBlock> &p_blocks,
+                const size_t p_root, const bool p_reversed) {
+    const size_t num_blocks = p_blocks.size();
+    std::vector<std::vector<bool>> dominators(
+        num_blocks, std::vector<bool>(num_blocks, true));
+    if (num_blocks == 0) {
+        return dominators;
+    }
+    dominators[p_root].assign(num_blocks, false);
+    dominators[p_root][p_root] = true;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < num_blocks; ++i) {
+            const size_t b = p_reversed ? num_blocks - 1 - i : i;
+            if (b == p_root) {
+                continue;
+            }
+            const auto &preds = p_reversed ? p_blocks[b].succs : p_blocks[b].preds;
+            std::vector<bool> meet(num_blocks, true);
+            for (auto pred : preds) {
+                for (size_t d = 0; d < num_blocks; ++d) {
+                    meet[d] = meet[d] && dominators[pred][d];
+                }
+            }
+            meet[b] = true;
+            if (meet != dominators[b]) {
+                dominators[b] = std::move(meet);
+                changed = true;
+            }
+        }
+    }
+    return dominators;
+}
+
+std::vector<std::vector<bool>>
+computeDominators(const std::vector<MachineBasicBlock> &p_blocks) {
+    return solveDominators(p_blocks, 0, false);
+}
+
+std::vector<std::vector<bool>>
+computePostDominators(const std::vector<MachineBasicBlock> &p_blocks) {
+    return solveDominators(p_blocks, p_blocks.size() - 1, true);
+}
@@ -0,0 +1,402 @@
+#include "codegen/MachineFunction.hpp"
+#include "codegen/MachineCFG.hpp"
+
+#include <algorithm>
+
+static MachineOperand regOp(const int p_reg) {
+    return MachineOperand::createReg(p_reg);
+}
+
+static MachineOperand immOp(const int64_t p_imm) {
+    return MachineOperand::createImm(p_imm);
+}
+
+static MachineOperand memOp(const int p_base, const int64_t p_offset) {
+    return MachineOperand::createMem(p_base, p_offset);
+}
+
+// the largest frame that a single addi can allocate and address
+static constexpr int kMaxSmallFrameSize = 2032;
+// the reach of the 12-bit offset of a load or store, and of addi
+static constexpr int kMinImm12 = -2048;
+static constexpr int kMaxImm12 = 2047;
+
+int MachineFunction::getFrameSize() const {
+    // keep sp 16-byte aligned as the RISC-V psABI requires
+    return (-m_frame_bottom + 15) & ~15;
+}
+
+// Without s0 the slots are addressed from sp, which works as long as the
+// body neither moves sp (push/pop) nor takes the address of a slot.
+static bool needsFramePointer(const MachineFunction::Instrs &p_instrs) {
+    for (const auto &instr : p_instrs) {
+        for (const auto &operand : instr.getOperands()) {
+            if ((operand.isReg() &&
+                 (operand.getReg() == reg::s0 || operand.getReg() == reg::sp)) ||
+                (operand.isMem() && operand.getReg() == reg::sp)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static bool needsSave(const MachineFunction::Instrs &p_instrs,
+                      const MachineBasicBlock &p_block,
+                      const std::vector<int> &p_saved_regs) {
+    for (size_t i = p_block.begin; i < p_block.end; ++i) {
+        if (p_instrs[i].isCall()) {
+            return true;
+        }
+        for (auto reg : p_instrs[i].getUses()) {
+            if (std::count(p_saved_regs.begin(), p_saved_regs.end(), reg)) {
+                return true;
+            }
+        }
+        for (auto reg : p_instrs[i].getDefs()) {
+            if (std::count(p_saved_regs.begin(), p_saved_regs.end(), reg)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static std::vector<bool> reachableFrom(const std::vector<MachineBasicBlock> &p_blocks,
+                                       const size_t p_block, const bool p_reversed) {
+    std::vector<bool> reached(p_blocks.size(), false);
+    std::vector<size_t> worklist = {p_block};
+    while (!worklist.empty()) {
+        const size_t b = worklist.back();
+        worklist.pop_back();
+        for (auto next : p_reversed ? p_blocks[b].preds : p_blocks[b].succs) {
+            if (!reached[next]) {
+                reached[next] = true;
+                worklist.push_back(next);
+            }
+        }
+    }
+    return reached;
+}
+
+// the deepest of p_candidates in the (post-)dominator tree
+static size_t findDeepest(const std::vector<std::vector<bool>> &p_dominators,
+                          const std::vector<bool> &p_candidates) {
+    size_t deepest = 0, depth = 0;
+    for (size_t d = 0; d < p_dominators.size(); ++d) {
+        const size_t d_depth =
+            std::count(p_dominators[d].begin(), p_dominators[d].end(), true);
+        if (p_candidates[d] && d_depth > depth) {
+            deepest = d;
+            depth = d_depth;
+        }
+    }
+    return deepest;
+}
+
+// the nearest block that (post-)dominates every block in p_blocks
+static size_t findNearestCommon(const std::vector<std::vector<bool>> &p_dominators,
+                                const std::vector<size_t> &p_blocks) {
+    std::vector<bool> common(p_dominators.size(), true);
+    for (auto b : p_blocks) {
+        for (size_t d = 0; d < common.size(); ++d) {
+            common[d] = common[d] && p_dominators[b][d];
+        }
+    }
+    return findDeepest(p_dominators, common);
+}
+
+// where code placed at the start of p_block goes: after its labels
+static size_t getBlockStart(const MachineFunction::Instrs &p_instrs,
+                            const MachineBasicBlock &p_block) {
+    size_t pos = p_block.begin;
+    while (pos < p_block.end && p_instrs[pos].isLabel()) {
+        ++pos;
+    }
+    return pos;
+}
+
+// where code placed at the end of p_block goes: before its terminator
+static size_t getBlockEnd(const MachineFunction::Instrs &p_instrs,
+                          const MachineBasicBlock &p_block) {
+    for (size_t pos = p_block.end; pos-- > p_block.begin;) {
+        if (p_instrs[pos].isInstruction()) {
+            return p_instrs[pos].isTerminator() ? pos : pos + 1;
+        }
+    }
+    return p_block.end;
+}
+
+namespace {
+
+// positions in the instructions, before any insertion
+struct SaveRestorePoints {
+    size_t save;
+    std::vector<size_t> restores;
+};
+
+} // namespace
+
+// Shrink-wrapping: where ra and the callee-saved registers are saved and
+// restored. The save block dominates and the restore block post-dominates
+// every block that calls or touches one of them, so paths that need neither
+// (the base case of a recursion, say) skip both. When a return path that
+// skips the save joins the others only at the end of the body, the restores
+// go at the end of each return path that went through the save instead. A
+// save inside a loop would be repeated, so that case, like any function that
+// cannot always reach its end, keeps them at the entry and the exit (and in
+// front of every tail call).
+static SaveRestorePoints
+findSaveRestorePoints(const MachineFunction::Instrs &p_instrs,
+                      const std::vector<int> &p_saved_regs) {
+    const auto blocks = splitBasicBlocks(p_instrs);
+    const size_t entry = 0, exit = blocks.size() - 1;
+    SaveRestorePoints fallback = {0, {p_instrs.size()}};
+    // tail calls leave without reaching the end, so they restore for
+    // themselves
+    for (size_t i = 0; i < p_instrs.size(); ++i) {
+        if (p_instrs[i].isTailCall()) {
+            fallback.restores.push_back(i);
+        }
+    }
+    if (fallback.restores.size() > 1) {
+        return fallback;
+    }
+
+    const auto reachable = reachableFrom(blocks, entry, false);
+    const auto reaches_exit = reachableFrom(blocks, exit, true);
+    std::vector<size_t> needing;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (b != entry && !reachable[b]) {
+            continue;
+        }
+        if (b != exit && !reaches_exit[b]) {
+            return fallback;
+        }
+        if (needsSave(p_instrs, blocks[b], p_saved_regs)) {
+            needing.push_back(b);
+        }
+    }
+    auto is_needing = [&](const size_t p_block) {
+        return std::count(needing.begin(), needing.end(), p_block) > 0;
+    };
+    if (needing.empty() || is_needing(entry) || is_needing(exit)) {
+        return fallback;
+    }
+
+    const auto dominators = computeDominators(blocks);
+    const auto post_dominators = computePostDominators(blocks);
+    const size_t save = findNearestCommon(dominators, needing);
+    size_t restore = findNearestCommon(post_dominators, needing);
+    // restores go in front of the block, so it must not need them itself
+    while (is_needing(restore)) {
+        auto strict = post_dominators[restore];
+        strict[restore] = false;
+        restore = findDeepest(post_dominators, strict);
+    }
+
+    const auto reachable_from_save = reachableFrom(blocks, save, false);
+    if (save == entry || reachable_from_save[save]) {
+        return fallback;
+    }
+    if (dominators[restore][save] && !reachableFrom(blocks, restore, false)[restore]) {
+        return {getBlockStart(p_instrs, blocks[save]),
+                {restore == exit ? p_instrs.size()
+                                 : getBlockStart(p_instrs, blocks[restore])}};
+    }
+    if (restore != exit) {
+        return fallback;
+    }
+
+    SaveRestorePoints points = {getBlockStart(p_instrs, blocks[save]), {}};
+    for (auto pred : blocks[exit].preds) {
+        if (!reachable[pred] || (pred != save && !reachable_from_save[pred])) {
+            continue;
+        }
+        // a return path only reaches the end of the body through the save
+        // if every path to it does
+        if (!dominators[pred][save] || blocks[pred].succs.size() != 1) {
+            return fallback;
+        }
+        points.restores.push_back(getBlockEnd(p_instrs, blocks[pred]));
+    }
+    return points;
+}
+
+static bool fitsImm12(const int64_t p_imm) {
+    return p_imm >= kMinImm12 && p_imm <= kMaxImm12;
+}
+
+// Slots of a large frame may lie beyond the 12-bit offset of s0. Their
+// address is built in a register instead: loads and addi build it in the
+// register they write, stores in t0 (t1 when t0 is the value), which is
+// pushed around the store since any register may be live there.
+static void legalizeFrameOffsets(MachineFunction::Instrs &p_instrs) {
+    MachineFunction::Instrs legal;
+    legal.reserve(p_instrs.size());
+    for (auto &instr : p_instrs) {
+        const auto &ops = instr.getOperands();
+        if (instr.isInstruction() && instr.getOpcode() == "addi" &&
+            ops[1].getReg() == reg::s0 && !fitsImm12(ops[2].getImm())) {
+            const int dst = ops[0].getReg();
+            legal.emplace_back("li", MachineInstr::Operands{
+                                         regOp(dst), immOp(ops[2].getImm())});
+            legal.emplace_back("add", MachineInstr::Operands{
+                                          regOp(dst), regOp(reg::s0), regOp(dst)});
+            continue;
+        }
+        if (!instr.isInstruction() || ops.size() != 2 || !ops[1].isMem() ||
+            ops[1].getReg() != reg::s0 || fitsImm12(ops[1].getImm())) {
+            legal.push_back(instr);
+            continue;
+        }
+        const int value = ops[0].getReg();
+        const int64_t offset = ops[1].getImm();
+        if (instr.isLoad()) {
+            legal.emplace_back("li", MachineInstr::Operands{regOp(value),
+                                                            immOp(offset)});
+            legal.emplace_back("add", MachineInstr::Operands{
+                                          regOp(value), regOp(value), regOp(reg::s0)});
+            instr.getOperand(1) = memOp(value, 0);
+            legal.push_back(instr);
+            continue;
+        }
+        const int scratch = value == reg::t0 ? reg::t1 : reg::t0;
+        legal.emplace_back("addi", MachineInstr::Operands{regOp(reg::sp),
+                                                          regOp(reg::sp), immOp(-4)});
+        legal.emplace_back("sw", MachineInstr::Operands{regOp(scratch),
+                                                        memOp(reg::sp, 0)});
+        legal.emplace_back("li", MachineInstr::Operands{regOp(scratch),
+                                                        immOp(offset)});
+        legal.emplace_back("add", MachineInstr::Operands{
+                                      regOp(scratch), regOp(scratch), regOp(reg::s0)});
+        instr.getOperand(1) = memOp(scratch, 0);
+        legal.push_back(instr);
+        legal.emplace_back("lw", MachineInstr::Operands{regOp(scratch),
+                                                        memOp(reg::sp, 0)});
+        legal.emplace_back("addi", MachineInstr::Operands{regOp(reg::sp),
+                                                          regOp(reg::sp), immOp(4)});
+    }
+    p_instrs.swap(legal);
+}
+
+void MachineFunction::insertPrologueEpilogue() {
+    const bool has_call =
+        std::any_of(m_instrs.begin(), m_instrs.end(),
+                    [](const MachineInstr &p_instr) { return p_instr.isCall(); });
+    const bool uses_frame_pointer = needsFramePointer(m_instrs);
+
+    // ra only has to be kept if a call overwrites it
+    std::vector<int> saved_regs = m_saved_regs;
+    if (has_call) {
+        saved_regs.insert(saved_regs.begin(), reg::ra);
+    }
+    std::vector<int> saved_slots;
+    for (size_t i = 0; i < saved_regs.size(); ++i) {
+        saved_slots.push_back(allocateStackSlot(4));
+    }
+    // large frames are addressed from s0 as well
+    const bool has_frame_pointer =
+        uses_frame_pointer || getFrameSize() + 4 > kMaxSmallFrameSize;
+    const int fp_slot = has_frame_pointer ? allocateStackSlot(4) : 0;
+    const int frame_size = getFrameSize();
+    const bool is_small_frame = frame_size <= kMaxSmallFrameSize;
+
+    if (!has_frame_pointer) {
+        for (auto &instr : m_instrs) {
+            instr.forEachRegOperand([&](MachineOperand &p_operand) {
+                if (p_operand.isMem() && p_operand.getReg() == reg::s0) {
+                    p_operand.setReg(reg::sp);
+                    p_operand.setImm(p_operand.getImm() + frame_size);
+                }
+            });
+        }
+    }
+    auto slotOp = [&](const int p_slot) {
+        return has_frame_pointer ? memOp(reg::s0, p_slot)
+                                 : memOp(reg::sp, frame_size + p_slot);
+    };
+
+    Instrs saves, restores;
+    for (size_t i = 0; i < saved_regs.size(); ++i) {
+        saves.emplace_back("sw", MachineInstr::Operands{regOp(saved_regs[i]),
+                                                        slotOp(saved_slots[i])});
+        restores.emplace_back("lw", MachineInstr::Operands{
+                                        regOp(saved_regs[i]), slotOp(saved_slots[i])});
+    }
+    if (!saves.empty()) {
+        auto points = findSaveRestorePoints(m_instrs, saved_regs);
+        // insert from the back so that the positions stay valid
+        std::vector<std::pair<size_t, const Instrs *>> insertions = {
+            {points.save, &saves}};
+        for (auto pos : points.restores) {
+            insertions.emplace_back(pos, &restores);
+        }
+        std::sort(insertions.begin(), insertions.end(),
+                  [](const std::pair<size_t, const Instrs *> &p_lhs,
+                     const std::pair<size_t, const Instrs *> &p_rhs) {
+                      return p_lhs.first > p_rhs.first;
+                  });
+        for (const auto &insertion : insertions) {
+            m_instrs.insert(m_instrs.begin() + insertion.first,
+                            insertion.second->begin(), insertion.second->end());
+        }
+    }
+
+    Instrs prologue, epilogue;
+    if (frame_size == 0) {
+        // a leaf without slots needs no frame at all
+    } else if (is_small_frame) {
+        prologue.emplace_back("addi", MachineInstr::Operands{regOp(reg::sp),
+                                                             regOp(reg::sp),
+                                                             immOp(-frame_size)});
+        if (has_frame_pointer) {
+            prologue.emplace_back("sw", MachineInstr::Operands{
+                                            regOp(reg::s0),
+                                            memOp(reg::sp, frame_size + fp_slot)});
+            prologue.emplace_back("addi", MachineInstr::Operands{
+                                              regOp(reg::s0), regOp(reg::sp),
+                                              immOp(frame_size)});
+            epilogue.emplace_back("lw", MachineInstr::Operands{
+                                            regOp(reg::s0),
+                                            memOp(reg::sp, frame_size + fp_slot)});
+        }
+        epilogue.emplace_back("addi", MachineInstr::Operands{regOp(reg::sp),
+                                                             regOp(reg::sp),
+                                                             immOp(frame_size)});
+    } else {
+        // the saved registers sit at the bottom, within reach of sp; t0
+        // carries neither an argument nor the return value
+        prologue = {
+            MachineInstr("li", {regOp(reg::t0), immOp(-frame_size)}),
+            MachineInstr("add", {regOp(reg::sp), regOp(reg::sp), regOp(reg::t0)}),
+            MachineInstr("sw", {regOp(reg::s0), memOp(reg::sp, frame_size + fp_slot)}),
+            MachineInstr("sub", {regOp(reg::s0), regOp(reg::sp), regOp(reg::t0)})};
+        epilogue = {
+            MachineInstr("lw", {regOp(reg::s0), memOp(reg::sp, frame_size + fp_slot)}),
+            MachineInstr("li", {regOp(reg::t0), immOp(frame_size)}),
+            MachineInstr("add", {regOp(reg::sp), regOp(reg::sp), regOp(reg::t0)})};
+    }
+    // tail calls tear the frame down as well, ra already holds where the
+    // callee returns to
+    for (size_t i = 0; i < m_instrs.size(); ++i) {
+        if (m_instrs[i].isTailCall()) {
+            m_instrs.insert(m_instrs.begin() + i, epilogue.begin(), epilogue.end());
+            i += epilogue.size();
+        }
+    }
+    epilogue.emplace_back("jr", MachineInstr::Operands{regOp(reg::ra)});
+
+    m_instrs.insert(m_instrs.begin(), prologue.begin(), prologue.end());
+    m_instrs.insert(m_instrs.end(), epilogue.begin(), epilogue.end());
+
+    if (!is_small_frame) {
+        legalizeFrameOffsets(m_instrs);
+    }
+}
+
+void MachineFunction::print(FILE *p_out_file) const {
+    for (const auto &instr : m_instrs) {
+        std::fprintf(p_out_file, "%s\n", instr.toString().c_str());
+    }
+}
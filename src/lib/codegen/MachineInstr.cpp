@@ -0,0 +1,340 @@
+#include "codegen/MachineInstr.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstdlib>
+
+const char *kRegisterNames[kNumPhysRegs] = {
+    "zero", "ra", "sp", "gp", "tp",  "t0",  "t1", "t2", "s0", "s1", "a0",
+    "a1",   "a2", "a3", "a4", "a5",  "a6",  "a7", "s2", "s3", "s4", "s5",
+    "s6",   "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"};
+
+static const char *kVirtualRegPrefix = "%v";
+
+int lookupRegister(const std::string &p_name) {
+    for (int i = 0; i < kNumPhysRegs; ++i) {
+        if (p_name == kRegisterNames[i]) {
+            return i;
+        }
+    }
+    if (p_name == "fp") {
+        return reg::s0;
+    }
+    if (p_name.size() > 1 && p_name[0] == 'v' &&
+        std::all_of(p_name.begin() + 1, p_name.end(),
+                    [](const char p_c) { return std::isdigit(p_c); })) {
+        const int number = std::atoi(p_name.c_str() + 1);
+        return number < kNumVectorRegs ? kFirstVectorReg + number : kNoReg;
+    }
+    if (p_name.compare(0, 2, kVirtualRegPrefix) == 0) {
+        return kFirstVirtualReg + std::atoi(p_name.c_str() + 2);
+    }
+    return kNoReg;
+}
+
+std::string getRegisterName(const int p_reg) {
+    if (isVirtualReg(p_reg)) {
+        return kVirtualRegPrefix + std::to_string(p_reg - kFirstVirtualReg);
+    }
+    if (isVectorReg(p_reg)) {
+        return "v" + std::to_string(p_reg - kFirstVectorReg);
+    }
+    assert(p_reg >= 0 && p_reg < kNumPhysRegs && "invalid register number");
+    return kRegisterNames[p_reg];
+}
+
+// ===========================================
+// > MachineOperand
+// ===========================================
+MachineOperand MachineOperand::createReg(const int p_reg) {
+    MachineOperand operand(KindEnum::kRegister);
+    operand.m_reg = p_reg;
+    return operand;
+}
+
+MachineOperand MachineOperand::createImm(const int64_t p_imm) {
+    MachineOperand operand(KindEnum::kImmediate);
+    operand.m_imm = p_imm;
+    return operand;
+}
+
+MachineOperand MachineOperand::createMem(const int p_base,
+                                         const int64_t p_offset) {
+    MachineOperand operand(KindEnum::kMemory);
+    operand.m_reg = p_base;
+    operand.m_imm = p_offset;
+    return operand;
+}
+
+MachineOperand MachineOperand::createSymbol(const std::string &p_symbol) {
+    MachineOperand operand(KindEnum::kSymbol);
+    operand.m_symbol = p_symbol;
+    return operand;
+}
+
+bool MachineOperand::operator==(const MachineOperand &p_other) const {
+    return m_kind == p_other.m_kind && m_reg == p_other.m_reg &&
+           m_imm == p_other.m_imm && m_symbol == p_other.m_symbol;
+}
+
+std::string MachineOperand::toString() const {
+    switch (m_kind) {
+    case KindEnum::kRegister:
+        return getRegisterName(m_reg);
+    case KindEnum::kImmediate:
+        return std::to_string(m_imm);
+    case KindEnum::kMemory:
+        return std::to_string(m_imm) + "(" + getRegisterName(m_reg) + ")";
+    case KindEnum::kSymbol:
+        return m_symbol;
+    }
+    return "";
+}
+
+// ===========================================
+// > MachineInstr
+// ===========================================
+static const MachineInstr::Regs kCallerSavedRegs = {
+    reg::ra, reg::t0, reg::t1, reg::t2, reg::a0, reg::a1, reg::a2, reg::a3,
+    reg::a4, reg::a5, reg::a6, reg::a7, reg::t3, reg::t4, reg::t5, reg::t6};
+
+// argument registers of the calling convention used by CodeGenerator
+static const MachineInstr::Regs kAllArgRegs = {
+    reg::a0, reg::a1, reg::a2, reg::a3, reg::a4, reg::a5,
+    reg::a6, reg::a7, reg::t3, reg::t4, reg::t5, reg::t6};
+
+MachineInstr MachineInstr::createLabel(const std::string &p_name) {
+    MachineInstr instr(p_name, {});
+    instr.m_kind = KindEnum::kLabel;
+    return instr;
+}
+
+MachineInstr MachineInstr::createComment(const std::string &p_text) {
+    MachineInstr instr(p_text, {});
+    instr.m_kind = KindEnum::kComment;
+    return instr;
+}
+
+MachineInstr MachineInstr::createCall(const std::string &p_callee,
+                                      const Regs &p_arg_regs) {
+    MachineInstr instr("jal", {MachineOperand::createReg(reg::ra),
+                               MachineOperand::createSymbol(p_callee)});
+    instr.m_implicit_uses = p_arg_regs;
+    instr.m_implicit_defs = kCallerSavedRegs;
+    return instr;
+}
+
+MachineInstr MachineInstr::createTailCall(const std::string &p_callee,
+                                          const Regs &p_arg_regs) {
+    MachineInstr instr("tail", {MachineOperand::createSymbol(p_callee)});
+    instr.m_implicit_uses = p_arg_regs;
+    return instr;
+}
+
+static std::string trim(const std::string &p_str) {
+    auto begin = p_str.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    auto end = p_str.find_last_not_of(" \t");
+    return p_str.substr(begin, end - begin + 1);
+}
+
+static bool isIntegerLiteral(const std::string &p_str) {
+    if (p_str.empty()) {
+        return false;
+    }
+    char *end = nullptr;
+    std::strtoll(p_str.c_str(), &end, 0);
+    return *end == '\0';
+}
+
+static MachineOperand parseOperand(const std::string &p_text,
+                                   const bool p_is_symbol) {
+    if (p_is_symbol) {
+        // P identifiers such as "a1" would otherwise read as registers
+        return MachineOperand::createSymbol(p_text);
+    }
+
+    auto paren_pos = p_text.find('(');
+    if (paren_pos != std::string::npos && p_text.back() == ')' &&
+        p_text[0] != '%') {
+        auto base = lookupRegister(
+            p_text.substr(paren_pos + 1, p_text.size() - paren_pos - 2));
+        auto offset = p_text.substr(0, paren_pos);
+        assert(base != kNoReg && "unknown base register of memory operand");
+        return MachineOperand::createMem(
+            base, offset.empty() ? 0 : std::strtoll(offset.c_str(), nullptr, 0));
+    }
+
+    auto reg = lookupRegister(p_text);
+    if (reg != kNoReg) {
+        return MachineOperand::createReg(reg);
+    }
+
+    if (isIntegerLiteral(p_text)) {
+        return MachineOperand::createImm(std::strtoll(p_text.c_str(), nullptr, 0));
+    }
+
+    return MachineOperand::createSymbol(p_text);
+}
+
+MachineInstr MachineInstr::parse(const std::string &p_line) {
+    const std::string line = trim(p_line);
+
+    if (line.compare(0, 2, "//") == 0) {
+        return createComment(trim(line.substr(2)));
+    }
+    if (!line.empty() && line.back() == ':') {
+        return createLabel(line.substr(0, line.size() - 1));
+    }
+
+    auto space_pos = line.find_first_of(" \t");
+    MachineInstr instr(line.substr(0, space_pos), {});
+    const auto &opcode = instr.m_opcode;
+    const bool has_symbol_operand = opcode == "la" || opcode == "call" ||
+                                    opcode == "tail" || opcode == "j" ||
+                                    opcode == "jal" || opcode[0] == 'b';
+    if (space_pos != std::string::npos) {
+        std::string operands = line.substr(space_pos);
+        size_t begin = 0;
+        while (begin <= operands.size()) {
+            auto comma_pos = operands.find(',', begin);
+            if (comma_pos == std::string::npos) {
+                comma_pos = operands.size();
+            }
+            auto text = trim(operands.substr(begin, comma_pos - begin));
+            const bool is_last = operands.find(',', begin) == std::string::npos;
+            if (!text.empty()) {
+                instr.m_operands.push_back(
+                    parseOperand(text, has_symbol_operand && is_last));
+            }
+            begin = comma_pos + 1;
+        }
+    }
+
+    if (instr.isCall()) {
+        // the callee's arity is unknown from the text alone
+        instr.m_implicit_uses = kAllArgRegs;
+        instr.m_implicit_defs = kCallerSavedRegs;
+    } else if (instr.isTailCall()) {
+        instr.m_implicit_uses = kAllArgRegs;
+    }
+    return instr;
+}
+
+bool MachineInstr::isCall() const {
+    if (!isInstruction()) {
+        return false;
+    }
+    return m_opcode == "call" ||
+           (m_opcode == "jal" && !m_operands.empty() &&
+            m_operands.back().isSymbol() &&
+            (m_operands.size() == 1 || m_operands[0].getReg() == reg::ra));
+}
+
+bool MachineInstr::isReturn() const {
+    if (!isInstruction()) {
+        return false;
+    }
+    return m_opcode == "ret" || m_opcode == "tail" ||
+           (m_opcode == "jr" && m_operands.size() == 1 &&
+            m_operands[0].getReg() == reg::ra);
+}
+
+bool MachineInstr::isTailCall() const {
+    return isInstruction() && m_opcode == "tail";
+}
+
+bool MachineInstr::isBranch() const {
+    return isInstruction() && m_opcode[0] == 'b' && !m_operands.empty() &&
+           m_operands.back().isSymbol();
+}
+
+bool MachineInstr::isUnconditionalJump() const {
+    return isInstruction() && m_opcode == "j";
+}
+
+static const char *kLoadOpcodes[] = {"lw", "lh", "lhu", "lb", "lbu", "vle32.v"};
+static const char *kStoreOpcodes[] = {"sw", "sh", "sb", "vse32.v"};
+
+bool MachineInstr::isLoad() const {
+    return isInstruction() &&
+           std::find(std::begin(kLoadOpcodes), std::end(kLoadOpcodes),
+                     m_opcode) != std::end(kLoadOpcodes);
+}
+
+bool MachineInstr::isStore() const {
+    return isInstruction() &&
+           std::find(std::begin(kStoreOpcodes), std::end(kStoreOpcodes),
+                     m_opcode) != std::end(kStoreOpcodes);
+}
+
+bool MachineInstr::isVector() const {
+    return isInstruction() && m_opcode[0] == 'v';
+}
+
+const std::string *MachineInstr::getBranchTarget() const {
+    if (isBranch() || isUnconditionalJump()) {
+        return &m_operands.back().getSymbol();
+    }
+    return nullptr;
+}
+
+void MachineInstr::setBranchTarget(const std::string &p_label) {
+    assert((isBranch() || isUnconditionalJump()) &&
+           "only branches and jumps have a target");
+    m_operands.back().setSymbol(p_label);
+}
+
+bool MachineInstr::definesFirstOperand() const {
+    if (!isInstruction() || m_operands.empty() || !m_operands[0].isReg()) {
+        return false;
+    }
+    return !isStore() && !isBranch() && !isUnconditionalJump() &&
+           m_opcode != "jr" && m_opcode != "jalr";
+}
+
+MachineInstr::Regs MachineInstr::getUses() const {
+    Regs uses;
+    for (size_t i = definesFirstOperand() ? 1 : 0; i < m_operands.size(); ++i) {
+        if (m_operands[i].isReg() || m_operands[i].isMem()) {
+            uses.push_back(m_operands[i].getReg());
+        }
+    }
+    uses.insert(uses.end(), m_implicit_uses.begin(), m_implicit_uses.end());
+    return uses;
+}
+
+MachineInstr::Regs MachineInstr::getDefs() const {
+    Regs defs;
+    if (definesFirstOperand()) {
+        defs.push_back(m_operands[0].getReg());
+    }
+    defs.insert(defs.end(), m_implicit_defs.begin(), m_implicit_defs.end());
+    return defs;
+}
+
+std::string MachineInstr::toString() const {
+    switch (m_kind) {
+    case KindEnum::kLabel:
+        return m_opcode + ":";
+    case KindEnum::kComment:
+        return "// " + m_opcode;
+    case KindEnum::kInstruction:
+        break;
+    }
+
+    std::string text = "    " + m_opcode;
+    for (size_t i = 0; i < m_operands.size(); ++i) {
+        text += (i == 0) ? " " : ", ";
+        // vector loads and stores take no offset
+        if (isVector() && m_operands[i].isMem() && m_operands[i].getImm() == 0) {
+            text += "(" + getRegisterName(m_operands[i].getReg()) + ")";
+        } else {
+            text += m_operands[i].toString();
+        }
+    }
+    return text;
+}
@@ -0,0 +1,44 @@
+#include "codegen/MachineModel.hpp"
+
+static const MachineModel kMachineModels[] = {
+    // a classic five-stage pipeline with forwarding
+    {"generic", 2, 3, 20},
+    // Nuclei Bumblebee (GD32VF103): two stages, iterative mul/div unit
+    {"bumblebee", 2, 17, 33},
+    // Rocket and the SiFive 3 series
+    {"rocket", 3, 4, 33},
+};
+
+int MachineModel::getLatency(const MachineInstr &p_instr) const {
+    if (p_instr.isLoad()) {
+        return load_latency;
+    }
+    const std::string &opcode = p_instr.getOpcode();
+    if (opcode.compare(0, 3, "mul") == 0) {
+        return mul_latency;
+    }
+    if (opcode.compare(0, 3, "div") == 0 || opcode.compare(0, 3, "rem") == 0) {
+        return div_latency;
+    }
+    return 1;
+}
+
+const MachineModel *lookupMachineModel(const std::string &p_name) {
+    for (const auto &model : kMachineModels) {
+        if (p_name == model.name) {
+            return &model;
+        }
+    }
+    return nullptr;
+}
+
+std::string getMachineModelNames() {
+    std::string names;
+    for (const auto &model : kMachineModels) {
+        if (!names.empty()) {
+            names += '|';
+        }
+        names += model.name;
+    }
+    return names;
+}
@@ -0,0 +1,270 @@
+#include "codegen/PeepholeOptimizer.hpp"
+
+#include <algorithm>
+#include <set>
+#include <string>
+
+using Instrs = PeepholeOptimizer::Instrs;
+
+static bool contains(const MachineInstr::Regs &p_regs, const int p_reg) {
+    return std::find(p_regs.begin(), p_regs.end(), p_reg) != p_regs.end();
+}
+
+static bool readsReg(const MachineInstr &p_instr, const int p_reg) {
+    return contains(p_instr.getUses(), p_reg);
+}
+
+static bool writesReg(const MachineInstr &p_instr, const int p_reg) {
+    return contains(p_instr.getDefs(), p_reg);
+}
+
+static bool isSpAdjust(const MachineInstr &p_instr, const int64_t p_amount) {
+    return p_instr.isInstruction() && p_instr.getOpcode() == "addi" &&
+           p_instr.getOperands().size() == 3 &&
+           p_instr.getOperand(0).isReg() &&
+           p_instr.getOperand(0).getReg() == reg::sp &&
+           p_instr.getOperand(1).isReg() &&
+           p_instr.getOperand(1).getReg() == reg::sp &&
+           p_instr.getOperand(2).isImm() &&
+           p_instr.getOperand(2).getImm() == p_amount;
+}
+
+static bool isStackTop(const MachineOperand &p_operand) {
+    return p_operand.isMem() && p_operand.getReg() == reg::sp &&
+           p_operand.getImm() == 0;
+}
+
+static MachineInstr createMove(const int p_dst, const int p_src) {
+    return MachineInstr("mv", {MachineOperand::createReg(p_dst),
+                               MachineOperand::createReg(p_src)});
+}
+
+// addi sp, sp, -4; sw x, 0(sp); ...; lw y, 0(sp); addi sp, sp, 4
+// => ...; mv y, x
+static bool cancelPushPop(const PeepholeOptimizer &p_optimizer,
+                          Instrs &p_instrs, const size_t p_pos) {
+    const auto window = p_optimizer.getWindow(p_instrs, p_pos);
+    if (window.size() < 4 || !isSpAdjust(p_instrs[window[0]], -4)) {
+        return false;
+    }
+    const auto &push = p_instrs[window[1]];
+    if (push.getOpcode() != "sw" || !isStackTop(push.getOperand(1))) {
+        return false;
+    }
+    const int pushed = push.getOperand(0).getReg();
+
+    for (size_t k = 2; k + 1 < window.size(); ++k) {
+        const auto &instr = p_instrs[window[k]];
+        if (instr.getOpcode() == "lw" && isStackTop(instr.getOperand(1)) &&
+            isSpAdjust(p_instrs[window[k + 1]], 4)) {
+            const int popped = instr.getOperand(0).getReg();
+            p_instrs.erase(p_instrs.begin() + window[k + 1]);
+            if (popped == pushed) {
+                p_instrs.erase(p_instrs.begin() + window[k]);
+            } else {
+                p_instrs[window[k]] = createMove(popped, pushed);
+            }
+            p_instrs.erase(p_instrs.begin() + window[1]);
+            p_instrs.erase(p_instrs.begin() + window[0]);
+            return true;
+        }
+        if (instr.isCall() || instr.isTerminator() || readsReg(instr, reg::sp) ||
+            writesReg(instr, reg::sp) || writesReg(instr, pushed)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// mv x, x => (nothing)
+// mv x, y; ...; mv y, x => mv x, y; ...
+// mv x, y; ...; (x overwritten before any read) => ...
+static bool removeRedundantMove(const PeepholeOptimizer &p_optimizer,
+                                Instrs &p_instrs, const size_t p_pos) {
+    const auto &move = p_instrs[p_pos];
+    if (move.getOpcode() != "mv") {
+        return false;
+    }
+    const int dst = move.getOperand(0).getReg();
+    const int src = move.getOperand(1).getReg();
+    if (dst == src) {
+        p_instrs.erase(p_instrs.begin() + p_pos);
+        return true;
+    }
+
+    const auto window = p_optimizer.getWindow(p_instrs, p_pos);
+    for (size_t k = 1; k < window.size(); ++k) {
+        const auto &instr = p_instrs[window[k]];
+        if (instr.getOpcode() == "mv" && instr.getOperand(0).getReg() == src &&
+            instr.getOperand(1).getReg() == dst) {
+            p_instrs.erase(p_instrs.begin() + window[k]);
+            return true;
+        }
+        if (readsReg(instr, dst) || instr.isTerminator() ||
+            writesReg(instr, src)) {
+            return false;
+        }
+        if (writesReg(instr, dst)) {
+            p_instrs.erase(p_instrs.begin() + p_pos);
+            return true;
+        }
+    }
+    return false;
+}
+
+// sw x, off(b); ...; lw y, off(b) => sw x, off(b); ...; mv y, x
+static bool forwardStoreToLoad(const PeepholeOptimizer &p_optimizer,
+                               Instrs &p_instrs, const size_t p_pos) {
+    const auto &store = p_instrs[p_pos];
+    if (store.getOpcode() != "sw") {
+        return false;
+    }
+    const int value = store.getOperand(0).getReg();
+    const auto &address = store.getOperand(1);
+
+    const auto window = p_optimizer.getWindow(p_instrs, p_pos);
+    for (size_t k = 1; k < window.size(); ++k) {
+        auto &instr = p_instrs[window[k]];
+        if (instr.getOpcode() == "lw" && instr.getOperand(1) == address) {
+            const int loaded = instr.getOperand(0).getReg();
+            if (loaded == value) {
+                p_instrs.erase(p_instrs.begin() + window[k]);
+            } else {
+                instr = createMove(loaded, value);
+            }
+            return true;
+        }
+        if (instr.isStore() || instr.isCall() || instr.isTerminator() ||
+            writesReg(instr, value) || writesReg(instr, address.getReg())) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// j L; L: => L:
+static bool removeJumpToNext(const PeepholeOptimizer &p_optimizer,
+                             Instrs &p_instrs, const size_t p_pos) {
+    const auto &jump = p_instrs[p_pos];
+    if (!jump.isUnconditionalJump()) {
+        return false;
+    }
+    for (size_t i = p_pos + 1; i < p_instrs.size(); ++i) {
+        if (p_instrs[i].isInstruction()) {
+            break;
+        }
+        if (p_instrs[i].isLabel() &&
+            p_instrs[i].getName() == *jump.getBranchTarget()) {
+            p_instrs.erase(p_instrs.begin() + p_pos);
+            return true;
+        }
+    }
+    return false;
+}
+
+// the first instruction at label p_label, nullptr if there is none
+static const MachineInstr *findInstrAt(const Instrs &p_instrs,
+                                       const std::string &p_label) {
+    auto it = std::find_if(p_instrs.begin(), p_instrs.end(),
+                           [&](const MachineInstr &p_instr) {
+                               return p_instr.isLabel() &&
+                                      p_instr.getName() == p_label;
+                           });
+    for (; it != p_instrs.end(); ++it) {
+        if (it->isInstruction()) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+// b/j L; ...; L: j M => b/j M
+static bool threadJump(const PeepholeOptimizer &p_optimizer, Instrs &p_instrs,
+                       const size_t p_pos) {
+    auto &jump = p_instrs[p_pos];
+    if (!jump.isBranch() && !jump.isUnconditionalJump()) {
+        return false;
+    }
+
+    std::set<std::string> visited = {*jump.getBranchTarget()};
+    std::string target = *jump.getBranchTarget();
+    for (;;) {
+        const auto *next = findInstrAt(p_instrs, target);
+        if (!next || !next->isUnconditionalJump()) {
+            break;
+        }
+        if (!visited.insert(*next->getBranchTarget()).second) {
+            // jumps in a cycle, i.e. an endless loop; keep it as written
+            return false;
+        }
+        target = *next->getBranchTarget();
+    }
+    if (target == *jump.getBranchTarget()) {
+        return false;
+    }
+    jump.setBranchTarget(target);
+    return true;
+}
+
+// New rules go here; the order is the order they are tried in.
+static const PeepholeOptimizer::Rule kRules[] = {
+    {"push-pop", cancelPushPop},
+    {"redundant-mv", removeRedundantMove},
+    {"store-load", forwardStoreToLoad},
+    {"jump-to-next", removeJumpToNext},
+    {"jump-thread", threadJump},
+};
+static const size_t kNumRules = sizeof(kRules) / sizeof(kRules[0]);
+
+PeepholeOptimizer::PeepholeOptimizer(const size_t p_window_size)
+    : m_window_size(p_window_size), m_hits(kNumRules, 0) {}
+
+std::vector<size_t> PeepholeOptimizer::getWindow(const Instrs &p_instrs,
+                                                 const size_t p_pos) const {
+    std::vector<size_t> window;
+    for (size_t i = p_pos; i < p_instrs.size() && window.size() < m_window_size;
+         ++i) {
+        if (p_instrs[i].isLabel()) {
+            break;
+        }
+        if (p_instrs[i].isInstruction()) {
+            window.push_back(i);
+        }
+    }
+    return window;
+}
+
+void PeepholeOptimizer::run(MachineFunction &p_function) {
+    if (m_window_size == 0) {
+        return;
+    }
+
+    auto &instrs = p_function.getInstrs();
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t pos = 0; pos < instrs.size();) {
+            bool applied = false;
+            for (size_t r = 0; r < kNumRules && !applied; ++r) {
+                if (instrs[pos].isInstruction() &&
+                    kRules[r].apply(*this, instrs, pos)) {
+                    ++m_hits[r];
+                    applied = true;
+                }
+            }
+            // whatever is at pos now gets another chance
+            if (applied) {
+                changed = true;
+            } else {
+                ++pos;
+            }
+        }
+    }
+}
+
+void PeepholeOptimizer::printStats(FILE *p_out_file) const {
+    fprintf(p_out_file, "peephole (window %zu):\n", m_window_size);
+    for (size_t r = 0; r < kNumRules; ++r) {
+        fprintf(p_out_file, "    %-16s %zu\n", kRules[r].name, m_hits[r]);
+    }
+}
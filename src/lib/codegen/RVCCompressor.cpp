@@ -0,0 +1,261 @@
+#include "codegen/RVCCompressor.hpp"
+
+#include <map>
+
+using Instrs = RVCCompressor::Instrs;
+using Operands = MachineInstr::Operands;
+
+static MachineOperand regOp(const int p_reg) {
+    return MachineOperand::createReg(p_reg);
+}
+
+// x8 ~ x15, the registers of the 3-bit fields
+static bool isCompressibleReg(const int p_reg) {
+    return p_reg >= reg::s0 && p_reg <= reg::a5;
+}
+
+static bool fitsSigned(const int64_t p_imm, const int p_bits) {
+    return p_imm >= -(int64_t{1} << (p_bits - 1)) &&
+           p_imm < (int64_t{1} << (p_bits - 1));
+}
+
+// an unsigned offset of p_bits scaled by 4
+static bool fitsWordOffset(const int64_t p_offset, const int p_bits) {
+    return p_offset >= 0 && p_offset % 4 == 0 &&
+           p_offset < (int64_t{1} << p_bits);
+}
+
+static bool matches(const Operands &p_operands, const char *p_kinds) {
+    size_t i = 0;
+    for (; p_kinds[i] != '\0'; ++i) {
+        if (i == p_operands.size()) {
+            return false;
+        }
+        const MachineOperand &operand = p_operands[i];
+        const bool ok = (p_kinds[i] == 'r' && operand.isReg()) ||
+                        (p_kinds[i] == 'i' && operand.isImm()) ||
+                        (p_kinds[i] == 'm' && operand.isMem()) ||
+                        (p_kinds[i] == 's' && operand.isSymbol());
+        if (!ok) {
+            return false;
+        }
+    }
+    return i == p_operands.size();
+}
+
+// the 16-bit form of p_instr in p_result, if there is one; jumps and
+// branches still have to be checked for their reach
+static bool compress(const MachineInstr &p_instr, MachineInstr &p_result) {
+    const std::string &opcode = p_instr.getOpcode();
+    const Operands &ops = p_instr.getOperands();
+    auto rewrite = [&](const char *p_opcode, const Operands &p_operands) {
+        p_result = MachineInstr(p_opcode, p_operands);
+        return true;
+    };
+
+    if (opcode == "addi" && matches(ops, "rri")) {
+        const int rd = ops[0].getReg(), rs = ops[1].getReg();
+        const int64_t imm = ops[2].getImm();
+        if (rd == reg::sp && rs == reg::sp && imm != 0 && imm % 16 == 0 &&
+            fitsSigned(imm, 10)) {
+            return rewrite("c.addi16sp", {ops[0], ops[2]});
+        }
+        if (rd == rs && rd != reg::zero && imm != 0 && fitsSigned(imm, 6)) {
+            return rewrite("c.addi", {ops[0], ops[2]});
+        }
+        if (rs == reg::sp && isCompressibleReg(rd) && imm != 0 &&
+            fitsWordOffset(imm, 10)) {
+            return rewrite("c.addi4spn", ops);
+        }
+        if (imm == 0 && rd != reg::zero && rs != reg::zero) {
+            return rewrite("c.mv", {ops[0], ops[1]});
+        }
+        return false;
+    }
+    if (opcode == "li" && matches(ops, "ri")) {
+        if (ops[0].getReg() != reg::zero && fitsSigned(ops[1].getImm(), 6)) {
+            return rewrite("c.li", ops);
+        }
+        return false;
+    }
+    if (opcode == "mv" && matches(ops, "rr")) {
+        if (ops[0].getReg() != reg::zero && ops[1].getReg() != reg::zero) {
+            return rewrite("c.mv", ops);
+        }
+        return false;
+    }
+    if ((opcode == "lw" || opcode == "sw") && matches(ops, "rm")) {
+        const int rd = ops[0].getReg(), base = ops[1].getReg();
+        const int64_t offset = ops[1].getImm();
+        if (base == reg::sp && (opcode == "sw" || rd != reg::zero) &&
+            fitsWordOffset(offset, 8)) {
+            return rewrite(opcode == "lw" ? "c.lwsp" : "c.swsp", ops);
+        }
+        if (isCompressibleReg(rd) && isCompressibleReg(base) &&
+            fitsWordOffset(offset, 7)) {
+            return rewrite(opcode == "lw" ? "c.lw" : "c.sw", ops);
+        }
+        return false;
+    }
+    if (opcode == "add" && matches(ops, "rrr")) {
+        const int rd = ops[0].getReg(), rs1 = ops[1].getReg(),
+                  rs2 = ops[2].getReg();
+        if (rd == reg::zero) {
+            return false;
+        }
+        if (rs1 == reg::zero && rs2 != reg::zero) {
+            return rewrite("c.mv", {ops[0], ops[2]});
+        }
+        if (rd == rs1 && rs2 != reg::zero) {
+            return rewrite("c.add", {ops[0], ops[2]});
+        }
+        if (rd == rs2 && rs1 != reg::zero) {
+            return rewrite("c.add", {ops[0], ops[1]});
+        }
+        return false;
+    }
+    if ((opcode == "sub" || opcode == "xor" || opcode == "or" ||
+         opcode == "and") &&
+        matches(ops, "rrr")) {
+        const int rd = ops[0].getReg(), rs1 = ops[1].getReg(),
+                  rs2 = ops[2].getReg();
+        const std::string c_opcode = "c." + opcode;
+        if (!isCompressibleReg(rd)) {
+            return false;
+        }
+        if (rd == rs1 && isCompressibleReg(rs2)) {
+            return rewrite(c_opcode.c_str(), {ops[0], ops[2]});
+        }
+        if (opcode != "sub" && rd == rs2 && isCompressibleReg(rs1)) {
+            return rewrite(c_opcode.c_str(), {ops[0], ops[1]});
+        }
+        return false;
+    }
+    if (opcode == "andi" && matches(ops, "rri")) {
+        if (ops[0].getReg() == ops[1].getReg() &&
+            isCompressibleReg(ops[0].getReg()) && fitsSigned(ops[2].getImm(), 6)) {
+            return rewrite("c.andi", {ops[0], ops[2]});
+        }
+        return false;
+    }
+    if ((opcode == "slli" || opcode == "srli" || opcode == "srai") &&
+        matches(ops, "rri")) {
+        const int rd = ops[0].getReg();
+        const int64_t shamt = ops[2].getImm();
+        const bool reg_ok =
+            opcode == "slli" ? rd != reg::zero : isCompressibleReg(rd);
+        if (rd == ops[1].getReg() && reg_ok && shamt > 0 && shamt < 32) {
+            return rewrite(("c." + opcode).c_str(), {ops[0], ops[2]});
+        }
+        return false;
+    }
+    if (opcode == "jr" && matches(ops, "r") && ops[0].getReg() != reg::zero) {
+        return rewrite("c.jr", ops);
+    }
+    if (opcode == "ret" && ops.empty()) {
+        return rewrite("c.jr", {regOp(reg::ra)});
+    }
+    if (opcode == "j" && matches(ops, "s")) {
+        return rewrite("c.j", ops);
+    }
+    if ((opcode == "beq" || opcode == "bne") && matches(ops, "rrs")) {
+        const char *c_opcode = opcode == "beq" ? "c.beqz" : "c.bnez";
+        const int rs1 = ops[0].getReg(), rs2 = ops[1].getReg();
+        if (rs2 == reg::zero && isCompressibleReg(rs1)) {
+            return rewrite(c_opcode, {ops[0], ops[2]});
+        }
+        if (rs1 == reg::zero && isCompressibleReg(rs2)) {
+            return rewrite(c_opcode, {ops[1], ops[2]});
+        }
+        return false;
+    }
+    if ((opcode == "beqz" || opcode == "bnez") && matches(ops, "rs") &&
+        isCompressibleReg(ops[0].getReg())) {
+        return rewrite(opcode == "beqz" ? "c.beqz" : "c.bnez", ops);
+    }
+    return false;
+}
+
+size_t RVCCompressor::getSize(const MachineInstr &p_instr) {
+    if (!p_instr.isInstruction()) {
+        return 0;
+    }
+    const std::string &opcode = p_instr.getOpcode();
+    if (opcode.compare(0, 2, "c.") == 0) {
+        return 2;
+    }
+    if (opcode == "la" || opcode == "call" || opcode == "tail") {
+        return 8; // auipc + addi/jalr
+    }
+    if (opcode == "li" && p_instr.getOperands().size() == 2 &&
+        p_instr.getOperand(1).isImm()) {
+        // lui + addi unless one of them does it alone
+        const int64_t imm = p_instr.getOperand(1).getImm();
+        return fitsSigned(imm, 12) || (imm & 0xfff) == 0 ? 4 : 8;
+    }
+    return 4;
+}
+
+void RVCCompressor::run(MachineFunction &p_function) {
+    Instrs &instrs = p_function.getInstrs();
+    std::vector<MachineInstr> compressed(instrs.size(), MachineInstr("", {}));
+    std::vector<bool> is_compressed(instrs.size(), false);
+    size_t size_before = 0;
+    for (size_t i = 0; i < instrs.size(); ++i) {
+        size_before += getSize(instrs[i]);
+        if (instrs[i].isInstruction()) {
+            is_compressed[i] = compress(instrs[i], compressed[i]);
+        }
+    }
+
+    // giving up on a jump only makes the code longer, so this ends
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        std::map<std::string, int64_t> labels;
+        std::vector<int64_t> addresses(instrs.size());
+        int64_t address = 0;
+        for (size_t i = 0; i < instrs.size(); ++i) {
+            addresses[i] = address;
+            if (instrs[i].isLabel()) {
+                labels[instrs[i].getName()] = address;
+            }
+            address += is_compressed[i] ? 2 : getSize(instrs[i]);
+        }
+        for (size_t i = 0; i < instrs.size(); ++i) {
+            const std::string *target = instrs[i].getBranchTarget();
+            if (!is_compressed[i] || !target) {
+                continue;
+            }
+            auto it = labels.find(*target);
+            // c.j reaches +-2 KiB, c.beqz and c.bnez +-256 bytes
+            const int bits = instrs[i].isUnconditionalJump() ? 12 : 9;
+            if (it == labels.end() ||
+                !fitsSigned(it->second - addresses[i], bits)) {
+                is_compressed[i] = false;
+                changed = true;
+            }
+        }
+    }
+
+    size_t size_after = 0;
+    for (size_t i = 0; i < instrs.size(); ++i) {
+        if (is_compressed[i]) {
+            instrs[i] = compressed[i];
+        }
+        size_after += getSize(instrs[i]);
+    }
+    m_sizes.push_back({p_function.getName(), size_before, size_after});
+}
+
+void RVCCompressor::printStats(FILE *p_out_file) const {
+    size_t before = 0, after = 0;
+    fprintf(p_out_file, "rvc:\n");
+    for (const auto &size : m_sizes) {
+        fprintf(p_out_file, "    %-16s %zu -> %zu bytes\n", size.name.c_str(),
+                size.before, size.after);
+        before += size.before;
+        after += size.after;
+    }
+    fprintf(p_out_file, "    %-16s %zu -> %zu bytes\n", "(total)", before, after);
+}
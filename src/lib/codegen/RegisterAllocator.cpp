@@ -0,0 +1,420 @@
+#include "codegen/RegisterAllocator.hpp"
+#include "codegen/MachineCFG.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+// Allocatable registers in order of preference. Caller-saved registers come
+// first since they cost nothing in the prologue; intervals that live across a
+// call conflict with all of them and end up in s1 ~ s11.
+static const int kAllocationOrder[] = {
+    reg::t2, reg::t3, reg::t4, reg::t5, reg::t6,  reg::a7, reg::a6,
+    reg::a5, reg::a4, reg::a3, reg::a2, reg::a1,  reg::a0, reg::s1,
+    reg::s2, reg::s3, reg::s4, reg::s5, reg::s6,  reg::s7, reg::s8,
+    reg::s9, reg::s10, reg::s11};
+
+// The same with a5 ~ a0 and s1 (x9 ~ x15) ahead of the others, for the
+// compressed encodings. s0 (x8) stays the frame pointer.
+static const int kCompressibleFirstOrder[] = {
+    reg::a5, reg::a4, reg::a3, reg::a2, reg::a1,  reg::a0, reg::t2,
+    reg::t3, reg::t4, reg::t5, reg::t6, reg::a7,  reg::a6, reg::s1,
+    reg::s2, reg::s3, reg::s4, reg::s5, reg::s6,  reg::s7, reg::s8,
+    reg::s9, reg::s10, reg::s11};
+static_assert(sizeof(kCompressibleFirstOrder) == sizeof(kAllocationOrder),
+              "both orders hand out the same registers");
+
+// reserved for reloading spilled registers, never handed out
+static const int kSpillScratchRegs[] = {reg::t0, reg::t1};
+
+void LinearScanRegisterAllocator::run() {
+    computeLiveSegments();
+    collectHints();
+    allocate();
+    rewrite();
+}
+
+void LinearScanRegisterAllocator::computeLiveSegments() {
+    const auto &instrs = m_function.getInstrs();
+    const size_t num_regs = m_function.getNumRegs();
+
+    const auto blocks = splitBasicBlocks(instrs);
+    std::vector<std::vector<bool>> live_ins(blocks.size()),
+        live_outs(blocks.size());
+
+    // registers read after falling off the end of the body
+    std::vector<bool> exit_live(num_regs, false);
+    if (m_function.returnsValue()) {
+        exit_live[reg::a0] = true;
+    }
+
+    // gen: read before written in the block, kill: written in the block
+    std::vector<std::vector<bool>> gen(blocks.size()), kill(blocks.size());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        gen[b].assign(num_regs, false);
+        kill[b].assign(num_regs, false);
+        live_ins[b].assign(num_regs, false);
+        live_outs[b].assign(num_regs, false);
+        for (size_t i = blocks[b].begin; i < blocks[b].end; ++i) {
+            for (auto use : instrs[i].getUses()) {
+                if (!kill[b][use]) {
+                    gen[b][use] = true;
+                }
+            }
+            for (auto def : instrs[i].getDefs()) {
+                kill[b][def] = true;
+            }
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = blocks.size(); b-- > 0;) {
+            const auto &block = blocks[b];
+            std::vector<bool> live_out =
+                block.succs.empty() ? exit_live
+                                    : std::vector<bool>(num_regs, false);
+            for (auto succ : block.succs) {
+                for (size_t r = 0; r < num_regs; ++r) {
+                    if (live_ins[succ][r]) {
+                        live_out[r] = true;
+                    }
+                }
+            }
+            // falling off the end of the body also reaches the exit
+            if (b + 1 == blocks.size() && !block.succs.empty()) {
+                for (size_t r = 0; r < num_regs; ++r) {
+                    if (exit_live[r]) {
+                        live_out[r] = true;
+                    }
+                }
+            }
+            std::vector<bool> live_in(num_regs, false);
+            for (size_t r = 0; r < num_regs; ++r) {
+                live_in[r] = gen[b][r] || (live_out[r] && !kill[b][r]);
+            }
+            if (live_in != live_ins[b] || live_out != live_outs[b]) {
+                live_ins[b] = std::move(live_in);
+                live_outs[b] = std::move(live_out);
+                changed = true;
+            }
+        }
+    }
+
+    m_segments.assign(num_regs, {});
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const auto &block = blocks[b];
+        if (block.begin == block.end) {
+            continue;
+        }
+        const int block_begin_point = 2 * block.begin;
+        const int block_end_point = 2 * block.end - 1;
+
+        std::vector<bool> live = live_outs[b];
+        std::vector<int> open_end(num_regs, block_end_point);
+
+        for (size_t i = block.end; i-- > block.begin;) {
+            const int use_point = 2 * i;
+            const int def_point = 2 * i + 1;
+            for (auto def : instrs[i].getDefs()) {
+                if (live[def]) {
+                    m_segments[def].emplace_back(def_point, open_end[def]);
+                    live[def] = false;
+                } else {
+                    // dead definitions still clobber the register
+                    m_segments[def].emplace_back(def_point, def_point);
+                }
+            }
+            for (auto use : instrs[i].getUses()) {
+                if (!live[use]) {
+                    live[use] = true;
+                    open_end[use] = use_point;
+                }
+            }
+        }
+        for (size_t r = 0; r < num_regs; ++r) {
+            if (live[r]) {
+                m_segments[r].emplace_back(block_begin_point, open_end[r]);
+            }
+        }
+    }
+
+    for (auto &segments : m_segments) {
+        std::sort(segments.begin(), segments.end());
+    }
+    for (size_t r = kFirstVirtualReg; r < num_regs; ++r) {
+        if (m_segments[r].empty()) {
+            continue;
+        }
+        LiveInterval interval{static_cast<int>(r), m_segments[r][0].first,
+                              m_segments[r][0].second};
+        for (const auto &segment : m_segments[r]) {
+            interval.start = std::min(interval.start, segment.first);
+            interval.end = std::max(interval.end, segment.second);
+        }
+        m_intervals.push_back(interval);
+    }
+    std::sort(m_intervals.begin(), m_intervals.end(),
+              [](const LiveInterval &p_lhs, const LiveInterval &p_rhs) {
+                  return p_lhs.start < p_rhs.start;
+              });
+}
+
+void LinearScanRegisterAllocator::collectHints() {
+    const size_t num_regs = m_function.getNumRegs();
+    m_phys_hints.assign(num_regs, kNoReg);
+    m_virtual_hints.assign(num_regs, kNoReg);
+
+    // a copy whose both sides share a register disappears after rewriting
+    for (const auto &instr : m_function.getInstrs()) {
+        if (!instr.isInstruction() || instr.getOpcode() != "mv") {
+            continue;
+        }
+        const int dst = instr.getOperand(0).getReg();
+        const int src = instr.getOperand(1).getReg();
+        if (isVirtualReg(dst) && !isVirtualReg(src)) {
+            m_phys_hints[dst] = src;
+        } else if (!isVirtualReg(dst) && isVirtualReg(src)) {
+            m_phys_hints[src] = dst;
+        } else if (isVirtualReg(dst) && isVirtualReg(src)) {
+            m_virtual_hints[dst] = src;
+            m_virtual_hints[src] = dst;
+        }
+    }
+}
+
+bool LinearScanRegisterAllocator::covers(const LiveInterval &p_interval,
+                                         const int p_point) const {
+    for (const auto &segment : m_segments[p_interval.vreg]) {
+        if (segment.first <= p_point && p_point <= segment.second) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LinearScanRegisterAllocator::overlaps(
+    const int p_reg, const LiveInterval &p_interval) const {
+    // both sorted by start
+    const auto &lhs = m_segments[p_reg];
+    const auto &rhs = m_segments[p_interval.vreg];
+    size_t i = 0, j = 0;
+    while (i < lhs.size() && j < rhs.size()) {
+        if (lhs[i].second < rhs[j].first) {
+            ++i;
+        } else if (rhs[j].second < lhs[i].first) {
+            ++j;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LinearScanRegisterAllocator::allocate() {
+    // active: live at the current point, inactive: in a hole
+    std::vector<LiveInterval *> active, inactive;
+    std::vector<int> assigned(m_function.getNumRegs(), kNoReg);
+
+    for (auto &current : m_intervals) {
+        std::vector<LiveInterval *> still_active, still_inactive;
+        for (auto *interval : active) {
+            if (interval->end >= current.start) {
+                (covers(*interval, current.start) ? still_active
+                                                  : still_inactive)
+                    .push_back(interval);
+            }
+        }
+        for (auto *interval : inactive) {
+            if (interval->end >= current.start) {
+                (covers(*interval, current.start) ? still_active
+                                                  : still_inactive)
+                    .push_back(interval);
+            }
+        }
+        active = std::move(still_active);
+        inactive = std::move(still_inactive);
+
+        // whether p_phys stays free wherever current is live, apart from
+        // what the active interval holding it would give up
+        auto is_free_beside_active = [&](const int p_phys) {
+            for (const auto *interval : inactive) {
+                if (interval->phys == p_phys &&
+                    overlaps(interval->vreg, current)) {
+                    return false;
+                }
+            }
+            return !overlaps(p_phys, current);
+        };
+        auto is_free = [&](const int p_phys) {
+            for (const auto *interval : active) {
+                if (interval->phys == p_phys) {
+                    return false;
+                }
+            }
+            return is_free_beside_active(p_phys);
+        };
+
+        const int *order_begin = m_prefer_compressible
+                                     ? std::begin(kCompressibleFirstOrder)
+                                     : std::begin(kAllocationOrder);
+        const int *order_end = m_prefer_compressible
+                                   ? std::end(kCompressibleFirstOrder)
+                                   : std::end(kAllocationOrder);
+
+        int choice = kNoReg;
+        const int hints[] = {m_phys_hints[current.vreg],
+                             m_virtual_hints[current.vreg] == kNoReg
+                                 ? kNoReg
+                                 : assigned[m_virtual_hints[current.vreg]]};
+        for (auto hint : hints) {
+            if (hint != kNoReg && choice == kNoReg &&
+                std::find(order_begin, order_end, hint) != order_end &&
+                is_free(hint)) {
+                choice = hint;
+            }
+        }
+        for (const int *phys = order_begin; phys != order_end; ++phys) {
+            if (choice == kNoReg && is_free(*phys)) {
+                choice = *phys;
+            }
+        }
+
+        if (choice == kNoReg) {
+            // spill whichever interval reaches furthest
+            LiveInterval *victim = nullptr;
+            for (auto *interval : active) {
+                if (interval->end > current.end &&
+                    is_free_beside_active(interval->phys) &&
+                    (!victim || interval->end > victim->end)) {
+                    victim = interval;
+                }
+            }
+            if (victim) {
+                choice = victim->phys;
+                victim->phys = kNoReg;
+                victim->spilled = true;
+                assigned[victim->vreg] = kNoReg;
+                active.erase(std::find(active.begin(), active.end(), victim));
+            } else {
+                current.spilled = true;
+                continue;
+            }
+        }
+
+        current.phys = choice;
+        assigned[current.vreg] = choice;
+        active.push_back(&current);
+    }
+
+    for (auto &interval : m_intervals) {
+        if (interval.spilled) {
+            interval.spill_slot = m_function.allocateStackSlot(4);
+            ++m_num_spilled;
+        }
+    }
+}
+
+void LinearScanRegisterAllocator::rewrite() {
+    std::vector<const LiveInterval *> interval_of(m_function.getNumRegs(),
+                                                  nullptr);
+    for (const auto &interval : m_intervals) {
+        interval_of[interval.vreg] = &interval;
+    }
+
+    std::vector<bool> is_saved(kNumPhysRegs, false);
+    MachineFunction::Instrs result;
+
+    for (auto instr : m_function.getInstrs()) {
+        if (!instr.isInstruction()) {
+            result.push_back(instr);
+            continue;
+        }
+
+        const bool has_def = instr.definesFirstOperand();
+        const int def_vreg = has_def ? instr.getOperand(0).getReg() : kNoReg;
+
+        // spilled register -> scratch register holding it in this instruction
+        std::vector<std::pair<int, int>> reloads;
+        auto scratch_of = [&](const int p_vreg) {
+            for (const auto &reload : reloads) {
+                if (reload.first == p_vreg) {
+                    return reload.second;
+                }
+            }
+            assert(reloads.size() < 2 && "too many spilled operands");
+            reloads.emplace_back(p_vreg, kSpillScratchRegs[reloads.size()]);
+            return reloads.back().second;
+        };
+
+        MachineInstr::Operands &operands = instr.getOperands();
+        for (size_t i = 0; i < operands.size(); ++i) {
+            if (!operands[i].isReg() && !operands[i].isMem()) {
+                continue;
+            }
+            const int r = operands[i].getReg();
+            if (!isVirtualReg(r) || (i == 0 && has_def)) {
+                continue;
+            }
+            const auto *interval = interval_of[r];
+            assert(interval && "use of a register that is never live");
+            operands[i].setReg(interval->spilled ? scratch_of(r)
+                                                 : interval->phys);
+        }
+
+        for (const auto &reload : reloads) {
+            result.emplace_back(
+                "lw",
+                MachineInstr::Operands{
+                    MachineOperand::createReg(reload.second),
+                    MachineOperand::createMem(
+                        reg::s0, interval_of[reload.first]->spill_slot)});
+        }
+
+        const LiveInterval *spilled_def = nullptr;
+        if (isVirtualReg(def_vreg)) {
+            const auto *interval = interval_of[def_vreg];
+            if (interval->spilled) {
+                spilled_def = interval;
+                // the sources are read before the result is written, so the
+                // result may share a scratch register with them
+                int scratch = kSpillScratchRegs[0];
+                for (const auto &reload : reloads) {
+                    if (reload.first == def_vreg) {
+                        scratch = reload.second;
+                    }
+                }
+                operands[0].setReg(scratch);
+            } else {
+                operands[0].setReg(interval->phys);
+            }
+        }
+
+        if (has_def && isCalleeSavedReg(operands[0].getReg()) &&
+            operands[0].getReg() != reg::s0) {
+            is_saved[operands[0].getReg()] = true;
+        }
+
+        const bool is_identity_move = instr.getOpcode() == "mv" &&
+                                      operands[0] == operands[1];
+        if (!is_identity_move) {
+            result.push_back(instr);
+        }
+
+        if (spilled_def) {
+            result.emplace_back(
+                "sw", MachineInstr::Operands{
+                          MachineOperand::createReg(operands[0].getReg()),
+                          MachineOperand::createMem(reg::s0,
+                                                    spilled_def->spill_slot)});
+        }
+    }
+
+    m_function.getInstrs() = std::move(result);
+    for (int r = 0; r < kNumPhysRegs; ++r) {
+        if (is_saved[r]) {
+            m_function.addSavedReg(r);
+        }
+    }
+}
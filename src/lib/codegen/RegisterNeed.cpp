@@ -0,0 +1,70 @@
+#include "codegen/RegisterNeed.hpp"
+#include "sema/SymbolTable.hpp"
+#include "visitor/AstNodeInclude.hpp"
+
+#include <algorithm>
+
+const RegisterNeed &RegisterNeedLabeler::get(AstNode &p_expr) {
+    auto result = m_labels.find(&p_expr);
+    if (result == m_labels.end()) {
+        p_expr.accept(*this);
+        result = m_labels.find(&p_expr);
+    }
+    return result->second;
+}
+
+bool RegisterNeedLabeler::canReorder(const RegisterNeed &p_first,
+                                     const RegisterNeed &p_second) {
+    return !(p_first.has_call && p_second.has_call) &&
+           !(p_first.has_call && p_second.reads_global) &&
+           !(p_second.has_call && p_first.reads_global);
+}
+
+void RegisterNeedLabeler::visit(ConstantValueNode &p_constant_value) {
+    m_labels[&p_constant_value] = RegisterNeed();
+}
+
+void RegisterNeedLabeler::visit(BinaryOperatorNode &p_bin_op) {
+    const auto lhs = get(*p_bin_op.getL());
+    const auto rhs = get(*p_bin_op.getR());
+
+    RegisterNeed label;
+    if (p_bin_op.getOp() == Operator::kAndOp ||
+        p_bin_op.getOp() == Operator::kOrOp) {
+        // jumping code: nothing is held while the right operand runs
+        label.need = std::max({lhs.need, rhs.need, 1});
+    } else {
+        label.need = (lhs.need == rhs.need) ? lhs.need + 1
+                                            : std::max(lhs.need, rhs.need);
+    }
+    label.has_call = lhs.has_call || rhs.has_call;
+    label.reads_global = lhs.reads_global || rhs.reads_global;
+    m_labels[&p_bin_op] = label;
+}
+
+void RegisterNeedLabeler::visit(UnaryOperatorNode &p_un_op) {
+    m_labels[&p_un_op] = get(*p_un_op.getVal());
+}
+
+void RegisterNeedLabeler::visit(FunctionInvocationNode &p_func_invocation) {
+    RegisterNeed label;
+    label.has_call = true;
+
+    // the values of the earlier arguments stay in registers
+    const auto &args = p_func_invocation.getArguments();
+    for (size_t i = 0; i < args.size(); ++i) {
+        const auto &arg = get(*args[i]);
+        label.need = std::max(label.need, static_cast<int>(i) + arg.need);
+        label.reads_global = label.reads_global || arg.reads_global;
+    }
+    m_labels[&p_func_invocation] = label;
+}
+
+void RegisterNeedLabeler::visit(VariableReferenceNode &p_variable_ref) {
+    RegisterNeed label;
+    const auto *entry = m_symbol_manager_ptr->lookup(p_variable_ref.getName());
+    label.reads_global =
+        entry && entry->getLevel() == 0 &&
+        entry->getKind() != SymbolEntry::KindEnum::kConstantKind;
+    m_labels[&p_variable_ref] = label;
+}
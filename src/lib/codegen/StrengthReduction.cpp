@@ -0,0 +1,230 @@
+#include "codegen/StrengthReduction.hpp"
+#include "codegen/MachineFunction.hpp"
+
+#include <cassert>
+
+std::vector<ShiftAddDigit> computeShiftAddDigits(const uint32_t p_multiplier) {
+    std::vector<ShiftAddDigit> digits;
+    // one bit wider than the multiplier, so that the carry of a -1 digit in
+    // the top bit does not get lost
+    uint64_t rest = p_multiplier;
+    for (int shift = 0; rest != 0; ++shift, rest >>= 1) {
+        if ((rest & 1) == 0) {
+            continue;
+        }
+        // ...01 ends a run of ones, ...11 starts one, which is cheaper as
+        // 2^(k+1) - 1
+        const int sign = (rest & 3) == 3 ? -1 : 1;
+        digits.push_back(ShiftAddDigit{shift, sign});
+        rest = sign > 0 ? rest - 1 : rest + 1;
+    }
+    return std::vector<ShiftAddDigit>(digits.rbegin(), digits.rend());
+}
+
+int getShiftAddCost(const std::vector<ShiftAddDigit> &p_digits) {
+    if (p_digits.size() <= 1) {
+        // a single shift (or move)
+        return 1;
+    }
+    // a shift and an add or sub per later digit, and the shift that is left
+    // after the last one
+    int cost = 2 * static_cast<int>(p_digits.size() - 1);
+    if (p_digits.back().shift > 0) {
+        ++cost;
+    }
+    return cost;
+}
+
+MagicDivisor computeMagicDivisor(const int32_t p_divisor) {
+    assert(p_divisor >= 2 && getExactLog2(p_divisor) < 0 &&
+           "powers of two are divided by shifting");
+    const uint32_t two31 = 0x80000000u;
+    const uint32_t ad = static_cast<uint32_t>(p_divisor);
+    const uint32_t anc = two31 - 1 - two31 % ad; // |nc|
+    int p = 31;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32_t delta;
+    do {
+        ++p;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            ++q1;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) {
+            ++q2;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    return MagicDivisor{static_cast<int32_t>(q2 + 1), p - 32};
+}
+
+int getExactLog2(const uint32_t p_value) {
+    if (p_value == 0 || (p_value & (p_value - 1)) != 0) {
+        return -1;
+    }
+    int log2 = 0;
+    while ((p_value >> log2) != 1) {
+        ++log2;
+    }
+    return log2;
+}
+
+// a multiplication by a constant stays a mul if more instructions than this
+// would replace it
+static const int kMaxShiftAddCost = 4;
+
+static MachineOperand regOp(const int p_reg) {
+    return MachineOperand::createReg(p_reg);
+}
+
+static MachineOperand immOp(const int64_t p_imm) {
+    return MachineOperand::createImm(p_imm);
+}
+
+static void emit(MachineFunction &p_function, const char *p_opcode,
+                 std::initializer_list<MachineOperand> p_operands) {
+    p_function.append(MachineInstr(p_opcode, p_operands));
+}
+
+uint32_t getMagnitude(const int32_t p_value) {
+    return p_value < 0 ? 0u - static_cast<uint32_t>(p_value)
+                       : static_cast<uint32_t>(p_value);
+}
+
+bool isCheapMultiplier(const int32_t p_multiplier) {
+    if (p_multiplier == 0) {
+        return true;
+    }
+    const auto digits = computeShiftAddDigits(getMagnitude(p_multiplier));
+    return getShiftAddCost(digits) + (p_multiplier < 0 ? 1 : 0) <=
+           kMaxShiftAddCost;
+}
+
+bool isReducibleDivisor(const int32_t p_divisor, int &p_num_temps) {
+    const uint32_t magnitude = getMagnitude(p_divisor);
+    if (p_divisor == 0 || magnitude == 0x80000000u) {
+        return false;
+    }
+    p_num_temps = getExactLog2(magnitude) < 0 ? 1 : 0;
+    return true;
+}
+
+void emitMultiplyByConstant(MachineFunction &p_function, const int p_dst,
+                            const int p_src, const int32_t p_multiplier) {
+    if (p_multiplier == 0) {
+        emit(p_function, "li", {regOp(p_dst), immOp(0)});
+        return;
+    }
+    // Horner's rule over the digits, so p_src is all that has to be kept
+    const auto digits = computeShiftAddDigits(getMagnitude(p_multiplier));
+    if (digits.size() == 1) {
+        if (digits[0].shift > 0) {
+            emit(p_function, "slli",
+                 {regOp(p_dst), regOp(p_src), immOp(digits[0].shift)});
+        } else {
+            emit(p_function, "mv", {regOp(p_dst), regOp(p_src)});
+        }
+    } else {
+        emit(p_function, "slli",
+             {regOp(p_dst), regOp(p_src),
+              immOp(digits[0].shift - digits[1].shift)});
+        for (size_t i = 1; i < digits.size(); ++i) {
+            emit(p_function, digits[i].sign > 0 ? "add" : "sub",
+                 {regOp(p_dst), regOp(p_dst), regOp(p_src)});
+            const int next_shift =
+                i + 1 < digits.size() ? digits[i + 1].shift : 0;
+            if (digits[i].shift > next_shift) {
+                emit(p_function, "slli",
+                     {regOp(p_dst), regOp(p_dst),
+                      immOp(digits[i].shift - next_shift)});
+            }
+        }
+    }
+    if (p_multiplier < 0) {
+        emit(p_function, "neg", {regOp(p_dst), regOp(p_dst)});
+    }
+}
+
+// p_dst = p_src + (p_src < 0 ? 2^p_log2 - 1 : 0), which makes an arithmetic
+// shift round towards zero like div does
+static void emitRoundingBias(MachineFunction &p_function, const int p_dst,
+                             const int p_src, const int p_log2) {
+    if (p_log2 == 1) {
+        emit(p_function, "srli", {regOp(p_dst), regOp(p_src), immOp(31)});
+    } else {
+        emit(p_function, "srai", {regOp(p_dst), regOp(p_src), immOp(31)});
+        emit(p_function, "srli",
+             {regOp(p_dst), regOp(p_dst), immOp(32 - p_log2)});
+    }
+    emit(p_function, "add", {regOp(p_dst), regOp(p_src), regOp(p_dst)});
+}
+
+void emitDivideByConstant(MachineFunction &p_function, const int p_dst,
+                          const int p_src, const int32_t p_divisor,
+                          const int p_temp) {
+    const uint32_t magnitude = getMagnitude(p_divisor);
+    const int log2 = getExactLog2(magnitude);
+    if (log2 == 0) {
+        emit(p_function, "mv", {regOp(p_dst), regOp(p_src)});
+    } else if (log2 > 0) {
+        emitRoundingBias(p_function, p_dst, p_src, log2);
+        emit(p_function, "srai", {regOp(p_dst), regOp(p_dst), immOp(log2)});
+    } else {
+        const auto magic = computeMagicDivisor(static_cast<int32_t>(magnitude));
+        emit(p_function, "li", {regOp(p_temp), immOp(magic.multiplier)});
+        emit(p_function, "mulh", {regOp(p_dst), regOp(p_src), regOp(p_temp)});
+        if (magic.multiplier < 0) {
+            emit(p_function, "add", {regOp(p_dst), regOp(p_dst), regOp(p_src)});
+        }
+        if (magic.shift > 0) {
+            emit(p_function, "srai",
+                 {regOp(p_dst), regOp(p_dst), immOp(magic.shift)});
+        }
+        // the quotient is one too small for negative dividends
+        emit(p_function, "srli", {regOp(p_temp), regOp(p_src), immOp(31)});
+        emit(p_function, "add", {regOp(p_dst), regOp(p_dst), regOp(p_temp)});
+    }
+    if (p_divisor < 0) {
+        emit(p_function, "neg", {regOp(p_dst), regOp(p_dst)});
+    }
+}
+
+void emitModuloByConstant(MachineFunction &p_function, const int p_dst,
+                          const int p_src, const int32_t p_divisor,
+                          const int p_temp) {
+    // x mod d = x - x / |d| * |d|, which has the sign of x like rem
+    const uint32_t magnitude = getMagnitude(p_divisor);
+    const auto divisor = static_cast<int32_t>(magnitude);
+    const int log2 = getExactLog2(magnitude);
+    if (log2 == 0) {
+        emit(p_function, "li", {regOp(p_dst), immOp(0)});
+        return;
+    }
+    if (log2 > 0) {
+        // clear the low bits instead of shifting down and up again
+        emitRoundingBias(p_function, p_dst, p_src, log2);
+        if (divisor <= 2048) {
+            emit(p_function, "andi",
+                 {regOp(p_dst), regOp(p_dst), immOp(-divisor)});
+        } else {
+            emit(p_function, "srai", {regOp(p_dst), regOp(p_dst), immOp(log2)});
+            emit(p_function, "slli", {regOp(p_dst), regOp(p_dst), immOp(log2)});
+        }
+        emit(p_function, "sub", {regOp(p_dst), regOp(p_src), regOp(p_dst)});
+        return;
+    }
+    emitDivideByConstant(p_function, p_dst, p_src, divisor, p_temp);
+    if (isCheapMultiplier(divisor)) {
+        emitMultiplyByConstant(p_function, p_temp, p_dst, divisor);
+    } else {
+        emit(p_function, "li", {regOp(p_temp), immOp(divisor)});
+        emit(p_function, "mul", {regOp(p_temp), regOp(p_dst), regOp(p_temp)});
+    }
+    emit(p_function, "sub", {regOp(p_dst), regOp(p_src), regOp(p_temp)});
+}
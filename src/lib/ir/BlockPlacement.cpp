@@ -0,0 +1,185 @@
+#include "ir/BlockPlacement.hpp"
+#include "ir/Dominators.hpp"
+#include "ir/LoopInfo.hpp"
+
+#include <algorithm>
+
+namespace ir {
+
+// a jump is an instruction of its own on top of leaving the straight line
+static const uint64_t kJumpCost = 2;
+static const uint64_t kTakenBranchCost = 1;
+
+// What leaving the straight line costs with the blocks laid out in p_order,
+// as often as the profile says it happens. Only the last block falls
+// through into the epilogue; a branch whose targets both come elsewhere
+// is taken or followed by a jump.
+static uint64_t getTransferCost(const std::vector<BasicBlock *> &p_order) {
+    uint64_t cost = 0;
+    for (size_t i = 0; i < p_order.size(); ++i) {
+        const BasicBlock *next =
+            i + 1 < p_order.size() ? p_order[i + 1] : nullptr;
+        const Instruction *terminator = p_order[i]->getTerminator();
+        const auto &counts = terminator->getCounts();
+        switch (terminator->getOpcode()) {
+        case Opcode::kRet:
+            if (next) {
+                cost += kJumpCost *
+                        std::max<int64_t>(p_order[i]->getCount(), 0);
+            }
+            break;
+        case Opcode::kJump:
+            if (!counts.empty() && terminator->getBlock(0) != next) {
+                cost += kJumpCost * counts[0];
+            }
+            break;
+        case Opcode::kBranch:
+            if (counts.empty()) {
+                break;
+            }
+            if (terminator->getBlock(0) == next) {
+                cost += kTakenBranchCost * counts[1];
+            } else if (terminator->getBlock(1) == next) {
+                cost += kTakenBranchCost * counts[0];
+            } else {
+                cost += kTakenBranchCost * counts[0] + kJumpCost * counts[1];
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return cost;
+}
+
+void BlockPlacement::run() {
+    if (m_function.getEntryCount() < 0) {
+        return;
+    }
+    m_function.updatePredecessors();
+    const DominatorTree dom_tree(m_function);
+    const LoopInfo loop_info(dom_tree);
+
+    std::vector<BasicBlock *> old_order;
+    std::vector<bool> cold(m_function.getNumBlockIds(), false);
+    for (auto &block : m_function.getBlocks()) {
+        old_order.push_back(block.get());
+        if (block.get() != m_function.getEntry() && block->getCount() == 0) {
+            cold[block->getId()] = true;
+        }
+    }
+    buildChains(dom_tree, cold);
+    rotateLoops(loop_info);
+
+    std::vector<BasicBlock *> new_order =
+        m_chains[m_chain_of[m_function.getEntry()->getId()]];
+    for (BasicBlock *block : old_order) {
+        const auto &chain = m_chains[m_chain_of[block->getId()]];
+        if (block != m_function.getEntry() && !cold[block->getId()] &&
+            chain.front() == block) {
+            new_order.insert(new_order.end(), chain.begin(), chain.end());
+        }
+    }
+    for (BasicBlock *block : old_order) {
+        if (cold[block->getId()]) {
+            new_order.push_back(block);
+            ++m_num_cold;
+        }
+    }
+
+    // the chains are picked greedily, and the blocks that only jump on
+    // may make the result worse
+    if (getTransferCost(new_order) >= getTransferCost(old_order)) {
+        m_num_cold = 0;
+        return;
+    }
+    for (size_t i = 0; i < new_order.size(); ++i) {
+        if (new_order[i] != old_order[i]) {
+            ++m_num_moved;
+        }
+        m_function.moveBlockToEnd(new_order[i]);
+    }
+}
+
+void BlockPlacement::buildChains(const DominatorTree &p_dom_tree,
+                                 const std::vector<bool> &p_cold) {
+    struct Edge {
+        BasicBlock *from;
+        BasicBlock *to;
+        uint64_t weight;
+    };
+    std::vector<Edge> edges;
+    m_chains.clear();
+    m_chain_of.assign(m_function.getNumBlockIds(), 0);
+    for (auto &block : m_function.getBlocks()) {
+        m_chain_of[block->getId()] = m_chains.size();
+        m_chains.push_back({block.get()});
+
+        const Instruction *terminator = block->getTerminator();
+        if (p_cold[block->getId()] || !p_dom_tree.isReachable(block.get())) {
+            continue;
+        }
+        for (size_t i = 0; i < terminator->getCounts().size(); ++i) {
+            BasicBlock *succ = terminator->getBlock(i);
+            if (terminator->getCounts()[i] > 0 && !p_cold[succ->getId()] &&
+                succ != m_function.getEntry() &&
+                !p_dom_tree.dominates(succ, block.get())) {
+                edges.push_back(
+                    {block.get(), succ, terminator->getCounts()[i]});
+            }
+        }
+    }
+    // ties keep the layout order
+    std::stable_sort(edges.begin(), edges.end(),
+                     [](const Edge &p_a, const Edge &p_b) {
+                         return p_a.weight > p_b.weight;
+                     });
+
+    for (const Edge &edge : edges) {
+        const size_t from = m_chain_of[edge.from->getId()];
+        const size_t to = m_chain_of[edge.to->getId()];
+        if (from == to || m_chains[from].back() != edge.from ||
+            m_chains[to].front() != edge.to) {
+            continue;
+        }
+        for (BasicBlock *block : m_chains[to]) {
+            m_chain_of[block->getId()] = from;
+            m_chains[from].push_back(block);
+        }
+        m_chains[to].clear();
+    }
+}
+
+void BlockPlacement::rotateLoops(const LoopInfo &p_loop_info) {
+    // inner loops first, so an outer loop sees them rotated
+    for (const auto &loop : p_loop_info.getLoops()) {
+        BasicBlock *header = loop->getHeader();
+        // the entry has to stay first
+        if (header == m_function.getEntry() || header->getCount() <= 0) {
+            continue;
+        }
+        const auto succs = header->getSuccessors();
+        if (std::all_of(succs.begin(), succs.end(),
+                        [&](const BasicBlock *p_succ) {
+                            return loop->contains(p_succ);
+                        })) {
+            continue;
+        }
+
+        // the part of the chain from the header on that stays in the loop
+        auto &chain = m_chains[m_chain_of[header->getId()]];
+        const auto begin = std::find(chain.begin(), chain.end(), header);
+        auto end = begin + 1;
+        while (end != chain.end() && loop->contains(*end)) {
+            ++end;
+        }
+        const auto latch_succs = end[-1]->getSuccessors();
+        if (end - begin < 2 || std::find(latch_succs.begin(), latch_succs.end(),
+                                         header) == latch_succs.end()) {
+            continue;
+        }
+        std::rotate(begin, begin + 1, end);
+    }
+}
+
+} // namespace ir
@@ -0,0 +1,123 @@
+#include "ir/DCE.hpp"
+#include "ir/SideEffects.hpp"
+
+#include <algorithm>
+
+namespace ir {
+
+size_t DeadCodeElimination::run() {
+    m_loaded_slots.assign(m_function.getNumSlotIds(), false);
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            if (instr->getOpcode() == Opcode::kLoad) {
+                m_loaded_slots[instr->getSlot()->id] = true;
+            }
+        }
+    }
+
+    m_live.assign(m_function.getNumValueIds(), false);
+    std::vector<Instruction *> worklist;
+    for (auto &block : m_function.getBlocks()) {
+        for (size_t i = 0; i < block->getInstrs().size(); ++i) {
+            if (isRoot(*block, i)) {
+                Instruction *instr = block->getInstrs()[i].get();
+                m_live[instr->getId()] = true;
+                worklist.push_back(instr);
+            }
+        }
+    }
+    while (!worklist.empty()) {
+        Instruction *instr = worklist.back();
+        worklist.pop_back();
+        for (Instruction *operand : instr->getOperands()) {
+            if (!m_live[operand->getId()]) {
+                m_live[operand->getId()] = true;
+                worklist.push_back(operand);
+            }
+        }
+    }
+
+    std::vector<bool> used_slots(m_function.getNumSlotIds(), false);
+    for (auto &block : m_function.getBlocks()) {
+        auto &instrs = block->getInstrs();
+        const size_t num_instrs = instrs.size();
+        instrs.erase(std::remove_if(instrs.begin(), instrs.end(),
+                                    [&](const std::unique_ptr<Instruction> &p_ptr) {
+                                        return !m_live[p_ptr->getId()];
+                                    }),
+                     instrs.end());
+        m_num_removed += num_instrs - instrs.size();
+        for (auto &instr : instrs) {
+            if (instr->getSlot()) {
+                used_slots[instr->getSlot()->id] = true;
+            }
+        }
+    }
+    std::vector<const Slot *> unused;
+    for (auto &slot : m_function.getSlots()) {
+        if (!used_slots[slot->id]) {
+            unused.push_back(slot.get());
+        }
+    }
+    for (const Slot *slot : unused) {
+        m_function.eraseSlot(slot);
+    }
+    return m_num_removed;
+}
+
+bool DeadCodeElimination::isDeadStore(const BasicBlock &p_block,
+                                      const size_t p_index) const {
+    const auto &instrs = p_block.getInstrs();
+    const Instruction &store = *instrs[p_index];
+    const bool is_global = store.getOpcode() == Opcode::kStoreGlobal;
+    if (is_global ? !m_side_effects.get("main").reads.count(store.getSymbol())
+                  : !m_loaded_slots[store.getSlot()->id]) {
+        return true;
+    }
+
+    // stored again before anything reads it; calls only read globals
+    for (size_t i = p_index + 1; i < instrs.size(); ++i) {
+        const Instruction &instr = *instrs[i];
+        switch (instr.getOpcode()) {
+        case Opcode::kLoad:
+        case Opcode::kStore:
+            if (!is_global && instr.getSlot() == store.getSlot()) {
+                return instr.getOpcode() == Opcode::kStore;
+            }
+            break;
+        case Opcode::kLoadGlobal:
+        case Opcode::kStoreGlobal:
+            if (is_global && instr.getSymbol() == store.getSymbol()) {
+                return instr.getOpcode() == Opcode::kStoreGlobal;
+            }
+            break;
+        case Opcode::kCall:
+            if (is_global && m_side_effects.get(instr.getSymbol())
+                                 .reads.count(store.getSymbol())) {
+                return false;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+bool DeadCodeElimination::isRoot(const BasicBlock &p_block,
+                                 const size_t p_index) const {
+    const Instruction &instr = *p_block.getInstrs()[p_index];
+    switch (instr.getOpcode()) {
+    case Opcode::kStore:
+    case Opcode::kStoreGlobal:
+        return !isDeadStore(p_block, p_index);
+    case Opcode::kCall: {
+        const FunctionEffects &effects = m_side_effects.get(instr.getSymbol());
+        return !effects.isPure() || !effects.terminates;
+    }
+    default:
+        return instr.hasSideEffect();
+    }
+}
+
+} // namespace ir
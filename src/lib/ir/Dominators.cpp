@@ -0,0 +1,128 @@
+#include "ir/Dominators.hpp"
+
+#include <algorithm>
+
+namespace ir {
+
+static void computePostOrder(BasicBlock *p_block, std::vector<bool> &p_visited,
+                             std::vector<BasicBlock *> &p_order) {
+    // iterative, deep CFGs would overflow the call stack
+    std::vector<std::pair<BasicBlock *, size_t>> stack = {{p_block, 0}};
+    p_visited[p_block->getId()] = true;
+    while (!stack.empty()) {
+        BasicBlock *block = stack.back().first;
+        const auto succs = block->getSuccessors();
+        if (stack.back().second < succs.size()) {
+            BasicBlock *succ = succs[stack.back().second++];
+            if (!p_visited[succ->getId()]) {
+                p_visited[succ->getId()] = true;
+                stack.emplace_back(succ, 0);
+            }
+        } else {
+            p_order.push_back(block);
+            stack.pop_back();
+        }
+    }
+}
+
+DominatorTree::DominatorTree(const Function &p_function) {
+    const int num_ids = p_function.getNumBlockIds();
+    std::vector<bool> visited(num_ids, false);
+    computePostOrder(p_function.getEntry(), visited, m_rpo);
+    std::reverse(m_rpo.begin(), m_rpo.end());
+
+    m_rpo_index.assign(num_ids, -1);
+    for (size_t i = 0; i < m_rpo.size(); ++i) {
+        m_rpo_index[m_rpo[i]->getId()] = i;
+    }
+
+    // the entry is its own idom while iterating, nullptr afterwards
+    m_idoms.assign(num_ids, nullptr);
+    m_idoms[p_function.getEntry()->getId()] = p_function.getEntry();
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < m_rpo.size(); ++i) {
+            BasicBlock *block = m_rpo[i];
+            BasicBlock *new_idom = nullptr;
+            for (BasicBlock *pred : block->getPredecessors()) {
+                if (!m_idoms[pred->getId()]) {
+                    continue;
+                }
+                new_idom = new_idom ? intersect(pred, new_idom) : pred;
+            }
+            if (m_idoms[block->getId()] != new_idom) {
+                m_idoms[block->getId()] = new_idom;
+                changed = true;
+            }
+        }
+    }
+    m_idoms[p_function.getEntry()->getId()] = nullptr;
+
+    m_children.assign(num_ids, {});
+    for (size_t i = 1; i < m_rpo.size(); ++i) {
+        m_children[getIdom(m_rpo[i])->getId()].push_back(m_rpo[i]);
+    }
+
+    // Cytron et al.: walk up from each predecessor of a join to its idom
+    m_frontiers.assign(num_ids, {});
+    for (BasicBlock *block : m_rpo) {
+        if (block->getPredecessors().size() < 2) {
+            continue;
+        }
+        for (BasicBlock *pred : block->getPredecessors()) {
+            if (!isReachable(pred)) {
+                continue;
+            }
+            for (BasicBlock *runner = pred; runner != getIdom(block);
+                 runner = getIdom(runner)) {
+                auto &frontier = m_frontiers[runner->getId()];
+                if (std::find(frontier.begin(), frontier.end(), block) ==
+                    frontier.end()) {
+                    frontier.push_back(block);
+                }
+            }
+        }
+    }
+}
+
+BasicBlock *DominatorTree::intersect(BasicBlock *p_a, BasicBlock *p_b) const {
+    while (p_a != p_b) {
+        while (m_rpo_index[p_a->getId()] > m_rpo_index[p_b->getId()]) {
+            p_a = m_idoms[p_a->getId()];
+        }
+        while (m_rpo_index[p_b->getId()] > m_rpo_index[p_a->getId()]) {
+            p_b = m_idoms[p_b->getId()];
+        }
+    }
+    return p_a;
+}
+
+bool DominatorTree::dominates(const BasicBlock *p_a,
+                              const BasicBlock *p_b) const {
+    if (!isReachable(p_b)) {
+        return true;
+    }
+    for (const BasicBlock *block = p_b; block; block = getIdom(block)) {
+        if (block == p_a) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DominatorTree::dominates(const Instruction *p_def,
+                              const Instruction *p_user,
+                              const size_t p_operand) const {
+    const BasicBlock *def_block = p_def->getParent();
+    if (p_user->isPhi()) {
+        return dominates(def_block, p_user->getBlock(p_operand));
+    }
+    const BasicBlock *use_block = p_user->getParent();
+    if (def_block != use_block) {
+        return dominates(def_block, use_block);
+    }
+    return def_block->indexOf(p_def) < use_block->indexOf(p_user);
+}
+
+} // namespace ir
@@ -0,0 +1,201 @@
+#include "ir/GVN.hpp"
+#include "ir/Dominators.hpp"
+#include "ir/SideEffects.hpp"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+namespace ir {
+
+bool GVN::Key::operator<(const Key &p_other) const {
+    return std::tie(opcode, imm, symbol, slot, memory, operands) <
+           std::tie(p_other.opcode, p_other.imm, p_other.symbol, p_other.slot,
+                    p_other.memory, p_other.operands);
+}
+
+size_t GVN::run() {
+    m_function.updatePredecessors();
+    const DominatorTree dom_tree(m_function);
+    m_replacements.assign(m_function.getNumValueIds(), nullptr);
+    m_exit_memory.assign(m_function.getNumBlockIds(), 0);
+    m_num_uses.assign(m_function.getNumValueIds(), 0);
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            for (const Instruction *operand : instr->getOperands()) {
+                ++m_num_uses[operand->getId()];
+            }
+        }
+    }
+
+    // preorder over the dominator tree; the keys of a block leave the table
+    // once its subtree is done
+    std::vector<std::pair<BasicBlock *, size_t>> walk = {
+        {m_function.getEntry(), 0}};
+    std::vector<std::vector<Key>> added = {visit(m_function.getEntry(), dom_tree)};
+    while (!walk.empty()) {
+        BasicBlock *block = walk.back().first;
+        const auto &children = dom_tree.getChildren(block);
+        if (walk.back().second < children.size()) {
+            BasicBlock *child = children[walk.back().second++];
+            walk.emplace_back(child, 0);
+            added.push_back(visit(child, dom_tree));
+            continue;
+        }
+        for (const Key &key : added.back()) {
+            m_values.erase(key);
+        }
+        added.pop_back();
+        walk.pop_back();
+    }
+
+    // phis may use a value redundant further down
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            for (auto &operand : instr->getOperands()) {
+                operand = resolve(operand);
+            }
+        }
+    }
+    for (auto &block : m_function.getBlocks()) {
+        auto &instrs = block->getInstrs();
+        instrs.erase(std::remove_if(instrs.begin(), instrs.end(),
+                                    [&](const std::unique_ptr<Instruction> &p_ptr) {
+                                        return m_replacements[p_ptr->getId()] !=
+                                               nullptr;
+                                    }),
+                     instrs.end());
+    }
+    return m_num_removed;
+}
+
+std::vector<GVN::Key> GVN::visit(BasicBlock *p_block,
+                                 const DominatorTree &p_dom_tree) {
+    const auto &preds = p_block->getPredecessors();
+    if (preds.size() == 1 && preds.front() == p_dom_tree.getIdom(p_block)) {
+        m_memory = m_exit_memory[preds.front()->getId()];
+    } else {
+        m_memory = ++m_next_memory;
+    }
+
+    std::vector<Key> added;
+    const auto &instrs = p_block->getInstrs();
+    for (size_t i = 0; i < instrs.size(); ++i) {
+        Instruction *instr = instrs[i].get();
+        // a compare the branch right after alone uses costs nothing on top
+        // of the branch, while a value kept for it would
+        const bool fused = instr->isCompare() && m_num_uses[instr->getId()] == 1 &&
+                           i + 1 < instrs.size() &&
+                           instrs[i + 1]->getOpcode() == Opcode::kBranch &&
+                           instrs[i + 1]->getOperand(0) == instr;
+        if (!fused && isNumbered(*instr)) {
+            Key key = makeKey(*instr);
+            auto it = m_values.find(key);
+            if (it != m_values.end()) {
+                m_replacements[instr->getId()] = it->second;
+                ++m_num_removed;
+            } else {
+                m_values.emplace(key, instr);
+                added.push_back(std::move(key));
+            }
+            continue;
+        }
+
+        switch (instr->getOpcode()) {
+        case Opcode::kStore:
+        case Opcode::kStoreGlobal: {
+            m_memory = ++m_next_memory;
+            Key key{instr->getOpcode() == Opcode::kStore ? Opcode::kLoad
+                                                         : Opcode::kLoadGlobal,
+                    0,
+                    instr->getSymbol(),
+                    instr->getSlot(),
+                    m_memory,
+                    {}};
+            if (m_values.emplace(key, resolve(instr->getOperand(0))).second) {
+                added.push_back(std::move(key));
+            }
+            break;
+        }
+        case Opcode::kStorePtr: {
+            m_memory = ++m_next_memory;
+            Key key = makeKey(*instr);
+            key.opcode = Opcode::kLoadPtr;
+            key.operands.erase(key.operands.begin());
+            if (m_values.emplace(key, resolve(instr->getOperand(0))).second) {
+                added.push_back(std::move(key));
+            }
+            break;
+        }
+        case Opcode::kCall:
+        case Opcode::kVStore:
+            m_memory = ++m_next_memory;
+            break;
+        default:
+            break;
+        }
+    }
+    m_exit_memory[p_block->getId()] = m_memory;
+    return added;
+}
+
+bool GVN::isNumbered(const Instruction &p_instr) const {
+    switch (p_instr.getOpcode()) {
+    case Opcode::kNeg:
+    case Opcode::kNot:
+    case Opcode::kLoad:
+    case Opcode::kLoadGlobal:
+    case Opcode::kLoadPtr:
+    case Opcode::kAddr:
+    case Opcode::kAddrGlobal:
+        return true;
+    case Opcode::kCall:
+        // the first call has returned, so the second one would as well
+        return m_side_effects.get(p_instr.getSymbol()).isPure();
+    default:
+        return p_instr.isBinary();
+    }
+}
+
+GVN::Key GVN::makeKey(const Instruction &p_instr) const {
+    Key key{p_instr.getOpcode(), p_instr.getImm(), p_instr.getSymbol(),
+            p_instr.getSlot(), 0, {}};
+    for (Instruction *operand : p_instr.getOperands()) {
+        operand = resolve(operand);
+        key.operands.push_back(operand->isConst()
+                                   ? std::make_pair(-1, operand->getImm())
+                                   : std::make_pair(operand->getId(), 0));
+    }
+    switch (p_instr.getOpcode()) {
+    case Opcode::kLoad:
+    case Opcode::kLoadGlobal:
+    case Opcode::kLoadPtr:
+    case Opcode::kStorePtr:
+    case Opcode::kCall:
+        key.memory = m_memory;
+        break;
+    case Opcode::kGt:
+        key.opcode = Opcode::kLt;
+        std::swap(key.operands[0], key.operands[1]);
+        break;
+    case Opcode::kGe:
+        key.opcode = Opcode::kLe;
+        std::swap(key.operands[0], key.operands[1]);
+        break;
+    default:
+        if (p_instr.isCommutative() && key.operands[1] < key.operands[0]) {
+            std::swap(key.operands[0], key.operands[1]);
+        }
+        break;
+    }
+    return key;
+}
+
+Instruction *GVN::resolve(Instruction *p_value) const {
+    while (m_replacements[p_value->getId()]) {
+        p_value = m_replacements[p_value->getId()];
+    }
+    return p_value;
+}
+
+} // namespace ir
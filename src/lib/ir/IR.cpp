@@ -0,0 +1,470 @@
+#include "ir/IR.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ir {
+
+const char *getOpcodeName(const Opcode p_opcode) {
+    switch (p_opcode) {
+    case Opcode::kConst:
+        return "const";
+    case Opcode::kParam:
+        return "param";
+    case Opcode::kAdd:
+        return "add";
+    case Opcode::kSub:
+        return "sub";
+    case Opcode::kMul:
+        return "mul";
+    case Opcode::kDiv:
+        return "div";
+    case Opcode::kMod:
+        return "mod";
+    case Opcode::kNeg:
+        return "neg";
+    case Opcode::kNot:
+        return "not";
+    case Opcode::kEq:
+        return "eq";
+    case Opcode::kNe:
+        return "ne";
+    case Opcode::kLt:
+        return "lt";
+    case Opcode::kLe:
+        return "le";
+    case Opcode::kGt:
+        return "gt";
+    case Opcode::kGe:
+        return "ge";
+    case Opcode::kLoad:
+        return "load";
+    case Opcode::kStore:
+        return "store";
+    case Opcode::kLoadGlobal:
+        return "load.global";
+    case Opcode::kStoreGlobal:
+        return "store.global";
+    case Opcode::kAddr:
+        return "addr";
+    case Opcode::kAddrGlobal:
+        return "addr.global";
+    case Opcode::kLoadPtr:
+        return "load.ptr";
+    case Opcode::kStorePtr:
+        return "store.ptr";
+    case Opcode::kCall:
+        return "call";
+    case Opcode::kPrint:
+        return "print";
+    case Opcode::kRead:
+        return "read";
+    case Opcode::kCount:
+        return "count";
+    case Opcode::kPhi:
+        return "phi";
+    case Opcode::kJump:
+        return "jump";
+    case Opcode::kBranch:
+        return "branch";
+    case Opcode::kRet:
+        return "ret";
+    case Opcode::kVSetVL:
+        return "vsetvl";
+    case Opcode::kVLoad:
+        return "vload";
+    case Opcode::kVSplat:
+        return "vsplat";
+    case Opcode::kVStore:
+        return "vstore";
+    case Opcode::kVAdd:
+        return "vadd";
+    case Opcode::kVSub:
+        return "vsub";
+    case Opcode::kVMul:
+        return "vmul";
+    case Opcode::kVRedSum:
+        return "vredsum";
+    }
+    return "?";
+}
+
+bool Instruction::isBinary() const {
+    switch (m_opcode) {
+    case Opcode::kAdd:
+    case Opcode::kSub:
+    case Opcode::kMul:
+    case Opcode::kDiv:
+    case Opcode::kMod:
+        return true;
+    default:
+        return isCompare();
+    }
+}
+
+bool Instruction::isCompare() const {
+    switch (m_opcode) {
+    case Opcode::kEq:
+    case Opcode::kNe:
+    case Opcode::kLt:
+    case Opcode::kLe:
+    case Opcode::kGt:
+    case Opcode::kGe:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool Instruction::isTerminator() const {
+    return m_opcode == Opcode::kJump || m_opcode == Opcode::kBranch ||
+           m_opcode == Opcode::kRet;
+}
+
+// the V extension comes last in Opcode
+static bool isVectorOp(const Opcode p_opcode) {
+    return p_opcode >= Opcode::kVSetVL;
+}
+
+bool Instruction::isVector() const {
+    switch (m_opcode) {
+    case Opcode::kVLoad:
+    case Opcode::kVSplat:
+    case Opcode::kVAdd:
+    case Opcode::kVSub:
+    case Opcode::kVMul:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool Instruction::hasResult() const {
+    switch (m_opcode) {
+    case Opcode::kStore:
+    case Opcode::kStoreGlobal:
+    case Opcode::kStorePtr:
+    case Opcode::kVStore:
+    case Opcode::kPrint:
+    case Opcode::kCount:
+    case Opcode::kJump:
+    case Opcode::kBranch:
+    case Opcode::kRet:
+        return false;
+    default:
+        return true;
+    }
+}
+
+bool Instruction::isCommutative() const {
+    switch (m_opcode) {
+    case Opcode::kAdd:
+    case Opcode::kMul:
+    case Opcode::kEq:
+    case Opcode::kNe:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool Instruction::hasSideEffect() const {
+    switch (m_opcode) {
+    case Opcode::kStore:
+    case Opcode::kStoreGlobal:
+    case Opcode::kStorePtr:
+    case Opcode::kCall:
+    case Opcode::kPrint:
+    case Opcode::kRead:
+    case Opcode::kCount:
+        return true;
+    default:
+        return isTerminator() || isVectorOp(m_opcode);
+    }
+}
+
+Instruction *Instruction::getIncomingValue(const BasicBlock *p_block) const {
+    for (size_t i = 0; i < m_blocks.size(); ++i) {
+        if (m_blocks[i] == p_block) {
+            return m_operands[i];
+        }
+    }
+    return nullptr;
+}
+
+void Instruction::addIncoming(Instruction *const p_value,
+                              BasicBlock *const p_block) {
+    m_operands.push_back(p_value);
+    m_blocks.push_back(p_block);
+}
+
+void Instruction::removeIncoming(const BasicBlock *p_block) {
+    for (size_t i = 0; i < m_blocks.size();) {
+        if (m_blocks[i] == p_block) {
+            m_operands.erase(m_operands.begin() + i);
+            m_blocks.erase(m_blocks.begin() + i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void Instruction::replaceUsesOfWith(const Instruction *p_from,
+                                    Instruction *const p_to) {
+    std::replace(m_operands.begin(), m_operands.end(),
+                 const_cast<Instruction *>(p_from), p_to);
+}
+
+Instruction *BasicBlock::getTerminator() const {
+    if (m_instrs.empty() || !m_instrs.back()->isTerminator()) {
+        return nullptr;
+    }
+    return m_instrs.back().get();
+}
+
+BasicBlock::Blocks BasicBlock::getSuccessors() const {
+    const Instruction *terminator = getTerminator();
+    if (!terminator) {
+        return {};
+    }
+    return terminator->getBlocks();
+}
+
+int64_t BasicBlock::getCount() const {
+    int64_t count = 0;
+    if (this == m_parent->getEntry()) {
+        count = m_parent->getEntryCount();
+        if (count < 0) {
+            return -1;
+        }
+    }
+    for (const BasicBlock *pred : m_preds) {
+        const Instruction *terminator = pred->getTerminator();
+        if (terminator->getCounts().empty()) {
+            return -1;
+        }
+        for (size_t i = 0; i < terminator->getBlocks().size(); ++i) {
+            if (terminator->getBlock(i) == this) {
+                count += terminator->getCounts()[i];
+            }
+        }
+    }
+    return count;
+}
+
+size_t BasicBlock::indexOf(const Instruction *p_instr) const {
+    for (size_t i = 0; i < m_instrs.size(); ++i) {
+        if (m_instrs[i].get() == p_instr) {
+            return i;
+        }
+    }
+    assert(false && "instruction not in this block");
+    return m_instrs.size();
+}
+
+size_t BasicBlock::getFirstNonPhi() const {
+    size_t pos = 0;
+    while (pos < m_instrs.size() && m_instrs[pos]->isPhi()) {
+        ++pos;
+    }
+    return pos;
+}
+
+Instruction *BasicBlock::insert(const size_t p_pos,
+                                std::unique_ptr<Instruction> p_instr) {
+    p_instr->setParent(this);
+    return m_instrs.insert(m_instrs.begin() + p_pos, std::move(p_instr))->get();
+}
+
+Instruction *BasicBlock::append(std::unique_ptr<Instruction> p_instr) {
+    return insert(m_instrs.size(), std::move(p_instr));
+}
+
+Instruction *
+BasicBlock::insertBeforeTerminator(std::unique_ptr<Instruction> p_instr) {
+    return insert(getTerminator() ? m_instrs.size() - 1 : m_instrs.size(),
+                  std::move(p_instr));
+}
+
+std::unique_ptr<Instruction> BasicBlock::remove(Instruction *p_instr) {
+    const size_t pos = indexOf(p_instr);
+    std::unique_ptr<Instruction> instr = std::move(m_instrs[pos]);
+    m_instrs.erase(m_instrs.begin() + pos);
+    instr->setParent(nullptr);
+    return instr;
+}
+
+BasicBlock *Function::getNextBlock(const BasicBlock *p_block) const {
+    for (size_t i = 0; i + 1 < m_blocks.size(); ++i) {
+        if (m_blocks[i].get() == p_block) {
+            return m_blocks[i + 1].get();
+        }
+    }
+    return nullptr;
+}
+
+BasicBlock *Function::createBlock() {
+    m_blocks.emplace_back(new BasicBlock(m_next_block_id++, this));
+    return m_blocks.back().get();
+}
+
+static Function::Blocks::iterator findBlock(Function::Blocks &p_blocks,
+                                            const BasicBlock *p_block) {
+    return std::find_if(p_blocks.begin(), p_blocks.end(),
+                        [&](const std::unique_ptr<BasicBlock> &p_ptr) {
+                            return p_ptr.get() == p_block;
+                        });
+}
+
+void Function::moveBlockToEnd(BasicBlock *p_block) {
+    auto it = findBlock(m_blocks, p_block);
+    std::unique_ptr<BasicBlock> block = std::move(*it);
+    m_blocks.erase(it);
+    m_blocks.push_back(std::move(block));
+}
+
+void Function::moveBlockBefore(BasicBlock *p_block, const BasicBlock *p_next) {
+    auto it = findBlock(m_blocks, p_block);
+    std::unique_ptr<BasicBlock> block = std::move(*it);
+    m_blocks.erase(it);
+    m_blocks.insert(findBlock(m_blocks, p_next), std::move(block));
+}
+
+void Function::eraseBlock(BasicBlock *p_block) {
+    m_blocks.erase(findBlock(m_blocks, p_block));
+}
+
+Slot *Function::createSlot(const std::string &p_name, const int p_size) {
+    m_slots.emplace_back(new Slot{m_next_slot_id++, p_name, p_size});
+    return m_slots.back().get();
+}
+
+void Function::eraseSlot(const Slot *p_slot) {
+    m_slots.erase(std::find_if(m_slots.begin(), m_slots.end(),
+                               [&](const std::unique_ptr<Slot> &p_ptr) {
+                                   return p_ptr.get() == p_slot;
+                               }));
+}
+
+std::unique_ptr<Instruction>
+Function::createInstr(const Opcode p_opcode,
+                      const Instruction::Operands &p_operands) {
+    return std::unique_ptr<Instruction>(
+        new Instruction(p_opcode, m_next_value_id++, p_operands));
+}
+
+void Function::updatePredecessors() {
+    for (auto &block : m_blocks) {
+        block->getPredecessors().clear();
+    }
+    for (auto &block : m_blocks) {
+        for (BasicBlock *succ : block->getSuccessors()) {
+            auto &preds = succ->getPredecessors();
+            // a branch with both targets the same is still one edge
+            if (std::find(preds.begin(), preds.end(), block.get()) ==
+                preds.end()) {
+                preds.push_back(block.get());
+            }
+        }
+    }
+}
+
+void Function::removeUnreachableBlocks() {
+    std::vector<bool> reachable(m_next_block_id, false);
+    std::vector<BasicBlock *> worklist = {getEntry()};
+    reachable[getEntry()->getId()] = true;
+    while (!worklist.empty()) {
+        BasicBlock *block = worklist.back();
+        worklist.pop_back();
+        for (BasicBlock *succ : block->getSuccessors()) {
+            if (!reachable[succ->getId()]) {
+                reachable[succ->getId()] = true;
+                worklist.push_back(succ);
+            }
+        }
+    }
+
+    for (auto &block : m_blocks) {
+        if (!reachable[block->getId()]) {
+            continue;
+        }
+        for (auto &instr : block->getInstrs()) {
+            if (!instr->isPhi()) {
+                break;
+            }
+            auto &blocks = instr->getBlocks();
+            for (size_t i = 0; i < blocks.size();) {
+                if (!reachable[blocks[i]->getId()]) {
+                    instr->removeIncoming(blocks[i]);
+                } else {
+                    ++i;
+                }
+            }
+        }
+    }
+    m_blocks.erase(std::remove_if(m_blocks.begin(), m_blocks.end(),
+                                  [&](const std::unique_ptr<BasicBlock> &p_ptr) {
+                                      return !reachable[p_ptr->getId()];
+                                  }),
+                   m_blocks.end());
+    updatePredecessors();
+}
+
+BasicBlock *Function::splitEdge(BasicBlock *p_from, BasicBlock *p_to) {
+    BasicBlock *middle = createBlock();
+    moveBlockBefore(middle, p_to);
+
+    auto jump = createInstr(Opcode::kJump);
+    jump->getBlocks().push_back(p_to);
+    const Instruction *terminator = p_from->getTerminator();
+    if (!terminator->getCounts().empty()) {
+        uint64_t count = 0;
+        for (size_t i = 0; i < terminator->getBlocks().size(); ++i) {
+            if (terminator->getBlock(i) == p_to) {
+                count += terminator->getCounts()[i];
+            }
+        }
+        jump->getCounts().push_back(count);
+    }
+    middle->append(std::move(jump));
+
+    auto &targets = p_from->getTerminator()->getBlocks();
+    std::replace(targets.begin(), targets.end(), p_to, middle);
+    for (auto &instr : p_to->getInstrs()) {
+        if (!instr->isPhi()) {
+            break;
+        }
+        std::replace(instr->getBlocks().begin(), instr->getBlocks().end(),
+                     p_from, middle);
+    }
+    updatePredecessors();
+    return middle;
+}
+
+void Function::replaceAllUsesWith(const Instruction *p_from,
+                                  Instruction *p_to) {
+    for (auto &block : m_blocks) {
+        for (auto &instr : block->getInstrs()) {
+            instr->replaceUsesOfWith(p_from, p_to);
+        }
+    }
+}
+
+Function *Module::createFunction(const std::string &p_name,
+                                 const int p_num_params,
+                                 const bool p_returns_value) {
+    m_functions.emplace_back(
+        new Function(p_name, p_num_params, p_returns_value));
+    return m_functions.back().get();
+}
+
+Function *Module::lookup(const std::string &p_name) const {
+    for (auto &function : m_functions) {
+        if (function->getName() == p_name) {
+            return function.get();
+        }
+    }
+    return nullptr;
+}
+
+} // namespace ir
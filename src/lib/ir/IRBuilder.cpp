@@ -0,0 +1,882 @@
+#include "ir/IRBuilder.hpp"
+#include "codegen/FrameLayout.hpp"
+#include "sema/SymbolTable.hpp"
+#include "visitor/AstNodeInclude.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <tuple>
+
+namespace ir {
+
+// instructions an unrolled loop body may grow to
+static const uint64_t kMaxUnrolledSize = 128;
+// a shorter loop doesn't pay for the vsetvli
+static const uint32_t kMinVectorizedTripCount = 4;
+// v1 ~ v31 hold the vectors, in groups of LMUL registers
+static const size_t kNumVectorRegs = 32;
+
+static Opcode getBinaryOpcode(const Operator p_op) {
+    switch (p_op) {
+    case Operator::kPlusOp:
+        return Opcode::kAdd;
+    case Operator::kMinusOp:
+        return Opcode::kSub;
+    case Operator::kMultiplyOp:
+        return Opcode::kMul;
+    case Operator::kDivideOp:
+        return Opcode::kDiv;
+    case Operator::kModOp:
+        return Opcode::kMod;
+    case Operator::kEqualOp:
+        return Opcode::kEq;
+    case Operator::kNotEqualOp:
+        return Opcode::kNe;
+    case Operator::kLessOp:
+        return Opcode::kLt;
+    case Operator::kLessOrEqualOp:
+        return Opcode::kLe;
+    case Operator::kGreaterOp:
+        return Opcode::kGt;
+    case Operator::kGreaterOrEqualOp:
+        return Opcode::kGe;
+    default:
+        assert(false && "not a binary operator with a value");
+        return Opcode::kAdd;
+    }
+}
+
+namespace {
+
+// An element a[c1]...[i + c] of an integer array in a loop over i: every
+// index but the last is a constant, the last one follows the loop.
+struct VectorAccess {
+    const SymbolEntry *array;
+    std::vector<int32_t> leading;
+    int32_t offset;
+
+    bool operator<(const VectorAccess &p_other) const {
+        return std::tie(array, leading, offset) <
+               std::tie(p_other.array, p_other.leading, p_other.offset);
+    }
+};
+
+// An array parameter may be any array passed in, or a row of one, so it
+// may be the memory of another parameter or of a global. Two globals never
+// share.
+bool mayShare(const SymbolEntry &p_lhs, const SymbolEntry &p_rhs) {
+    auto is_param = [](const SymbolEntry &p_entry) {
+        return p_entry.getKind() == SymbolEntry::KindEnum::kParameterKind;
+    };
+    auto is_shareable = [&](const SymbolEntry &p_entry) {
+        return p_entry.getLevel() == 0 || is_param(p_entry);
+    };
+    return &p_lhs == &p_rhs ||
+           (is_shareable(p_lhs) && is_shareable(p_rhs) &&
+            (is_param(p_lhs) || is_param(p_rhs)));
+}
+
+// Whether the body of a for loop can run vl iterations at once, and the
+// parts of it that do: the elements accessed, the scalars that stay the
+// same throughout, and the statements.
+class VectorLoop {
+  public:
+    enum class Kind { kInvalid, kScalar, kVector };
+
+    struct Statement {
+        ExpressionNode *expr;
+        // the element stored, or the scalar added up if null
+        const VectorAccess *store;
+        const SymbolEntry *sum;
+    };
+
+  private:
+    const SymbolManager &m_symbol_manager;
+    const SymbolEntry &m_iter;
+    const int64_t m_lower;
+    const int64_t m_trip_count;
+    // the scalars the body assigns, all of them reductions
+    std::set<const SymbolEntry *> m_sums;
+    std::map<const ExpressionNode *, Kind> m_kinds;
+    std::map<const AstNode *, VectorAccess> m_accesses;
+    std::vector<Statement> m_statements;
+    // the largest expressions without a vector in them
+    std::vector<ExpressionNode *> m_invariants;
+    size_t m_num_vectors = 0;
+
+  public:
+    VectorLoop(const SymbolManager &p_symbol_manager, const SymbolEntry &p_iter,
+               const int32_t p_lower, const uint32_t p_trip_count)
+        : m_symbol_manager(p_symbol_manager), m_iter(p_iter), m_lower(p_lower),
+          m_trip_count(p_trip_count) {}
+
+    bool analyze(CompoundStatementNode &p_body);
+
+    Kind getKind(const ExpressionNode &p_expr) const {
+        return m_kinds.at(&p_expr);
+    }
+    const VectorAccess &getAccess(const AstNode &p_ref) const {
+        return m_accesses.at(&p_ref);
+    }
+    const std::map<const AstNode *, VectorAccess> &getAccesses() const {
+        return m_accesses;
+    }
+    const std::vector<Statement> &getStatements() const { return m_statements; }
+    const std::vector<ExpressionNode *> &getInvariants() const {
+        return m_invariants;
+    }
+    // the vectors that may be live at once
+    size_t getNumVectors() const { return m_num_vectors; }
+
+  private:
+    bool isIter(const ExpressionNode &p_expr) const;
+    // only accesses within the bounds of the array are taken, so that
+    // different rows never overlap
+    bool parseAccess(VariableReferenceNode &p_ref);
+    Kind classify(ExpressionNode &p_expr);
+    void collectInvariants(ExpressionNode &p_expr);
+    // no element is stored to in one iteration and accessed in another
+    bool isIndependent() const;
+};
+
+bool VectorLoop::isIter(const ExpressionNode &p_expr) const {
+    auto *const ref = dynamic_cast<const VariableReferenceNode *>(&p_expr);
+    return ref && ref->getIndices().empty() &&
+           m_symbol_manager.lookup(ref->getName()) == &m_iter;
+}
+
+bool VectorLoop::parseAccess(VariableReferenceNode &p_ref) {
+    const SymbolEntry *entry = m_symbol_manager.lookup(p_ref.getName());
+    const PType &type = *entry->getTypePtr();
+    const auto &dimensions = type.getDimensions();
+    const auto &indices = p_ref.getIndices();
+    if (!type.isPrimitiveInteger() || indices.size() != dimensions.size()) {
+        return false;
+    }
+    VectorAccess access{entry, {}, 0};
+    for (size_t i = 0; i + 1 < indices.size(); ++i) {
+        auto *const constant = dynamic_cast<ConstantValueNode *>(indices[i].get());
+        if (!constant || constant->getConstantPtr()->word() < 0 ||
+            static_cast<uint64_t>(constant->getConstantPtr()->word()) >=
+                dimensions[i]) {
+            return false;
+        }
+        access.leading.push_back(constant->getConstantPtr()->word());
+    }
+
+    // i, i + c, c + i or i - c
+    ExpressionNode &last = *indices.back();
+    if (!isIter(last)) {
+        auto *const bin_op = dynamic_cast<BinaryOperatorNode *>(&last);
+        if (!bin_op || (bin_op->getOp() != Operator::kPlusOp &&
+                        bin_op->getOp() != Operator::kMinusOp)) {
+            return false;
+        }
+        const bool iter_first = isIter(*bin_op->getL());
+        auto *const constant = dynamic_cast<ConstantValueNode *>(
+            iter_first ? bin_op->getR() : bin_op->getL());
+        if (!constant || !(iter_first || isIter(*bin_op->getR())) ||
+            (bin_op->getOp() == Operator::kMinusOp && !iter_first)) {
+            return false;
+        }
+        access.offset = constant->getConstantPtr()->word();
+        if (bin_op->getOp() == Operator::kMinusOp) {
+            access.offset = -access.offset;
+        }
+    }
+    const int64_t first = m_lower + access.offset;
+    if (first < 0 ||
+        first + m_trip_count > static_cast<int64_t>(dimensions.back())) {
+        return false;
+    }
+    m_accesses.emplace(&p_ref, access);
+    return true;
+}
+
+VectorLoop::Kind VectorLoop::classify(ExpressionNode &p_expr) {
+    // so are calls, which may do anything to the arrays
+    Kind kind = Kind::kInvalid;
+    if (auto *const constant = dynamic_cast<ConstantValueNode *>(&p_expr)) {
+        if (constant->getConstantPtr()->getTypePtr()->isPrimitiveInteger()) {
+            kind = Kind::kScalar;
+        }
+    } else if (auto *const ref = dynamic_cast<VariableReferenceNode *>(&p_expr)) {
+        const SymbolEntry *entry = m_symbol_manager.lookup(ref->getName());
+        if (!ref->getIndices().empty()) {
+            if (parseAccess(*ref)) {
+                kind = Kind::kVector;
+                ++m_num_vectors;
+            }
+        } else if (entry != &m_iter && !m_sums.count(entry) &&
+                   entry->getTypePtr()->isInteger()) {
+            kind = Kind::kScalar;
+        }
+    } else if (auto *const bin_op = dynamic_cast<BinaryOperatorNode *>(&p_expr)) {
+        const Kind lhs = classify(*bin_op->getL());
+        const Kind rhs = classify(*bin_op->getR());
+        const bool is_arithmetic = bin_op->getOp() == Operator::kPlusOp ||
+                                   bin_op->getOp() == Operator::kMinusOp ||
+                                   bin_op->getOp() == Operator::kMultiplyOp;
+        if (lhs == Kind::kInvalid || rhs == Kind::kInvalid) {
+            kind = Kind::kInvalid;
+        } else if (lhs == Kind::kScalar && rhs == Kind::kScalar) {
+            kind = Kind::kScalar;
+        } else if (is_arithmetic) {
+            kind = Kind::kVector;
+            ++m_num_vectors;
+        }
+    } else if (auto *const un_op = dynamic_cast<UnaryOperatorNode *>(&p_expr)) {
+        kind = classify(*un_op->getVal());
+        if (kind == Kind::kVector) {
+            if (un_op->getOp() == Operator::kNegOp) {
+                ++m_num_vectors;
+            } else {
+                kind = Kind::kInvalid;
+            }
+        }
+    }
+    m_kinds[&p_expr] = kind;
+    return kind;
+}
+
+void VectorLoop::collectInvariants(ExpressionNode &p_expr) {
+    if (getKind(p_expr) == Kind::kScalar) {
+        m_invariants.push_back(&p_expr);
+    } else if (auto *const bin_op = dynamic_cast<BinaryOperatorNode *>(&p_expr)) {
+        collectInvariants(*bin_op->getL());
+        collectInvariants(*bin_op->getR());
+    } else if (auto *const un_op = dynamic_cast<UnaryOperatorNode *>(&p_expr)) {
+        collectInvariants(*un_op->getVal());
+    }
+}
+
+bool VectorLoop::isIndependent() const {
+    for (const auto &statement : m_statements) {
+        if (!statement.store) {
+            continue;
+        }
+        const VectorAccess &store = *statement.store;
+        for (const auto &access : m_accesses) {
+            const VectorAccess &other = access.second;
+            if (other.array == store.array && other.leading != store.leading) {
+                continue;
+            }
+            if (mayShare(*other.array, *store.array) &&
+                !(other.leading == store.leading &&
+                  other.offset == store.offset)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool VectorLoop::analyze(CompoundStatementNode &p_body) {
+    if (p_body.getSymbolTable() && !p_body.getSymbolTable()->getEntries().empty()) {
+        return false;
+    }
+    std::vector<AssignmentNode *> assignments;
+    for (const auto &stmt : p_body.getStmtNodes()) {
+        auto *const assignment = dynamic_cast<AssignmentNode *>(stmt.get());
+        if (!assignment) {
+            return false;
+        }
+        assignments.push_back(assignment);
+        VariableReferenceNode &target = *assignment->getL();
+        const SymbolEntry *entry = m_symbol_manager.lookup(target.getName());
+        if (target.getIndices().empty() &&
+            (entry == &m_iter || !m_sums.insert(entry).second)) {
+            return false;
+        }
+    }
+
+    for (AssignmentNode *assignment : assignments) {
+        VariableReferenceNode &target = *assignment->getL();
+        if (!target.getIndices().empty()) {
+            if (!parseAccess(target) ||
+                classify(*assignment->getR()) == Kind::kInvalid) {
+                return false;
+            }
+            // a scalar is spread over a vector first
+            if (getKind(*assignment->getR()) == Kind::kScalar) {
+                ++m_num_vectors;
+            }
+            collectInvariants(*assignment->getR());
+            m_statements.push_back(
+                {assignment->getR(), &m_accesses.at(&target), nullptr});
+            continue;
+        }
+
+        // s := s + e or s := e + s, where e doesn't read s
+        const SymbolEntry *sum = m_symbol_manager.lookup(target.getName());
+        auto *const bin_op = dynamic_cast<BinaryOperatorNode *>(assignment->getR());
+        if (!sum->getTypePtr()->isInteger() || !bin_op ||
+            bin_op->getOp() != Operator::kPlusOp) {
+            return false;
+        }
+        auto is_sum = [&](ExpressionNode *p_expr) {
+            auto *const ref = dynamic_cast<VariableReferenceNode *>(p_expr);
+            return ref && ref->getIndices().empty() &&
+                   m_symbol_manager.lookup(ref->getName()) == sum;
+        };
+        ExpressionNode *addend = is_sum(bin_op->getL())   ? bin_op->getR()
+                                 : is_sum(bin_op->getR()) ? bin_op->getL()
+                                                          : nullptr;
+        if (!addend || classify(*addend) == Kind::kInvalid) {
+            return false;
+        }
+        collectInvariants(*addend);
+        m_statements.push_back({addend, nullptr, sum});
+    }
+    // kVRedSum needs a register of its own
+    for (const auto &statement : m_statements) {
+        if (!statement.store) {
+            ++m_num_vectors;
+            break;
+        }
+    }
+    return !m_statements.empty() && isIndependent();
+}
+
+} // namespace
+
+void IRBuilder::beginFunction(const std::string &p_name,
+                              const int p_num_params,
+                              const bool p_returns_value) {
+    m_function = m_module.createFunction(p_name, p_num_params, p_returns_value);
+    m_block = m_function->createBlock();
+}
+
+void IRBuilder::endFunction() {
+    // falling off the end returns, with an unspecified value if any
+    if (!m_block->getTerminator()) {
+        if (m_function->returnsValue()) {
+            emit(Opcode::kRet, {emitConst(0)});
+        } else {
+            emit(Opcode::kRet);
+        }
+    }
+    m_function->removeUnreachableBlocks();
+    m_function = nullptr;
+    m_block = nullptr;
+}
+
+Instruction *IRBuilder::emit(const Opcode p_opcode,
+                             const Instruction::Operands &p_operands) {
+    return m_block->append(m_function->createInstr(p_opcode, p_operands));
+}
+
+Instruction *IRBuilder::emitConst(const int32_t p_value) {
+    Instruction *constant = emit(Opcode::kConst);
+    constant->setImm(p_value);
+    return constant;
+}
+
+void IRBuilder::emitJump(BasicBlock *p_target) {
+    emit(Opcode::kJump)->getBlocks().push_back(p_target);
+}
+
+void IRBuilder::startBlock(BasicBlock *p_block) {
+    m_function->moveBlockToEnd(p_block);
+    m_block = p_block;
+}
+
+Instruction *IRBuilder::evaluate(ExpressionNode &p_expr) {
+    p_expr.accept(*this);
+    return m_value;
+}
+
+void IRBuilder::branchOnCondition(ExpressionNode &p_cond, BasicBlock *p_true,
+                                  BasicBlock *p_false) {
+    if (auto *const constant = dynamic_cast<ConstantValueNode *>(&p_cond)) {
+        emitJump(constant->getConstantPtr()->boolean() ? p_true : p_false);
+        return;
+    }
+    if (auto *const un_op = dynamic_cast<UnaryOperatorNode *>(&p_cond)) {
+        if (un_op->getOp() == Operator::kNotOp) {
+            branchOnCondition(*un_op->getVal(), p_false, p_true);
+            return;
+        }
+    }
+    auto *const bin_op = dynamic_cast<BinaryOperatorNode *>(&p_cond);
+    if (bin_op && (bin_op->getOp() == Operator::kAndOp ||
+                   bin_op->getOp() == Operator::kOrOp)) {
+        BasicBlock *rhs_block = m_function->createBlock();
+        if (bin_op->getOp() == Operator::kAndOp) {
+            branchOnCondition(*bin_op->getL(), rhs_block, p_false);
+        } else {
+            branchOnCondition(*bin_op->getL(), p_true, rhs_block);
+        }
+        startBlock(rhs_block);
+        branchOnCondition(*bin_op->getR(), p_true, p_false);
+        return;
+    }
+
+    Instruction *branch = emit(Opcode::kBranch, {evaluate(p_cond)});
+    branch->getBlocks() = {p_true, p_false};
+}
+
+void IRBuilder::declareLocals(const SymbolTable *p_table) {
+    if (!p_table) {
+        return;
+    }
+    int num_params = 0;
+    for (const auto &entry : p_table->getEntries()) {
+        // constants are used as immediates and need no slot
+        if (entry->getKind() == SymbolEntry::KindEnum::kFunctionKind ||
+            entry->getKind() == SymbolEntry::KindEnum::kProgramKind ||
+            entry->getKind() == SymbolEntry::KindEnum::kConstantKind) {
+            continue;
+        }
+        // an unrolled loop body declares its locals once per copy
+        Slot *&slot = m_slots[entry.get()];
+        if (!slot) {
+            // an array parameter is the address of the caller's
+            const bool is_address =
+                entry->getKind() == SymbolEntry::KindEnum::kParameterKind &&
+                !entry->getTypePtr()->getDimensions().empty();
+            slot = m_function->createSlot(
+                entry->getName(),
+                is_address ? 4 : FrameLayout::getSlotSize(*entry->getTypePtr()));
+        }
+
+        if (entry->getKind() == SymbolEntry::KindEnum::kParameterKind) {
+            Instruction *param = emit(Opcode::kParam);
+            param->setImm(num_params++);
+            storeVar(*entry, param);
+        }
+    }
+}
+
+Instruction *IRBuilder::loadVar(const SymbolEntry &p_entry) {
+    if (p_entry.getKind() == SymbolEntry::KindEnum::kConstantKind) {
+        return emitConst(p_entry.getAttribute().constant()->word());
+    }
+    if (p_entry.getLevel() == 0) {
+        Instruction *load = emit(Opcode::kLoadGlobal);
+        load->setSymbol(p_entry.getName());
+        return load;
+    }
+    Instruction *load = emit(Opcode::kLoad);
+    load->setSlot(m_slots.at(&p_entry));
+    return load;
+}
+
+void IRBuilder::storeVar(const SymbolEntry &p_entry, Instruction *p_value) {
+    if (p_entry.getLevel() == 0) {
+        emit(Opcode::kStoreGlobal, {p_value})->setSymbol(p_entry.getName());
+        return;
+    }
+    emit(Opcode::kStore, {p_value})->setSlot(m_slots.at(&p_entry));
+}
+
+Instruction *IRBuilder::arrayBase(const SymbolEntry &p_entry) {
+    if (p_entry.getLevel() == 0) {
+        Instruction *address = emit(Opcode::kAddrGlobal);
+        address->setSymbol(p_entry.getName());
+        return address;
+    }
+    if (p_entry.getKind() == SymbolEntry::KindEnum::kParameterKind) {
+        return loadVar(p_entry);
+    }
+    Instruction *address = emit(Opcode::kAddr);
+    address->setSlot(m_slots.at(&p_entry));
+    return address;
+}
+
+Instruction *IRBuilder::elementAddress(VariableReferenceNode &p_ref,
+                                       int32_t &p_offset) {
+    const SymbolEntry &entry = *m_symbol_manager_ptr->lookup(p_ref.getName());
+    const auto &dimensions = entry.getTypePtr()->getDimensions();
+    Instruction *address = arrayBase(entry);
+    p_offset = 0;
+    for (size_t i = 0; i < p_ref.getIndices().size(); ++i) {
+        int32_t stride = 4;
+        for (size_t j = i + 1; j < dimensions.size(); ++j) {
+            stride *= dimensions[j];
+        }
+        ExpressionNode &index = *p_ref.getIndices()[i];
+        if (auto *const constant = dynamic_cast<ConstantValueNode *>(&index)) {
+            p_offset += constant->getConstantPtr()->word() * stride;
+            continue;
+        }
+        Instruction *scaled =
+            emit(Opcode::kMul, {evaluate(index), emitConst(stride)});
+        address = emit(Opcode::kAdd, {address, scaled});
+    }
+    return address;
+}
+
+void IRBuilder::assign(VariableReferenceNode &p_ref, Instruction *p_value) {
+    const SymbolEntry &entry = *m_symbol_manager_ptr->lookup(p_ref.getName());
+    if (p_ref.getIndices().empty()) {
+        storeVar(entry, p_value);
+        return;
+    }
+    int32_t offset = 0;
+    Instruction *address = elementAddress(p_ref, offset);
+    emit(Opcode::kStorePtr, {p_value, address})->setImm(offset);
+}
+
+void IRBuilder::visit(ProgramNode &p_program) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_program.getSymbolTable());
+
+    for (const auto &function : p_program.getFuncNodes()) {
+        function->accept(*this);
+    }
+
+    beginFunction("main", 0, false);
+    const_cast<CompoundStatementNode &>(p_program.getBody()).accept(*this);
+    endFunction();
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(
+        p_program.getSymbolTable());
+}
+
+void IRBuilder::visit(ConstantValueNode &p_constant_value) {
+    m_value = emitConst(p_constant_value.getConstantPtr()->word());
+}
+
+void IRBuilder::visit(FunctionNode &p_function) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_function.getSymbolTable());
+
+    beginFunction(p_function.getName(),
+                  FunctionNode::getParametersNum(p_function.getParameters()),
+                  !p_function.getTypePtr()->isVoid());
+    declareLocals(p_function.getSymbolTable());
+    p_function.visitChildNodes(*this);
+    endFunction();
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(
+        p_function.getSymbolTable());
+}
+
+void IRBuilder::visit(CompoundStatementNode &p_compound_statement) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_compound_statement.getSymbolTable());
+
+    declareLocals(p_compound_statement.getSymbolTable());
+    for (const auto &stmt : p_compound_statement.getStmtNodes()) {
+        stmt->accept(*this);
+    }
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(
+        p_compound_statement.getSymbolTable());
+}
+
+void IRBuilder::visit(PrintNode &p_print) {
+    emit(Opcode::kPrint,
+         {evaluate(const_cast<ExpressionNode &>(p_print.getTarget()))});
+}
+
+void IRBuilder::visit(BinaryOperatorNode &p_bin_op) {
+    if (p_bin_op.getOp() == Operator::kAndOp ||
+        p_bin_op.getOp() == Operator::kOrOp) {
+        BasicBlock *true_block = m_function->createBlock();
+        BasicBlock *false_block = m_function->createBlock();
+        BasicBlock *done_block = m_function->createBlock();
+        branchOnCondition(p_bin_op, true_block, false_block);
+
+        startBlock(true_block);
+        Instruction *one = emitConst(1);
+        emitJump(done_block);
+        startBlock(false_block);
+        Instruction *zero = emitConst(0);
+        emitJump(done_block);
+
+        startBlock(done_block);
+        m_value = emit(Opcode::kPhi);
+        m_value->addIncoming(one, true_block);
+        m_value->addIncoming(zero, false_block);
+        return;
+    }
+
+    Instruction *lhs = evaluate(*p_bin_op.getL());
+    Instruction *rhs = evaluate(*p_bin_op.getR());
+    m_value = emit(getBinaryOpcode(p_bin_op.getOp()), {lhs, rhs});
+}
+
+void IRBuilder::visit(UnaryOperatorNode &p_un_op) {
+    Instruction *operand = evaluate(*p_un_op.getVal());
+    m_value = emit(p_un_op.getOp() == Operator::kNegOp ? Opcode::kNeg
+                                                       : Opcode::kNot,
+                   {operand});
+}
+
+void IRBuilder::visit(FunctionInvocationNode &p_func_invocation) {
+    Instruction::Operands args;
+    for (const auto &arg : p_func_invocation.getArguments()) {
+        args.push_back(evaluate(*arg));
+    }
+    m_value = emit(Opcode::kCall, args);
+    m_value->setSymbol(p_func_invocation.getName());
+}
+
+void IRBuilder::visit(VariableReferenceNode &p_variable_ref) {
+    const SymbolEntry &entry =
+        *m_symbol_manager_ptr->lookup(p_variable_ref.getName());
+    const size_t num_dimensions = entry.getTypePtr()->getDimensions().size();
+    if (num_dimensions == 0) {
+        m_value = loadVar(entry);
+        return;
+    }
+    int32_t offset = 0;
+    Instruction *address = elementAddress(p_variable_ref, offset);
+    if (p_variable_ref.getIndices().size() < num_dimensions) {
+        // an array or a row of one is passed by address
+        m_value = offset == 0 ? address
+                              : emit(Opcode::kAdd, {address, emitConst(offset)});
+        return;
+    }
+    m_value = emit(Opcode::kLoadPtr, {address});
+    m_value->setImm(offset);
+}
+
+void IRBuilder::visit(AssignmentNode &p_assignment) {
+    Instruction *value = evaluate(*p_assignment.getR());
+    assign(*p_assignment.getL(), value);
+}
+
+void IRBuilder::visit(ReadNode &p_read) {
+    assign(*p_read.getVar(), emit(Opcode::kRead));
+}
+
+void IRBuilder::visit(IfNode &p_if) {
+    BasicBlock *then_block = m_function->createBlock();
+    BasicBlock *else_block =
+        p_if.getElse() ? m_function->createBlock() : nullptr;
+    BasicBlock *done_block = m_function->createBlock();
+
+    branchOnCondition(*p_if.getCond(), then_block,
+                      else_block ? else_block : done_block);
+    startBlock(then_block);
+    p_if.getBody()->accept(*this);
+    emitJump(done_block);
+    if (else_block) {
+        startBlock(else_block);
+        p_if.getElse()->accept(*this);
+        emitJump(done_block);
+    }
+    startBlock(done_block);
+}
+
+void IRBuilder::visit(WhileNode &p_while) {
+    BasicBlock *cond_block = m_function->createBlock();
+    BasicBlock *body_block = m_function->createBlock();
+    BasicBlock *done_block = m_function->createBlock();
+
+    emitJump(cond_block);
+    startBlock(cond_block);
+    branchOnCondition(*p_while.getCond(), body_block, done_block);
+    startBlock(body_block);
+    p_while.getBody()->accept(*this);
+    emitJump(cond_block);
+    startBlock(done_block);
+}
+
+void IRBuilder::visit(ForNode &p_for) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_for.getSymbolTable());
+
+    declareLocals(p_for.getSymbolTable());
+    const SymbolEntry &iter = *m_symbol_manager_ptr->lookup(
+        p_for.getInit()->getLvalue().getName());
+    const int32_t lower = p_for.getLowerBound().getConstantPtr()->integer();
+    const int32_t upper = p_for.getUpperBound().getConstantPtr()->integer();
+    // the loop ends once the variable reaches the upper bound, wrapping
+    // around if it starts above
+    const uint32_t trip_count =
+        static_cast<uint32_t>(upper) - static_cast<uint32_t>(lower);
+    auto value_at = [&](const uint32_t p_iteration) {
+        return emitConst(static_cast<int32_t>(static_cast<uint32_t>(lower) +
+                                              p_iteration));
+    };
+
+    storeVar(iter, emitConst(lower));
+    if (trip_count == 0 || vectorize(p_for, iter, lower, trip_count)) {
+        m_symbol_manager_ptr->removeSymbolsFromHashTable(
+            p_for.getSymbolTable());
+        return;
+    }
+
+    // the bounds are known, so the first test always passes and the loop
+    // is entered at the body with the test at the bottom
+    BasicBlock *body_block = m_function->createBlock();
+    emitJump(body_block);
+    startBlock(body_block);
+    const int first_id = m_function->getNumValueIds();
+    p_for.getBody()->accept(*this);
+    const uint64_t body_size = m_function->getNumValueIds() - first_id;
+
+    if (trip_count <= m_max_full_unroll &&
+        trip_count * body_size <= kMaxUnrolledSize) {
+        for (uint32_t i = 1; i < trip_count; ++i) {
+            storeVar(iter, value_at(i));
+            p_for.getBody()->accept(*this);
+        }
+        m_symbol_manager_ptr->removeSymbolsFromHashTable(
+            p_for.getSymbolTable());
+        return;
+    }
+
+    uint32_t factor = std::min<uint64_t>(
+        {m_unroll_factor, trip_count, kMaxUnrolledSize / body_size});
+    factor = std::max<uint32_t>(factor, 1);
+    const uint32_t looped = trip_count / factor * factor;
+    for (uint32_t i = 1; i < factor; ++i) {
+        storeVar(iter, emit(Opcode::kAdd, {loadVar(iter), emitConst(1)}));
+        p_for.getBody()->accept(*this);
+    }
+    storeVar(iter, emit(Opcode::kAdd, {loadVar(iter), emitConst(1)}));
+    BasicBlock *done_block = m_function->createBlock();
+    Instruction *at_end = emit(Opcode::kEq, {loadVar(iter), value_at(looped)});
+    emit(Opcode::kBranch, {at_end})->getBlocks() = {done_block, body_block};
+
+    // the iterations the unrolled loop leaves over
+    startBlock(done_block);
+    for (uint32_t i = looped; i < trip_count; ++i) {
+        storeVar(iter, value_at(i));
+        p_for.getBody()->accept(*this);
+    }
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_for.getSymbolTable());
+}
+
+bool IRBuilder::vectorize(ForNode &p_for, const SymbolEntry &p_iter,
+                          const int32_t p_lower, const uint32_t p_trip_count) {
+    if (!m_vectorize || p_trip_count < kMinVectorizedTripCount) {
+        return false;
+    }
+    VectorLoop loop(*m_symbol_manager_ptr, p_iter, p_lower, p_trip_count);
+    if (!loop.analyze(*p_for.getBody())) {
+        return false;
+    }
+    // the widest groups that leave one for every vector, v0 aside
+    int lmul = 8;
+    while (lmul > 1 && kNumVectorRegs / lmul - 1 < loop.getNumVectors()) {
+        lmul /= 2;
+    }
+    if (kNumVectorRegs / lmul - 1 < loop.getNumVectors()) {
+        return false;
+    }
+
+    // what stays the same in every strip is computed once up front: the
+    // scalars and the address of the first element of each access
+    std::map<const ExpressionNode *, Instruction *> invariants;
+    for (ExpressionNode *expr : loop.getInvariants()) {
+        invariants[expr] = evaluate(*expr);
+    }
+    std::map<VectorAccess, Instruction *> first_elements;
+    for (const auto &it : loop.getAccesses()) {
+        const VectorAccess &access = it.second;
+        if (first_elements.count(access)) {
+            continue;
+        }
+        const auto &dimensions = access.array->getTypePtr()->getDimensions();
+        int32_t offset = 0, stride = 4;
+        for (size_t i = dimensions.size(); i-- > 0;) {
+            const int32_t index =
+                i < access.leading.size() ? access.leading[i]
+                                          : p_lower + access.offset;
+            offset += index * stride;
+            stride *= dimensions[i];
+        }
+        first_elements[access] =
+            emit(Opcode::kAdd, {arrayBase(*access.array), emitConst(offset)});
+    }
+    Slot *done = m_function->createSlot("vl.done", 4);
+    emit(Opcode::kStore, {emitConst(0)})->setSlot(done);
+
+    BasicBlock *body_block = m_function->createBlock();
+    BasicBlock *done_block = m_function->createBlock();
+    emitJump(body_block);
+    startBlock(body_block);
+    Instruction *num_done = emit(Opcode::kLoad);
+    num_done->setSlot(done);
+    Instruction *left = emit(
+        Opcode::kSub, {emitConst(static_cast<int32_t>(p_trip_count)), num_done});
+    Instruction *vl = emit(Opcode::kVSetVL, {left});
+    vl->setImm(lmul);
+    Instruction *bytes_done = emit(Opcode::kMul, {num_done, emitConst(4)});
+
+    std::map<VectorAccess, Instruction *> addresses, vectors;
+    auto address_of = [&](const VectorAccess &p_access) {
+        Instruction *&address = addresses[p_access];
+        if (!address) {
+            address = emit(Opcode::kAdd, {first_elements.at(p_access), bytes_done});
+        }
+        return address;
+    };
+    std::function<Instruction *(ExpressionNode &)> emit_vector =
+        [&](ExpressionNode &p_expr) -> Instruction * {
+        if (loop.getKind(p_expr) == VectorLoop::Kind::kScalar) {
+            return invariants.at(&p_expr);
+        }
+        if (auto *const ref = dynamic_cast<VariableReferenceNode *>(&p_expr)) {
+            const VectorAccess &access = loop.getAccess(*ref);
+            Instruction *&vector = vectors[access];
+            if (!vector) {
+                vector = emit(Opcode::kVLoad, {address_of(access)});
+            }
+            return vector;
+        }
+        if (auto *const un_op = dynamic_cast<UnaryOperatorNode *>(&p_expr)) {
+            Instruction *operand = emit_vector(*un_op->getVal());
+            return emit(Opcode::kVSub, {emitConst(0), operand});
+        }
+        auto &bin_op = dynamic_cast<BinaryOperatorNode &>(p_expr);
+        Instruction *lhs = emit_vector(*bin_op.getL());
+        Instruction *rhs = emit_vector(*bin_op.getR());
+        const Opcode opcode = bin_op.getOp() == Operator::kPlusOp    ? Opcode::kVAdd
+                              : bin_op.getOp() == Operator::kMinusOp ? Opcode::kVSub
+                                                                     : Opcode::kVMul;
+        return emit(opcode, {lhs, rhs});
+    };
+
+    for (const auto &statement : loop.getStatements()) {
+        Instruction *value = emit_vector(*statement.expr);
+        if (statement.store) {
+            const VectorAccess &store = *statement.store;
+            if (!value->isVector()) {
+                value = emit(Opcode::kVSplat, {value});
+            }
+            emit(Opcode::kVStore, {value, address_of(store)});
+            // what was loaded from an array that may be this one is stale
+            for (auto it = vectors.begin(); it != vectors.end();) {
+                it = mayShare(*it->first.array, *store.array) ? vectors.erase(it)
+                                                             : std::next(it);
+            }
+            vectors[store] = value;
+            continue;
+        }
+        Instruction *sum = loadVar(*statement.sum);
+        if (value->isVector()) {
+            sum = emit(Opcode::kVRedSum, {value, sum});
+        } else {
+            sum = emit(Opcode::kAdd, {sum, emit(Opcode::kMul, {value, vl})});
+        }
+        storeVar(*statement.sum, sum);
+    }
+
+    Instruction *next = emit(Opcode::kAdd, {num_done, vl});
+    emit(Opcode::kStore, {next})->setSlot(done);
+    Instruction *at_end = emit(
+        Opcode::kEq, {next, emitConst(static_cast<int32_t>(p_trip_count))});
+    emit(Opcode::kBranch, {at_end})->getBlocks() = {done_block, body_block};
+    startBlock(done_block);
+    ++m_num_vectorized;
+    return true;
+}
+
+void IRBuilder::visit(ReturnNode &p_return) {
+    emit(Opcode::kRet, {evaluate(*p_return.getRetVal())});
+    // whatever follows is unreachable and dropped in the end
+    startBlock(m_function->createBlock());
+}
+
+} // namespace ir
@@ -0,0 +1,134 @@
+#include "ir/IRPrinter.hpp"
+
+namespace ir {
+
+static void printValue(FILE *p_out_file, const Instruction *p_value) {
+    fprintf(p_out_file, "%%%d", p_value->getId());
+}
+
+static void printBlock(FILE *p_out_file, const BasicBlock *p_block) {
+    fprintf(p_out_file, "bb%d", p_block->getId());
+}
+
+static void printInstruction(FILE *p_out_file, const Instruction &p_instr) {
+    fprintf(p_out_file, "    ");
+    if (p_instr.hasResult()) {
+        printValue(p_out_file, &p_instr);
+        fprintf(p_out_file, " = ");
+    }
+    fprintf(p_out_file, "%s%s", p_instr.isTailCall() ? "tail " : "",
+            getOpcodeName(p_instr.getOpcode()));
+
+    const char *separator = " ";
+    auto next = [&]() {
+        fprintf(p_out_file, "%s", separator);
+        separator = ", ";
+    };
+    switch (p_instr.getOpcode()) {
+    case Opcode::kConst:
+    case Opcode::kParam:
+    case Opcode::kCount:
+        next();
+        fprintf(p_out_file, "%d", p_instr.getImm());
+        break;
+    case Opcode::kLoad:
+    case Opcode::kStore:
+    case Opcode::kAddr:
+        next();
+        fprintf(p_out_file, "$%s.%d", p_instr.getSlot()->name.c_str(),
+                p_instr.getSlot()->id);
+        break;
+    case Opcode::kLoadGlobal:
+    case Opcode::kStoreGlobal:
+    case Opcode::kAddrGlobal:
+    case Opcode::kCall:
+        next();
+        fprintf(p_out_file, "@%s", p_instr.getSymbol().c_str());
+        break;
+    default:
+        break;
+    }
+
+    if (p_instr.isPhi()) {
+        for (size_t i = 0; i < p_instr.getOperands().size(); ++i) {
+            next();
+            fprintf(p_out_file, "[");
+            printValue(p_out_file, p_instr.getOperand(i));
+            fprintf(p_out_file, ", ");
+            printBlock(p_out_file, p_instr.getBlock(i));
+            fprintf(p_out_file, "]");
+        }
+    } else {
+        for (const Instruction *operand : p_instr.getOperands()) {
+            next();
+            printValue(p_out_file, operand);
+        }
+        for (const BasicBlock *target : p_instr.getBlocks()) {
+            next();
+            printBlock(p_out_file, target);
+        }
+    }
+    switch (p_instr.getOpcode()) {
+    case Opcode::kLoadPtr:
+    case Opcode::kStorePtr:
+        if (p_instr.getImm() != 0) {
+            fprintf(p_out_file, " %+d", p_instr.getImm());
+        }
+        break;
+    case Opcode::kVSetVL:
+        fprintf(p_out_file, ", m%d", p_instr.getImm());
+        break;
+    default:
+        break;
+    }
+    if (!p_instr.getCounts().empty()) {
+        fprintf(p_out_file, "  ; counts");
+        for (uint64_t count : p_instr.getCounts()) {
+            fprintf(p_out_file, " %llu",
+                    static_cast<unsigned long long>(count));
+        }
+    }
+    fprintf(p_out_file, "\n");
+}
+
+void printFunction(FILE *p_out_file, const Function &p_function) {
+    fprintf(p_out_file, "function %s(%d)%s", p_function.getName().c_str(),
+            p_function.getNumParams(),
+            p_function.returnsValue() ? " -> value" : "");
+    if (p_function.getEntryCount() >= 0) {
+        fprintf(p_out_file, "  ; %lld calls",
+                static_cast<long long>(p_function.getEntryCount()));
+    }
+    fprintf(p_out_file, "\n");
+    fprintf(p_out_file, "  slots:");
+    for (auto &slot : p_function.getSlots()) {
+        fprintf(p_out_file, " $%s.%d (%d bytes)", slot->name.c_str(), slot->id,
+                slot->size);
+    }
+    fprintf(p_out_file, "%s\n", p_function.getSlots().empty() ? " (none)" : "");
+
+    for (auto &block : p_function.getBlocks()) {
+        printBlock(p_out_file, block.get());
+        fprintf(p_out_file, ":");
+        if (!block->getPredecessors().empty()) {
+            fprintf(p_out_file, "  ; preds:");
+            for (const BasicBlock *pred : block->getPredecessors()) {
+                fprintf(p_out_file, " ");
+                printBlock(p_out_file, pred);
+            }
+        }
+        fprintf(p_out_file, "\n");
+        for (auto &instr : block->getInstrs()) {
+            printInstruction(p_out_file, *instr);
+        }
+    }
+}
+
+void printModule(FILE *p_out_file, const Module &p_module) {
+    for (auto &function : p_module.getFunctions()) {
+        printFunction(p_out_file, *function);
+        fprintf(p_out_file, "\n");
+    }
+}
+
+} // namespace ir
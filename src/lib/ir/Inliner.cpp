@@ -0,0 +1,270 @@
+#include "ir/Inliner.hpp"
+#include "ir/SimplifyCFG.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace ir {
+
+// the size a caller may grow to by inlining
+static const size_t kMaxCallerSize = 1024;
+// how much bigger a callee may be where the profile says the call is hot
+static const size_t kHotThresholdScale = 4;
+
+size_t Inliner::getSize(const Function &p_function) {
+    size_t size = 0;
+    for (auto &block : p_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            switch (instr->getOpcode()) {
+            case Opcode::kConst:
+            case Opcode::kParam:
+            case Opcode::kPhi:
+            case Opcode::kJump:
+            case Opcode::kRet:
+                break;
+            default:
+                ++size;
+                break;
+            }
+        }
+    }
+    return size;
+}
+
+static bool callsItself(const Function &p_function) {
+    for (auto &block : p_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            if (instr->getOpcode() == Opcode::kCall &&
+                instr->getSymbol() == p_function.getName()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t Inliner::run() {
+    for (auto &function : m_module.getFunctions()) {
+        for (auto &block : function->getBlocks()) {
+            for (auto &instr : block->getInstrs()) {
+                if (instr->getOpcode() == Opcode::kCall) {
+                    ++m_num_call_sites[instr->getSymbol()];
+                }
+            }
+        }
+    }
+
+    for (auto &function : m_module.getFunctions()) {
+        std::vector<Instruction *> calls;
+        for (auto &block : function->getBlocks()) {
+            for (auto &instr : block->getInstrs()) {
+                if (instr->getOpcode() == Opcode::kCall &&
+                    instr->getSymbol() != function->getName()) {
+                    calls.push_back(instr.get());
+                }
+            }
+        }
+        size_t size = getSize(*function);
+        bool changed = false;
+        for (Instruction *call : calls) {
+            const Function *callee = m_module.lookup(call->getSymbol());
+            // no body to copy for a callee that was never defined
+            if (callee == nullptr ||
+                !shouldInline(*function, *call, *callee, size)) {
+                continue;
+            }
+            inlineCall(*function, call, *callee);
+            size += getSize(*callee) - 1;
+            ++m_num_inlined;
+            changed = true;
+        }
+        // the calling blocks and the copies are straight lines now
+        if (changed) {
+            SimplifyCFG(*function).run();
+        }
+    }
+    return m_num_inlined;
+}
+
+bool Inliner::shouldInline(const Function &p_caller, const Instruction &p_call,
+                           const Function &p_callee,
+                           const size_t p_caller_size) const {
+    const size_t size = getSize(p_callee);
+    const bool is_single_call_site =
+        m_num_call_sites.at(p_callee.getName()) == 1;
+    // with a profile, a call made more often than the program ran is hot
+    // and one never made is not worth the code
+    const int64_t count = p_call.getParent()->getCount();
+    const Function *main = m_module.lookup("main");
+    const bool is_hot = count >= 0 && main && count > main->getEntryCount();
+    const size_t threshold =
+        is_hot ? m_threshold * kHotThresholdScale : m_threshold;
+    const char *reason = nullptr;
+    if (callsItself(p_callee)) {
+        reason = "it is recursive";
+    } else if (!p_callee.getEntry()->getPredecessors().empty()) {
+        reason = "its entry is a loop header";
+    } else if (p_caller_size + size > kMaxCallerSize) {
+        reason = "the caller would grow too big";
+    } else if (count == 0 && !is_single_call_site) {
+        reason = "the profile never saw it run";
+    } else if (size > threshold && !is_single_call_site) {
+        reason = "it is too big";
+    }
+    // the rest of the block only runs if the callee returns
+    if (!reason) {
+        bool returns = false;
+        for (auto &block : p_callee.getBlocks()) {
+            const Instruction *terminator = block->getTerminator();
+            returns |= terminator && terminator->getOpcode() == Opcode::kRet;
+        }
+        if (!returns) {
+            reason = "it never returns";
+        }
+    }
+
+    if (m_remarks) {
+        const int id = p_call.getId();
+        if (reason) {
+            std::fprintf(m_remarks,
+                         "remark: %s: call %%%d to %s not inlined: %s "
+                         "(size %zu, threshold %zu%s)\n",
+                         p_caller.getName().c_str(), id,
+                         p_callee.getName().c_str(), reason, size, threshold,
+                         is_hot ? ", hot" : "");
+        } else {
+            std::fprintf(m_remarks,
+                         "remark: %s: call %%%d to %s inlined (size %zu, "
+                         "threshold %zu%s%s)\n",
+                         p_caller.getName().c_str(), id,
+                         p_callee.getName().c_str(), size, threshold,
+                         is_hot ? ", hot" : "",
+                         size > threshold ? ", single call site" : "");
+        }
+    }
+    return reason == nullptr;
+}
+
+void Inliner::inlineCall(Function &p_caller, Instruction *p_call,
+                         const Function &p_callee) {
+    // the copy runs as often as the call, in the proportions of the callee
+    const int64_t num_calls = p_call->getParent()->getCount();
+    const int64_t num_entries = p_callee.getEntryCount();
+    const bool has_counts = num_calls >= 0 && num_entries >= 0;
+    auto scale = [&](const uint64_t p_count) -> uint64_t {
+        return num_entries == 0
+                   ? 0
+                   : static_cast<uint64_t>(static_cast<double>(p_count) *
+                                           num_calls / num_entries);
+    };
+    // everything after the call moves into a block of its own, the rest
+    BasicBlock *block = p_call->getParent();
+    BasicBlock *rest = p_caller.createBlock();
+    if (BasicBlock *next = p_caller.getNextBlock(block)) {
+        p_caller.moveBlockBefore(rest, next);
+    }
+    auto &instrs = block->getInstrs();
+    const size_t call_pos = block->indexOf(p_call);
+    while (instrs.size() > call_pos + 1) {
+        rest->append(block->remove(instrs[call_pos + 1].get()));
+    }
+    for (BasicBlock *succ : rest->getSuccessors()) {
+        for (auto &instr : succ->getInstrs()) {
+            if (!instr->isPhi()) {
+                break;
+            }
+            auto &blocks = instr->getBlocks();
+            std::replace(blocks.begin(), blocks.end(), block, rest);
+        }
+    }
+
+    std::vector<BasicBlock *> block_map(p_callee.getNumBlockIds(), nullptr);
+    for (auto &callee_block : p_callee.getBlocks()) {
+        BasicBlock *clone = p_caller.createBlock();
+        p_caller.moveBlockBefore(clone, rest);
+        block_map[callee_block->getId()] = clone;
+    }
+    std::map<const Slot *, Slot *> slot_map;
+    for (auto &slot : p_callee.getSlots()) {
+        slot_map[slot.get()] = p_caller.createSlot(
+            p_callee.getName() + "." + slot->name, slot->size);
+    }
+
+    // operands may refer to values defined further down, so they are
+    // mapped once everything has been copied
+    std::vector<Instruction *> value_map(p_callee.getNumValueIds(), nullptr);
+    std::vector<Instruction *> clones;
+    std::vector<std::pair<Instruction *, BasicBlock *>> returned;
+    for (auto &callee_block : p_callee.getBlocks()) {
+        BasicBlock *clone_block = block_map[callee_block->getId()];
+        for (auto &instr : callee_block->getInstrs()) {
+            if (instr->getOpcode() == Opcode::kParam) {
+                value_map[instr->getId()] = p_call->getOperand(instr->getImm());
+                continue;
+            }
+            if (instr->getOpcode() == Opcode::kRet) {
+                if (!instr->getOperands().empty()) {
+                    returned.emplace_back(instr->getOperand(0), clone_block);
+                }
+                auto jump = p_caller.createInstr(Opcode::kJump);
+                jump->getBlocks().push_back(rest);
+                const int64_t count = callee_block->getCount();
+                if (has_counts && count >= 0) {
+                    jump->getCounts().push_back(scale(count));
+                }
+                clone_block->append(std::move(jump));
+                continue;
+            }
+            auto clone =
+                p_caller.createInstr(instr->getOpcode(), instr->getOperands());
+            clone->setImm(instr->getImm());
+            clone->setSymbol(instr->getSymbol());
+            if (instr->getSlot()) {
+                clone->setSlot(slot_map.at(instr->getSlot()));
+            }
+            for (BasicBlock *target : instr->getBlocks()) {
+                clone->getBlocks().push_back(block_map[target->getId()]);
+            }
+            if (has_counts) {
+                for (uint64_t count : instr->getCounts()) {
+                    clone->getCounts().push_back(scale(count));
+                }
+            }
+            if (instr->getOpcode() == Opcode::kCall) {
+                ++m_num_call_sites[instr->getSymbol()];
+            }
+            value_map[instr->getId()] = clone.get();
+            clones.push_back(clone_block->append(std::move(clone)));
+        }
+    }
+    for (Instruction *clone : clones) {
+        for (Instruction *&operand : clone->getOperands()) {
+            operand = value_map[operand->getId()];
+        }
+    }
+
+    if (p_callee.returnsValue()) {
+        Instruction *value = nullptr;
+        if (returned.size() == 1) {
+            value = value_map[returned.front().first->getId()];
+        } else {
+            value = rest->insert(0, p_caller.createInstr(Opcode::kPhi));
+            for (auto &incoming : returned) {
+                value->addIncoming(value_map[incoming.first->getId()],
+                                   incoming.second);
+            }
+        }
+        p_caller.replaceAllUsesWith(p_call, value);
+    }
+    --m_num_call_sites[p_callee.getName()];
+    block->erase(p_call);
+    auto jump = p_caller.createInstr(Opcode::kJump);
+    jump->getBlocks().push_back(block_map[p_callee.getEntry()->getId()]);
+    if (has_counts) {
+        jump->getCounts().push_back(num_calls);
+    }
+    block->append(std::move(jump));
+    p_caller.updatePredecessors();
+}
+
+} // namespace ir
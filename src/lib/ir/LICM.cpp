@@ -0,0 +1,220 @@
+#include "ir/LICM.hpp"
+#include "ir/Dominators.hpp"
+#include "ir/LoopInfo.hpp"
+#include "ir/SideEffects.hpp"
+
+#include <algorithm>
+
+namespace ir {
+
+size_t LICM::run() {
+    m_function.updatePredecessors();
+    {
+        const DominatorTree dom_tree(m_function);
+        const LoopInfo loops(dom_tree);
+        if (loops.empty()) {
+            return 0;
+        }
+        for (auto &loop : loops.getLoops()) {
+            if (loop->getPreheader()) {
+                continue;
+            }
+            BasicBlock *preheader = insertPreheader(*loop);
+            // it joins the loops around
+            for (Loop *outer = loop->getParent(); outer && preheader;
+                 outer = outer->getParent()) {
+                outer->addBlock(preheader);
+            }
+        }
+    }
+
+    m_users.assign(m_function.getNumValueIds(), {});
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            for (const Instruction *operand : instr->getOperands()) {
+                m_users[operand->getId()].push_back(instr.get());
+            }
+        }
+    }
+
+    const DominatorTree dom_tree(m_function);
+    const LoopInfo loops(dom_tree);
+    for (auto &loop : loops.getLoops()) {
+        if (loop->getPreheader()) {
+            hoist(*loop, dom_tree);
+        }
+    }
+    return m_num_hoisted;
+}
+
+BasicBlock *LICM::insertPreheader(const Loop &p_loop) {
+    BasicBlock *header = p_loop.getHeader();
+    std::vector<BasicBlock *> entering;
+    for (BasicBlock *pred : header->getPredecessors()) {
+        if (!p_loop.contains(pred)) {
+            entering.push_back(pred);
+        }
+    }
+    if (entering.empty()) {
+        return nullptr;
+    }
+    if (entering.size() == 1) {
+        return m_function.splitEdge(entering.front(), header);
+    }
+
+    // the values entering the loop merge in the preheader now
+    BasicBlock *preheader = m_function.createBlock();
+    m_function.moveBlockBefore(preheader, header);
+    for (BasicBlock *pred : entering) {
+        auto &targets = pred->getTerminator()->getBlocks();
+        std::replace(targets.begin(), targets.end(), header, preheader);
+    }
+    for (auto &instr : header->getInstrs()) {
+        if (!instr->isPhi()) {
+            break;
+        }
+        auto merged = m_function.createInstr(Opcode::kPhi);
+        for (BasicBlock *pred : entering) {
+            merged->addIncoming(instr->getIncomingValue(pred), pred);
+            instr->removeIncoming(pred);
+        }
+        instr->addIncoming(preheader->append(std::move(merged)), preheader);
+    }
+    auto jump = m_function.createInstr(Opcode::kJump);
+    jump->getBlocks().push_back(header);
+    Instruction *preheader_jump = preheader->append(std::move(jump));
+    m_function.updatePredecessors();
+    if (preheader->getCount() >= 0) {
+        preheader_jump->getCounts().push_back(preheader->getCount());
+    }
+    return preheader;
+}
+
+void LICM::hoist(const Loop &p_loop, const DominatorTree &p_dom_tree) {
+    BasicBlock *preheader = p_loop.getPreheader();
+    const std::vector<BasicBlock *> exiting = p_loop.getExitingBlocks();
+    collectWrites(p_loop);
+
+    // dominators first, so operands move out before their users
+    for (BasicBlock *block : p_dom_tree.getReversePostOrder()) {
+        if (!p_loop.contains(block)) {
+            continue;
+        }
+        // whether it runs every time the loop is entered
+        const bool always_runs =
+            std::all_of(exiting.begin(), exiting.end(),
+                        [&](const BasicBlock *p_exiting) {
+                            return p_dom_tree.dominates(block, p_exiting);
+                        });
+        auto &instrs = block->getInstrs();
+        for (size_t i = block->getFirstNonPhi(); i < instrs.size();) {
+            Instruction *instr = instrs[i].get();
+            // a call that never returns must not overtake the output before
+            // it, even when bound to run
+            if (isInvariant(p_loop, *instr) && isWorthHoisting(*instr) &&
+                (isSafeToSpeculate(*instr) ||
+                 (always_runs && instr->getOpcode() != Opcode::kCall))) {
+                preheader->insertBeforeTerminator(block->remove(instr));
+                ++m_num_hoisted;
+            } else {
+                ++i;
+            }
+        }
+    }
+}
+
+void LICM::collectWrites(const Loop &p_loop) {
+    m_written_slots.clear();
+    m_written_globals.clear();
+    m_writes_memory = false;
+    for (const BasicBlock *block : p_loop.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            if (instr->getOpcode() == Opcode::kStore) {
+                m_written_slots.insert(instr->getSlot());
+            } else if (instr->getOpcode() == Opcode::kStoreGlobal) {
+                m_written_globals.insert(instr->getSymbol());
+            } else if (instr->getOpcode() == Opcode::kStorePtr ||
+                       instr->getOpcode() == Opcode::kVStore) {
+                m_writes_memory = true;
+            } else if (instr->getOpcode() == Opcode::kCall) {
+                const FunctionEffects &effects =
+                    m_side_effects.get(instr->getSymbol());
+                m_written_globals.insert(effects.writes.begin(),
+                                         effects.writes.end());
+                m_writes_memory = m_writes_memory || effects.writes_memory;
+            }
+        }
+    }
+}
+
+bool LICM::isInvariant(const Loop &p_loop, const Instruction &p_instr) const {
+    switch (p_instr.getOpcode()) {
+    case Opcode::kLoad:
+        if (m_written_slots.count(p_instr.getSlot())) {
+            return false;
+        }
+        break;
+    case Opcode::kLoadGlobal:
+        if (m_written_globals.count(p_instr.getSymbol())) {
+            return false;
+        }
+        break;
+    case Opcode::kLoadPtr:
+        if (m_writes_memory) {
+            return false;
+        }
+        break;
+    case Opcode::kCall: {
+        const FunctionEffects &effects = m_side_effects.get(p_instr.getSymbol());
+        if (!effects.isPure() || (effects.reads_memory && m_writes_memory)) {
+            return false;
+        }
+        for (const std::string &global : effects.reads) {
+            if (m_written_globals.count(global)) {
+                return false;
+            }
+        }
+        break;
+    }
+    case Opcode::kParam:
+    case Opcode::kPhi:
+        return false;
+    default:
+        if (p_instr.hasSideEffect()) {
+            return false;
+        }
+        break;
+    }
+    for (const Instruction *operand : p_instr.getOperands()) {
+        if (p_loop.contains(operand->getParent())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LICM::isWorthHoisting(const Instruction &p_instr) const {
+    // a compare only a branch right after uses becomes part of that branch
+    const auto &users = m_users[p_instr.getId()];
+    return !(p_instr.isCompare() && users.size() == 1 &&
+             users.front()->getOpcode() == Opcode::kBranch &&
+             users.front()->getParent() == p_instr.getParent());
+}
+
+bool LICM::isSafeToSpeculate(const Instruction &p_instr) const {
+    switch (p_instr.getOpcode()) {
+    case Opcode::kDiv:
+    case Opcode::kMod:
+        return p_instr.getOperand(1)->isConst() &&
+               p_instr.getOperand(1)->getImm() != 0;
+    case Opcode::kCall:
+        return m_side_effects.get(p_instr.getSymbol()).terminates;
+    case Opcode::kLoadPtr:
+        // the index may only be in range where the loop would load
+        return false;
+    default:
+        return true;
+    }
+}
+
+} // namespace ir
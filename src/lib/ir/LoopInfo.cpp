@@ -0,0 +1,102 @@
+#include "ir/LoopInfo.hpp"
+#include "ir/Dominators.hpp"
+
+#include <algorithm>
+
+namespace ir {
+
+void Loop::addBlock(BasicBlock *p_block) {
+    if (m_block_set.insert(p_block).second) {
+        m_blocks.push_back(p_block);
+    }
+}
+
+BasicBlock *Loop::getPreheader() const {
+    BasicBlock *entering = nullptr;
+    for (BasicBlock *pred : m_header->getPredecessors()) {
+        if (contains(pred)) {
+            continue;
+        }
+        if (entering) {
+            return nullptr;
+        }
+        entering = pred;
+    }
+    if (!entering || entering->getTerminator()->getOpcode() != Opcode::kJump) {
+        return nullptr;
+    }
+    return entering;
+}
+
+std::vector<BasicBlock *> Loop::getLatches() const {
+    std::vector<BasicBlock *> latches;
+    for (BasicBlock *pred : m_header->getPredecessors()) {
+        if (contains(pred)) {
+            latches.push_back(pred);
+        }
+    }
+    return latches;
+}
+
+std::vector<BasicBlock *> Loop::getExitingBlocks() const {
+    std::vector<BasicBlock *> exiting;
+    for (BasicBlock *block : m_blocks) {
+        for (const BasicBlock *succ : block->getSuccessors()) {
+            if (!contains(succ)) {
+                exiting.push_back(block);
+                break;
+            }
+        }
+    }
+    return exiting;
+}
+
+LoopInfo::LoopInfo(const DominatorTree &p_dom_tree) {
+    // headers come in reverse postorder, so a loop follows the loops around it
+    for (BasicBlock *header : p_dom_tree.getReversePostOrder()) {
+        std::vector<BasicBlock *> worklist;
+        for (BasicBlock *pred : header->getPredecessors()) {
+            if (p_dom_tree.isReachable(pred) &&
+                p_dom_tree.dominates(header, pred)) {
+                worklist.push_back(pred);
+            }
+        }
+        if (worklist.empty()) {
+            continue;
+        }
+
+        std::unique_ptr<Loop> loop(new Loop(header));
+        while (!worklist.empty()) {
+            BasicBlock *block = worklist.back();
+            worklist.pop_back();
+            if (loop->contains(block)) {
+                continue;
+            }
+            loop->addBlock(block);
+            for (BasicBlock *pred : block->getPredecessors()) {
+                if (p_dom_tree.isReachable(pred)) {
+                    worklist.push_back(pred);
+                }
+            }
+        }
+        for (auto it = m_loops.rbegin(); it != m_loops.rend(); ++it) {
+            if ((*it)->contains(header)) {
+                loop->setParent(it->get());
+                break;
+            }
+        }
+        m_loops.push_back(std::move(loop));
+    }
+    std::reverse(m_loops.begin(), m_loops.end());
+}
+
+Loop *LoopInfo::getLoopFor(const BasicBlock *p_block) const {
+    for (auto &loop : m_loops) {
+        if (loop->contains(p_block)) {
+            return loop.get();
+        }
+    }
+    return nullptr;
+}
+
+} // namespace ir
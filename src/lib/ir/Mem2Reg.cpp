@@ -0,0 +1,258 @@
+#include "ir/Mem2Reg.hpp"
+#include "ir/Dominators.hpp"
+
+#include <algorithm>
+#include <set>
+
+namespace ir {
+
+static bool isScalar(const Slot &p_slot) { return p_slot.size == 4; }
+
+size_t Mem2Reg::run() {
+    // an array of a single element is accessed through its address
+    std::vector<bool> addressed(m_function.getNumSlotIds(), false);
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            if (instr->getOpcode() == Opcode::kAddr) {
+                addressed[instr->getSlot()->id] = true;
+            }
+        }
+    }
+    m_slot_index.assign(m_function.getNumSlotIds(), -1);
+    for (auto &slot : m_function.getSlots()) {
+        if (isScalar(*slot) && !addressed[slot->id]) {
+            m_slot_index[slot->id] = m_promoted.size();
+            m_promoted.push_back(slot.get());
+        }
+    }
+    if (m_promoted.empty()) {
+        return 0;
+    }
+
+    m_function.updatePredecessors();
+    const DominatorTree dom_tree(m_function);
+    // inserted up front, the walk in rename() must not move the entry
+    m_undef = m_function.getEntry()->insert(
+        0, m_function.createInstr(Opcode::kConst));
+    placePhis(dom_tree);
+    rename(dom_tree);
+
+    for (const Slot *slot : m_promoted) {
+        m_function.eraseSlot(slot);
+    }
+    removeUselessPhis();
+    if (!isUsed(m_undef)) {
+        m_function.getEntry()->erase(m_undef);
+    }
+    return m_promoted.size();
+}
+
+void Mem2Reg::placePhis(const DominatorTree &p_dom_tree) {
+    std::vector<std::vector<BasicBlock *>> def_blocks(m_promoted.size());
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            if (instr->getOpcode() != Opcode::kStore) {
+                continue;
+            }
+            const int index = m_slot_index[instr->getSlot()->id];
+            if (index >= 0 && (def_blocks[index].empty() ||
+                               def_blocks[index].back() != block.get())) {
+                def_blocks[index].push_back(block.get());
+            }
+        }
+    }
+
+    for (size_t index = 0; index < m_promoted.size(); ++index) {
+        std::set<const BasicBlock *> has_phi;
+        std::vector<BasicBlock *> worklist = def_blocks[index];
+        std::set<const BasicBlock *> queued(worklist.begin(), worklist.end());
+        while (!worklist.empty()) {
+            BasicBlock *block = worklist.back();
+            worklist.pop_back();
+            for (BasicBlock *frontier : p_dom_tree.getFrontier(block)) {
+                if (!has_phi.insert(frontier).second) {
+                    continue;
+                }
+                Instruction *phi = frontier->insert(
+                    0, m_function.createInstr(Opcode::kPhi));
+                m_phi_slots[phi] = index;
+                // the phi is a definition of its own
+                if (queued.insert(frontier).second) {
+                    worklist.push_back(frontier);
+                }
+            }
+        }
+    }
+}
+
+void Mem2Reg::rename(const DominatorTree &p_dom_tree) {
+    m_replacements.assign(m_function.getNumValueIds(), nullptr);
+    std::vector<std::vector<Instruction *>> stacks(m_promoted.size());
+    std::vector<Instruction *> dead;
+
+    auto current_value = [&](const int p_index) {
+        return stacks[p_index].empty() ? m_undef : stacks[p_index].back();
+    };
+
+    // preorder over the dominator tree; a block is left once its subtree is
+    std::vector<std::pair<BasicBlock *, size_t>> walk = {
+        {m_function.getEntry(), 0}};
+    std::vector<std::vector<int>> pushed = {{}};
+    while (!walk.empty()) {
+        BasicBlock *block = walk.back().first;
+        if (walk.back().second == 0) {
+            for (auto &instr : block->getInstrs()) {
+                int index = -1;
+                if (instr->isPhi()) {
+                    auto it = m_phi_slots.find(instr.get());
+                    if (it == m_phi_slots.end()) {
+                        continue;
+                    }
+                    index = it->second;
+                    stacks[index].push_back(instr.get());
+                } else if (instr->getOpcode() == Opcode::kStore &&
+                           m_slot_index[instr->getSlot()->id] >= 0) {
+                    index = m_slot_index[instr->getSlot()->id];
+                    stacks[index].push_back(instr->getOperand(0));
+                    dead.push_back(instr.get());
+                } else if (instr->getOpcode() == Opcode::kLoad &&
+                           m_slot_index[instr->getSlot()->id] >= 0) {
+                    m_replacements[instr->getId()] =
+                        current_value(m_slot_index[instr->getSlot()->id]);
+                    dead.push_back(instr.get());
+                }
+                if (index >= 0) {
+                    pushed.back().push_back(index);
+                }
+            }
+            for (BasicBlock *succ : block->getSuccessors()) {
+                for (auto &instr : succ->getInstrs()) {
+                    if (!instr->isPhi()) {
+                        break;
+                    }
+                    auto it = m_phi_slots.find(instr.get());
+                    if (it != m_phi_slots.end() &&
+                        !instr->getIncomingValue(block)) {
+                        instr->addIncoming(current_value(it->second), block);
+                    }
+                }
+            }
+        }
+
+        const auto &children = p_dom_tree.getChildren(block);
+        if (walk.back().second < children.size()) {
+            walk.emplace_back(children[walk.back().second++], 0);
+            pushed.emplace_back();
+            continue;
+        }
+        for (const int index : pushed.back()) {
+            stacks[index].pop_back();
+        }
+        pushed.pop_back();
+        walk.pop_back();
+    }
+
+    // loads may have been stored again before their replacement was known
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            for (auto &operand : instr->getOperands()) {
+                operand = resolve(operand);
+            }
+        }
+    }
+    for (Instruction *instr : dead) {
+        instr->getParent()->erase(instr);
+    }
+}
+
+bool Mem2Reg::isUsed(const Instruction *p_value) const {
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            const auto &operands = instr->getOperands();
+            if (std::find(operands.begin(), operands.end(), p_value) !=
+                operands.end()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+Instruction *Mem2Reg::resolve(Instruction *p_value) const {
+    while (p_value->getId() < static_cast<int>(m_replacements.size()) &&
+           m_replacements[p_value->getId()]) {
+        p_value = m_replacements[p_value->getId()];
+    }
+    return p_value;
+}
+
+void Mem2Reg::removeUselessPhis() {
+    // a phi merging one value (besides itself) is that value
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &block : m_function.getBlocks()) {
+            for (size_t i = 0; i < block->getInstrs().size();) {
+                Instruction *phi = block->getInstrs()[i].get();
+                if (!phi->isPhi()) {
+                    break;
+                }
+                Instruction *unique = nullptr;
+                bool merges = false;
+                for (Instruction *operand : phi->getOperands()) {
+                    if (operand == phi || operand == unique) {
+                        continue;
+                    }
+                    merges = unique != nullptr;
+                    unique = operand;
+                    if (merges) {
+                        break;
+                    }
+                }
+                if (merges) {
+                    ++i;
+                    continue;
+                }
+                m_function.replaceAllUsesWith(phi, unique ? unique : m_undef);
+                block->erase(phi);
+                changed = true;
+            }
+        }
+    }
+
+    // the rest is dead unless something other than a dead phi uses it
+    std::set<const Instruction *> live;
+    std::vector<Instruction *> worklist;
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            if (instr->isPhi()) {
+                continue;
+            }
+            for (Instruction *operand : instr->getOperands()) {
+                if (operand->isPhi() && live.insert(operand).second) {
+                    worklist.push_back(operand);
+                }
+            }
+        }
+    }
+    while (!worklist.empty()) {
+        Instruction *phi = worklist.back();
+        worklist.pop_back();
+        for (Instruction *operand : phi->getOperands()) {
+            if (operand->isPhi() && live.insert(operand).second) {
+                worklist.push_back(operand);
+            }
+        }
+    }
+    for (auto &block : m_function.getBlocks()) {
+        auto &instrs = block->getInstrs();
+        instrs.erase(std::remove_if(instrs.begin(), instrs.end(),
+                                    [&](const std::unique_ptr<Instruction> &p_ptr) {
+                                        return p_ptr->isPhi() &&
+                                               !live.count(p_ptr.get());
+                                    }),
+                     instrs.end());
+    }
+}
+
+} // namespace ir
@@ -0,0 +1,133 @@
+#include "ir/Profile.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+namespace ir {
+
+const char *const Profile::kCounterTable = "__p_profile_counters";
+
+// 32-bit FNV-1a
+static const uint32_t kChecksumBasis = 2166136261u;
+static const uint32_t kChecksumPrime = 16777619u;
+
+static void addToChecksum(uint32_t &p_checksum, const unsigned char p_byte) {
+    p_checksum = (p_checksum ^ p_byte) * kChecksumPrime;
+}
+
+Profile::Profile(Module &p_module) : m_module(p_module) {
+    m_checksum = kChecksumBasis;
+    for (auto &function : m_module.getFunctions()) {
+        for (const char c : function->getName()) {
+            addToChecksum(m_checksum, c);
+        }
+        addToChecksum(m_checksum, '(');
+        for (auto &block : function->getBlocks()) {
+            m_counters.push_back({block.get(), false});
+            const Instruction *terminator = block->getTerminator();
+            if (terminator && terminator->getOpcode() == Opcode::kBranch) {
+                m_counters.push_back({block.get(), true});
+                addToChecksum(m_checksum, 'B');
+            } else {
+                addToChecksum(m_checksum, 'b');
+            }
+        }
+        addToChecksum(m_checksum, ')');
+    }
+}
+
+void Profile::instrument() {
+    for (size_t k = 0; k < m_counters.size(); ++k) {
+        BasicBlock *block = m_counters[k].block;
+        Function &function = *block->getParent();
+        if (!m_counters[k].is_taken) {
+            const size_t pos = block->getFirstNonPhi();
+            Instruction *one =
+                block->insert(pos, function.createInstr(Opcode::kConst));
+            one->setImm(1);
+            block->insert(pos + 1, function.createInstr(Opcode::kCount, {one}))
+                ->setImm(k);
+            continue;
+        }
+
+        // the comparisons already give 0 or 1
+        Instruction *taken = block->getTerminator()->getOperand(0);
+        if (!taken->isCompare()) {
+            Instruction *zero = block->insertBeforeTerminator(
+                function.createInstr(Opcode::kConst));
+            taken = block->insertBeforeTerminator(
+                function.createInstr(Opcode::kNe, {taken, zero}));
+        }
+        block->insertBeforeTerminator(
+                 function.createInstr(Opcode::kCount, {taken}))
+            ->setImm(k);
+    }
+}
+
+bool Profile::annotate(const std::string &p_path, std::string &p_error) {
+    std::FILE *file = std::fopen(p_path.c_str(), "r");
+    if (!file) {
+        p_error = "cannot open the profile " + p_path;
+        return false;
+    }
+    uint32_t checksum = 0;
+    size_t num_counters = 0;
+    const bool has_header =
+        std::fscanf(file, "p-profile %" SCNu32 " %zu", &checksum,
+                    &num_counters) == 2;
+    std::vector<uint64_t> counts(m_counters.size());
+    bool complete = has_header && checksum == m_checksum &&
+                    num_counters == m_counters.size();
+    for (size_t k = 0; complete && k < counts.size(); ++k) {
+        complete = std::fscanf(file, "%" SCNu64, &counts[k]) == 1;
+    }
+    std::fclose(file);
+    if (!has_header) {
+        p_error = p_path + " is not a profile";
+        return false;
+    }
+    if (!complete) {
+        p_error = "the profile " + p_path + " is of a different program";
+        return false;
+    }
+
+    // by block id, per function
+    std::vector<uint64_t> block_counts;
+    std::vector<uint64_t> taken_counts;
+    size_t k = 0;
+    for (auto &function : m_module.getFunctions()) {
+        block_counts.assign(function->getNumBlockIds(), 0);
+        taken_counts.assign(function->getNumBlockIds(), 0);
+        for (; k < m_counters.size() &&
+               m_counters[k].block->getParent() == function.get();
+             ++k) {
+            const int id = m_counters[k].block->getId();
+            (m_counters[k].is_taken ? taken_counts : block_counts)[id] =
+                counts[k];
+        }
+
+        // whatever does not come in through an edge is a call
+        int64_t entry_count = block_counts[function->getEntry()->getId()];
+        for (auto &block : function->getBlocks()) {
+            Instruction *terminator = block->getTerminator();
+            const uint64_t count = block_counts[block->getId()];
+            if (terminator->getOpcode() == Opcode::kJump) {
+                terminator->getCounts() = {count};
+            } else if (terminator->getOpcode() == Opcode::kBranch) {
+                const uint64_t taken =
+                    std::min(taken_counts[block->getId()], count);
+                terminator->getCounts() = {taken, count - taken};
+            }
+            for (size_t i = 0; i < terminator->getCounts().size(); ++i) {
+                if (terminator->getBlock(i) == function->getEntry()) {
+                    entry_count -= terminator->getCounts()[i];
+                }
+            }
+        }
+        function->setEntryCount(std::max<int64_t>(entry_count, 0));
+    }
+    return true;
+}
+
+} // namespace ir
@@ -0,0 +1,356 @@
+#include "ir/SCCP.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace ir {
+
+ConstantGlobals::ConstantGlobals(const Module &p_module) {
+    std::map<std::string, int32_t> stored;
+    std::set<std::string> varying;
+    for (auto &function : p_module.getFunctions()) {
+        for (auto &block : function->getBlocks()) {
+            for (auto &instr : block->getInstrs()) {
+                if (instr->getOpcode() != Opcode::kStoreGlobal) {
+                    continue;
+                }
+                const Instruction *value = instr->getOperand(0);
+                auto it =
+                    stored.emplace(instr->getSymbol(), value->getImm()).first;
+                if (!value->isConst() || it->second != value->getImm()) {
+                    varying.insert(instr->getSymbol());
+                }
+            }
+        }
+    }
+
+    // a call may read the global, so may a loop back to the entry
+    const BasicBlock *entry = p_module.lookup("main")->getEntry();
+    if (!entry->getPredecessors().empty()) {
+        return;
+    }
+    for (auto &instr : entry->getInstrs()) {
+        if (instr->getOpcode() == Opcode::kCall) {
+            break;
+        }
+        if (instr->getOpcode() == Opcode::kStoreGlobal &&
+            !varying.count(instr->getSymbol())) {
+            m_globals.emplace(instr->getSymbol(),
+                              std::make_pair(instr->getOperand(0)->getImm(),
+                                             instr.get()));
+        }
+    }
+}
+
+bool ConstantGlobals::lookup(const Instruction &p_load, int32_t &p_value) const {
+    auto it = m_globals.find(p_load.getSymbol());
+    if (it == m_globals.end()) {
+        return false;
+    }
+    const BasicBlock *entry = it->second.second->getParent();
+    if (p_load.getParent() == entry &&
+        entry->indexOf(&p_load) < entry->indexOf(it->second.second)) {
+        return false;
+    }
+    p_value = it->second.first;
+    return true;
+}
+
+void SCCP::run() {
+    m_function.updatePredecessors();
+    m_values.assign(m_function.getNumValueIds(), Lattice());
+    m_users.assign(m_function.getNumValueIds(), {});
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            for (const Instruction *operand : instr->getOperands()) {
+                m_users[operand->getId()].push_back(instr.get());
+            }
+        }
+    }
+    m_executable.assign(m_function.getNumBlockIds(), false);
+    m_executable[m_function.getEntry()->getId()] = true;
+    m_block_worklist = {m_function.getEntry()};
+
+    while (!m_block_worklist.empty() || !m_value_worklist.empty()) {
+        if (!m_value_worklist.empty()) {
+            Instruction *value = m_value_worklist.back();
+            m_value_worklist.pop_back();
+            for (Instruction *user : m_users[value->getId()]) {
+                if (m_executable[user->getParent()->getId()]) {
+                    visit(user);
+                }
+            }
+            continue;
+        }
+        BasicBlock *block = m_block_worklist.back();
+        m_block_worklist.pop_back();
+        for (auto &instr : block->getInstrs()) {
+            visit(instr.get());
+        }
+    }
+    rewrite();
+}
+
+void SCCP::markEdge(const BasicBlock *p_from, BasicBlock *p_to) {
+    if (!m_executable_edges.emplace(p_from->getId(), p_to->getId()).second) {
+        return;
+    }
+    if (!m_executable[p_to->getId()]) {
+        m_executable[p_to->getId()] = true;
+        m_block_worklist.push_back(p_to);
+        return;
+    }
+    // the phis get another value to merge
+    for (auto &instr : p_to->getInstrs()) {
+        if (!instr->isPhi()) {
+            break;
+        }
+        visit(instr.get());
+    }
+}
+
+bool SCCP::isEdgeExecutable(const BasicBlock *p_from,
+                            const BasicBlock *p_to) const {
+    return m_executable_edges.count({p_from->getId(), p_to->getId()}) != 0;
+}
+
+void SCCP::visit(Instruction *p_instr) {
+    switch (p_instr->getOpcode()) {
+    case Opcode::kJump:
+        markEdge(p_instr->getParent(), p_instr->getBlock(0));
+        return;
+    case Opcode::kBranch: {
+        const Lattice &cond = m_values[p_instr->getOperand(0)->getId()];
+        if (cond.state == State::kConstant) {
+            markEdge(p_instr->getParent(),
+                     p_instr->getBlock(cond.value != 0 ? 0 : 1));
+        } else if (cond.state == State::kOverdefined) {
+            markEdge(p_instr->getParent(), p_instr->getBlock(0));
+            markEdge(p_instr->getParent(), p_instr->getBlock(1));
+        }
+        return;
+    }
+    default:
+        if (p_instr->hasResult()) {
+            update(p_instr, evaluate(*p_instr));
+        }
+        return;
+    }
+}
+
+SCCP::Lattice SCCP::evaluate(const Instruction &p_instr) const {
+    Lattice result;
+    switch (p_instr.getOpcode()) {
+    case Opcode::kConst:
+        result.state = State::kConstant;
+        result.value = p_instr.getImm();
+        return result;
+    case Opcode::kPhi:
+        for (size_t i = 0; i < p_instr.getOperands().size(); ++i) {
+            if (!isEdgeExecutable(p_instr.getBlock(i), p_instr.getParent())) {
+                continue;
+            }
+            const Lattice &incoming = m_values[p_instr.getOperand(i)->getId()];
+            if (incoming.state == State::kUnknown) {
+                continue;
+            }
+            if (incoming.state == State::kOverdefined ||
+                (result.state == State::kConstant &&
+                 result.value != incoming.value)) {
+                result.state = State::kOverdefined;
+                return result;
+            }
+            result = incoming;
+        }
+        return result;
+    case Opcode::kLoadGlobal:
+        result.state = m_globals.lookup(p_instr, result.value)
+                           ? State::kConstant
+                           : State::kOverdefined;
+        return result;
+    case Opcode::kNeg:
+    case Opcode::kNot:
+        break;
+    default:
+        if (!p_instr.isBinary()) {
+            result.state = State::kOverdefined;
+            return result;
+        }
+        break;
+    }
+
+    // overdefined wins, unknown may still turn out constant
+    bool unknown = false;
+    for (const Instruction *operand : p_instr.getOperands()) {
+        const State state = m_values[operand->getId()].state;
+        if (state == State::kOverdefined) {
+            result.state = State::kOverdefined;
+            return result;
+        }
+        unknown |= state == State::kUnknown;
+    }
+    if (unknown) {
+        return result;
+    }
+
+    // wrap around like the machine does
+    const int32_t a = m_values[p_instr.getOperand(0)->getId()].value;
+    const uint32_t ua = static_cast<uint32_t>(a);
+    result.state = State::kConstant;
+    if (p_instr.getOpcode() == Opcode::kNeg) {
+        result.value = static_cast<int32_t>(0u - ua);
+        return result;
+    }
+    if (p_instr.getOpcode() == Opcode::kNot) {
+        result.value = a ^ 1;
+        return result;
+    }
+    const int32_t b = m_values[p_instr.getOperand(1)->getId()].value;
+    const uint32_t ub = static_cast<uint32_t>(b);
+    switch (p_instr.getOpcode()) {
+    case Opcode::kAdd:
+        result.value = static_cast<int32_t>(ua + ub);
+        break;
+    case Opcode::kSub:
+        result.value = static_cast<int32_t>(ua - ub);
+        break;
+    case Opcode::kMul:
+        result.value = static_cast<int32_t>(ua * ub);
+        break;
+    case Opcode::kDiv:
+    case Opcode::kMod:
+        // leave the trapping and the overflowing cases to run time
+        if (b == 0 || (a == std::numeric_limits<int32_t>::min() && b == -1)) {
+            result.state = State::kOverdefined;
+            break;
+        }
+        result.value = p_instr.getOpcode() == Opcode::kDiv ? a / b : a % b;
+        break;
+    case Opcode::kEq:
+        result.value = a == b;
+        break;
+    case Opcode::kNe:
+        result.value = a != b;
+        break;
+    case Opcode::kLt:
+        result.value = a < b;
+        break;
+    case Opcode::kLe:
+        result.value = a <= b;
+        break;
+    case Opcode::kGt:
+        result.value = a > b;
+        break;
+    case Opcode::kGe:
+        result.value = a >= b;
+        break;
+    default:
+        result.state = State::kOverdefined;
+        break;
+    }
+    return result;
+}
+
+void SCCP::update(Instruction *p_instr, const Lattice &p_value) {
+    Lattice &current = m_values[p_instr->getId()];
+    if (p_value.state == State::kUnknown ||
+        (p_value.state == current.state &&
+         (p_value.state != State::kConstant ||
+          p_value.value == current.value))) {
+        return;
+    }
+    // values only ever go down
+    if (current.state == State::kOverdefined) {
+        return;
+    }
+    if (current.state == State::kConstant) {
+        current.state = State::kOverdefined;
+    } else {
+        current = p_value;
+    }
+    m_value_worklist.push_back(p_instr);
+}
+
+void SCCP::rewrite() {
+    std::vector<Instruction *> replacements(m_function.getNumValueIds(),
+                                            nullptr);
+    for (auto &block : m_function.getBlocks()) {
+        if (!m_executable[block->getId()]) {
+            continue;
+        }
+        auto &instrs = block->getInstrs();
+        for (size_t i = 0; i < instrs.size(); ++i) {
+            Instruction *instr = instrs[i].get();
+            const Lattice &value = m_values[instr->getId()];
+            if (instr->isConst() || value.state != State::kConstant ||
+                instr->hasSideEffect()) {
+                continue;
+            }
+            ++m_num_constants;
+            if (instr->isPhi()) {
+                auto constant = m_function.createInstr(Opcode::kConst);
+                constant->setImm(value.value);
+                replacements[instr->getId()] = block->insert(
+                    block->getFirstNonPhi(), std::move(constant));
+                continue;
+            }
+            instr->setOpcode(Opcode::kConst);
+            instr->setImm(value.value);
+            instr->getOperands().clear();
+            instr->setSymbol("");
+            instr->setSlot(nullptr);
+        }
+
+        Instruction *branch = block->getTerminator();
+        if (!branch || branch->getOpcode() != Opcode::kBranch) {
+            continue;
+        }
+        const Lattice &cond = m_values[branch->getOperand(0)->getId()];
+        if (cond.state != State::kConstant) {
+            continue;
+        }
+        BasicBlock *taken = branch->getBlock(cond.value != 0 ? 0 : 1);
+        BasicBlock *skipped = branch->getBlock(cond.value != 0 ? 1 : 0);
+        if (skipped != taken) {
+            for (auto &instr : skipped->getInstrs()) {
+                if (!instr->isPhi()) {
+                    break;
+                }
+                instr->removeIncoming(block.get());
+            }
+        }
+        auto jump = m_function.createInstr(Opcode::kJump);
+        jump->getBlocks().push_back(taken);
+        if (!branch->getCounts().empty()) {
+            jump->getCounts().push_back(
+                branch->getCounts()[cond.value != 0 ? 0 : 1]);
+        }
+        block->erase(branch);
+        block->append(std::move(jump));
+        ++m_num_branches_folded;
+    }
+
+    replacements.resize(m_function.getNumValueIds(), nullptr);
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            for (auto &operand : instr->getOperands()) {
+                if (replacements[operand->getId()]) {
+                    operand = replacements[operand->getId()];
+                }
+            }
+        }
+    }
+    for (auto &block : m_function.getBlocks()) {
+        auto &instrs = block->getInstrs();
+        instrs.erase(std::remove_if(instrs.begin(), instrs.end(),
+                                    [&](const std::unique_ptr<Instruction> &p_ptr) {
+                                        return replacements[p_ptr->getId()] !=
+                                               nullptr;
+                                    }),
+                     instrs.end());
+    }
+    // the blocks never executed are unreachable now
+    m_function.removeUnreachableBlocks();
+}
+
+} // namespace ir
@@ -0,0 +1,109 @@
+#include "ir/SideEffects.hpp"
+
+#include <vector>
+
+namespace ir {
+
+static bool hasCycle(const Function &p_function) {
+    // 1: on the current path, 2: done
+    std::vector<int> state(p_function.getNumBlockIds(), 0);
+    std::vector<std::pair<const BasicBlock *, size_t>> stack = {
+        {p_function.getEntry(), 0}};
+    state[p_function.getEntry()->getId()] = 1;
+    while (!stack.empty()) {
+        const BasicBlock *block = stack.back().first;
+        const auto succs = block->getSuccessors();
+        if (stack.back().second == succs.size()) {
+            state[block->getId()] = 2;
+            stack.pop_back();
+            continue;
+        }
+        const BasicBlock *succ = succs[stack.back().second++];
+        if (state[succ->getId()] == 1) {
+            return true;
+        }
+        if (state[succ->getId()] == 0) {
+            state[succ->getId()] = 1;
+            stack.emplace_back(succ, 0);
+        }
+    }
+    return false;
+}
+
+SideEffects::SideEffects(const Module &p_module) {
+    std::map<std::string, std::set<std::string>> callees;
+    std::set<std::string> acyclic;
+    for (auto &function : p_module.getFunctions()) {
+        FunctionEffects &effects = m_effects[function->getName()];
+        for (auto &block : function->getBlocks()) {
+            for (auto &instr : block->getInstrs()) {
+                switch (instr->getOpcode()) {
+                case Opcode::kLoadGlobal:
+                    effects.reads.insert(instr->getSymbol());
+                    break;
+                case Opcode::kStoreGlobal:
+                    effects.writes.insert(instr->getSymbol());
+                    break;
+                case Opcode::kLoadPtr:
+                case Opcode::kVLoad:
+                    effects.reads_memory = true;
+                    break;
+                case Opcode::kStorePtr:
+                case Opcode::kVStore:
+                    effects.writes_memory = true;
+                    break;
+                case Opcode::kPrint:
+                case Opcode::kRead:
+                // a call dropped would not be counted
+                case Opcode::kCount:
+                    effects.does_io = true;
+                    break;
+                case Opcode::kCall:
+                    callees[function->getName()].insert(instr->getSymbol());
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+        if (!hasCycle(*function)) {
+            acyclic.insert(function->getName());
+        }
+    }
+
+    // propagate to the callers until nothing changes; a recursive function
+    // never gets to terminate since its callees never do first
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &entry : m_effects) {
+            FunctionEffects &effects = entry.second;
+            bool terminates = acyclic.count(entry.first) != 0;
+            for (const std::string &callee : callees[entry.first]) {
+                const FunctionEffects &callee_effects = m_effects[callee];
+                for (const std::string &global : callee_effects.reads) {
+                    changed |= effects.reads.insert(global).second;
+                }
+                for (const std::string &global : callee_effects.writes) {
+                    changed |= effects.writes.insert(global).second;
+                }
+                auto merge = [&](bool &p_flag, const bool p_callee_flag) {
+                    if (p_callee_flag && !p_flag) {
+                        p_flag = true;
+                        changed = true;
+                    }
+                };
+                merge(effects.reads_memory, callee_effects.reads_memory);
+                merge(effects.writes_memory, callee_effects.writes_memory);
+                merge(effects.does_io, callee_effects.does_io);
+                terminates = terminates && callee_effects.terminates;
+            }
+            if (terminates != effects.terminates) {
+                effects.terminates = terminates;
+                changed = true;
+            }
+        }
+    }
+}
+
+} // namespace ir
@@ -0,0 +1,137 @@
+#include "ir/SimplifyCFG.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace ir {
+
+// makes the phis in p_succ take what came in from p_from from p_to instead
+static void replaceIncomingBlock(BasicBlock *p_succ, BasicBlock *p_from,
+                                 BasicBlock *p_to) {
+    for (auto &instr : p_succ->getInstrs()) {
+        if (!instr->isPhi()) {
+            break;
+        }
+        auto &blocks = instr->getBlocks();
+        std::replace(blocks.begin(), blocks.end(), p_from, p_to);
+    }
+}
+
+size_t SimplifyCFG::run() {
+    const size_t num_blocks = m_function.getBlocks().size();
+    m_function.removeUnreachableBlocks();
+    bool changed = true;
+    while (changed) {
+        changed = foldBranches();
+        changed |= bypassEmptyBlocks();
+        changed |= mergeStraightLines();
+    }
+    return num_blocks - m_function.getBlocks().size();
+}
+
+bool SimplifyCFG::foldBranches() {
+    bool changed = false;
+    for (auto &block : m_function.getBlocks()) {
+        Instruction *branch = block->getTerminator();
+        if (!branch || branch->getOpcode() != Opcode::kBranch ||
+            branch->getBlock(0) != branch->getBlock(1)) {
+            continue;
+        }
+        auto jump = m_function.createInstr(Opcode::kJump);
+        jump->getBlocks().push_back(branch->getBlock(0));
+        if (!branch->getCounts().empty()) {
+            jump->getCounts().push_back(branch->getCounts()[0] +
+                                        branch->getCounts()[1]);
+        }
+        block->erase(branch);
+        block->append(std::move(jump));
+        changed = true;
+    }
+    if (changed) {
+        m_function.updatePredecessors();
+    }
+    return changed;
+}
+
+bool SimplifyCFG::bypassEmptyBlocks() {
+    bool changed = false;
+    for (size_t i = 1; i < m_function.getBlocks().size(); ++i) {
+        BasicBlock *block = m_function.getBlocks()[i].get();
+        Instruction *jump = block->getTerminator();
+        if (block->getInstrs().size() != 1 || jump->getOpcode() != Opcode::kJump ||
+            jump->getBlock(0) == block) {
+            continue;
+        }
+        BasicBlock *target = jump->getBlock(0);
+        const auto &target_preds = target->getPredecessors();
+        const bool has_phis = target->getFirstNonPhi() != 0;
+        const std::vector<BasicBlock *> preds = block->getPredecessors();
+        for (BasicBlock *pred : preds) {
+            // a phi could not tell the two edges from pred apart
+            if (has_phis && std::find(target_preds.begin(), target_preds.end(),
+                                      pred) != target_preds.end()) {
+                continue;
+            }
+            auto &targets = pred->getTerminator()->getBlocks();
+            std::replace(targets.begin(), targets.end(), block, target);
+            for (auto &instr : target->getInstrs()) {
+                if (!instr->isPhi()) {
+                    break;
+                }
+                instr->addIncoming(instr->getIncomingValue(block), pred);
+            }
+            m_function.updatePredecessors();
+            changed = true;
+        }
+        if (block->getPredecessors().empty()) {
+            for (auto &instr : target->getInstrs()) {
+                if (!instr->isPhi()) {
+                    break;
+                }
+                instr->removeIncoming(block);
+            }
+            m_function.eraseBlock(block);
+            m_function.updatePredecessors();
+            --i;
+        }
+    }
+    return changed;
+}
+
+bool SimplifyCFG::mergeStraightLines() {
+    bool changed = false;
+    for (size_t i = 0; i < m_function.getBlocks().size(); ++i) {
+        BasicBlock *block = m_function.getBlocks()[i].get();
+        for (;;) {
+            Instruction *jump = block->getTerminator();
+            if (!jump || jump->getOpcode() != Opcode::kJump) {
+                break;
+            }
+            BasicBlock *succ = jump->getBlock(0);
+            if (succ == block || succ == m_function.getEntry() ||
+                succ->getPredecessors().size() != 1) {
+                break;
+            }
+            block->erase(jump);
+            auto &instrs = succ->getInstrs();
+            while (!instrs.empty()) {
+                Instruction *instr = instrs.front().get();
+                if (instr->isPhi()) {
+                    m_function.replaceAllUsesWith(instr, instr->getOperand(0));
+                    succ->erase(instr);
+                } else {
+                    block->append(succ->remove(instr));
+                }
+            }
+            for (BasicBlock *next : block->getSuccessors()) {
+                replaceIncomingBlock(next, succ, block);
+            }
+            m_function.eraseBlock(succ);
+            m_function.updatePredecessors();
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+} // namespace ir
@@ -0,0 +1,175 @@
+#include "ir/TailCalls.hpp"
+
+#include <algorithm>
+
+namespace ir {
+
+// the call the block returns the value of right away, nullptr if none
+static Instruction *getTailCall(const BasicBlock &p_block) {
+    const auto &instrs = p_block.getInstrs();
+    if (instrs.size() < 2) {
+        return nullptr;
+    }
+    const Instruction *ret = instrs.back().get();
+    Instruction *call = instrs[instrs.size() - 2].get();
+    if (ret->getOpcode() != Opcode::kRet || call->getOpcode() != Opcode::kCall) {
+        return nullptr;
+    }
+    // a ret of nothing leaves the value unused, as nothing else can follow
+    if (!ret->getOperands().empty() && ret->getOperand(0) != call) {
+        return nullptr;
+    }
+    return call;
+}
+
+// Whether p_block ends in a call followed by a jump to a block that only
+// returns, e.g. the end of an if statement. Returning right away instead
+// makes the call a tail call.
+static bool jumpsToReturnAfterCall(const BasicBlock &p_block) {
+    const auto &instrs = p_block.getInstrs();
+    if (instrs.size() < 2 || instrs.back()->getOpcode() != Opcode::kJump ||
+        instrs[instrs.size() - 2]->getOpcode() != Opcode::kCall) {
+        return false;
+    }
+    const BasicBlock *target = instrs.back()->getBlock(0);
+    const Instruction *ret = target->getTerminator();
+    if (ret->getOpcode() != Opcode::kRet ||
+        target->getFirstNonPhi() + 1 != target->getInstrs().size()) {
+        return false;
+    }
+    return ret->getOperands().empty() ||
+           ret->getOperand(0)->getParent() != target ||
+           ret->getOperand(0)->getIncomingValue(&p_block) ==
+               instrs[instrs.size() - 2].get();
+}
+
+void TailCallElimination::duplicateReturns() {
+    bool changed = false;
+    for (auto &block : m_function.getBlocks()) {
+        if (!jumpsToReturnAfterCall(*block)) {
+            continue;
+        }
+        Instruction *jump = block->getTerminator();
+        BasicBlock *target = jump->getBlock(0);
+        auto ret = m_function.createInstr(Opcode::kRet);
+        const Instruction *value = target->getTerminator();
+        if (!value->getOperands().empty()) {
+            Instruction *operand = value->getOperand(0);
+            ret->addOperand(operand->getParent() == target
+                                ? operand->getIncomingValue(block.get())
+                                : operand);
+        }
+        for (auto &instr : target->getInstrs()) {
+            if (instr->isPhi()) {
+                instr->removeIncoming(block.get());
+            }
+        }
+        block->erase(jump);
+        block->append(std::move(ret));
+        changed = true;
+    }
+    if (changed) {
+        m_function.removeUnreachableBlocks();
+    }
+}
+
+void TailCallElimination::run() {
+    // the callee could be handed an array of the frame it replaces
+    for (auto &block : m_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            if (instr->getOpcode() == Opcode::kAddr) {
+                return;
+            }
+        }
+    }
+    duplicateReturns();
+    std::vector<Instruction *> recursions;
+    for (auto &block : m_function.getBlocks()) {
+        Instruction *call = getTailCall(*block);
+        if (!call) {
+            continue;
+        }
+        if (call->getSymbol() == m_function.getName()) {
+            recursions.push_back(call);
+        } else if (call->getOperands().size() <= m_num_arg_regs) {
+            call->setTailCall(true);
+            ++m_num_tail_calls;
+        }
+    }
+    if (!recursions.empty()) {
+        removeRecursion(recursions);
+    }
+}
+
+void TailCallElimination::removeRecursion(
+    const std::vector<Instruction *> &p_calls) {
+    // the profile counted the recursive calls as calls of the function
+    std::vector<int64_t> counts;
+    int64_t num_recursions = 0;
+    for (Instruction *call : p_calls) {
+        counts.push_back(call->getParent()->getCount());
+        num_recursions = counts.back() < 0 || num_recursions < 0
+                             ? -1
+                             : num_recursions + counts.back();
+    }
+
+    // the old entry becomes the loop header behind a new entry that keeps
+    // the parameters
+    BasicBlock *header = m_function.getEntry();
+    BasicBlock *entry = m_function.createBlock();
+    m_function.moveBlockBefore(entry, header);
+    std::vector<Instruction *> params(m_function.getNumParams(), nullptr);
+    auto &instrs = header->getInstrs();
+    for (size_t i = 0; i < instrs.size();) {
+        if (instrs[i]->getOpcode() == Opcode::kParam) {
+            Instruction *param = instrs[i].get();
+            params[param->getImm()] = entry->append(header->remove(param));
+        } else {
+            ++i;
+        }
+    }
+    auto jump = m_function.createInstr(Opcode::kJump);
+    jump->getBlocks().push_back(header);
+    Instruction *entry_jump = entry->append(std::move(jump));
+
+    std::vector<Instruction *> phis(params.size(), nullptr);
+    size_t num_phis = 0;
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (!params[i]) {
+            continue;
+        }
+        Instruction *phi =
+            header->insert(num_phis++, m_function.createInstr(Opcode::kPhi));
+        m_function.replaceAllUsesWith(params[i], phi);
+        phi->addIncoming(params[i], entry);
+        phis[i] = phi;
+    }
+
+    if (m_function.getEntryCount() >= 0 && num_recursions >= 0) {
+        m_function.setEntryCount(
+            std::max<int64_t>(m_function.getEntryCount() - num_recursions, 0));
+        entry_jump->getCounts().push_back(m_function.getEntryCount());
+    }
+
+    for (size_t nth = 0; nth < p_calls.size(); ++nth) {
+        Instruction *call = p_calls[nth];
+        BasicBlock *block = call->getParent();
+        block->erase(block->getTerminator());
+        for (size_t i = 0; i < phis.size(); ++i) {
+            if (phis[i]) {
+                phis[i]->addIncoming(call->getOperand(i), block);
+            }
+        }
+        block->erase(call);
+        auto back_edge = m_function.createInstr(Opcode::kJump);
+        back_edge->getBlocks().push_back(header);
+        if (!entry_jump->getCounts().empty()) {
+            back_edge->getCounts().push_back(counts[nth]);
+        }
+        block->append(std::move(back_edge));
+        ++m_num_recursions_removed;
+    }
+    m_function.updatePredecessors();
+}
+
+} // namespace ir
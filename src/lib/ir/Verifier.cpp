@@ -0,0 +1,245 @@
+#include "ir/Verifier.hpp"
+#include "ir/Dominators.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace ir {
+
+// -1 where it varies
+static int getNumOperands(const Instruction &p_instr) {
+    switch (p_instr.getOpcode()) {
+    case Opcode::kConst:
+    case Opcode::kParam:
+    case Opcode::kLoad:
+    case Opcode::kLoadGlobal:
+    case Opcode::kAddr:
+    case Opcode::kAddrGlobal:
+    case Opcode::kRead:
+    case Opcode::kJump:
+        return 0;
+    case Opcode::kNeg:
+    case Opcode::kNot:
+    case Opcode::kStore:
+    case Opcode::kStoreGlobal:
+    case Opcode::kLoadPtr:
+    case Opcode::kPrint:
+    case Opcode::kCount:
+    case Opcode::kBranch:
+    case Opcode::kVSetVL:
+    case Opcode::kVLoad:
+    case Opcode::kVSplat:
+        return 1;
+    case Opcode::kCall:
+    case Opcode::kPhi:
+    case Opcode::kRet:
+        return -1;
+    default:
+        return 2;
+    }
+}
+
+// whether p_instr takes vectors, its operand p_nth included
+static bool takesVector(const Instruction &p_instr, const size_t p_nth) {
+    switch (p_instr.getOpcode()) {
+    case Opcode::kVAdd:
+    case Opcode::kVSub:
+    case Opcode::kVMul:
+        return true;
+    case Opcode::kVStore:
+    case Opcode::kVRedSum:
+        return p_nth == 0;
+    default:
+        return false;
+    }
+}
+
+static size_t getNumBlocks(const Instruction &p_instr) {
+    switch (p_instr.getOpcode()) {
+    case Opcode::kJump:
+        return 1;
+    case Opcode::kBranch:
+        return 2;
+    case Opcode::kPhi:
+        return p_instr.getOperands().size();
+    default:
+        return 0;
+    }
+}
+
+static bool isReturnedRightAway(const Instruction &p_call) {
+    const auto &instrs = p_call.getParent()->getInstrs();
+    const size_t pos = p_call.getParent()->indexOf(&p_call);
+    if (p_call.getOpcode() != Opcode::kCall || pos + 1 == instrs.size()) {
+        return false;
+    }
+    const Instruction &next = *instrs[pos + 1];
+    return next.getOpcode() == Opcode::kRet &&
+           (next.getOperands().empty() || next.getOperand(0) == &p_call);
+}
+
+void Verifier::report(const Function &p_function, const BasicBlock *p_block,
+                      const std::string &p_message) {
+    m_errors.push_back(p_function.getName() + ", bb" +
+                       std::to_string(p_block->getId()) + ": " + p_message);
+}
+
+bool Verifier::run(const Function &p_function) {
+    const size_t num_errors = m_errors.size();
+    if (p_function.getBlocks().empty()) {
+        m_errors.push_back(p_function.getName() + ": no entry block");
+        return false;
+    }
+
+    std::set<const BasicBlock *> blocks;
+    std::set<const Instruction *> values;
+    std::set<const Slot *> slots;
+    for (auto &block : p_function.getBlocks()) {
+        blocks.insert(block.get());
+        for (auto &instr : block->getInstrs()) {
+            values.insert(instr.get());
+        }
+    }
+    for (auto &slot : p_function.getSlots()) {
+        slots.insert(slot.get());
+    }
+
+    // the predecessors as the terminators say
+    std::map<const BasicBlock *, std::set<const BasicBlock *>> preds;
+    for (auto &block : p_function.getBlocks()) {
+        const auto &instrs = block->getInstrs();
+        if (instrs.empty() || !instrs.back()->isTerminator()) {
+            report(p_function, block.get(), "missing terminator");
+        }
+        bool past_phis = false;
+        for (auto &instr : instrs) {
+            const std::string name =
+                std::string(getOpcodeName(instr->getOpcode())) + " %" +
+                std::to_string(instr->getId());
+            if (instr->getParent() != block.get()) {
+                report(p_function, block.get(), name + " has a wrong parent");
+            }
+            if (instr->isTerminator() && instr != instrs.back()) {
+                report(p_function, block.get(),
+                       name + " terminates the block early");
+            }
+            if (instr->isPhi() && past_phis) {
+                report(p_function, block.get(), name + " follows a non-phi");
+            }
+            past_phis = past_phis || !instr->isPhi();
+
+            const int num_operands = getNumOperands(*instr);
+            const size_t expected =
+                instr->getOpcode() == Opcode::kRet
+                    ? (p_function.returnsValue() ? 1 : 0)
+                    : static_cast<size_t>(num_operands);
+            if ((num_operands >= 0 || instr->getOpcode() == Opcode::kRet) &&
+                instr->getOperands().size() != expected) {
+                report(p_function, block.get(),
+                       name + " has the wrong number of operands");
+            }
+            if (instr->getBlocks().size() != getNumBlocks(*instr)) {
+                report(p_function, block.get(),
+                       name + " has the wrong number of blocks");
+            }
+            if (!instr->getCounts().empty() &&
+                instr->getCounts().size() != instr->getBlocks().size()) {
+                report(p_function, block.get(),
+                       name + " has counts for a different number of blocks");
+            }
+            for (size_t i = 0; i < instr->getOperands().size(); ++i) {
+                const Instruction *operand = instr->getOperand(i);
+                if (!values.count(operand)) {
+                    report(p_function, block.get(),
+                           name + " uses a value not in the function");
+                } else if (!operand->hasResult()) {
+                    report(p_function, block.get(),
+                           name + " uses an instruction without a value");
+                } else if (operand->isVector() && !takesVector(*instr, i)) {
+                    report(p_function, block.get(),
+                           name + " uses a vector as a word");
+                } else if (operand->isVector() &&
+                           operand->getParent() != block.get()) {
+                    // vl is only known within the block
+                    report(p_function, block.get(),
+                           name + " uses a vector from another block");
+                }
+            }
+            if (instr->getOpcode() == Opcode::kVStore &&
+                !instr->getOperands().empty() &&
+                !instr->getOperand(0)->isVector()) {
+                report(p_function, block.get(), name + " stores a word");
+            }
+            for (const BasicBlock *target : instr->getBlocks()) {
+                if (!blocks.count(target)) {
+                    report(p_function, block.get(),
+                           name + " refers to a block not in the function");
+                }
+            }
+            if (instr->isTailCall() && instr->getParent() == block.get() &&
+                !isReturnedRightAway(*instr)) {
+                report(p_function, block.get(),
+                       name + " is a tail call but no ret follows");
+            }
+            if ((instr->getOpcode() == Opcode::kLoad ||
+                 instr->getOpcode() == Opcode::kStore ||
+                 instr->getOpcode() == Opcode::kAddr) &&
+                !slots.count(instr->getSlot())) {
+                report(p_function, block.get(),
+                       name + " accesses a slot not in the function");
+            }
+        }
+        for (const BasicBlock *succ : block->getSuccessors()) {
+            preds[succ].insert(block.get());
+        }
+    }
+    if (m_errors.size() != num_errors) {
+        return false;
+    }
+
+    for (auto &block : p_function.getBlocks()) {
+        const auto &stored = block->getPredecessors();
+        if (std::set<const BasicBlock *>(stored.begin(), stored.end()) !=
+                preds[block.get()] ||
+            stored.size() != preds[block.get()].size()) {
+            report(p_function, block.get(), "stale predecessors");
+        }
+        for (auto &instr : block->getInstrs()) {
+            if (!instr->isPhi()) {
+                break;
+            }
+            const auto &incoming = instr->getBlocks();
+            if (std::set<const BasicBlock *>(incoming.begin(), incoming.end()) !=
+                    preds[block.get()] ||
+                incoming.size() != preds[block.get()].size()) {
+                report(p_function, block.get(),
+                       "phi %" + std::to_string(instr->getId()) +
+                           " does not match the predecessors");
+            }
+        }
+    }
+    if (!preds[p_function.getEntry()].empty()) {
+        report(p_function, p_function.getEntry(), "the entry has predecessors");
+    }
+    if (m_errors.size() != num_errors) {
+        return false;
+    }
+
+    const DominatorTree dom_tree(p_function);
+    for (auto &block : p_function.getBlocks()) {
+        for (auto &instr : block->getInstrs()) {
+            for (size_t i = 0; i < instr->getOperands().size(); ++i) {
+                if (!dom_tree.dominates(instr->getOperand(i), instr.get(), i)) {
+                    report(p_function, block.get(),
+                           "%" + std::to_string(instr->getOperand(i)->getId()) +
+                               " does not dominate its use in %" +
+                               std::to_string(instr->getId()));
+                }
+            }
+        }
+    }
+    return m_errors.size() == num_errors;
+}
+
+} // namespace ir
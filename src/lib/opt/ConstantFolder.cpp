@@ -0,0 +1,317 @@
+#include "opt/ConstantFolder.hpp"
+#include "visitor/AstNodeInclude.hpp"
+
+#include <cstdint>
+#include <limits>
+
+static const ConstantValueNode *asConstant(const ExpressionNode *p_expr) {
+    return dynamic_cast<const ConstantValueNode *>(p_expr);
+}
+
+static bool isIntegerConstant(const ConstantValueNode *p_constant) {
+    return p_constant && p_constant->getTypePtr()->isInteger();
+}
+
+static bool isBoolConstant(const ConstantValueNode *p_constant) {
+    return p_constant && p_constant->getTypePtr()->isBool();
+}
+
+// integers are 32 bits wide on the target
+static int32_t integerOf(const ConstantValueNode *p_constant) {
+    return static_cast<int32_t>(p_constant->getConstantPtr()->integer());
+}
+
+static bool booleanOf(const ConstantValueNode *p_constant) {
+    return p_constant->getConstantPtr()->boolean();
+}
+
+static bool isIntegerConstant(const ConstantValueNode *p_constant,
+                              const int32_t p_value) {
+    return isIntegerConstant(p_constant) && integerOf(p_constant) == p_value;
+}
+
+static bool isBoolConstant(const ConstantValueNode *p_constant,
+                           const bool p_value) {
+    return isBoolConstant(p_constant) && booleanOf(p_constant) == p_value;
+}
+
+static ExpressionNode *createInteger(const Location &p_location,
+                                     const int32_t p_value) {
+    Constant::ConstantValue value;
+    value.integer = p_value;
+    auto *const constant = new Constant(
+        std::make_shared<PType>(PType::PrimitiveTypeEnum::kIntegerType), value);
+    auto *const node =
+        new ConstantValueNode(p_location.line, p_location.col, constant);
+    node->setInferredType(new PType(PType::PrimitiveTypeEnum::kIntegerType));
+    return node;
+}
+
+static ExpressionNode *createBoolean(const Location &p_location,
+                                     const bool p_value) {
+    Constant::ConstantValue value;
+    value.integer = 0;
+    value.boolean = p_value;
+    auto *const constant = new Constant(
+        std::make_shared<PType>(PType::PrimitiveTypeEnum::kBoolType), value);
+    auto *const node =
+        new ConstantValueNode(p_location.line, p_location.col, constant);
+    node->setInferredType(new PType(PType::PrimitiveTypeEnum::kBoolType));
+    return node;
+}
+
+// whether evaluating the expression may do more than produce its value
+static bool hasSideEffect(const ExpressionNode &p_expr) {
+    if (dynamic_cast<const FunctionInvocationNode *>(&p_expr)) {
+        return true;
+    }
+    if (const auto *bin_op = dynamic_cast<const BinaryOperatorNode *>(&p_expr)) {
+        return hasSideEffect(bin_op->getLeftOperand()) ||
+               hasSideEffect(bin_op->getRightOperand());
+    }
+    if (const auto *un_op = dynamic_cast<const UnaryOperatorNode *>(&p_expr)) {
+        return hasSideEffect(un_op->getOperand());
+    }
+    if (const auto *var_ref =
+            dynamic_cast<const VariableReferenceNode *>(&p_expr)) {
+        for (const auto &index : var_ref->getIndices()) {
+            if (hasSideEffect(*index)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ConstantFolder::foldChildNodes(AstNode &p_node) {
+    p_node.visitChildNodes(*this);
+    p_node.rewriteChildExpressions(*this);
+}
+
+void ConstantFolder::visit(ProgramNode &p_program) {
+    foldChildNodes(p_program);
+}
+
+void ConstantFolder::visit(DeclNode &p_decl) { foldChildNodes(p_decl); }
+
+void ConstantFolder::visit(FunctionNode &p_function) {
+    foldChildNodes(p_function);
+}
+
+void ConstantFolder::visit(CompoundStatementNode &p_compound_statement) {
+    foldChildNodes(p_compound_statement);
+}
+
+void ConstantFolder::visit(PrintNode &p_print) { foldChildNodes(p_print); }
+
+void ConstantFolder::visit(BinaryOperatorNode &p_bin_op) {
+    foldChildNodes(p_bin_op);
+}
+
+void ConstantFolder::visit(UnaryOperatorNode &p_un_op) {
+    foldChildNodes(p_un_op);
+}
+
+void ConstantFolder::visit(FunctionInvocationNode &p_func_invocation) {
+    foldChildNodes(p_func_invocation);
+}
+
+void ConstantFolder::visit(VariableReferenceNode &p_variable_ref) {
+    foldChildNodes(p_variable_ref);
+}
+
+void ConstantFolder::visit(AssignmentNode &p_assignment) {
+    foldChildNodes(p_assignment);
+}
+
+void ConstantFolder::visit(ReadNode &p_read) { foldChildNodes(p_read); }
+
+void ConstantFolder::visit(IfNode &p_if) { foldChildNodes(p_if); }
+
+void ConstantFolder::visit(WhileNode &p_while) { foldChildNodes(p_while); }
+
+void ConstantFolder::visit(ForNode &p_for) { foldChildNodes(p_for); }
+
+void ConstantFolder::visit(ReturnNode &p_return) { foldChildNodes(p_return); }
+
+void ConstantFolder::rewrite(std::unique_ptr<ExpressionNode> &p_expr) {
+    if (foldBinary(p_expr) || foldUnary(p_expr)) {
+        ++m_num_folded;
+    }
+}
+
+bool ConstantFolder::foldBinary(std::unique_ptr<ExpressionNode> &p_expr) {
+    auto *const bin_op = dynamic_cast<BinaryOperatorNode *>(p_expr.get());
+    if (!bin_op) {
+        return false;
+    }
+    const auto *const lhs = asConstant(bin_op->getL());
+    const auto *const rhs = asConstant(bin_op->getR());
+    const auto &location = bin_op->getLocation();
+
+    if (isIntegerConstant(lhs) && isIntegerConstant(rhs)) {
+        const int32_t a = integerOf(lhs), b = integerOf(rhs);
+        // wrap around like the hardware does
+        const uint32_t ua = a, ub = b;
+        switch (bin_op->getOp()) {
+        case Operator::kPlusOp:
+            p_expr.reset(createInteger(location, ua + ub));
+            return true;
+        case Operator::kMinusOp:
+            p_expr.reset(createInteger(location, ua - ub));
+            return true;
+        case Operator::kMultiplyOp:
+            p_expr.reset(createInteger(location, ua * ub));
+            return true;
+        case Operator::kDivideOp:
+        case Operator::kModOp:
+            // leave the trapping and the overflowing cases to run time
+            if (b == 0 || (a == std::numeric_limits<int32_t>::min() && b == -1)) {
+                return false;
+            }
+            p_expr.reset(createInteger(location, bin_op->getOp() ==
+                                                         Operator::kDivideOp
+                                                     ? a / b
+                                                     : a % b));
+            return true;
+        case Operator::kLessOp:
+            p_expr.reset(createBoolean(location, a < b));
+            return true;
+        case Operator::kLessOrEqualOp:
+            p_expr.reset(createBoolean(location, a <= b));
+            return true;
+        case Operator::kGreaterOp:
+            p_expr.reset(createBoolean(location, a > b));
+            return true;
+        case Operator::kGreaterOrEqualOp:
+            p_expr.reset(createBoolean(location, a >= b));
+            return true;
+        case Operator::kEqualOp:
+            p_expr.reset(createBoolean(location, a == b));
+            return true;
+        case Operator::kNotEqualOp:
+            p_expr.reset(createBoolean(location, a != b));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    if (isBoolConstant(lhs) && isBoolConstant(rhs)) {
+        const bool a = booleanOf(lhs), b = booleanOf(rhs);
+        switch (bin_op->getOp()) {
+        case Operator::kAndOp:
+            p_expr.reset(createBoolean(location, a && b));
+            return true;
+        case Operator::kOrOp:
+            p_expr.reset(createBoolean(location, a || b));
+            return true;
+        case Operator::kEqualOp:
+            p_expr.reset(createBoolean(location, a == b));
+            return true;
+        case Operator::kNotEqualOp:
+            p_expr.reset(createBoolean(location, a != b));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // identities; the kept operand is released before its parent is deleted
+    const auto *const type = bin_op->getInferredType();
+    if (type && type->isInteger()) {
+        switch (bin_op->getOp()) {
+        case Operator::kPlusOp:
+            if (isIntegerConstant(rhs, 0)) {
+                p_expr.reset(bin_op->releaseL());
+                return true;
+            }
+            if (isIntegerConstant(lhs, 0)) {
+                p_expr.reset(bin_op->releaseR());
+                return true;
+            }
+            return false;
+        case Operator::kMinusOp:
+            if (isIntegerConstant(rhs, 0)) {
+                p_expr.reset(bin_op->releaseL());
+                return true;
+            }
+            return false;
+        case Operator::kMultiplyOp:
+            if (isIntegerConstant(rhs, 1)) {
+                p_expr.reset(bin_op->releaseL());
+                return true;
+            }
+            if (isIntegerConstant(lhs, 1)) {
+                p_expr.reset(bin_op->releaseR());
+                return true;
+            }
+            if ((isIntegerConstant(rhs, 0) && !hasSideEffect(*bin_op->getL())) ||
+                (isIntegerConstant(lhs, 0) && !hasSideEffect(*bin_op->getR()))) {
+                p_expr.reset(createInteger(location, 0));
+                return true;
+            }
+            return false;
+        case Operator::kDivideOp:
+            if (isIntegerConstant(rhs, 1)) {
+                p_expr.reset(bin_op->releaseL());
+                return true;
+            }
+            return false;
+        default:
+            return false;
+        }
+    }
+
+    if (type && type->isBool()) {
+        // x and true, x or false
+        const bool neutral = bin_op->getOp() == Operator::kAndOp;
+        if (bin_op->getOp() != Operator::kAndOp &&
+            bin_op->getOp() != Operator::kOrOp) {
+            return false;
+        }
+        if (isBoolConstant(rhs, neutral)) {
+            p_expr.reset(bin_op->releaseL());
+            return true;
+        }
+        if (isBoolConstant(lhs, neutral)) {
+            p_expr.reset(bin_op->releaseR());
+            return true;
+        }
+        // false and x, true or x never evaluate x; x and false, x or true
+        // still have to
+        if (isBoolConstant(lhs, !neutral) ||
+            (isBoolConstant(rhs, !neutral) && !hasSideEffect(*bin_op->getL()))) {
+            p_expr.reset(createBoolean(location, !neutral));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ConstantFolder::foldUnary(std::unique_ptr<ExpressionNode> &p_expr) {
+    auto *const un_op = dynamic_cast<UnaryOperatorNode *>(p_expr.get());
+    if (!un_op) {
+        return false;
+    }
+    const auto *const operand = asConstant(un_op->getVal());
+    const auto &location = un_op->getLocation();
+
+    if (un_op->getOp() == Operator::kNegOp && isIntegerConstant(operand)) {
+        p_expr.reset(createInteger(
+            location, 0u - static_cast<uint32_t>(integerOf(operand))));
+        return true;
+    }
+    if (un_op->getOp() == Operator::kNotOp && isBoolConstant(operand)) {
+        p_expr.reset(createBoolean(location, !booleanOf(operand)));
+        return true;
+    }
+
+    // not not b, - - x
+    auto *const inner = dynamic_cast<UnaryOperatorNode *>(un_op->getVal());
+    if (inner && inner->getOp() == un_op->getOp()) {
+        p_expr.reset(inner->releaseVal());
+        return true;
+    }
+    return false;
+}
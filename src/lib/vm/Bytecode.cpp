@@ -0,0 +1,107 @@
+#include "vm/Bytecode.hpp"
+
+namespace vm {
+
+// by Opcode
+static const char *const kOpcodeNames[] = {
+    "move",     "load.int",  "load.const", "load.global", "store.global",
+    "addr.global", "addr.local", "index",  "load.elem",   "store.elem",
+    "add",      "sub",       "mul",        "div",         "mod",
+    "add.imm",  "mul.imm",   "neg",        "not",         "eq",
+    "ne",       "lt",        "le",         "gt",          "ge",
+    "fadd",     "fsub",      "fmul",       "fdiv",        "fneg",
+    "feq",      "fne",       "flt",        "fle",         "fgt",
+    "fge",      "itof",      "concat",     "jump",        "jz",
+    "jnz",      "call",      "ret",        "ret.void",    "print.int",
+    "print.real", "print.string", "read.int", "read.real", "read.string",
+};
+static_assert(sizeof(kOpcodeNames) / sizeof(kOpcodeNames[0]) ==
+                  static_cast<size_t>(Opcode::kNumOpcodes),
+              "a name for every opcode");
+
+const char *getOpcodeName(const Opcode p_opcode) {
+    return kOpcodeNames[static_cast<size_t>(p_opcode)];
+}
+
+static void printInstruction(FILE *p_out_file, const Program &p_program,
+                             const Instruction &p_instr) {
+    fprintf(p_out_file, "%s", getOpcodeName(p_instr.opcode));
+    switch (p_instr.opcode) {
+    case Opcode::kLoadInt:
+    case Opcode::kAddrLocal:
+        fprintf(p_out_file, " r%u, %d", p_instr.a, p_instr.imm());
+        break;
+    case Opcode::kLoadConst: {
+        const Value constant = p_program.constants[p_instr.imm()];
+        fprintf(p_out_file, " r%u, #%d", p_instr.a, p_instr.imm());
+        if (p_program.is_string_constant[p_instr.imm()]) {
+            fprintf(p_out_file, " \"%s\"", constant.string);
+        } else {
+            fprintf(p_out_file, " %f", constant.real);
+        }
+        break;
+    }
+    case Opcode::kLoadGlobal:
+    case Opcode::kStoreGlobal:
+    case Opcode::kAddrGlobal:
+        fprintf(p_out_file, " r%u, g%d", p_instr.a, p_instr.imm());
+        break;
+    case Opcode::kAddImm:
+    case Opcode::kMulImm:
+        fprintf(p_out_file, " r%u, r%u, %d", p_instr.a, p_instr.b,
+                p_instr.simm());
+        break;
+    case Opcode::kMove:
+    case Opcode::kNeg:
+    case Opcode::kNot:
+    case Opcode::kFNeg:
+    case Opcode::kIntToReal:
+        fprintf(p_out_file, " r%u, r%u", p_instr.a, p_instr.b);
+        break;
+    case Opcode::kJump:
+        fprintf(p_out_file, " %d", p_instr.imm());
+        break;
+    case Opcode::kJumpIfZero:
+    case Opcode::kJumpIfNonZero:
+        fprintf(p_out_file, " r%u, %d", p_instr.a, p_instr.imm());
+        break;
+    case Opcode::kCall:
+        fprintf(p_out_file, " r%u, @%s, r%u", p_instr.a,
+                p_program.functions[p_instr.b].name.c_str(), p_instr.c);
+        break;
+    case Opcode::kRetVoid:
+        break;
+    case Opcode::kRet:
+    case Opcode::kPrintInt:
+    case Opcode::kPrintReal:
+    case Opcode::kPrintString:
+    case Opcode::kReadInt:
+    case Opcode::kReadReal:
+    case Opcode::kReadString:
+        fprintf(p_out_file, " r%u", p_instr.a);
+        break;
+    default:
+        fprintf(p_out_file, " r%u, r%u, r%u", p_instr.a, p_instr.b,
+                p_instr.c);
+        break;
+    }
+}
+
+void printProgram(FILE *p_out_file, const Program &p_program) {
+    for (size_t i = 0; i < p_program.functions.size(); ++i) {
+        const Function &function = p_program.functions[i];
+        const size_t end = i + 1 < p_program.functions.size()
+                               ? p_program.functions[i + 1].entry
+                               : p_program.code.size();
+        fprintf(p_out_file, "function %s(%u): %u registers, frame %u\n",
+                function.name.c_str(), function.num_params,
+                function.num_registers, function.frame_size);
+        for (size_t pc = function.entry; pc < end; ++pc) {
+            fprintf(p_out_file, "  %6zu  ", pc);
+            printInstruction(p_out_file, p_program, p_program.code[pc]);
+            fprintf(p_out_file, "\n");
+        }
+    }
+}
+
+} // namespace vm
@@ -0,0 +1,632 @@
+#include "vm/BytecodeGenerator.hpp"
+#include "sema/SymbolTable.hpp"
+#include "visitor/AstNodeInclude.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace vm {
+
+static const uint32_t kMaxRegisters = std::numeric_limits<uint16_t>::max();
+
+static Opcode getBinaryOpcode(const Operator p_op, const bool p_is_real) {
+    switch (p_op) {
+    case Operator::kPlusOp:
+        return p_is_real ? Opcode::kFAdd : Opcode::kAdd;
+    case Operator::kMinusOp:
+        return p_is_real ? Opcode::kFSub : Opcode::kSub;
+    case Operator::kMultiplyOp:
+        return p_is_real ? Opcode::kFMul : Opcode::kMul;
+    case Operator::kDivideOp:
+        return p_is_real ? Opcode::kFDiv : Opcode::kDiv;
+    case Operator::kModOp:
+        return Opcode::kMod;
+    case Operator::kEqualOp:
+        return p_is_real ? Opcode::kFEq : Opcode::kEq;
+    case Operator::kNotEqualOp:
+        return p_is_real ? Opcode::kFNe : Opcode::kNe;
+    case Operator::kLessOp:
+        return p_is_real ? Opcode::kFLt : Opcode::kLt;
+    case Operator::kLessOrEqualOp:
+        return p_is_real ? Opcode::kFLe : Opcode::kLe;
+    case Operator::kGreaterOp:
+        return p_is_real ? Opcode::kFGt : Opcode::kGt;
+    case Operator::kGreaterOrEqualOp:
+        return p_is_real ? Opcode::kFGe : Opcode::kGe;
+    default:
+        assert(false && "not a binary operator with a value");
+        return Opcode::kAdd;
+    }
+}
+
+static bool fitsImm(const int64_t p_value) {
+    return p_value >= std::numeric_limits<int16_t>::min() &&
+           p_value <= std::numeric_limits<int16_t>::max();
+}
+
+static bool isReal(const ExpressionNode &p_expr) {
+    return p_expr.getInferredType()->isReal();
+}
+
+static uint32_t getNumElements(const PType &p_type) {
+    uint32_t num = 1;
+    for (const uint64_t dimension : p_type.getDimensions()) {
+        num *= dimension;
+    }
+    return num;
+}
+
+void BytecodeGenerator::beginFunction(const std::string &p_name,
+                                      const uint16_t p_num_params,
+                                      const bool p_returns_real) {
+    m_function_index[p_name] = m_program.functions.size();
+    m_program.functions.emplace_back();
+    m_function = &m_program.functions.back();
+    m_function->name = p_name;
+    m_function->num_params = p_num_params;
+    m_function->entry = m_program.code.size();
+    m_function->returns_real = p_returns_real;
+    m_registers.clear();
+    m_num_locals = 0;
+    m_next_register = 0;
+    m_array_size = 0;
+    m_local_addresses.clear();
+}
+
+void BytecodeGenerator::endFunction() {
+    m_function->frame_size = m_function->num_registers + m_array_size;
+    for (const size_t address : m_local_addresses) {
+        Instruction &instr = m_program.code[address];
+        instr.setImm(instr.imm() + m_function->num_registers);
+    }
+    m_function = nullptr;
+}
+
+size_t BytecodeGenerator::emit(const Opcode p_opcode, const uint32_t p_a,
+                               const uint32_t p_b, const uint32_t p_c) {
+    Instruction instr;
+    instr.opcode = p_opcode;
+    instr.a = p_a;
+    instr.b = p_b;
+    instr.c = p_c;
+    m_program.code.push_back(instr);
+    return m_program.code.size() - 1;
+}
+
+size_t BytecodeGenerator::emitImm(const Opcode p_opcode, const uint32_t p_a,
+                                  const int32_t p_imm) {
+    const size_t index = emit(p_opcode, p_a);
+    m_program.code[index].setImm(p_imm);
+    return index;
+}
+
+void BytecodeGenerator::emitWithImm(const Opcode p_opcode,
+                                    const Opcode p_imm_opcode,
+                                    const uint16_t p_dst, const uint16_t p_src,
+                                    const int32_t p_imm) {
+    if (fitsImm(p_imm)) {
+        emit(p_imm_opcode, p_dst, p_src, static_cast<uint16_t>(p_imm));
+        return;
+    }
+    const uint16_t imm = newRegister();
+    emitImm(Opcode::kLoadInt, imm, p_imm);
+    emit(p_opcode, p_dst, p_src, imm);
+}
+
+void BytecodeGenerator::patch(const std::vector<size_t> &p_jumps,
+                              const size_t p_target) {
+    for (const size_t jump : p_jumps) {
+        m_program.code[jump].setImm(p_target);
+    }
+}
+
+uint16_t BytecodeGenerator::newRegister() {
+    if (m_next_register >= kMaxRegisters) {
+        fprintf(stderr, "error: %s needs more than %u registers\n",
+                m_function->name.c_str(), kMaxRegisters);
+        exit(EXIT_FAILURE);
+    }
+    const uint16_t reg = m_next_register++;
+    m_function->num_registers =
+        std::max<uint32_t>(m_function->num_registers, m_next_register);
+    return reg;
+}
+
+uint16_t BytecodeGenerator::newLocal() {
+    // the temporaries above the locals are dead between statements
+    m_next_register = m_num_locals;
+    const uint16_t reg = newRegister();
+    m_num_locals = m_next_register;
+    return reg;
+}
+
+uint16_t BytecodeGenerator::destination() {
+    return m_target >= 0 ? m_target : newRegister();
+}
+
+uint16_t BytecodeGenerator::evaluate(ExpressionNode &p_expr,
+                                     const int p_target) {
+    const int saved_target = m_target;
+    m_target = p_target;
+    p_expr.accept(*this);
+    m_target = saved_target;
+    if (p_target >= 0 && m_value != p_target) {
+        emit(Opcode::kMove, p_target, m_value);
+        m_value = p_target;
+    }
+    return m_value;
+}
+
+uint16_t BytecodeGenerator::evaluateAs(ExpressionNode &p_expr,
+                                       const bool p_to_real,
+                                       const int p_target) {
+    if (!p_to_real || !p_expr.getInferredType()->isInteger()) {
+        return evaluate(p_expr, p_target);
+    }
+    const uint16_t value = evaluate(p_expr);
+    const uint16_t real = p_target >= 0 ? p_target : newRegister();
+    emit(Opcode::kIntToReal, real, value);
+    return real;
+}
+
+void BytecodeGenerator::branch(ExpressionNode &p_cond, const bool p_sense,
+                               std::vector<size_t> &p_jumps) {
+    if (auto *const constant = dynamic_cast<ConstantValueNode *>(&p_cond)) {
+        if (constant->getConstantPtr()->boolean() == p_sense) {
+            p_jumps.push_back(emitImm(Opcode::kJump, 0, 0));
+        }
+        return;
+    }
+    if (auto *const un_op = dynamic_cast<UnaryOperatorNode *>(&p_cond)) {
+        if (un_op->getOp() == Operator::kNotOp) {
+            branch(*un_op->getVal(), !p_sense, p_jumps);
+            return;
+        }
+    }
+    auto *const bin_op = dynamic_cast<BinaryOperatorNode *>(&p_cond);
+    if (bin_op && (bin_op->getOp() == Operator::kAndOp ||
+                   bin_op->getOp() == Operator::kOrOp)) {
+        // a false operand of and, or a true one of or, decides alone
+        if ((bin_op->getOp() == Operator::kAndOp) != p_sense) {
+            branch(*bin_op->getL(), p_sense, p_jumps);
+            branch(*bin_op->getR(), p_sense, p_jumps);
+            return;
+        }
+        std::vector<size_t> decided;
+        branch(*bin_op->getL(), !p_sense, decided);
+        branch(*bin_op->getR(), p_sense, p_jumps);
+        patch(decided, m_program.code.size());
+        return;
+    }
+
+    const uint16_t cond = evaluate(p_cond);
+    p_jumps.push_back(emitImm(
+        p_sense ? Opcode::kJumpIfNonZero : Opcode::kJumpIfZero, cond, 0));
+}
+
+void BytecodeGenerator::loadConstant(const Constant &p_constant,
+                                     const uint16_t p_dst) {
+    const PType &type = *p_constant.getTypePtr();
+    if (!type.isPrimitiveReal() && !type.isPrimitiveString()) {
+        emitImm(Opcode::kLoadInt, p_dst, p_constant.word());
+        return;
+    }
+
+    Value value;
+    uint32_t *index;
+    if (type.isPrimitiveReal()) {
+        value.real = p_constant.real();
+        uint32_t bits;
+        memcpy(&bits, &value.real, sizeof(bits));
+        auto inserted = m_real_constants.emplace(bits, 0);
+        index = &inserted.first->second;
+        if (!inserted.second) {
+            emitImm(Opcode::kLoadConst, p_dst, *index);
+            return;
+        }
+    } else {
+        const char *string = p_constant.getConstantValueCString();
+        auto inserted = m_string_constants.emplace(string, 0);
+        index = &inserted.first->second;
+        if (!inserted.second) {
+            emitImm(Opcode::kLoadConst, p_dst, *index);
+            return;
+        }
+        m_program.strings.push_back(string);
+        value.string = m_program.strings.back().c_str();
+    }
+    *index = m_program.constants.size();
+    m_program.constants.push_back(value);
+    m_program.is_string_constant.push_back(type.isPrimitiveString());
+    emitImm(Opcode::kLoadConst, p_dst, *index);
+}
+
+void BytecodeGenerator::declareGlobals(const SymbolTable *p_table) {
+    for (const auto &entry : p_table->getEntries()) {
+        if (entry->getKind() != SymbolEntry::KindEnum::kVariableKind) {
+            continue;
+        }
+        m_globals[entry.get()] = m_program.num_globals;
+        m_program.num_globals += getNumElements(*entry->getTypePtr());
+    }
+}
+
+void BytecodeGenerator::declareLocals(const SymbolTable *p_table) {
+    if (!p_table) {
+        return;
+    }
+    for (const auto &entry : p_table->getEntries()) {
+        // constants are loaded where they are used
+        if (entry->getKind() == SymbolEntry::KindEnum::kFunctionKind ||
+            entry->getKind() == SymbolEntry::KindEnum::kProgramKind ||
+            entry->getKind() == SymbolEntry::KindEnum::kConstantKind) {
+            continue;
+        }
+        const uint16_t reg = newLocal();
+        m_registers[entry.get()] = reg;
+        // an array parameter is the address of the caller's, an array of
+        // the function gets the register holding its address
+        if (entry->getKind() != SymbolEntry::KindEnum::kParameterKind &&
+            !entry->getTypePtr()->getDimensions().empty()) {
+            m_local_addresses.push_back(
+                emitImm(Opcode::kAddrLocal, reg, m_array_size));
+            m_array_size += getNumElements(*entry->getTypePtr());
+        }
+    }
+}
+
+uint16_t BytecodeGenerator::arrayBase(const SymbolEntry &p_entry) {
+    if (p_entry.getLevel() != 0) {
+        return m_registers.at(&p_entry);
+    }
+    const uint16_t base = newRegister();
+    emitImm(Opcode::kAddrGlobal, base, m_globals.at(&p_entry));
+    return base;
+}
+
+void BytecodeGenerator::elementIndex(VariableReferenceNode &p_ref,
+                                     uint16_t &p_base, uint16_t &p_index) {
+    const SymbolEntry &entry = *m_symbol_manager_ptr->lookup(p_ref.getName());
+    const auto &dimensions = entry.getTypePtr()->getDimensions();
+    p_base = arrayBase(entry);
+    int32_t offset = 0;
+    int index = -1;
+    for (size_t i = 0; i < p_ref.getIndices().size(); ++i) {
+        int32_t stride = 1;
+        for (size_t j = i + 1; j < dimensions.size(); ++j) {
+            stride *= dimensions[j];
+        }
+        ExpressionNode &index_expr = *p_ref.getIndices()[i];
+        if (auto *const constant =
+                dynamic_cast<ConstantValueNode *>(&index_expr)) {
+            offset += constant->getConstantPtr()->word() * stride;
+            continue;
+        }
+        uint16_t scaled = evaluate(index_expr);
+        if (stride != 1) {
+            const uint16_t product = newRegister();
+            emitWithImm(Opcode::kMul, Opcode::kMulImm, product, scaled,
+                        stride);
+            scaled = product;
+        }
+        if (index < 0) {
+            index = scaled;
+        } else {
+            const uint16_t sum = newRegister();
+            emit(Opcode::kAdd, sum, index, scaled);
+            index = sum;
+        }
+    }
+
+    if (index < 0) {
+        p_index = newRegister();
+        emitImm(Opcode::kLoadInt, p_index, offset);
+    } else if (offset != 0) {
+        p_index = newRegister();
+        emitWithImm(Opcode::kAdd, Opcode::kAddImm, p_index, index, offset);
+    } else {
+        p_index = index;
+    }
+}
+
+void BytecodeGenerator::assign(VariableReferenceNode &p_ref,
+                               const uint16_t p_value) {
+    const SymbolEntry &entry = *m_symbol_manager_ptr->lookup(p_ref.getName());
+    if (!p_ref.getIndices().empty()) {
+        uint16_t base, index;
+        elementIndex(p_ref, base, index);
+        emit(Opcode::kStoreElem, p_value, base, index);
+    } else if (entry.getLevel() == 0) {
+        emitImm(Opcode::kStoreGlobal, p_value, m_globals.at(&entry));
+    } else if (m_registers.at(&entry) != p_value) {
+        emit(Opcode::kMove, m_registers.at(&entry), p_value);
+    }
+}
+
+void BytecodeGenerator::visit(ProgramNode &p_program) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_program.getSymbolTable());
+
+    declareGlobals(p_program.getSymbolTable());
+    for (const auto &function : p_program.getFuncNodes()) {
+        function->accept(*this);
+    }
+
+    m_program.main = m_program.functions.size();
+    beginFunction("main", 0, false);
+    const_cast<CompoundStatementNode &>(p_program.getBody()).accept(*this);
+    emit(Opcode::kRetVoid);
+    endFunction();
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(
+        p_program.getSymbolTable());
+}
+
+void BytecodeGenerator::visit(ConstantValueNode &p_constant_value) {
+    m_value = destination();
+    loadConstant(*p_constant_value.getConstantPtr(), m_value);
+}
+
+void BytecodeGenerator::visit(FunctionNode &p_function) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_function.getSymbolTable());
+
+    std::vector<bool> &real_params = m_real_params[p_function.getName()];
+    for (const auto &entry : p_function.getSymbolTable()->getEntries()) {
+        if (entry->getKind() == SymbolEntry::KindEnum::kParameterKind) {
+            real_params.push_back(entry->getTypePtr()->isReal());
+        }
+    }
+    beginFunction(p_function.getName(), real_params.size(),
+                  p_function.getTypePtr()->isReal());
+    m_function->real_params = real_params;
+    // the parameters come first, in registers 0, 1...
+    declareLocals(p_function.getSymbolTable());
+    p_function.visitChildNodes(*this);
+    // falling off the end returns, with 0 if a value is expected
+    if (p_function.getTypePtr()->isVoid()) {
+        emit(Opcode::kRetVoid);
+    } else {
+        const uint16_t zero = newRegister();
+        emitImm(Opcode::kLoadInt, zero, 0);
+        emit(Opcode::kRet, zero);
+    }
+    endFunction();
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(
+        p_function.getSymbolTable());
+}
+
+void BytecodeGenerator::visit(CompoundStatementNode &p_compound_statement) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_compound_statement.getSymbolTable());
+
+    declareLocals(p_compound_statement.getSymbolTable());
+    for (const auto &stmt : p_compound_statement.getStmtNodes()) {
+        m_next_register = m_num_locals;
+        stmt->accept(*this);
+    }
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(
+        p_compound_statement.getSymbolTable());
+}
+
+void BytecodeGenerator::visit(PrintNode &p_print) {
+    auto &target = const_cast<ExpressionNode &>(p_print.getTarget());
+    const PType &type = *target.getInferredType();
+    emit(type.isString() ? Opcode::kPrintString
+         : type.isReal() ? Opcode::kPrintReal
+                         : Opcode::kPrintInt,
+         evaluate(target));
+}
+
+void BytecodeGenerator::visit(BinaryOperatorNode &p_bin_op) {
+    const uint16_t dst = destination();
+    ExpressionNode &lhs = *p_bin_op.getL();
+    ExpressionNode &rhs = *p_bin_op.getR();
+    const Operator op = p_bin_op.getOp();
+    if (op == Operator::kAndOp || op == Operator::kOrOp) {
+        std::vector<size_t> to_false;
+        branch(p_bin_op, false, to_false);
+        emitImm(Opcode::kLoadInt, dst, 1);
+        const size_t to_done = emitImm(Opcode::kJump, 0, 0);
+        patch(to_false, m_program.code.size());
+        emitImm(Opcode::kLoadInt, dst, 0);
+        patch({to_done}, m_program.code.size());
+        m_value = dst;
+        return;
+    }
+    if (p_bin_op.getInferredType()->isString()) {
+        const uint16_t lhs_value = evaluate(lhs);
+        emit(Opcode::kConcat, dst, lhs_value, evaluate(rhs));
+        m_value = dst;
+        return;
+    }
+
+    const bool is_real = isReal(lhs) || isReal(rhs);
+    if (!is_real && (op == Operator::kPlusOp || op == Operator::kMinusOp ||
+                     op == Operator::kMultiplyOp)) {
+        // with a constant operand that fits the instruction
+        auto *const lhs_constant = dynamic_cast<ConstantValueNode *>(&lhs);
+        auto *const rhs_constant = dynamic_cast<ConstantValueNode *>(&rhs);
+        const Opcode imm_opcode =
+            op == Operator::kMultiplyOp ? Opcode::kMulImm : Opcode::kAddImm;
+        if (rhs_constant) {
+            int64_t imm = rhs_constant->getConstantPtr()->word();
+            if (op == Operator::kMinusOp) {
+                imm = -imm;
+            }
+            if (fitsImm(imm)) {
+                emit(imm_opcode, dst, evaluate(lhs),
+                     static_cast<uint16_t>(imm));
+                m_value = dst;
+                return;
+            }
+        } else if (lhs_constant && op != Operator::kMinusOp &&
+                   fitsImm(lhs_constant->getConstantPtr()->word())) {
+            emit(imm_opcode, dst, evaluate(rhs),
+                 static_cast<uint16_t>(lhs_constant->getConstantPtr()->word()));
+            m_value = dst;
+            return;
+        }
+    }
+    const uint16_t lhs_value = evaluateAs(lhs, is_real);
+    const uint16_t rhs_value = evaluateAs(rhs, is_real);
+    emit(getBinaryOpcode(op, is_real), dst, lhs_value, rhs_value);
+    m_value = dst;
+}
+
+void BytecodeGenerator::visit(UnaryOperatorNode &p_un_op) {
+    const uint16_t dst = destination();
+    ExpressionNode &operand = *p_un_op.getVal();
+    Opcode opcode = Opcode::kNot;
+    if (p_un_op.getOp() == Operator::kNegOp) {
+        opcode = isReal(operand) ? Opcode::kFNeg : Opcode::kNeg;
+    }
+    emit(opcode, dst, evaluate(operand));
+    m_value = dst;
+}
+
+void BytecodeGenerator::visit(FunctionInvocationNode &p_func_invocation) {
+    const uint16_t dst = destination();
+    const auto &args = p_func_invocation.getArguments();
+    const std::vector<bool> &real_params =
+        m_real_params.at(p_func_invocation.getName());
+    // the arguments go to consecutive registers, above whatever computing
+    // them takes
+    const uint16_t first_arg = m_next_register;
+    for (size_t i = 0; i < args.size(); ++i) {
+        newRegister();
+    }
+    for (size_t i = 0; i < args.size(); ++i) {
+        evaluateAs(*args[i], real_params[i], first_arg + i);
+    }
+    emit(Opcode::kCall, dst,
+         m_function_index.at(p_func_invocation.getName()), first_arg);
+    m_value = dst;
+}
+
+void BytecodeGenerator::visit(VariableReferenceNode &p_variable_ref) {
+    const SymbolEntry &entry =
+        *m_symbol_manager_ptr->lookup(p_variable_ref.getName());
+    if (entry.getKind() == SymbolEntry::KindEnum::kConstantKind) {
+        m_value = destination();
+        loadConstant(*entry.getAttribute().constant(), m_value);
+        return;
+    }
+    const size_t num_dimensions = entry.getTypePtr()->getDimensions().size();
+    const size_t num_indices = p_variable_ref.getIndices().size();
+    if (num_dimensions == 0 && entry.getLevel() != 0) {
+        m_value = m_registers.at(&entry);
+        return;
+    }
+    if (num_dimensions == 0) {
+        m_value = destination();
+        emitImm(Opcode::kLoadGlobal, m_value, m_globals.at(&entry));
+        return;
+    }
+    if (num_indices == 0) {
+        // an array is passed by address
+        m_value = arrayBase(entry);
+        return;
+    }
+
+    uint16_t base, index;
+    elementIndex(p_variable_ref, base, index);
+    m_value = destination();
+    emit(num_indices < num_dimensions ? Opcode::kIndex : Opcode::kLoadElem,
+         m_value, base, index);
+}
+
+void BytecodeGenerator::visit(AssignmentNode &p_assignment) {
+    VariableReferenceNode &lhs = *p_assignment.getL();
+    const SymbolEntry &entry = *m_symbol_manager_ptr->lookup(lhs.getName());
+    const bool to_real = entry.getTypePtr()->isPrimitiveReal();
+    // straight into the register of a local
+    if (lhs.getIndices().empty() && entry.getLevel() != 0) {
+        evaluateAs(*p_assignment.getR(), to_real, m_registers.at(&entry));
+        return;
+    }
+    assign(lhs, evaluateAs(*p_assignment.getR(), to_real));
+}
+
+void BytecodeGenerator::visit(ReadNode &p_read) {
+    VariableReferenceNode &target = *p_read.getVar();
+    const SymbolEntry &entry = *m_symbol_manager_ptr->lookup(target.getName());
+    const PType &type = *entry.getTypePtr();
+    const Opcode opcode = type.isPrimitiveString() ? Opcode::kReadString
+                          : type.isPrimitiveReal() ? Opcode::kReadReal
+                                                   : Opcode::kReadInt;
+    if (target.getIndices().empty() && entry.getLevel() != 0) {
+        emit(opcode, m_registers.at(&entry));
+        return;
+    }
+    const uint16_t value = newRegister();
+    emit(opcode, value);
+    assign(target, value);
+}
+
+void BytecodeGenerator::visit(IfNode &p_if) {
+    std::vector<size_t> to_else;
+    branch(*p_if.getCond(), false, to_else);
+    p_if.getBody()->accept(*this);
+    if (!p_if.getElse()) {
+        patch(to_else, m_program.code.size());
+        return;
+    }
+    const size_t to_done = emitImm(Opcode::kJump, 0, 0);
+    patch(to_else, m_program.code.size());
+    p_if.getElse()->accept(*this);
+    patch({to_done}, m_program.code.size());
+}
+
+void BytecodeGenerator::visit(WhileNode &p_while) {
+    // the test is at the bottom, where the loop is entered
+    const size_t to_cond = emitImm(Opcode::kJump, 0, 0);
+    const size_t body = m_program.code.size();
+    p_while.getBody()->accept(*this);
+    patch({to_cond}, m_program.code.size());
+    m_next_register = m_num_locals;
+    std::vector<size_t> to_body;
+    branch(*p_while.getCond(), true, to_body);
+    patch(to_body, body);
+}
+
+void BytecodeGenerator::visit(ForNode &p_for) {
+    m_symbol_manager_ptr->reconstructHashTableFromSymbolTable(
+        p_for.getSymbolTable());
+
+    declareLocals(p_for.getSymbolTable());
+    const uint16_t iter = m_registers.at(m_symbol_manager_ptr->lookup(
+        p_for.getInit()->getLvalue().getName()));
+    const int32_t lower = p_for.getLowerBound().getConstantPtr()->integer();
+    const int32_t upper = p_for.getUpperBound().getConstantPtr()->integer();
+    emitImm(Opcode::kLoadInt, iter, lower);
+
+    // the loop ends once the variable reaches the upper bound, wrapping
+    // around if it starts above; the first test always passes otherwise
+    if (lower != upper) {
+        const uint16_t bound = newLocal();
+        emitImm(Opcode::kLoadInt, bound, upper);
+        const size_t body = m_program.code.size();
+        p_for.getBody()->accept(*this);
+        m_next_register = m_num_locals;
+        emit(Opcode::kAddImm, iter, iter, 1);
+        const uint16_t more = newRegister();
+        emit(Opcode::kNe, more, iter, bound);
+        emitImm(Opcode::kJumpIfNonZero, more, body);
+    }
+
+    m_symbol_manager_ptr->removeSymbolsFromHashTable(p_for.getSymbolTable());
+}
+
+void BytecodeGenerator::visit(ReturnNode &p_return) {
+    emit(Opcode::kRet,
+         evaluateAs(*p_return.getRetVal(), m_function->returns_real));
+}
+
+} // namespace vm
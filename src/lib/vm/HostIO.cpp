@@ -0,0 +1,114 @@
+#include "vm/HostIO.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace vm {
+
+static const size_t kBufferSize = 1 << 16;
+
+HostIO::HostIO(std::FILE *p_in, std::FILE *p_out) : m_in(p_in), m_out(p_out) {
+    m_output.reserve(kBufferSize);
+}
+
+void HostIO::write(const char *p_chars, const size_t p_length) {
+    if (m_output.size() + p_length > kBufferSize) {
+        flush();
+    }
+    m_output.insert(m_output.end(), p_chars, p_chars + p_length);
+}
+
+void HostIO::flush() {
+    if (!m_output.empty()) {
+        std::fwrite(m_output.data(), 1, m_output.size(), m_out);
+        m_output.clear();
+    }
+    std::fflush(m_out);
+}
+
+void HostIO::printInt(const int32_t p_value) {
+    // the digits backwards from the end
+    char chars[16];
+    char *begin = chars + sizeof(chars);
+    *--begin = '\n';
+    uint32_t magnitude = p_value < 0 ? -static_cast<uint32_t>(p_value)
+                                     : static_cast<uint32_t>(p_value);
+    do {
+        *--begin = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (p_value < 0) {
+        *--begin = '-';
+    }
+    write(begin, chars + sizeof(chars) - begin);
+}
+
+void HostIO::printReal(const float p_value) {
+    char chars[64];
+    const int length = std::snprintf(chars, sizeof(chars), "%f\n", p_value);
+    if (length >= static_cast<int>(sizeof(chars))) {
+        // only the largest reals take this many digits
+        std::string long_chars(length + 1, '\0');
+        std::snprintf(&long_chars[0], long_chars.size(), "%f\n", p_value);
+        write(long_chars.data(), length);
+        return;
+    }
+    write(chars, length);
+}
+
+void HostIO::printString(const char *p_value) {
+    // a string variable never assigned to is empty
+    for (const char *c = p_value ? p_value : ""; *c != '\0'; ++c) {
+        if (m_output.size() == kBufferSize) {
+            flush();
+        }
+        m_output.push_back(*c);
+    }
+    write("\n", 1);
+}
+
+int HostIO::peek() {
+    if (m_input_pos == m_input.size()) {
+        if (m_at_eof) {
+            return -1;
+        }
+        // whatever the program printed before it asks comes first
+        flush();
+        // read() returns what a terminal has so far, fread() would wait
+        // for all of the buffer
+        m_input.resize(kBufferSize);
+        const ssize_t length =
+            ::read(fileno(m_in), m_input.data(), kBufferSize);
+        m_input.resize(length > 0 ? length : 0);
+        m_input_pos = 0;
+        if (length <= 0) {
+            m_at_eof = true;
+            return -1;
+        }
+    }
+    return static_cast<unsigned char>(m_input[m_input_pos]);
+}
+
+std::string HostIO::readWord() {
+    int c;
+    while ((c = peek()) != -1 && std::isspace(c)) {
+        ++m_input_pos;
+    }
+    std::string word;
+    while ((c = peek()) != -1 && !std::isspace(c)) {
+        word.push_back(c);
+        ++m_input_pos;
+    }
+    return word;
+}
+
+int32_t HostIO::readInt() {
+    return static_cast<int32_t>(std::strtoll(readWord().c_str(), nullptr, 10));
+}
+
+float HostIO::readReal() { return std::strtof(readWord().c_str(), nullptr); }
+
+std::string HostIO::readString() { return readWord(); }
+
+} // namespace vm
@@ -0,0 +1,287 @@
+#include "vm/Interpreter.hpp"
+
+#include <cstring>
+
+namespace vm {
+
+// Values on the stack of frames, 8 MiB of them, and the calls deep
+static const size_t kStackSize = 1 << 20;
+static const size_t kMaxCallDepth = 1 << 20;
+
+// The integer operations wrap around and divide as on RV32, where dividing
+// by 0 gives -1 and leaves the remainder the dividend.
+static int32_t wrap(const uint32_t p_value) {
+    return static_cast<int32_t>(p_value);
+}
+
+static int32_t divide(const int32_t p_lhs, const int32_t p_rhs) {
+    if (p_rhs == 0) {
+        return -1;
+    }
+    if (p_rhs == -1) {
+        return wrap(-static_cast<uint32_t>(p_lhs));
+    }
+    return p_lhs / p_rhs;
+}
+
+static int32_t remainder(const int32_t p_lhs, const int32_t p_rhs) {
+    if (p_rhs == 0) {
+        return p_lhs;
+    }
+    if (p_rhs == -1) {
+        return 0;
+    }
+    return p_lhs % p_rhs;
+}
+
+Interpreter::Interpreter(const Program &p_program, HostIO &p_io)
+    : m_program(p_program), m_io(p_io), m_stack(kStackSize),
+      m_globals(p_program.num_globals) {}
+
+int Interpreter::run() {
+    // by Opcode
+    static void *const kHandlers[] = {
+        &&move,       &&load_int,     &&load_const,  &&load_global,
+        &&store_global, &&addr_global, &&addr_local, &&index,
+        &&load_elem,  &&store_elem,   &&add,         &&sub,
+        &&mul,        &&div,          &&mod,         &&add_imm,
+        &&mul_imm,    &&neg,          &&not_,        &&eq,
+        &&ne,         &&lt,           &&le,          &&gt,
+        &&ge,         &&fadd,         &&fsub,        &&fmul,
+        &&fdiv,       &&fneg,         &&feq,         &&fne,
+        &&flt,        &&fle,          &&fgt,         &&fge,
+        &&int_to_real, &&concat,      &&jump,        &&jump_if_zero,
+        &&jump_if_non_zero, &&call,   &&ret,         &&ret_void,
+        &&print_int,  &&print_real,   &&print_string, &&read_int,
+        &&read_real,  &&read_string,
+    };
+    static_assert(sizeof(kHandlers) / sizeof(kHandlers[0]) ==
+                      static_cast<size_t>(Opcode::kNumOpcodes),
+                  "a handler for every opcode");
+
+    const Instruction *const code = m_program.code.data();
+    const Value *const constants = m_program.constants.data();
+    const Function *const functions = m_program.functions.data();
+    Value *const globals = m_globals.data();
+    Value *const stack_end = m_stack.data() + m_stack.size();
+
+    const Function &main = functions[m_program.main];
+    if (main.frame_size > m_stack.size()) {
+        fprintf(stderr, "runtime error: stack overflow in main\n");
+        return 1;
+    }
+    Value *fp = m_stack.data();
+    uint32_t frame_size = main.frame_size;
+    const Instruction *ip = code + main.entry;
+    Value result;
+
+#define DISPATCH() goto *kHandlers[static_cast<size_t>(ip->opcode)]
+#define NEXT()                                                                 \
+    do {                                                                       \
+        ++ip;                                                                  \
+        DISPATCH();                                                            \
+    } while (0)
+#define A fp[ip->a]
+#define B fp[ip->b]
+#define C fp[ip->c]
+
+    DISPATCH();
+
+move:
+    A = B;
+    NEXT();
+load_int:
+    A.integer = ip->imm();
+    NEXT();
+load_const:
+    A = constants[ip->imm()];
+    NEXT();
+load_global:
+    A = globals[ip->imm()];
+    NEXT();
+store_global:
+    globals[ip->imm()] = A;
+    NEXT();
+addr_global:
+    A.address = globals + ip->imm();
+    NEXT();
+addr_local:
+    A.address = fp + ip->imm();
+    NEXT();
+index:
+    A.address = B.address + C.integer;
+    NEXT();
+load_elem:
+    A = B.address[C.integer];
+    NEXT();
+store_elem:
+    B.address[C.integer] = A;
+    NEXT();
+
+add:
+    A.integer = wrap(static_cast<uint32_t>(B.integer) + C.integer);
+    NEXT();
+sub:
+    A.integer = wrap(static_cast<uint32_t>(B.integer) - C.integer);
+    NEXT();
+mul:
+    A.integer = wrap(static_cast<uint32_t>(B.integer) * C.integer);
+    NEXT();
+div:
+    A.integer = divide(B.integer, C.integer);
+    NEXT();
+mod:
+    A.integer = remainder(B.integer, C.integer);
+    NEXT();
+add_imm:
+    A.integer = wrap(static_cast<uint32_t>(B.integer) + ip->simm());
+    NEXT();
+mul_imm:
+    A.integer = wrap(static_cast<uint32_t>(B.integer) * ip->simm());
+    NEXT();
+neg:
+    A.integer = wrap(-static_cast<uint32_t>(B.integer));
+    NEXT();
+not_:
+    A.integer = !B.integer;
+    NEXT();
+eq:
+    A.integer = B.integer == C.integer;
+    NEXT();
+ne:
+    A.integer = B.integer != C.integer;
+    NEXT();
+lt:
+    A.integer = B.integer < C.integer;
+    NEXT();
+le:
+    A.integer = B.integer <= C.integer;
+    NEXT();
+gt:
+    A.integer = B.integer > C.integer;
+    NEXT();
+ge:
+    A.integer = B.integer >= C.integer;
+    NEXT();
+
+fadd:
+    A.real = B.real + C.real;
+    NEXT();
+fsub:
+    A.real = B.real - C.real;
+    NEXT();
+fmul:
+    A.real = B.real * C.real;
+    NEXT();
+fdiv:
+    A.real = B.real / C.real;
+    NEXT();
+fneg:
+    A.real = -B.real;
+    NEXT();
+feq:
+    A.integer = B.real == C.real;
+    NEXT();
+fne:
+    A.integer = B.real != C.real;
+    NEXT();
+flt:
+    A.integer = B.real < C.real;
+    NEXT();
+fle:
+    A.integer = B.real <= C.real;
+    NEXT();
+fgt:
+    A.integer = B.real > C.real;
+    NEXT();
+fge:
+    A.integer = B.real >= C.real;
+    NEXT();
+int_to_real:
+    A.real = B.integer;
+    NEXT();
+
+concat:
+    m_strings.push_back(std::string(B.string ? B.string : "") +
+                        (C.string ? C.string : ""));
+    A.string = m_strings.back().c_str();
+    NEXT();
+
+jump:
+    ip = code + ip->imm();
+    DISPATCH();
+jump_if_zero:
+    ip = A.integer == 0 ? code + ip->imm() : ip + 1;
+    DISPATCH();
+jump_if_non_zero:
+    ip = A.integer != 0 ? code + ip->imm() : ip + 1;
+    DISPATCH();
+
+call: {
+    const Function &callee = functions[ip->b];
+    Value *const frame = fp + frame_size;
+    if (callee.frame_size > static_cast<size_t>(stack_end - frame) ||
+        m_calls.size() == kMaxCallDepth) {
+        m_io.flush();
+        fprintf(stderr, "runtime error: stack overflow in %s\n",
+                callee.name.c_str());
+        return 1;
+    }
+    m_calls.push_back({ip + 1, fp, frame_size, ip->a});
+    std::memcpy(frame, fp + ip->c, callee.num_params * sizeof(Value));
+    std::memset(frame + callee.num_params, 0,
+                (callee.frame_size - callee.num_params) * sizeof(Value));
+    fp = frame;
+    frame_size = callee.frame_size;
+    ip = code + callee.entry;
+    DISPATCH();
+}
+ret:
+    result = A;
+    if (m_calls.empty()) {
+        return 0;
+    }
+    fp = m_calls.back().frame;
+    frame_size = m_calls.back().frame_size;
+    ip = m_calls.back().return_address;
+    fp[m_calls.back().result] = result;
+    m_calls.pop_back();
+    DISPATCH();
+ret_void:
+    if (m_calls.empty()) {
+        return 0;
+    }
+    fp = m_calls.back().frame;
+    frame_size = m_calls.back().frame_size;
+    ip = m_calls.back().return_address;
+    m_calls.pop_back();
+    DISPATCH();
+
+print_int:
+    m_io.printInt(A.integer);
+    NEXT();
+print_real:
+    m_io.printReal(A.real);
+    NEXT();
+print_string:
+    m_io.printString(A.string);
+    NEXT();
+read_int:
+    A.integer = m_io.readInt();
+    NEXT();
+read_real:
+    A.real = m_io.readReal();
+    NEXT();
+read_string:
+    m_strings.push_back(m_io.readString());
+    A.string = m_strings.back().c_str();
+    NEXT();
+
+#undef C
+#undef B
+#undef A
+#undef NEXT
+#undef DISPATCH
+}
+
+} // namespace vm
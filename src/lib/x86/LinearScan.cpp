@@ -0,0 +1,513 @@
+#include "x86/LinearScan.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace x86 {
+
+using vm::Opcode;
+
+static const char *const kRegNames[][3] = {
+    {"%rax", "%eax", "%al"},    {"%rcx", "%ecx", "%cl"},
+    {"%rdx", "%edx", "%dl"},    {"%rbx", "%ebx", "%bl"},
+    {"%rsi", "%esi", "%sil"},   {"%rdi", "%edi", "%dil"},
+    {"%r8", "%r8d", "%r8b"},    {"%r9", "%r9d", "%r9b"},
+    {"%r10", "%r10d", "%r10b"}, {"%r11", "%r11d", "%r11b"},
+    {"%r12", "%r12d", "%r12b"}, {"%r13", "%r13d", "%r13b"},
+    {"%r14", "%r14d", "%r14b"}, {"%r15", "%r15d", "%r15b"},
+};
+
+// in the order they are handed out
+static const Reg kCalleeSaved[] = {Reg::kRbx, Reg::kR12, Reg::kR13, Reg::kR14,
+                                   Reg::kR15};
+static const Reg kCallerSaved[] = {Reg::kR10, Reg::kR11, Reg::kR9,
+                                   Reg::kR8,  Reg::kRsi, Reg::kRdi};
+
+const Reg kIntArgRegs[kNumIntArgRegs] = {Reg::kRdi, Reg::kRsi, Reg::kRdx,
+                                         Reg::kRcx, Reg::kR8,  Reg::kR9};
+
+const char *getRegName(const Reg p_reg, const unsigned p_bits) {
+    return kRegNames[static_cast<size_t>(p_reg)][p_bits == 64   ? 0
+                                                 : p_bits == 32 ? 1
+                                                                : 2];
+}
+
+ArgLocations::ArgLocations(const vm::Function &p_function) {
+    size_t num_ints = 0;
+    size_t num_reals = 0;
+    for (uint16_t i = 0; i < p_function.num_params; ++i) {
+        const bool real = p_function.real_params[i];
+        size_t &num = real ? num_reals : num_ints;
+        if (num < (real ? kNumRealArgRegs : kNumIntArgRegs)) {
+            slots.push_back(num++);
+            on_stack.push_back(false);
+        } else {
+            slots.push_back(num_stack++);
+            on_stack.push_back(true);
+        }
+    }
+}
+
+void getRegisterOperands(const vm::Program &p_program,
+                         const vm::Instruction &p_instr,
+                         std::vector<uint16_t> &p_regs) {
+    p_regs.clear();
+    switch (p_instr.opcode) {
+    case Opcode::kJump:
+    case Opcode::kRetVoid:
+        break;
+    case Opcode::kLoadInt:
+    case Opcode::kLoadConst:
+    case Opcode::kLoadGlobal:
+    case Opcode::kStoreGlobal:
+    case Opcode::kAddrGlobal:
+    case Opcode::kAddrLocal:
+    case Opcode::kJumpIfZero:
+    case Opcode::kJumpIfNonZero:
+    case Opcode::kRet:
+    case Opcode::kPrintInt:
+    case Opcode::kPrintReal:
+    case Opcode::kPrintString:
+    case Opcode::kReadInt:
+    case Opcode::kReadReal:
+    case Opcode::kReadString:
+        p_regs.push_back(p_instr.a);
+        break;
+    case Opcode::kMove:
+    case Opcode::kAddImm:
+    case Opcode::kMulImm:
+    case Opcode::kNeg:
+    case Opcode::kNot:
+    case Opcode::kFNeg:
+    case Opcode::kIntToReal:
+        p_regs.push_back(p_instr.a);
+        p_regs.push_back(p_instr.b);
+        break;
+    case Opcode::kCall:
+        p_regs.push_back(p_instr.a);
+        for (uint16_t i = 0; i < p_program.functions[p_instr.b].num_params;
+             ++i) {
+            p_regs.push_back(p_instr.c + i);
+        }
+        break;
+    default:
+        p_regs.push_back(p_instr.a);
+        p_regs.push_back(p_instr.b);
+        p_regs.push_back(p_instr.c);
+        break;
+    }
+}
+
+bool isCall(const vm::Instruction &p_instr) {
+    switch (p_instr.opcode) {
+    case Opcode::kCall:
+    case Opcode::kConcat:
+    case Opcode::kPrintInt:
+    case Opcode::kPrintReal:
+    case Opcode::kPrintString:
+    case Opcode::kReadInt:
+    case Opcode::kReadReal:
+    case Opcode::kReadString:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool writesA(const vm::Instruction &p_instr) {
+    switch (p_instr.opcode) {
+    case Opcode::kStoreGlobal:
+    case Opcode::kStoreElem:
+    case Opcode::kJump:
+    case Opcode::kJumpIfZero:
+    case Opcode::kJumpIfNonZero:
+    case Opcode::kRet:
+    case Opcode::kRetVoid:
+    case Opcode::kPrintInt:
+    case Opcode::kPrintReal:
+    case Opcode::kPrintString:
+        return false;
+    default:
+        return true;
+    }
+}
+
+static size_t getEnd(const vm::Program &p_program, const size_t p_function) {
+    return p_function + 1 < p_program.functions.size()
+               ? p_program.functions[p_function + 1].entry
+               : p_program.code.size();
+}
+
+// appends the instructions p_instr at p_pc may go on to
+static void getSuccessors(const vm::Instruction &p_instr, const size_t p_pc,
+                          const size_t p_end, std::vector<size_t> &p_succs) {
+    p_succs.clear();
+    switch (p_instr.opcode) {
+    case Opcode::kRet:
+    case Opcode::kRetVoid:
+        return;
+    case Opcode::kJump:
+        p_succs.push_back(p_instr.imm());
+        return;
+    case Opcode::kJumpIfZero:
+    case Opcode::kJumpIfNonZero:
+        p_succs.push_back(p_instr.imm());
+        break;
+    default:
+        break;
+    }
+    if (p_pc + 1 < p_end) {
+        p_succs.push_back(p_pc + 1);
+    }
+}
+
+constexpr uint32_t LinearScan::kNoFrameSlot;
+
+LinearScan::LinearScan(const vm::Program &p_program, const size_t p_function)
+    : m_program(p_program), m_function(p_program.functions[p_function]),
+      m_begin(m_function.entry), m_end(getEnd(p_program, p_function)),
+      m_segments(m_function.num_registers),
+      m_frame_slots(m_function.num_registers, kNoFrameSlot) {}
+
+Reg LinearScan::getLocation(const uint16_t p_reg, const size_t p_pc) const {
+    const std::vector<Segment> &segments = m_segments[p_reg];
+    const size_t pc = p_pc - m_begin;
+    auto it = std::upper_bound(
+        segments.begin(), segments.end(), pc,
+        [](const size_t p_pc, const Segment &p_segment) {
+            return p_pc < p_segment.start;
+        });
+    if (it == segments.begin() || (--it)->end < pc) {
+        return Reg::kNone;
+    }
+    return m_locations[it->group];
+}
+
+void LinearScan::computeReachability() {
+    m_reachable.assign(m_end - m_begin, false);
+    std::vector<size_t> worklist;
+    if (m_end > m_begin) {
+        m_reachable[0] = true;
+        worklist.push_back(m_begin);
+    }
+    std::vector<size_t> succs;
+    while (!worklist.empty()) {
+        const size_t pc = worklist.back();
+        worklist.pop_back();
+        getSuccessors(m_program.code[pc], pc, m_end, succs);
+        for (const size_t succ : succs) {
+            if (!m_reachable[succ - m_begin]) {
+                m_reachable[succ - m_begin] = true;
+                worklist.push_back(succ);
+            }
+        }
+    }
+}
+
+void LinearScan::computeLiveness() {
+    const size_t size = m_end - m_begin;
+    const size_t num_regs = m_function.num_registers;
+    std::vector<std::vector<bool>> live_in(size, std::vector<bool>(num_regs));
+    m_live_out.assign(size, std::vector<bool>(num_regs));
+    std::vector<uint16_t> regs;
+    std::vector<size_t> succs;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = size; i-- > 0;) {
+            if (!m_reachable[i]) {
+                continue;
+            }
+            const vm::Instruction &instr = m_program.code[m_begin + i];
+            std::vector<bool> live(num_regs);
+            getSuccessors(instr, m_begin + i, m_end, succs);
+            for (const size_t succ : succs) {
+                const std::vector<bool> &succ_in = live_in[succ - m_begin];
+                for (size_t reg = 0; reg < num_regs; ++reg) {
+                    if (succ_in[reg]) {
+                        live[reg] = true;
+                    }
+                }
+            }
+            m_live_out[i] = live;
+            getRegisterOperands(m_program, instr, regs);
+            const size_t num_defs = writesA(instr) ? 1 : 0;
+            for (size_t j = 0; j < num_defs; ++j) {
+                live[regs[j]] = false;
+            }
+            for (size_t j = num_defs; j < regs.size(); ++j) {
+                live[regs[j]] = true;
+            }
+            if (live != live_in[i]) {
+                live_in[i] = std::move(live);
+                changed = true;
+            }
+        }
+    }
+    for (uint16_t reg = m_function.num_params; size && reg < num_regs;
+         ++reg) {
+        if (live_in[0][reg]) {
+            m_uninitialized.push_back(reg);
+        }
+    }
+}
+
+std::vector<LinearScan::Interval> LinearScan::buildIntervals() {
+    const size_t size = m_end - m_begin;
+    const size_t num_regs = m_function.num_registers;
+
+    // where each register is mentioned or holds a value still needed
+    std::vector<std::vector<bool>> occupied(num_regs,
+                                            std::vector<bool>(size));
+    std::vector<uint16_t> regs;
+    for (size_t i = 0; i < size; ++i) {
+        if (!m_reachable[i]) {
+            continue;
+        }
+        getRegisterOperands(m_program, m_program.code[m_begin + i], regs);
+        for (const uint16_t reg : regs) {
+            occupied[reg][i] = true;
+        }
+        for (size_t reg = 0; reg < num_regs; ++reg) {
+            if (m_live_out[i][reg]) {
+                occupied[reg][i] = true;
+            }
+        }
+    }
+    // the parameters arrive before the first instruction
+    for (uint16_t reg = 0; size && reg < m_function.num_params; ++reg) {
+        occupied[reg][0] = true;
+    }
+
+    std::vector<size_t> parents;
+    auto find = [&parents](size_t p_group) {
+        while (parents[p_group] != p_group) {
+            p_group = parents[p_group] = parents[parents[p_group]];
+        }
+        return p_group;
+    };
+    for (size_t reg = 0; reg < num_regs; ++reg) {
+        for (size_t i = 0; i < size; ++i) {
+            if (!occupied[reg][i]) {
+                continue;
+            }
+            if (i == 0 || !occupied[reg][i - 1]) {
+                m_segments[reg].push_back({i, i, parents.size()});
+                parents.push_back(parents.size());
+            }
+            m_segments[reg].back().end = i;
+        }
+    }
+    // a jump carries what is live across it to the target
+    auto segment_at = [this](const size_t p_reg, const size_t p_pc) {
+        for (const Segment &segment : m_segments[p_reg]) {
+            if (segment.start <= p_pc && p_pc <= segment.end) {
+                return segment.group;
+            }
+        }
+        assert(false && "not occupied");
+        return size_t{0};
+    };
+    for (size_t i = 0; i < size; ++i) {
+        const vm::Instruction &instr = m_program.code[m_begin + i];
+        if (!m_reachable[i]) {
+            continue;
+        }
+        if (instr.opcode != Opcode::kJump &&
+            instr.opcode != Opcode::kJumpIfZero &&
+            instr.opcode != Opcode::kJumpIfNonZero) {
+            continue;
+        }
+        const size_t target = instr.imm() - m_begin;
+        for (size_t reg = 0; reg < num_regs; ++reg) {
+            if (m_live_out[i][reg] && occupied[reg][target]) {
+                parents[find(segment_at(reg, i))] =
+                    find(segment_at(reg, target));
+            }
+        }
+    }
+
+    std::vector<size_t> groups(parents.size(), parents.size());
+    std::vector<Interval> intervals;
+    for (uint16_t reg = 0; reg < num_regs; ++reg) {
+        for (Segment &segment : m_segments[reg]) {
+            const size_t root = find(segment.group);
+            if (groups[root] == parents.size()) {
+                groups[root] = intervals.size();
+                intervals.push_back({intervals.size(), reg, segment.start,
+                                     segment.end, false});
+            }
+            segment.group = groups[root];
+            Interval &interval = intervals[segment.group];
+            interval.start = std::min(interval.start, segment.start);
+            interval.end = std::max(interval.end, segment.end);
+        }
+    }
+
+    std::vector<size_t> calls_before(size + 1, 0);
+    for (size_t i = 0; i < size; ++i) {
+        calls_before[i + 1] =
+            calls_before[i] + isCall(m_program.code[m_begin + i]);
+    }
+    for (Interval &interval : intervals) {
+        // a call using it or defining it doesn't count, but the parameters
+        // and the registers zeroed in the prologue are defined before the
+        // first instruction, so a call there does
+        const bool live_on_entry =
+            interval.start == 0 &&
+            (interval.reg < m_function.num_params ||
+             std::find(m_uninitialized.begin(), m_uninitialized.end(),
+                       interval.reg) != m_uninitialized.end());
+        const size_t first = live_on_entry ? 0 : interval.start + 1;
+        interval.spans_call =
+            interval.end > first &&
+            calls_before[interval.end] - calls_before[first] > 0;
+    }
+    std::stable_sort(intervals.begin(), intervals.end(),
+                     [](const Interval &p_lhs, const Interval &p_rhs) {
+                         return p_lhs.start < p_rhs.start;
+                     });
+    return intervals;
+}
+
+bool LinearScan::canHold(const Interval &p_interval, const Reg p_reg) const {
+    if (p_reg == Reg::kR10 || p_reg == Reg::kR11 ||
+        std::find(std::begin(kCalleeSaved), std::end(kCalleeSaved), p_reg) !=
+            std::end(kCalleeSaved)) {
+        return true;
+    }
+    const uint16_t reg = p_interval.reg;
+    if (p_interval.start == 0) {
+        // rep stosq zeroes the arrays through rdi
+        if (p_reg == Reg::kRdi &&
+            m_function.frame_size > m_function.num_registers) {
+            return false;
+        }
+        // the parameters are stored in order, the ones after this one
+        // still in the registers they came in
+        const ArgLocations params(m_function);
+        for (uint16_t param = reg + 1;
+             reg < m_function.num_params && param < m_function.num_params;
+             ++param) {
+            if (params.arrivesIn(m_function, param, p_reg)) {
+                return false;
+            }
+        }
+    }
+    for (size_t i = p_interval.start; i <= p_interval.end; ++i) {
+        const vm::Instruction &instr = m_program.code[m_begin + i];
+        if (instr.opcode == Opcode::kConcat && instr.c == reg &&
+            p_reg == Reg::kRdi) {
+            // b goes to rdi before c is read
+            return false;
+        }
+        if (instr.opcode != Opcode::kCall) {
+            continue;
+        }
+        const vm::Function &callee = m_program.functions[instr.b];
+        if (reg < instr.c || reg >= instr.c + callee.num_params) {
+            continue;
+        }
+        // the arguments are moved in order, so those before this one must
+        // not overwrite it; the ones on the stack are pushed first
+        const ArgLocations args(callee);
+        for (uint16_t param = 0; !args.on_stack[reg - instr.c] &&
+                                 param < reg - instr.c;
+             ++param) {
+            if (args.arrivesIn(callee, param, p_reg)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void LinearScan::assignFrameSlots() {
+    for (uint16_t reg = 0; reg < m_function.num_registers; ++reg) {
+        for (const Segment &segment : m_segments[reg]) {
+            if (m_locations[segment.group] == Reg::kNone) {
+                m_frame_slots[reg] = m_num_frame_slots++;
+                break;
+            }
+        }
+    }
+}
+
+void LinearScan::run() {
+    std::vector<Interval> active;
+    std::vector<Reg> free_callee_saved(std::begin(kCalleeSaved),
+                                       std::end(kCalleeSaved));
+    std::vector<Reg> free_caller_saved(std::begin(kCallerSaved),
+                                       std::end(kCallerSaved));
+    auto is_callee_saved = [](const Reg p_reg) {
+        return std::find(std::begin(kCalleeSaved), std::end(kCalleeSaved),
+                         p_reg) != std::end(kCalleeSaved);
+    };
+    auto release = [&](const Reg p_reg) {
+        (is_callee_saved(p_reg) ? free_callee_saved : free_caller_saved)
+            .push_back(p_reg);
+    };
+    // first handed out, first taken again, kNone if none fits
+    auto take = [&](std::vector<Reg> &p_free, const Interval &p_interval) {
+        for (auto it = p_free.begin(); it != p_free.end(); ++it) {
+            if (canHold(p_interval, *it)) {
+                const Reg reg = *it;
+                p_free.erase(it);
+                return reg;
+            }
+        }
+        return Reg::kNone;
+    };
+
+    computeReachability();
+    computeLiveness();
+    const std::vector<Interval> intervals = buildIntervals();
+    m_locations.assign(intervals.size(), Reg::kNone);
+    for (const Interval &interval : intervals) {
+        for (auto it = active.begin(); it != active.end();) {
+            if (it->end < interval.start) {
+                release(m_locations[it->group]);
+                it = active.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        Reg reg = Reg::kNone;
+        if (!interval.spans_call) {
+            reg = take(free_caller_saved, interval);
+        }
+        if (reg == Reg::kNone) {
+            reg = take(free_callee_saved, interval);
+        }
+        if (reg == Reg::kNone) {
+            // the one ending last gives up its register, if it fits
+            auto victim = active.end();
+            for (auto it = active.begin(); it != active.end(); ++it) {
+                const Reg victim_reg = m_locations[it->group];
+                if ((interval.spans_call ? is_callee_saved(victim_reg)
+                                         : canHold(interval, victim_reg)) &&
+                    (victim == active.end() || it->end > victim->end)) {
+                    victim = it;
+                }
+            }
+            if (victim == active.end() || victim->end <= interval.end) {
+                ++m_num_spilled;
+                continue;
+            }
+            reg = m_locations[victim->group];
+            m_locations[victim->group] = Reg::kNone;
+            active.erase(victim);
+            ++m_num_spilled;
+        }
+        m_locations[interval.group] = reg;
+        active.push_back(interval);
+        if (is_callee_saved(reg) &&
+            std::find(m_used_callee_saved.begin(), m_used_callee_saved.end(),
+                      reg) == m_used_callee_saved.end()) {
+            m_used_callee_saved.push_back(reg);
+        }
+    }
+    assignFrameSlots();
+}
+
+} // namespace x86
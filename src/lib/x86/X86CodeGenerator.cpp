@@ -0,0 +1,801 @@
+#include "x86/X86CodeGenerator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdarg>
+#include <cstring>
+
+namespace x86 {
+
+using vm::Opcode;
+
+static const char *const kGlobals = "__p_globals";
+
+// in the order of the real parameters
+static const char *const kRealArgRegs[] = {"%xmm0", "%xmm1", "%xmm2",
+                                           "%xmm3", "%xmm4", "%xmm5",
+                                           "%xmm6", "%xmm7"};
+
+static size_t getEnd(const vm::Program &p_program, const size_t p_function) {
+    return p_function + 1 < p_program.functions.size()
+               ? p_program.functions[p_function + 1].entry
+               : p_program.code.size();
+}
+
+static const char *getConditionCode(const Opcode p_opcode) {
+    switch (p_opcode) {
+    case Opcode::kEq:
+        return "e";
+    case Opcode::kNe:
+        return "ne";
+    case Opcode::kLt:
+        return "l";
+    case Opcode::kLe:
+        return "le";
+    case Opcode::kGt:
+        return "g";
+    case Opcode::kGe:
+        return "ge";
+    default:
+        assert(false && "not a comparison");
+        return "";
+    }
+}
+
+static const char *negateConditionCode(const Opcode p_opcode) {
+    switch (p_opcode) {
+    case Opcode::kEq:
+        return "ne";
+    case Opcode::kNe:
+        return "e";
+    case Opcode::kLt:
+        return "ge";
+    case Opcode::kLe:
+        return "g";
+    case Opcode::kGt:
+        return "le";
+    case Opcode::kGe:
+        return "l";
+    default:
+        assert(false && "not a comparison");
+        return "";
+    }
+}
+
+static std::string escape(const char *p_string) {
+    std::string escaped;
+    for (const char *c = p_string; *c; ++c) {
+        const unsigned char ch = static_cast<unsigned char>(*c);
+        if (ch == '"' || ch == '\\') {
+            escaped += '\\';
+            escaped += *c;
+        } else if (ch < 0x20 || ch >= 0x7f) {
+            char octal[8];
+            snprintf(octal, sizeof(octal), "\\%03o", ch);
+            escaped += octal;
+        } else {
+            escaped += *c;
+        }
+    }
+    return escaped;
+}
+
+X86CodeGenerator::X86CodeGenerator(const vm::Program &p_program,
+                                   const std::string &p_source_file_name,
+                                   const std::string &p_save_path,
+                                   const bool p_eliminate_tail_calls)
+    : m_program(p_program), m_eliminate_tail_calls(p_eliminate_tail_calls),
+      m_jump_targets(p_program.code.size(), false) {
+    const std::string &real_path = p_save_path.empty() ? "." : p_save_path;
+    auto slash_pos = p_source_file_name.rfind("/");
+    const auto dot_pos = p_source_file_name.rfind(".");
+    if (slash_pos != std::string::npos) {
+        ++slash_pos;
+    } else {
+        slash_pos = 0;
+    }
+    const std::string output_path =
+        real_path + "/" +
+        p_source_file_name.substr(slash_pos, dot_pos - slash_pos) + ".s";
+    m_output_file.reset(fopen(output_path.c_str(), "w"));
+}
+
+void X86CodeGenerator::emit(const char *p_format, ...) {
+    va_list args;
+    va_start(args, p_format);
+    vfprintf(m_output_file.get(), p_format, args);
+    va_end(args);
+}
+
+bool X86CodeGenerator::generate() {
+    if (!m_output_file) {
+        return false;
+    }
+    for (const vm::Instruction &instr : m_program.code) {
+        if (instr.opcode == Opcode::kJump ||
+            instr.opcode == Opcode::kJumpIfZero ||
+            instr.opcode == Opcode::kJumpIfNonZero) {
+            m_jump_targets[instr.imm()] = true;
+        }
+    }
+
+    emit("    .text\n");
+    for (size_t i = 0; i < m_program.functions.size(); ++i) {
+        emitFunction(i);
+    }
+
+    bool has_strings = false;
+    for (size_t i = 0; i < m_program.constants.size(); ++i) {
+        if (!m_program.is_string_constant[i]) {
+            continue;
+        }
+        if (!has_strings) {
+            emit("\n    .section .rodata\n");
+            has_strings = true;
+        }
+        emit(".LC%zu:\n    .string \"%s\"\n", i,
+             escape(m_program.constants[i].string).c_str());
+    }
+    if (m_program.num_globals) {
+        emit("\n    .local %s\n    .comm %s, %u, 8\n", kGlobals, kGlobals,
+             8 * m_program.num_globals);
+    }
+    emit("\n    .section .note.GNU-stack,\"\",@progbits\n");
+    return !ferror(m_output_file.get());
+}
+
+void X86CodeGenerator::emitFunction(const size_t p_index) {
+    const vm::Function &function = m_program.functions[p_index];
+    LinearScan allocation(m_program, p_index);
+    allocation.run();
+    m_allocation = &allocation;
+    m_function = &function;
+    m_function_index = p_index;
+    m_pc = function.entry;
+    m_num_spilled += allocation.getNumSpilled();
+
+    const char *const name =
+        p_index == m_program.main ? "main" : function.name.c_str();
+    emit("\n    .globl %s\n    .type %s, @function\n%s:\n", name, name, name);
+
+    // rbp, the callee-saved registers, then the frame, 16-byte aligned:
+    // the registers spilled and the arrays
+    const std::vector<Reg> &saved = allocation.getUsedCalleeSaved();
+    const uint32_t saved_size = 8 * saved.size();
+    uint32_t frame_size =
+        8 * (allocation.getNumFrameSlots() + function.frame_size -
+             function.num_registers);
+    if ((saved_size + frame_size) % 16) {
+        frame_size += 8;
+    }
+    m_frame_offset = -static_cast<int32_t>(saved_size + frame_size);
+    emit("    pushq %%rbp\n    movq %%rsp, %%rbp\n");
+    for (const Reg reg : saved) {
+        emit("    pushq %s\n", getRegName(reg, 64));
+    }
+    if (frame_size) {
+        emit("    subq $%u, %%rsp\n", frame_size);
+    }
+
+    const ArgLocations args(function);
+    for (uint16_t i = 0; i < function.num_params; ++i) {
+        if (args.on_stack[i]) {
+            const std::string slot =
+                std::to_string(16 + 8 * args.slots[i]) + "(%rbp)";
+            if (inRegister(i)) {
+                store(slot, i, 64);
+            } else {
+                emit("    movq %s, %%rax\n", slot.c_str());
+                store("%rax", i, 64);
+            }
+        } else if (function.real_params[i]) {
+            storeReal(kRealArgRegs[args.slots[i]], i);
+        } else {
+            store(getRegName(kIntArgRegs[args.slots[i]], 64), i, 64);
+        }
+    }
+
+    bool has_tail_calls = false;
+    for (size_t pc = function.entry; pc < getEnd(m_program, p_index); ++pc) {
+        has_tail_calls = has_tail_calls || isSelfTailCall(pc);
+    }
+    if (has_tail_calls) {
+        emit(".Ltail%zu:\n", p_index);
+    }
+
+    // the interpreter starts every frame zeroed
+    for (const uint16_t reg : allocation.getUninitialized()) {
+        if (inRegister(reg)) {
+            emit("    xorl %s, %s\n", home(reg, 32).c_str(),
+                 home(reg, 32).c_str());
+        } else {
+            emit("    movq $0, %s\n", home(reg, 64).c_str());
+        }
+    }
+    if (function.frame_size > function.num_registers) {
+        emit("    leaq %s, %%rdi\n    movl $%u, %%ecx\n"
+             "    xorl %%eax, %%eax\n    rep stosq\n",
+             frameSlot(function.num_registers).c_str(),
+             function.frame_size - function.num_registers);
+    }
+
+    const size_t end = getEnd(m_program, p_index);
+    for (size_t pc = function.entry; pc < end; ++pc) {
+        if (!allocation.isReachable(pc)) {
+            continue;
+        }
+        if (m_jump_targets[pc]) {
+            emit(".L%zu:\n", pc);
+        }
+        m_pc = pc;
+        if (emitInstruction(m_program.code[pc], pc)) {
+            ++pc;
+        }
+    }
+
+    emit(".Lret%zu:\n", p_index);
+    if (saved_size) {
+        emit("    leaq -%u(%%rbp), %%rsp\n", saved_size);
+    } else if (frame_size) {
+        emit("    movq %%rbp, %%rsp\n");
+    }
+    for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+        emit("    popq %s\n", getRegName(*it, 64));
+    }
+    emit("    popq %%rbp\n    ret\n    .size %s, .-%s\n", name, name);
+    m_allocation = nullptr;
+    m_function = nullptr;
+}
+
+bool X86CodeGenerator::inRegister(const uint16_t p_reg) const {
+    // an unused operand, as of ret.void, may name no register at all
+    return p_reg < m_function->num_registers &&
+           m_allocation->getLocation(p_reg, m_pc) != Reg::kNone;
+}
+
+std::string X86CodeGenerator::frameSlot(const uint32_t p_index) const {
+    // the arrays come after the registers that have a slot
+    const uint32_t slot =
+        p_index < m_function->num_registers
+            ? m_allocation->getFrameSlot(p_index)
+            : m_allocation->getNumFrameSlots() + p_index -
+                  m_function->num_registers;
+    assert(slot != LinearScan::kNoFrameSlot && "kept in a register");
+    return std::to_string(m_frame_offset + 8 * static_cast<int32_t>(slot)) +
+           "(%rbp)";
+}
+
+bool X86CodeGenerator::isLastInstruction(const size_t p_pc) const {
+    for (size_t pc = p_pc + 1; pc < getEnd(m_program, m_function_index);
+         ++pc) {
+        if (m_allocation->isReachable(pc)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool X86CodeGenerator::isSelfTailCall(const size_t p_pc) const {
+    if (!m_eliminate_tail_calls || !m_allocation->isReachable(p_pc)) {
+        return false;
+    }
+    const vm::Instruction &instr = m_program.code[p_pc];
+    if (instr.opcode != Opcode::kCall || instr.b != m_function_index ||
+        p_pc + 1 == getEnd(m_program, m_function_index)) {
+        return false;
+    }
+    const vm::Instruction &next = m_program.code[p_pc + 1];
+    return (next.opcode == Opcode::kRet && next.a == instr.a) ||
+           next.opcode == Opcode::kRetVoid;
+}
+
+std::string X86CodeGenerator::home(const uint16_t p_reg,
+                                   const unsigned p_bits) const {
+    const Reg reg = m_allocation->getLocation(p_reg, m_pc);
+    return reg == Reg::kNone ? frameSlot(p_reg) : getRegName(reg, p_bits);
+}
+
+void X86CodeGenerator::load(const uint16_t p_reg, const std::string &p_operand,
+                            const unsigned p_bits) {
+    const std::string from = home(p_reg, p_bits);
+    if (from != p_operand) {
+        emit("    mov%c %s, %s\n", p_bits == 64 ? 'q' : 'l', from.c_str(),
+             p_operand.c_str());
+        ++m_num_instrs;
+    }
+}
+
+void X86CodeGenerator::store(const std::string &p_operand,
+                             const uint16_t p_reg, const unsigned p_bits) {
+    const std::string to = home(p_reg, p_bits);
+    if (to != p_operand) {
+        emit("    mov%c %s, %s\n", p_bits == 64 ? 'q' : 'l', p_operand.c_str(),
+             to.c_str());
+        ++m_num_instrs;
+    }
+}
+
+void X86CodeGenerator::loadReal(const uint16_t p_reg, const char *p_xmm) {
+    emit("    movd %s, %s\n", home(p_reg, 32).c_str(), p_xmm);
+    ++m_num_instrs;
+}
+
+void X86CodeGenerator::storeReal(const char *p_xmm, const uint16_t p_reg) {
+    emit("    movd %s, %s\n", p_xmm, home(p_reg, 32).c_str());
+    ++m_num_instrs;
+}
+
+bool X86CodeGenerator::emitInstruction(const vm::Instruction &p_instr,
+                                       const size_t p_pc) {
+    // counts the instruction written in place below
+    auto op = [this](const char *p_format, auto... p_args) {
+        emit(p_format, p_args...);
+        ++m_num_instrs;
+    };
+    const uint16_t a = p_instr.a;
+    const uint16_t b = p_instr.b;
+    const uint16_t c = p_instr.c;
+    // the register to compute in, then stored to a if it isn't a itself
+    const std::string dst32 = inRegister(a) ? home(a, 32) : "%eax";
+    const std::string dst64 = inRegister(a) ? home(a, 64) : "%rax";
+
+    switch (p_instr.opcode) {
+    case Opcode::kMove:
+        if (inRegister(a) || inRegister(b)) {
+            load(b, home(a, 64), 64);
+        } else {
+            load(b, "%rax", 64);
+            store("%rax", a, 64);
+        }
+        break;
+    case Opcode::kLoadInt:
+        op("    movq $%d, %s\n", p_instr.imm(), home(a, 64).c_str());
+        break;
+    case Opcode::kLoadConst: {
+        const int32_t index = p_instr.imm();
+        if (m_program.is_string_constant[index]) {
+            op("    leaq .LC%d(%%rip), %s\n", index, dst64.c_str());
+            store(dst64, a, 64);
+        } else {
+            uint32_t bits;
+            std::memcpy(&bits, &m_program.constants[index].real,
+                        sizeof(bits));
+            op("    movl $0x%x, %s\n", bits, home(a, 32).c_str());
+        }
+        break;
+    }
+    case Opcode::kLoadGlobal:
+        op("    movq %s+%d(%%rip), %s\n", kGlobals, 8 * p_instr.imm(),
+           dst64.c_str());
+        store(dst64, a, 64);
+        break;
+    case Opcode::kStoreGlobal:
+        if (!inRegister(a)) {
+            load(a, "%rax", 64);
+        }
+        op("    movq %s, %s+%d(%%rip)\n", dst64.c_str(), kGlobals,
+           8 * p_instr.imm());
+        break;
+    case Opcode::kAddrGlobal:
+        op("    leaq %s+%d(%%rip), %s\n", kGlobals, 8 * p_instr.imm(),
+           dst64.c_str());
+        store(dst64, a, 64);
+        break;
+    case Opcode::kAddrLocal:
+        op("    leaq %s, %s\n", frameSlot(p_instr.imm()).c_str(),
+           dst64.c_str());
+        store(dst64, a, 64);
+        break;
+
+    case Opcode::kIndex:
+    case Opcode::kLoadElem:
+    case Opcode::kStoreElem: {
+        std::string base = "%rax";
+        if (inRegister(b)) {
+            base = home(b, 64);
+        } else {
+            load(b, base, 64);
+        }
+        op("    movslq %s, %%rcx\n", home(c, 32).c_str());
+        const std::string element = "(" + base + ",%rcx,8)";
+        if (p_instr.opcode == Opcode::kIndex) {
+            op("    leaq %s, %s\n", element.c_str(), dst64.c_str());
+            store(dst64, a, 64);
+        } else if (p_instr.opcode == Opcode::kLoadElem) {
+            op("    movq %s, %s\n", element.c_str(), dst64.c_str());
+            store(dst64, a, 64);
+        } else {
+            std::string value = "%rdx";
+            if (inRegister(a)) {
+                value = home(a, 64);
+            } else {
+                load(a, value, 64);
+            }
+            op("    movq %s, %s\n", value.c_str(), element.c_str());
+        }
+        break;
+    }
+
+    case Opcode::kAdd:
+        emitBinary("addl", p_instr);
+        break;
+    case Opcode::kSub:
+        emitBinary("subl", p_instr);
+        break;
+    case Opcode::kMul:
+        emitBinary("imull", p_instr);
+        break;
+    case Opcode::kDiv:
+    case Opcode::kMod:
+        emitDivision(p_instr);
+        break;
+    case Opcode::kAddImm:
+        if (inRegister(a) && a == b) {
+            op("    addl $%d, %s\n", p_instr.simm(), dst32.c_str());
+        } else if (inRegister(b)) {
+            op("    leal %d(%s), %s\n", p_instr.simm(), home(b, 64).c_str(),
+               dst32.c_str());
+            store(dst32, a, 32);
+        } else {
+            load(b, "%eax", 32);
+            op("    addl $%d, %%eax\n", p_instr.simm());
+            store("%eax", a, 32);
+        }
+        break;
+    case Opcode::kMulImm:
+        op("    imull $%d, %s, %s\n", p_instr.simm(), home(b, 32).c_str(),
+           dst32.c_str());
+        store(dst32, a, 32);
+        break;
+    case Opcode::kNeg:
+        load(b, dst32, 32);
+        op("    negl %s\n", dst32.c_str());
+        store(dst32, a, 32);
+        break;
+    case Opcode::kNot:
+        op("    cmpl $0, %s\n", home(b, 32).c_str());
+        op("    sete %%al\n");
+        op("    movzbl %%al, %s\n", dst32.c_str());
+        store(dst32, a, 32);
+        break;
+    case Opcode::kEq:
+    case Opcode::kNe:
+    case Opcode::kLt:
+    case Opcode::kLe:
+    case Opcode::kGt:
+    case Opcode::kGe:
+        return emitCompare(p_instr, p_pc);
+
+    case Opcode::kFAdd:
+        emitRealBinary("addss", p_instr);
+        break;
+    case Opcode::kFSub:
+        emitRealBinary("subss", p_instr);
+        break;
+    case Opcode::kFMul:
+        emitRealBinary("mulss", p_instr);
+        break;
+    case Opcode::kFDiv:
+        emitRealBinary("divss", p_instr);
+        break;
+    case Opcode::kFNeg:
+        load(b, dst32, 32);
+        op("    xorl $0x80000000, %s\n", dst32.c_str());
+        store(dst32, a, 32);
+        break;
+    case Opcode::kFEq:
+    case Opcode::kFNe:
+    case Opcode::kFLt:
+    case Opcode::kFLe:
+    case Opcode::kFGt:
+    case Opcode::kFGe:
+        emitRealCompare(p_instr);
+        break;
+    case Opcode::kIntToReal:
+        op("    cvtsi2ssl %s, %%xmm0\n", home(b, 32).c_str());
+        storeReal("%xmm0", a);
+        break;
+
+    case Opcode::kConcat:
+        load(b, "%rdi", 64);
+        load(c, "%rsi", 64);
+        op("    call concatString@PLT\n");
+        store("%rax", a, 64);
+        break;
+
+    case Opcode::kJump:
+        op("    jmp .L%d\n", p_instr.imm());
+        break;
+    case Opcode::kJumpIfZero:
+    case Opcode::kJumpIfNonZero:
+        op("    cmpl $0, %s\n", home(a, 32).c_str());
+        op("    j%s .L%d\n",
+           p_instr.opcode == Opcode::kJumpIfZero ? "e" : "ne", p_instr.imm());
+        break;
+    case Opcode::kCall:
+        if (isSelfTailCall(p_pc)) {
+            emitSelfTailCall(p_instr);
+            // the return can go unless something else jumps to it
+            return !m_jump_targets[p_pc + 1];
+        }
+        emitCall(p_instr);
+        break;
+    case Opcode::kRet:
+        if (m_function->returns_real) {
+            loadReal(a, "%xmm0");
+        } else {
+            load(a, "%rax", 64);
+        }
+        if (!isLastInstruction(p_pc)) {
+            op("    jmp .Lret%zu\n", m_function_index);
+        }
+        break;
+    case Opcode::kRetVoid:
+        // the exit status of main
+        op("    xorl %%eax, %%eax\n");
+        if (!isLastInstruction(p_pc)) {
+            op("    jmp .Lret%zu\n", m_function_index);
+        }
+        break;
+
+    case Opcode::kPrintInt:
+        load(a, "%edi", 32);
+        op("    call printInt@PLT\n");
+        break;
+    case Opcode::kPrintReal:
+        loadReal(a, "%xmm0");
+        op("    call printReal@PLT\n");
+        break;
+    case Opcode::kPrintString:
+        load(a, "%rdi", 64);
+        op("    call printString@PLT\n");
+        break;
+    case Opcode::kReadInt:
+        op("    call readInt@PLT\n");
+        store("%eax", a, 32);
+        break;
+    case Opcode::kReadReal:
+        op("    call readReal@PLT\n");
+        storeReal("%xmm0", a);
+        break;
+    case Opcode::kReadString:
+        op("    call readString@PLT\n");
+        store("%rax", a, 64);
+        break;
+
+    case Opcode::kNumOpcodes:
+        assert(false && "not an opcode");
+        break;
+    }
+    return false;
+}
+
+void X86CodeGenerator::emitBinary(const char *p_mnemonic,
+                                  const vm::Instruction &p_instr) {
+    const uint16_t a = p_instr.a;
+    const uint16_t b = p_instr.b;
+    const uint16_t c = p_instr.c;
+    // a can only be computed in place if writing b to it keeps c
+    const std::string dst = inRegister(a) && a != c ? home(a, 32) : "%eax";
+    load(b, dst, 32);
+    emit("    %s %s, %s\n", p_mnemonic, home(c, 32).c_str(), dst.c_str());
+    ++m_num_instrs;
+    store(dst, a, 32);
+}
+
+bool X86CodeGenerator::emitCompare(const vm::Instruction &p_instr,
+                                   const size_t p_pc) {
+    const uint16_t a = p_instr.a;
+    const uint16_t b = p_instr.b;
+    const uint16_t c = p_instr.c;
+    if (inRegister(b) || inRegister(c)) {
+        emit("    cmpl %s, %s\n", home(c, 32).c_str(), home(b, 32).c_str());
+    } else {
+        load(b, "%eax", 32);
+        emit("    cmpl %s, %%eax\n", home(c, 32).c_str());
+    }
+    ++m_num_instrs;
+
+    // branching on the result right away, and only there, needs no 0 or 1
+    const size_t next = p_pc + 1;
+    if (next < getEnd(m_program, m_function_index) && !m_jump_targets[next]) {
+        const vm::Instruction &jump = m_program.code[next];
+        if ((jump.opcode == Opcode::kJumpIfZero ||
+             jump.opcode == Opcode::kJumpIfNonZero) &&
+            jump.a == a && !m_allocation->isLiveAfter(a, next)) {
+            emit("    j%s .L%d\n",
+                 jump.opcode == Opcode::kJumpIfZero
+                     ? negateConditionCode(p_instr.opcode)
+                     : getConditionCode(p_instr.opcode),
+                 jump.imm());
+            ++m_num_instrs;
+            return true;
+        }
+    }
+    const std::string dst = inRegister(a) ? home(a, 32) : "%eax";
+    emit("    set%s %%al\n    movzbl %%al, %s\n",
+         getConditionCode(p_instr.opcode), dst.c_str());
+    m_num_instrs += 2;
+    store(dst, a, 32);
+    return false;
+}
+
+void X86CodeGenerator::emitRealBinary(const char *p_mnemonic,
+                                      const vm::Instruction &p_instr) {
+    loadReal(p_instr.b, "%xmm0");
+    if (inRegister(p_instr.c)) {
+        loadReal(p_instr.c, "%xmm1");
+        emit("    %s %%xmm1, %%xmm0\n", p_mnemonic);
+    } else {
+        emit("    %s %s, %%xmm0\n", p_mnemonic, home(p_instr.c, 32).c_str());
+    }
+    ++m_num_instrs;
+    storeReal("%xmm0", p_instr.a);
+}
+
+void X86CodeGenerator::emitRealCompare(const vm::Instruction &p_instr) {
+    // ucomiss sets the flags like an unsigned comparison, and the parity
+    // flag if either side is NaN, which compares false to everything
+    loadReal(p_instr.b, "%xmm0");
+    loadReal(p_instr.c, "%xmm1");
+    switch (p_instr.opcode) {
+    case Opcode::kFEq:
+        emit("    ucomiss %%xmm1, %%xmm0\n    sete %%al\n"
+             "    setnp %%cl\n    andb %%cl, %%al\n");
+        m_num_instrs += 4;
+        break;
+    case Opcode::kFNe:
+        emit("    ucomiss %%xmm1, %%xmm0\n    setne %%al\n"
+             "    setp %%cl\n    orb %%cl, %%al\n");
+        m_num_instrs += 4;
+        break;
+    case Opcode::kFLt:
+        emit("    ucomiss %%xmm0, %%xmm1\n    seta %%al\n");
+        m_num_instrs += 2;
+        break;
+    case Opcode::kFLe:
+        emit("    ucomiss %%xmm0, %%xmm1\n    setae %%al\n");
+        m_num_instrs += 2;
+        break;
+    case Opcode::kFGt:
+        emit("    ucomiss %%xmm1, %%xmm0\n    seta %%al\n");
+        m_num_instrs += 2;
+        break;
+    default:
+        emit("    ucomiss %%xmm1, %%xmm0\n    setae %%al\n");
+        m_num_instrs += 2;
+        break;
+    }
+    const std::string dst = inRegister(p_instr.a) ? home(p_instr.a, 32)
+                                                  : "%eax";
+    emit("    movzbl %%al, %s\n", dst.c_str());
+    ++m_num_instrs;
+    store(dst, p_instr.a, 32);
+}
+
+void X86CodeGenerator::emitDivision(const vm::Instruction &p_instr) {
+    const bool mod = p_instr.opcode == Opcode::kMod;
+    const size_t label = m_num_labels++;
+    load(p_instr.b, "%eax", 32);
+    load(p_instr.c, "%ecx", 32);
+    emit("    testl %%ecx, %%ecx\n    je .Ldiv%zu_zero\n"
+         "    cmpl $-1, %%ecx\n    je .Ldiv%zu_minus\n"
+         "    cltd\n    idivl %%ecx\n",
+         label, label);
+    m_num_instrs += 6;
+    if (mod) {
+        emit("    movl %%edx, %%eax\n");
+        ++m_num_instrs;
+    }
+    emit("    jmp .Ldiv%zu_done\n.Ldiv%zu_zero:\n", label, label);
+    ++m_num_instrs;
+    if (!mod) {
+        emit("    movl $-1, %%eax\n");
+        ++m_num_instrs;
+    }
+    emit("    jmp .Ldiv%zu_done\n.Ldiv%zu_minus:\n", label, label);
+    ++m_num_instrs;
+    if (mod) {
+        emit("    xorl %%eax, %%eax\n");
+    } else {
+        emit("    negl %%eax\n");
+    }
+    ++m_num_instrs;
+    emit(".Ldiv%zu_done:\n", label);
+    store("%eax", p_instr.a, 32);
+}
+
+void X86CodeGenerator::emitCall(const vm::Instruction &p_instr) {
+    const vm::Function &callee = m_program.functions[p_instr.b];
+    const ArgLocations args(callee);
+
+    // the stack arguments right to left, keeping rsp 16-byte aligned
+    const size_t stack_size = 8 * (args.num_stack + args.num_stack % 2);
+    if (args.num_stack % 2) {
+        emit("    subq $8, %%rsp\n");
+        ++m_num_instrs;
+    }
+    for (uint16_t i = callee.num_params; i-- > 0;) {
+        if (args.on_stack[i]) {
+            emit("    pushq %s\n", home(p_instr.c + i, 64).c_str());
+            ++m_num_instrs;
+        }
+    }
+    for (uint16_t i = 0; i < callee.num_params; ++i) {
+        if (args.on_stack[i]) {
+            continue;
+        }
+        if (callee.real_params[i]) {
+            loadReal(p_instr.c + i, kRealArgRegs[args.slots[i]]);
+        } else {
+            load(p_instr.c + i, getRegName(kIntArgRegs[args.slots[i]], 64),
+                 64);
+        }
+    }
+    emit("    call %s\n", callee.name.c_str());
+    ++m_num_instrs;
+    if (stack_size) {
+        emit("    addq $%zu, %%rsp\n", stack_size);
+        ++m_num_instrs;
+    }
+    if (callee.returns_real) {
+        storeReal("%xmm0", p_instr.a);
+    } else {
+        store("%rax", p_instr.a, 64);
+    }
+}
+
+void X86CodeGenerator::emitMove(const std::string &p_dst,
+                                const std::string &p_src) {
+    if (p_dst.find('(') != std::string::npos &&
+        p_src.find('(') != std::string::npos) {
+        emit("    movq %s, %%rcx\n    movq %%rcx, %s\n", p_src.c_str(),
+             p_dst.c_str());
+        m_num_instrs += 2;
+    } else {
+        emit("    movq %s, %s\n", p_src.c_str(), p_dst.c_str());
+        ++m_num_instrs;
+    }
+}
+
+void X86CodeGenerator::emitSelfTailCall(const vm::Instruction &p_instr) {
+    // the arguments become the parameters where the body expects them, all
+    // at once since a parameter may be where an argument still is
+    std::vector<std::pair<std::string, std::string>> moves;
+    for (uint16_t i = 0; i < m_function->num_params; ++i) {
+        const std::string src = home(p_instr.c + i, 64);
+        const size_t pc = m_pc;
+        m_pc = m_function->entry;
+        const std::string dst = home(i, 64);
+        m_pc = pc;
+        if (dst != src) {
+            moves.emplace_back(dst, src);
+        }
+    }
+    while (!moves.empty()) {
+        bool moved = false;
+        for (auto it = moves.begin(); it != moves.end();) {
+            const std::string &dst = it->first;
+            if (std::any_of(moves.begin(), moves.end(),
+                            [&dst](const std::pair<std::string, std::string>
+                                       &p_move) {
+                                return p_move.second == dst;
+                            })) {
+                ++it;
+                continue;
+            }
+            emitMove(it->first, it->second);
+            it = moves.erase(it);
+            moved = true;
+        }
+        if (!moved) {
+            // the rest are cycles, one of them is broken through rax
+            emitMove("%rax", moves.front().second);
+            moves.front().second = "%rax";
+        }
+    }
+    emit("    jmp .Ltail%zu\n", m_function_index);
+    ++m_num_instrs;
+}
+
+} // namespace x86
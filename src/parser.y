@@ -21,6 +21,12 @@
 
 #include "sema/SemanticAnalyzer.hpp"
 #include "codegen/CodeGenerator.hpp"
+#include "codegen/MachineModel.hpp"
+#include "opt/ConstantFolder.hpp"
+#include "vm/BytecodeGenerator.hpp"
+#include "vm/HostIO.hpp"
+#include "vm/Interpreter.hpp"
+#include "x86/X86CodeGenerator.hpp"
 
 #include "AST/constant.hpp"
 #include "AST/operator.hpp"
@@ -754,7 +760,154 @@ void yyerror(const char *msg) {
 
 int main(int argc, const char *argv[]) {
     if (argc < 2) {
-        fprintf(stderr, "Usage: ./compiler <filename> --save-path [save path]\n");
+        fprintf(stderr, "Usage: ./compiler <filename> [--dump-ast] [--dump-ir] "
+                        "[--regalloc=linear-scan|sethi-ullman|stack] [--peephole-window=N] "
+                        "[--no-fold] [--inline-threshold=N] [--opt-remarks] "
+                        "[--no-sccp] [--no-tail-calls] [--no-gvn] [--no-licm] "
+                        "[--no-dce] [--unroll=N] [--full-unroll=N] "
+                        "[-march=rv32gc|rv32gcv] [-mtune=%s] [--no-schedule] "
+                        "[--rvc] [--profile-generate[=FILE]] "
+                        "[--profile-use=FILE] [--emit=asm,obj] [--stats] "
+                        "[--run] [--dump-bytecode] "
+                        "[--target=riscv32|x86_64-linux] "
+                        "--save-path [save path]\n",
+                getMachineModelNames().c_str());
+        exit(-1);
+    }
+
+    bool dump_ast = false;
+    bool fold_constants = true;
+    bool run_program = false;
+    bool dump_bytecode = false;
+    bool target_x86_64 = false;
+    const char *save_path = "";
+    CodeGenOptions codegen_options;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--dump-ast") == 0) {
+            dump_ast = true;
+        } else if (strcmp(argv[i], "--dump-ir") == 0) {
+            codegen_options.dump_ir = true;
+        } else if ((strcmp(argv[i], "--save-path") == 0 ||
+                    strcmp(argv[i], "--save_path") == 0) && i + 1 < argc) {
+            save_path = argv[++i];
+        } else if (strcmp(argv[i], "--regalloc=linear-scan") == 0) {
+            codegen_options.regalloc = RegAllocKind::kLinearScan;
+        } else if (strcmp(argv[i], "--regalloc=sethi-ullman") == 0) {
+            codegen_options.regalloc = RegAllocKind::kSethiUllman;
+        } else if (strcmp(argv[i], "--regalloc=stack") == 0) {
+            codegen_options.regalloc = RegAllocKind::kStackMachine;
+        } else if (strncmp(argv[i], "--peephole-window=", 18) == 0) {
+            codegen_options.peephole_window = strtoul(argv[i] + 18, NULL, 10);
+        } else if (strcmp(argv[i], "--no-fold") == 0) {
+            fold_constants = false;
+        } else if (strncmp(argv[i], "--inline-threshold=", 19) == 0) {
+            codegen_options.inline_threshold = strtoul(argv[i] + 19, NULL, 10);
+        } else if (strcmp(argv[i], "--opt-remarks") == 0) {
+            codegen_options.opt_remarks = true;
+        } else if (strcmp(argv[i], "--no-sccp") == 0) {
+            codegen_options.propagate_constants = false;
+        } else if (strcmp(argv[i], "--no-tail-calls") == 0) {
+            codegen_options.eliminate_tail_calls = false;
+        } else if (strcmp(argv[i], "--no-gvn") == 0) {
+            codegen_options.number_values = false;
+        } else if (strcmp(argv[i], "--no-licm") == 0) {
+            codegen_options.hoist_invariants = false;
+        } else if (strcmp(argv[i], "--no-dce") == 0) {
+            codegen_options.eliminate_dead_code = false;
+        } else if (strncmp(argv[i], "--unroll=", 9) == 0) {
+            codegen_options.unroll_factor = strtoul(argv[i] + 9, NULL, 10);
+        } else if (strncmp(argv[i], "--full-unroll=", 14) == 0) {
+            codegen_options.max_full_unroll = strtoul(argv[i] + 14, NULL, 10);
+        } else if (strncmp(argv[i], "-march=", 7) == 0) {
+            const char *arch = argv[i] + 7;
+            if (strncmp(arch, "rv32", 4) != 0 || arch[4] == '\0' ||
+                !strchr("ieg", arch[4])) {
+                fprintf(stderr, "Unknown -march: %s (expected rv32 and the "
+                                "extensions, e.g. rv32gcv)\n", arch);
+                exit(-1);
+            }
+            // the single-letter extensions come before any named one
+            const size_t num_letters = strcspn(arch + 4, "_");
+            codegen_options.vectorize_loops =
+                memchr(arch + 4, 'v', num_letters) != NULL;
+        } else if (strncmp(argv[i], "-mtune=", 7) == 0) {
+            codegen_options.tune = argv[i] + 7;
+            if (!lookupMachineModel(codegen_options.tune)) {
+                fprintf(stderr, "Unknown -mtune model: %s (expected %s)\n",
+                        argv[i] + 7, getMachineModelNames().c_str());
+                exit(-1);
+            }
+        } else if (strcmp(argv[i], "--no-schedule") == 0) {
+            codegen_options.schedule_instrs = false;
+        } else if (strcmp(argv[i], "--rvc") == 0) {
+            codegen_options.compress_instrs = true;
+        } else if (strcmp(argv[i], "--profile-generate") == 0) {
+            // the source with .profile instead of .p
+            const char *source = argv[1];
+            const char *dot = strrchr(source, '.');
+            const char *slash = strrchr(source, '/');
+            const size_t length = dot && (!slash || dot > slash)
+                                      ? dot - source
+                                      : strlen(source);
+            codegen_options.profile_generate =
+                std::string(source, length) + ".profile";
+        } else if (strncmp(argv[i], "--profile-generate=", 19) == 0) {
+            codegen_options.profile_generate = argv[i] + 19;
+        } else if (strncmp(argv[i], "--profile-use=", 14) == 0) {
+            codegen_options.profile_use = argv[i] + 14;
+        } else if (strncmp(argv[i], "--emit=", 7) == 0) {
+            codegen_options.emit_assembly = false;
+            codegen_options.emit_object = false;
+            for (const char *kind = argv[i] + 7; *kind != '\0';) {
+                const size_t length = strcspn(kind, ",");
+                if (length == 3 && strncmp(kind, "asm", 3) == 0) {
+                    codegen_options.emit_assembly = true;
+                } else if (length == 3 && strncmp(kind, "obj", 3) == 0) {
+                    codegen_options.emit_object = true;
+                } else {
+                    fprintf(stderr, "Unknown --emit kind: %.*s (expected asm "
+                                    "or obj)\n", static_cast<int>(length), kind);
+                    exit(-1);
+                }
+                kind += length + (kind[length] == ',');
+            }
+            if (!codegen_options.emit_assembly &&
+                !codegen_options.emit_object) {
+                fprintf(stderr, "--emit needs asm, obj or both\n");
+                exit(-1);
+            }
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            codegen_options.print_stats = true;
+        } else if (strcmp(argv[i], "--run") == 0) {
+            run_program = true;
+        } else if (strcmp(argv[i], "--dump-bytecode") == 0) {
+            dump_bytecode = true;
+        } else if (strncmp(argv[i], "--target=", 9) == 0) {
+            const char *target = argv[i] + 9;
+            if (strcmp(target, "x86_64-linux") == 0) {
+                target_x86_64 = true;
+            } else if (strcmp(target, "riscv32") == 0) {
+                target_x86_64 = false;
+            } else {
+                fprintf(stderr, "Unknown --target: %s (expected riscv32 or "
+                                "x86_64-linux)\n", target);
+                exit(-1);
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            exit(-1);
+        }
+    }
+    if ((!codegen_options.profile_generate.empty() ||
+         !codegen_options.profile_use.empty()) &&
+        codegen_options.regalloc != RegAllocKind::kLinearScan) {
+        fprintf(stderr, "--profile-generate and --profile-use need the IR "
+                        "(--regalloc=linear-scan)\n");
+        exit(-1);
+    }
+    if (target_x86_64 && codegen_options.emit_object) {
+        fprintf(stderr, "--emit=obj is RISC-V only; assemble the .s of "
+                        "--target=x86_64-linux instead\n");
         exit(-1);
     }
 
@@ -765,7 +918,7 @@ int main(int argc, const char *argv[]) {
 
     yyparse();
 
-    if (argc >= 3 && strcmp(argv[2], "--dump-ast") == 0) {
+    if (dump_ast) {
         AstDumper ast_dumper;
         root->accept(ast_dumper);
     }
@@ -773,16 +926,77 @@ int main(int argc, const char *argv[]) {
     SemanticAnalyzer sema_analyzer(opt_dmp);
     root->accept(sema_analyzer);
 
-    CodeGenerator code_generator(argv[1], (argc == 4) ? argv[3] : "",
-                                 sema_analyzer.getSymbolManager());
-    root->accept(code_generator);
-
-    if (!sema_analyzer.hasError()) {
-        printf("\n"
-               "|---------------------------------------------------|\n"
-               "|  There is no syntactic error and semantic error!  |\n"
-               "|---------------------------------------------------|\n");
+    // the folder relies on the types inferred by a successful analysis
+    if (fold_constants && !sema_analyzer.hasError()) {
+        ConstantFolder constant_folder;
+        root->accept(constant_folder);
+        if (codegen_options.print_stats) {
+            fprintf(stderr, "constant folding: %zu expressions folded\n",
+                    constant_folder.getNumFolded());
+        }
+    }
+
+    // the bytecode is run, dumped or compiled for x86-64 in place of going
+    // through the IR to RISC-V
+    if (run_program || dump_bytecode || target_x86_64) {
+        if (sema_analyzer.hasError()) {
+            exit(-1);
+        }
+        vm::Program program;
+        vm::BytecodeGenerator bytecode_generator(
+            sema_analyzer.getSymbolManager(), program);
+        root->accept(bytecode_generator);
+        if (dump_bytecode) {
+            vm::printProgram(stdout, program);
+        }
+        if (codegen_options.print_stats) {
+            fprintf(stderr, "bytecode: %zu instructions, %zu constants, "
+                            "%zu functions\n",
+                    program.code.size(), program.constants.size(),
+                    program.functions.size());
+        }
+        if (target_x86_64) {
+            x86::X86CodeGenerator x86_generator(
+                program, argv[1], save_path,
+                codegen_options.eliminate_tail_calls);
+            if (!x86_generator.generate()) {
+                fprintf(stderr, "Failed to write the x86-64 assembly\n");
+                exit(-1);
+            }
+            if (codegen_options.print_stats) {
+                fprintf(stderr, "x86-64: %zu instructions, %zu registers "
+                                "spilled\n",
+                        x86_generator.getNumInstrs(),
+                        x86_generator.getNumSpilled());
+            }
+        }
+        int status = 0;
+        if (run_program) {
+            fflush(stdout);
+            vm::HostIO io(stdin, stdout);
+            status = vm::Interpreter(program, io).run();
+        }
+        delete root;
+        fclose(yyin);
+        yylex_destroy();
+        return status;
+    }
+
+    // the IR is built from a checked tree only
+    if (sema_analyzer.hasError()) {
+        exit(-1);
     }
+    {
+        CodeGenerator code_generator(argv[1], save_path,
+                                     sema_analyzer.getSymbolManager(),
+                                     codegen_options);
+        root->accept(code_generator);
+    }
+
+    printf("\n"
+           "|---------------------------------------------------|\n"
+           "|  There is no syntactic error and semantic error!  |\n"
+           "|---------------------------------------------------|\n");
 
     delete root;
     fclose(yyin);
@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * What a program compiled with --profile-generate calls at exit, from
+ * .fini_array; link it in next to io.c. Adds the counters to the profile
+ * at path, or starts a new one if there is none yet or the one there
+ * belongs to a different build of the program.
+ */
+void __p_profile_write(const char *path, unsigned checksum,
+                       const unsigned *counters, unsigned num)
+{
+    unsigned long long *totals = calloc(num, sizeof(*totals));
+    if (totals == NULL) {
+        return;
+    }
+
+    FILE *file = fopen(path, "r");
+    if (file != NULL) {
+        unsigned old_checksum, old_num, i;
+        if (fscanf(file, "p-profile %u %u", &old_checksum, &old_num) == 2 &&
+            old_checksum == checksum && old_num == num) {
+            for (i = 0; i < num; ++i) {
+                if (fscanf(file, "%llu", &totals[i]) != 1) {
+                    totals[i] = 0;
+                }
+            }
+        }
+        fclose(file);
+    }
+
+    file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        free(totals);
+        return;
+    }
+    fprintf(file, "p-profile %u %u\n", checksum, num);
+    for (unsigned i = 0; i < num; ++i) {
+        fprintf(file, "%llu\n", totals[i] + counters[i]);
+    }
+    fclose(file);
+    free(totals);
+}
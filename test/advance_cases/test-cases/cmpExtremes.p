@@ -0,0 +1,144 @@
+//&S-
+//&T-
+//&D-
+
+cmpExtremes;
+
+begin
+
+var n, max, min, m1, p1, i, count: integer;
+var b: boolean;
+read n;
+// 2147483647, -2147483648, -1 and 1, computed at run time
+max := n - 123 + 2147483647;
+min := -max - 1;
+m1 := 122 - n;
+p1 := n - 122;
+
+// conditions
+if max > m1 then
+begin
+    print 1;
+end
+else
+begin
+    print 0;
+end
+end if
+if min < p1 then
+begin
+    print 1;
+end
+else
+begin
+    print 0;
+end
+end if
+if min >= max then
+begin
+    print 0;
+end
+else
+begin
+    print 1;
+end
+end if
+if max <= min then
+begin
+    print 0;
+end
+else
+begin
+    print 1;
+end
+end if
+if min <> max then
+begin
+    print 1;
+end
+end if
+if m1 > min then
+begin
+    print 1;
+end
+end if
+if p1 < max then
+begin
+    print 1;
+end
+end if
+
+count := 0;
+i := max - 3;
+while i < max do
+begin
+    i := i + 1;
+    count := count + 1;
+end
+end do
+print count;
+
+count := 0;
+i := min + 3;
+while min < i do
+begin
+    i := i - 1;
+    count := count + 1;
+end
+end do
+print count;
+
+count := 0;
+while max > m1 and count < 5 do
+begin
+    count := count + 1;
+end
+end do
+print count;
+
+// values
+b := max > m1;
+if b then
+begin
+    print 1;
+end
+end if
+b := min < p1;
+if b then
+begin
+    print 2;
+end
+end if
+b := min > max;
+if b then
+begin
+    print 0;
+end
+end if
+b := max < min;
+if b then
+begin
+    print 0;
+end
+end if
+b := min <= m1;
+if b then
+begin
+    print 3;
+end
+end if
+b := max >= p1;
+if b then
+begin
+    print 4;
+end
+end if
+b := min = max + 1;
+if b then
+begin
+    print 5;
+end
+end if
+
+end
+end
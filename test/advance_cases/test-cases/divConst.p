@@ -0,0 +1,38 @@
+//&S-
+//&T-
+//&D-
+
+divConst;
+
+show(x: integer)
+begin
+    print x / 2;
+    print x mod 2;
+    print x / 8;
+    print x mod 8;
+    print x / 7;
+    print x mod 7;
+    print x / -3;
+    print x mod -3;
+    print x / -8;
+    print x mod -8;
+end
+end
+
+begin
+
+var n, min: integer;
+read n;
+min := 123 - n - 2147483647 - 1;
+show(n - 23);
+show(23 - n);
+show(n - 130);
+show(122 - n);
+show(n - 123);
+show(-min - 1);
+show(min);
+print min / -1;
+print min mod -1;
+
+end
+end
@@ -0,0 +1,195 @@
+//&S-
+//&T-
+//&D-
+
+longJumps;
+
+// with --rvc, c.j reaches +-2 KiB and c.beqz/c.bnez +-256 bytes; the
+// loop and the ifs in it are longer than that
+
+begin
+
+var n, i, a, b, c, d: integer;
+var odd: boolean;
+read n;
+a := n;
+b := n - 100;
+c := 7;
+d := 0;
+odd := n mod 2 = 1;
+i := 0;
+while i < n mod 10 do
+begin
+    b := c - a mod 7;
+    a := d * 3 + d;
+    b := (c + 9) mod 1000 - d;
+    b := b + c / 7 - 8;
+    d := a * 8 + d;
+    b := b * 5 + a;
+    a := b + c / 6 - 7;
+    c := b + a / 2 - 3;
+    b := b * 2 + b;
+    c := (c + 7) mod 1000 - b;
+    b := c - d mod 4;
+    d := a + b / 8 - 9;
+    b := (a + 5) mod 1000 - a;
+    b := b + a / 3 - 4;
+    a := c * 9 + d;
+    b := a * 7 + d;
+    a := a + a / 7 - 8;
+    a := c - a mod 2;
+    b := a - b mod 2;
+    c := b * 6 + d;
+    d := a - b mod 5;
+    b := (a + 4) mod 1000 - c;
+    b := a * 9 + d;
+    b := b * 8 + c;
+    c := b - c mod 6;
+    a := (a + 2) mod 1000 - c;
+    c := c * 9 + d;
+    a := d * 2 + b;
+    c := a + b / 6 - 7;
+    a := a - a mod 5;
+    d := (a + 6) mod 1000 - c;
+    a := (b + 8) mod 1000 - d;
+    c := (a + 3) mod 1000 - d;
+    c := (b + 6) mod 1000 - b;
+    c := d + b / 2 - 3;
+    b := a * 2 + c;
+    d := b * 6 + b;
+    b := c * 4 + c;
+    b := (d + 5) mod 1000 - d;
+    d := (c + 3) mod 1000 - c;
+    if a mod 2 = 0 then
+    begin
+        c := c - b mod 9;
+        d := b - c mod 7;
+        a := c + a / 5 - 6;
+        d := b - c mod 9;
+        b := b * 2 + c;
+        b := c + c / 5 - 6;
+        a := b * 6 + c;
+        b := c * 9 + a;
+        a := d * 8 + d;
+        b := (c + 4) mod 1000 - d;
+        d := d - b mod 4;
+        b := (c + 5) mod 1000 - a;
+        d := d * 6 + a;
+        b := b + c / 5 - 6;
+        d := d - a mod 7;
+        b := c * 4 + c;
+        c := d - b mod 6;
+        a := b + a / 3 - 4;
+        d := (a + 9) mod 1000 - b;
+        d := a * 4 + b;
+        d := c + b / 5 - 6;
+        b := (a + 9) mod 1000 - a;
+        c := (b + 2) mod 1000 - b;
+        a := a + c / 2 - 3;
+        c := c * 8 + c;
+        c := a - a mod 4;
+        b := a * 8 + d;
+        a := b * 9 + d;
+        c := d * 7 + c;
+        d := b * 3 + b;
+    end
+    else
+    begin
+        d := d + 1;
+    end
+    end if
+    c := b - b mod 4;
+    c := a - a mod 2;
+    d := d - c mod 7;
+    c := (a + 3) mod 1000 - a;
+    b := b - b mod 7;
+    b := c + a / 4 - 5;
+    d := b - a mod 3;
+    a := b + c / 6 - 7;
+    a := c * 9 + a;
+    c := c + d / 9 - 10;
+    a := a * 3 + a;
+    c := d + c / 9 - 10;
+    a := (d + 2) mod 1000 - a;
+    a := c * 3 + a;
+    c := a * 8 + d;
+    c := a * 3 + a;
+    b := d + b / 7 - 8;
+    a := a + a / 5 - 6;
+    d := d * 2 + d;
+    d := a - b mod 4;
+    b := b * 6 + b;
+    b := (c + 7) mod 1000 - d;
+    d := a + c / 3 - 4;
+    b := c * 4 + b;
+    b := c * 2 + b;
+    a := (b + 9) mod 1000 - a;
+    c := b - a mod 8;
+    c := c + c / 5 - 6;
+    d := d - a mod 5;
+    b := d - d mod 7;
+    d := d - a mod 2;
+    d := b + a / 9 - 10;
+    a := a - d mod 2;
+    a := a - b mod 3;
+    d := a + c / 5 - 6;
+    c := (c + 5) mod 1000 - b;
+    a := (c + 5) mod 1000 - a;
+    c := d * 7 + c;
+    a := d + d / 4 - 5;
+    b := a - b mod 2;
+    if odd then
+    begin
+        b := a * 5 + a;
+        c := b - a mod 9;
+        b := d + a / 9 - 10;
+        b := a * 8 + c;
+        d := d * 8 + d;
+        b := b * 3 + c;
+        b := a - a mod 7;
+        d := c - a mod 5;
+        c := c * 6 + d;
+        c := a - b mod 9;
+        c := a * 8 + b;
+        b := (a + 8) mod 1000 - d;
+        d := b - b mod 3;
+        d := d - a mod 9;
+        a := d * 3 + c;
+        c := b * 2 + b;
+        b := b - a mod 3;
+        c := d - d mod 6;
+        d := b - b mod 2;
+        a := c + d / 9 - 10;
+        a := c * 8 + c;
+        a := (d + 3) mod 1000 - b;
+        b := b - c mod 8;
+        b := c + a / 4 - 5;
+        c := (c + 5) mod 1000 - a;
+        d := (a + 2) mod 1000 - a;
+        c := (b + 3) mod 1000 - d;
+        c := (b + 3) mod 1000 - d;
+        a := (a + 8) mod 1000 - b;
+        b := c + b / 6 - 7;
+        c := b + d / 7 - 8;
+        c := b * 7 + b;
+        a := c + d / 4 - 5;
+        d := b - c mod 6;
+        c := c - d mod 3;
+        c := (a + 5) mod 1000 - c;
+        a := (c + 4) mod 1000 - d;
+        a := a + a / 6 - 7;
+        b := a * 7 + b;
+        c := (a + 8) mod 1000 - c;
+    end
+    end if
+    i := i + 1;
+    print i;
+end
+end do
+print a;
+print b;
+print c;
+print d;
+
+end
+end
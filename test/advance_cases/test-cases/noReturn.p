@@ -0,0 +1,84 @@
+//&S-
+//&T-
+//&D-
+
+noReturn;
+
+var total: integer;
+
+// a procedure that ends without return
+add(k: integer)
+begin
+    total := total + k;
+    if k > 100 then
+    begin
+        total := total - 100;
+    end
+    end if
+end
+end
+
+// every path returns, but the body itself falls off after if/else
+sign(x: integer): integer
+begin
+    if x < 0 then
+    begin
+        return -1;
+    end
+    else
+    begin
+        if x = 0 then
+        begin
+            return 0;
+        end
+        else
+        begin
+            return 1;
+        end
+        end if
+    end
+    end if
+end
+end
+
+// returns from inside the loop; the end after it is never reached
+firstMultiple(x, m: integer): integer
+begin
+    while true do
+    begin
+        if x mod m = 0 then
+        begin
+            return x;
+        end
+        end if
+        x := x + 1;
+    end
+    end do
+end
+end
+
+begin
+
+var n, a, b, c: integer;
+read n;
+
+a := n;
+b := n * 2;
+c := n - 1;
+total := 0;
+for i := 1 to 4 do
+begin
+    add(i * n);
+end
+end do
+print total;
+print a + b + c;
+
+print sign(n);
+print sign(-n);
+print sign(n - 123);
+print firstMultiple(n, 10);
+print firstMultiple(-n, 7);
+
+end
+end
@@ -0,0 +1,56 @@
+//&S-
+//&T-
+//&D-
+
+paramAfterCall;
+
+var g: integer;
+
+twice(x: integer): integer
+begin
+    print x;
+    return x + x;
+end
+end
+
+inc(x: integer): integer
+begin
+    return x + 1;
+end
+end
+
+// the call comes first, the parameters are needed after it
+sum3(a, b, c: integer): integer
+begin
+    g := inc(g);
+    return a * 100 + b * 10 + c + g;
+end
+end
+
+bump()
+begin
+    g := g + 1000;
+end
+end
+
+// and a call to a procedure
+show(a, b: integer)
+begin
+    bump();
+    print a - b + g;
+end
+end
+
+begin
+
+var n: integer;
+read n;
+print twice(21);
+print twice(n);
+g := 0;
+print sum3(1, 2, 3);
+print sum3(n, 4, 5);
+show(n, 3);
+
+end
+end
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Times the workloads here built for x86_64-linux and run natively against
+the RISC-V build run on spike, checking that both print the same."""
+
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import time
+from argparse import ArgumentParser
+
+BENCHMARK_DIR = os.path.dirname(os.path.abspath(__file__))
+TEST_DIR = os.path.dirname(BENCHMARK_DIR)
+
+
+def run(cmd, stdin=b"123\n"):
+    """Returns the output and the seconds taken, None if cmd failed."""
+    start = time.perf_counter()
+    proc = subprocess.run(cmd, input=stdin, stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT)
+    elapsed = time.perf_counter() - start
+    if proc.returncode != 0:
+        return None, elapsed
+    return proc.stdout.decode("utf-8", "replace"), elapsed
+
+
+def build(args, workload, native):
+    source = os.path.join(BENCHMARK_DIR, workload + ".p")
+    clist = [args.compiler, source, "--save-path", args.build_dir]
+    if native:
+        clist.append("--target=x86_64-linux")
+    if subprocess.run(clist, stdout=subprocess.DEVNULL).returncode != 0:
+        return None
+    suffix = "native" if native else "riscv"
+    assembly = os.path.join(args.build_dir,
+                            workload + (".s" if native else ".S"))
+    executable = os.path.join(args.build_dir, "%s.%s" % (workload, suffix))
+    gcc = args.gcc if native else args.riscv_gcc
+    io_file = os.path.join(TEST_DIR,
+                           "io_x86_64.c" if native else "io.c")
+    clist = [gcc, "-O2", assembly, io_file, "-o", executable]
+    if subprocess.run(clist).returncode != 0:
+        return None
+    return executable
+
+
+def measure(cmd, runs):
+    """The output and the median time of runs, None if any failed."""
+    output = None
+    times = []
+    for _ in range(runs):
+        output, elapsed = run(cmd)
+        if output is None:
+            return None, None
+        times.append(elapsed)
+    return output, statistics.median(times)
+
+
+def main():
+    parser = ArgumentParser()
+    parser.add_argument("--compiler", help="The compiler to benchmark.",
+                        default=os.path.join(TEST_DIR, "..", "src", "compiler"))
+    parser.add_argument("--build-dir", help="Where the builds go.",
+                        default=os.path.join(TEST_DIR, "benchmark_build"))
+    parser.add_argument("--gcc", help="The host compiler driver.",
+                        default="gcc")
+    parser.add_argument("--riscv-gcc", help="The RISC-V compiler driver.",
+                        default="riscv32-unknown-elf-gcc")
+    parser.add_argument("--spike", help="The RISC-V simulator.",
+                        default="spike")
+    parser.add_argument("--pk", help="The proxy kernel spike runs.",
+                        default="/risc-v/riscv32-unknown-elf/bin/pk")
+    parser.add_argument("--runs", help="Runs of each, the median is taken.",
+                        type=int, default=3)
+    parser.add_argument("workloads", nargs="*",
+                        help="The .p files here to run, all by default.")
+    args = parser.parse_args()
+    os.makedirs(args.build_dir, exist_ok=True)
+
+    workloads = args.workloads or sorted(
+        name[:-2] for name in os.listdir(BENCHMARK_DIR) if name.endswith(".p"))
+    has_spike = (shutil.which(args.spike) is not None and
+                 shutil.which(args.riscv_gcc) is not None and
+                 os.path.exists(args.pk))
+    if not has_spike:
+        print("%s, %s or %s not found: timing the native runs only" %
+              (args.spike, args.riscv_gcc, args.pk), file=sys.stderr)
+
+    print("%-12s %12s %12s %10s" % ("workload", "native (s)", "spike (s)",
+                                    "speedup"))
+    failed = False
+    for workload in workloads:
+        executable = build(args, workload, native=True)
+        native_output, native_time = (measure([executable], args.runs)
+                                      if executable else (None, None))
+        if native_output is None:
+            print("%-12s %12s" % (workload, "failed"))
+            failed = True
+            continue
+
+        spike_time = None
+        if has_spike:
+            executable = build(args, workload, native=False)
+            spike_output, spike_time = (
+                measure([args.spike, "--isa=RV32", args.pk, executable],
+                        args.runs) if executable else (None, None))
+            # the proxy kernel prints a banner of its own
+            if spike_output is not None:
+                spike_output = "".join(
+                    line for line in spike_output.splitlines(True)
+                    if line.strip() != "bbl loader")
+            if spike_output != native_output:
+                print("%-12s %12.3f %12s" % (workload, native_time,
+                                             "mismatch"))
+                failed = True
+                continue
+
+        if spike_time is None:
+            print("%-12s %12.3f %12s %10s" % (workload, native_time, "-", "-"))
+        else:
+            print("%-12s %12.3f %12.3f %9.1fx" %
+                  (workload, native_time, spike_time,
+                   spike_time / native_time))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,56 @@
+//&S-
+//&T-
+//&D-
+matmul;
+
+// nested loops over arrays passed by address
+var a, b, c: array 64 of array 64 of integer;
+
+multiply(x: array 64 of array 64 of integer; y: array 64 of array 64 of integer; z: array 64 of array 64 of integer)
+begin
+    var s: integer;
+    for i := 0 to 64 do
+    begin
+        for j := 0 to 64 do
+        begin
+            s := 0;
+            for k := 0 to 64 do
+            begin
+                s := s + x[i][k] * y[k][j];
+            end
+            end do
+            z[i][j] := s;
+        end
+        end do
+    end
+    end do
+end
+end
+
+begin
+    var trace: integer;
+    for i := 0 to 64 do
+    begin
+        for j := 0 to 64 do
+        begin
+            a[i][j] := (i * 7 + j * 3) mod 17 - 8;
+            b[i][j] := (i * 5 - j * 11) mod 13;
+        end
+        end do
+    end
+    end do
+    for round := 0 to 40 do
+    begin
+        multiply(a, b, c);
+        multiply(c, b, a);
+    end
+    end do
+    trace := 0;
+    for i := 0 to 64 do
+    begin
+        trace := trace + a[i][i];
+    end
+    end do
+    print trace;
+end
+end
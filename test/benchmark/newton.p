@@ -0,0 +1,44 @@
+//&S-
+//&T-
+//&D-
+newton;
+
+// division and comparisons: integer square roots by Newton's method
+root(x: integer): integer
+begin
+    var guess, next: integer;
+    if x < 2 then
+    begin
+        return x;
+    end
+    end if
+    guess := x;
+    next := (guess + x / guess) / 2;
+    while next < guess do
+    begin
+        guess := next;
+        next := (guess + x / guess) / 2;
+    end
+    end do
+    return guess;
+end
+end
+
+begin
+    var sum, exact: integer;
+    sum := 0;
+    exact := 0;
+    for i := 1 to 200000 do
+    begin
+        sum := sum + root(i) mod 1000;
+        if root(i) * root(i) = i then
+        begin
+            exact := exact + 1;
+        end
+        end if
+    end
+    end do
+    print sum;
+    print exact;
+end
+end
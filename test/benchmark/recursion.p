@@ -0,0 +1,21 @@
+//&S-
+//&T-
+//&D-
+recursion;
+
+// calls and returns
+fib(n: integer): integer
+begin
+    if n < 2 then
+    begin
+        return n;
+    end
+    end if
+    return fib(n - 1) + fib(n - 2);
+end
+end
+
+begin
+    print fib(32);
+end
+end
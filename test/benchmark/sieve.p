@@ -0,0 +1,39 @@
+//&S-
+//&T-
+//&D-
+sieve;
+
+// loads and stores through a global array
+var composite: array 200000 of boolean;
+
+begin
+    var count, j: integer;
+    for round := 0 to 40 do
+    begin
+        count := 0;
+        for i := 0 to 200000 do
+        begin
+            composite[i] := false;
+        end
+        end do
+        for i := 2 to 200000 do
+        begin
+            if not composite[i] then
+            begin
+                count := count + 1;
+                j := i + i;
+                while j < 200000 do
+                begin
+                    composite[j] := true;
+                    j := j + i;
+                end
+                end do
+            end
+            end if
+        end
+        end do
+    end
+    end do
+    print count;
+end
+end
@@ -0,0 +1,99 @@
+//&S-
+//&T-
+//&D-
+
+boolConst;
+
+var flag: boolean;
+
+choose(b: boolean; x, y: integer): integer
+begin
+    if b then
+    begin
+        return x;
+    end
+    end if
+    return y;
+end
+end
+
+always(): boolean
+begin
+    return true;
+end
+end
+
+begin
+
+var n: integer;
+var b: boolean;
+read n;
+
+b := true;
+if b then
+begin
+    print 1;
+end
+end if
+b := false;
+if b then
+begin
+    print 0;
+end
+else
+begin
+    print 2;
+end
+end if
+
+if true then
+begin
+    print 3;
+end
+end if
+if false then
+begin
+    print 0;
+end
+end if
+while false do
+begin
+    print 0;
+end
+end do
+
+b := n > 0;
+if true and b then
+begin
+    print 4;
+end
+end if
+if false or b then
+begin
+    print 5;
+end
+end if
+if false and b then
+begin
+    print 0;
+end
+end if
+if not true or not b then
+begin
+    print 0;
+end
+end if
+
+print choose(true, 6, 0);
+print choose(false, 0, 7);
+flag := false;
+if always() and not flag then
+begin
+    print 8;
+end
+end if
+flag := true;
+print choose(flag, 9, 0);
+
+end
+end
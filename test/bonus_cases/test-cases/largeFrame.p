@@ -0,0 +1,57 @@
+//&S-
+//&T-
+//&D-
+
+largeFrame;
+
+weight(x: integer): integer
+begin
+    return x mod 7;
+end
+end
+
+// 3000 integers take the frame far beyond the 12-bit offsets of s0
+fill(n: integer): integer
+begin
+    var buf: array 3000 of integer;
+    var k, total: integer;
+    for i := 0 to 3000 do
+    begin
+        buf[i] := i + n;
+    end
+    end do
+    total := 0;
+    k := 0;
+    while k < 3000 do
+    begin
+        total := total + buf[k] - buf[2999 - k] + weight(k);
+        k := k + 1;
+    end
+    end do
+    buf[2999] := total;
+    return buf[2999] + buf[0];
+end
+end
+
+begin
+
+var a: array 600 of integer;
+var n, sum: integer;
+read n;
+for i := 0 to 600 do
+begin
+    a[i] := i * n;
+end
+end do
+sum := 0;
+for i := 0 to 600 do
+begin
+    sum := sum + a[i];
+end
+end do
+print sum;
+print a[599];
+print fill(n);
+
+end
+end
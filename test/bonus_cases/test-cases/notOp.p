@@ -0,0 +1,76 @@
+//&S-
+//&T-
+//&D-
+
+notOp;
+
+positive(x: integer): boolean
+begin
+    return x > 0;
+end
+end
+
+begin
+
+var n: integer;
+var b, c: boolean;
+read n;
+
+b := n > 100;
+c := not b;
+if c then
+begin
+    print 0;
+end
+else
+begin
+    print 1;
+end
+end if
+if not c then
+begin
+    print 2;
+end
+end if
+if not not b then
+begin
+    print 3;
+end
+end if
+if not (n < 100) then
+begin
+    print 4;
+end
+end if
+if not positive(n - 123) then
+begin
+    print 5;
+end
+end if
+c := not positive(n);
+if not c then
+begin
+    print 6;
+end
+end if
+b := not (n = 123);
+if b then
+begin
+    print 0;
+end
+else
+begin
+    print 7;
+end
+end if
+
+n := 3;
+while not (n = 0) do
+begin
+    print n;
+    n := n - 1;
+end
+end do
+
+end
+end
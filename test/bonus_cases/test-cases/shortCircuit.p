@@ -0,0 +1,120 @@
+//&S-
+//&T-
+//&D-
+
+shortCircuit;
+
+var trace: integer;
+
+// records v in trace and returns r
+tick(v: integer; r: boolean): boolean
+begin
+    trace := trace * 10 + v;
+    return r;
+end
+end
+
+begin
+
+var n, i: integer;
+var b, c: boolean;
+read n;
+
+// conditions
+trace := 0;
+if tick(1, n > 0) and tick(2, n < 0) and tick(3, true) then
+begin
+    print 1;
+end
+else
+begin
+    print 0;
+end
+end if
+print trace;
+
+trace := 0;
+if tick(1, n < 0) or tick(2, n = 123) or tick(3, false) then
+begin
+    print 1;
+end
+else
+begin
+    print 0;
+end
+end if
+print trace;
+
+trace := 0;
+if not (tick(1, false) or tick(2, n > 100)) then
+begin
+    print 1;
+end
+else
+begin
+    print 0;
+end
+end if
+print trace;
+
+trace := 0;
+if not tick(1, n = 0) and (tick(2, false) or not tick(3, false)) then
+begin
+    print 1;
+end
+else
+begin
+    print 0;
+end
+end if
+print trace;
+
+i := 0;
+trace := 0;
+while i < 3 and tick(i + 1, n > i) do
+begin
+    i := i + 1;
+end
+end do
+print i;
+print trace;
+
+trace := 0;
+while not (tick(4, i = 0) or tick(5, false)) do
+begin
+    i := i - 1;
+end
+end do
+print i;
+print trace;
+
+// values
+trace := 0;
+b := tick(1, n > 0) or tick(2, true);
+c := tick(3, false) and tick(4, true);
+print trace;
+b := not (b and c) and tick(5, not c);
+print trace;
+if b then
+begin
+    print 1;
+end
+end if
+if c then
+begin
+    print 2;
+end
+end if
+
+trace := 0;
+c := not tick(6, b) or tick(7, n = 123);
+b := tick(8, false) or (tick(9, c) and not c);
+print trace;
+if c and not b then
+begin
+    print 3;
+end
+end if
+
+end
+end
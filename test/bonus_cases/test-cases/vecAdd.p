@@ -0,0 +1,68 @@
+//&S-
+//&T-
+//&D-
+
+vecAdd;
+
+var ga: array 37 of integer;
+
+begin
+
+var n: integer;
+var a, b, c: array 37 of integer;
+var m: array 3 of array 37 of integer;
+read n;
+for i := 0 to 37 do
+begin
+    a[i] := i * 3 - n;
+    b[i] := n - i * 7;
+end
+end do
+
+// element by element, in strips of vl with a shorter one at the end
+for i := 0 to 37 do
+begin
+    c[i] := a[i] + b[i];
+end
+end do
+print c[0];
+print c[31];
+print c[36];
+
+for i := 1 to 36 do
+begin
+    ga[i] := c[i] * 5 - a[i] + n;
+end
+end do
+print ga[0];
+print ga[1];
+print ga[35];
+print ga[36];
+
+for i := 0 to 37 do
+begin
+    c[i] := 7 - c[i] * n;
+    b[i] := a[i] * b[i] - 1;
+end
+end do
+print c[0];
+print c[36];
+print b[5];
+print b[33];
+
+for i := 0 to 3 do
+begin
+    for j := 2 to 35 do
+    begin
+        m[i][j] := a[j] - b[j + 1] + i;
+    end
+    end do
+end
+end do
+print m[0][2];
+print m[1][20];
+print m[2][34];
+print m[2][35];
+
+end
+end
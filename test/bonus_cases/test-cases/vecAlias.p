@@ -0,0 +1,62 @@
+//&S-
+//&T-
+//&D-
+
+vecAlias;
+
+var g: array 20 of integer;
+
+// p may be g itself, so an element can depend on the one stored in the
+// iteration before
+shift(p: array 20 of integer; k: integer)
+begin
+    for i := 1 to 20 do
+    begin
+        p[i] := g[i - 1] + k;
+    end
+    end do
+end
+end
+
+// and so may q
+copy(p, q: array 20 of integer)
+begin
+    for i := 1 to 20 do
+    begin
+        p[i] := q[i - 1] * 2;
+    end
+    end do
+end
+end
+
+begin
+
+var n: integer;
+var a: array 20 of integer;
+read n;
+for i := 0 to 20 do
+begin
+    g[i] := i;
+    a[i] := n;
+end
+end do
+
+shift(a, 1);
+print a[0];
+print a[1];
+print a[19];
+
+shift(g, n);
+print g[0];
+print g[1];
+print g[10];
+print g[19];
+
+copy(a, a);
+print a[0];
+print a[1];
+print a[2];
+print a[19];
+
+end
+end
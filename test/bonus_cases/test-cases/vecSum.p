@@ -0,0 +1,83 @@
+//&S-
+//&T-
+//&D-
+
+vecSum;
+
+var g: array 45 of integer;
+
+dot(k: integer): integer
+begin
+    var s: integer;
+    var a: array 45 of integer;
+    for i := 0 to 45 do
+    begin
+        a[i] := k - i;
+    end
+    end do
+    s := 0;
+    for i := 0 to 45 do
+    begin
+        s := s + a[i] * g[i];
+    end
+    end do
+    return s;
+end
+end
+
+begin
+
+var n, s, t: integer;
+var m: array 4 of array 9 of integer;
+read n;
+for i := 0 to 45 do
+begin
+    g[i] := i * i - n;
+end
+end do
+
+// sums over vl elements at a time, the tail included
+s := 0;
+for i := 0 to 45 do
+begin
+    s := s + g[i];
+end
+end do
+print s;
+
+s := 100;
+t := 0;
+for i := 3 to 40 do
+begin
+    s := s + g[i] * 2;
+    t := t + (g[i + 1] - n);
+end
+end do
+print s;
+print t;
+
+print dot(n);
+
+for i := 0 to 4 do
+begin
+    for j := 0 to 9 do
+    begin
+        m[i][j] := i * 9 + j;
+    end
+    end do
+end
+end do
+s := 0;
+for i := 0 to 4 do
+begin
+    for j := 0 to 9 do
+    begin
+        s := s + m[i][j];
+    end
+    end do
+end
+end do
+print s;
+
+end
+end
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* io.c for --target=x86_64-linux; strings are read and concatenated here
+ * rather than inline */
+
+void printInt(int value)
+{
+    printf("%d\n", value);
+}
+
+int readInt()
+{
+    int value;
+    scanf("%d", &value);
+    return value;
+}
+
+void printReal(float value)
+{
+    printf("%f\n", value);
+}
+
+float readReal(){
+    float value;
+    scanf("%f", &value);
+    return value;
+}
+
+void printString(char *value)
+{
+    printf("%s\n", value);
+}
+
+char *readString()
+{
+    char buffer[1024];
+    if (scanf("%1023s", buffer) != 1) {
+        buffer[0] = '\0';
+    }
+    return strdup(buffer);
+}
+
+char *concatString(const char *lhs, const char *rhs)
+{
+    if (!lhs) {
+        lhs = "";
+    }
+    if (!rhs) {
+        rhs = "";
+    }
+    size_t lhs_length = strlen(lhs);
+    size_t rhs_length = strlen(rhs);
+    char *result = malloc(lhs_length + rhs_length + 1);
+    memcpy(result, lhs, lhs_length);
+    memcpy(result + lhs_length, rhs, rhs_length + 1);
+    return result;
+}
@@ -29,9 +29,14 @@ class Grader:
         4 : "advLoop1",
         5 : "advLoop2",
         6 : "argument",
-        7 : "negative"
+        7 : "negative",
+        8 : "noReturn",
+        9 : "cmpExtremes",
+        10 : "divConst",
+        11 : "paramAfterCall",
+        12 : "longJumps"
     }
-    advance_case_scores = [0, 5, 5, 5, 5, 5, 5, 5]
+    advance_case_scores = [0, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5]
     advance_id_list = advance_cases.keys()
 
     bonus_case_dir = "./bonus_cases"
@@ -42,17 +47,39 @@ class Grader:
         4 : "arraytest2",
         5 : "stringtest",
         6 : "realtest1",
-        7 : "realtest2"
+        7 : "realtest2",
+        8 : "notOp",
+        9 : "boolConst",
+        10 : "shortCircuit",
+        11 : "largeFrame",
+        12 : "vecAdd",
+        13 : "vecSum",
+        14 : "vecAlias"
     }
-    bonus_case_scores = [0, 2, 2, 3, 3, 3, 3, 3]
+    bonus_case_scores = [0, 2, 2, 3, 3, 3, 3, 3, 2, 2, 3, 3, 3, 3, 3]
     bonus_id_list = bonus_cases.keys()
 
     diff_result = ""
 
     def __init__(self, compiler, save_path, 
-                executable_file_path, code_result_path, io_file):
+                executable_file_path, code_result_path, io_file,
+                target = "riscv32", flags = (), isa = "RV32", vm = False,
+                emit = "asm", profile_runtime = None):
         self.compiler = compiler
         self.io_file = io_file
+        # passed on to the compiler for every case
+        self.flags = list(flags)
+        # x86_64-linux runs natively instead of on spike
+        self.native = target == "x86_64-linux"
+        # the ISA spike simulates, matching any -march in flags
+        self.isa = isa
+        # interpret the cases with the compiler's bytecode VM, nothing is built
+        self.vm = vm
+        # link the object file the compiler encodes itself instead of its assembly
+        self.emit = emit
+        # with the profile runtime, every case is built with --profile-generate,
+        # run, and built again with --profile-use of the profile it wrote
+        self.profile_runtime = profile_runtime
 
         self.save_path = save_path
         if not os.path.exists(self.save_path):
@@ -70,7 +97,10 @@ class Grader:
         if not os.path.exists(self.output_dir):
             os.makedirs(self.output_dir)
 
-    def gen_riscv_code(self, case_type, case_id):
+    def gen_riscv_code(self, case_type, case_id, extra_flags = ()):
+        if self.vm:
+            return
+
         if case_type == "basic":
             test_case = "%s/%s/%s.p" % (self.basic_case_dir, "test-cases", self.basic_cases[case_id])
         elif case_type == "advance":
@@ -79,6 +109,10 @@ class Grader:
             test_case = "%s/%s/%s.p" % (self.bonus_case_dir, "test-cases", self.bonus_cases[case_id])
       
         clist = [self.compiler, test_case, "--save-path", self.save_path]
+        if self.native:
+            clist.append("--target=x86_64-linux")
+        clist += self.flags
+        clist += extra_flags
         cmd = " ".join(clist)
         try:
             proc = subprocess.Popen(cmd, shell=True)
@@ -89,17 +123,27 @@ class Grader:
         proc.wait()
 
     def compile_riscv_code(self, case_type, case_id):
+        if self.vm:
+            return
+
+        if self.emit == "obj":
+            suffix = "o"
+        else:
+            suffix = "s" if self.native else "S"
         if case_type == "basic":
-            test_case = "%s/%s.S" % (self.save_path, self.basic_cases[case_id])
+            test_case = "%s/%s.%s" % (self.save_path, self.basic_cases[case_id], suffix)
             executable_file = "%s/%s" % (self.executable_file_path, self.basic_cases[case_id])
         elif case_type == "advance":
-            test_case = "%s/%s.S" % (self.save_path, self.advance_cases[case_id])
+            test_case = "%s/%s.%s" % (self.save_path, self.advance_cases[case_id], suffix)
             executable_file = "%s/%s" % (self.executable_file_path, self.advance_cases[case_id])
         elif case_type == "bonus":
-            test_case = "%s/%s.S" % (self.save_path, self.bonus_cases[case_id])
+            test_case = "%s/%s.%s" % (self.save_path, self.bonus_cases[case_id], suffix)
             executable_file = "%s/%s" % (self.executable_file_path, self.bonus_cases[case_id])
 
-        clist = ["riscv32-unknown-elf-gcc", test_case, self.io_file, "-o", executable_file]
+        compiler = "gcc" if self.native else "riscv32-unknown-elf-gcc"
+        clist = [compiler, test_case, self.io_file, "-o", executable_file]
+        if self.profile_runtime is not None:
+            clist.insert(3, self.profile_runtime)
         cmd = " ".join(clist)
         try:
             proc = subprocess.Popen(cmd, shell=True)
@@ -113,14 +157,22 @@ class Grader:
         if case_type == "basic":
             output_file = "%s/%s" % (self.code_result_path, self.basic_cases[case_id])
             executable_file = "%s/%s" % (self.executable_file_path, self.basic_cases[case_id])
+            test_case = "%s/%s/%s.p" % (self.basic_case_dir, "test-cases", self.basic_cases[case_id])
         elif case_type == "advance":
             output_file = "%s/%s" % (self.code_result_path, self.advance_cases[case_id])
             executable_file = "%s/%s" % (self.executable_file_path, self.advance_cases[case_id])
+            test_case = "%s/%s/%s.p" % (self.advance_case_dir, "test-cases", self.advance_cases[case_id])
         elif case_type == "bonus":
             output_file = "%s/%s" % (self.code_result_path, self.bonus_cases[case_id])
             executable_file = "%s/%s" % (self.executable_file_path, self.bonus_cases[case_id])
+            test_case = "%s/%s/%s.p" % (self.bonus_case_dir, "test-cases", self.bonus_cases[case_id])
 
-        clist = ["echo", "123", "|", "spike", "--isa=RV32", "/risc-v/riscv32-unknown-elf/bin/pk", executable_file]
+        if self.vm:
+            clist = ["echo", "123", "|", self.compiler, test_case, "--run"] + self.flags
+        elif self.native:
+            clist = ["echo", "123", "|", executable_file]
+        else:
+            clist = ["echo", "123", "|", "spike", "--isa=%s" % self.isa, "/risc-v/riscv32-unknown-elf/bin/pk", executable_file]
         cmd = " ".join(clist)
         try:
             proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, shell=True)
@@ -163,6 +215,13 @@ class Grader:
             output_file = "%s/%s" % (self.code_result_path, self.bonus_cases[case_id])
             solution = "%s/%s/%s" % (self.bonus_case_dir, "sample-solutions", self.bonus_cases[case_id])
 
+        if self.native or self.vm:
+            # there is no proxy kernel to print its banner
+            expected = "%s.expected" % output_file
+            with open(solution) as src, open(expected, "w") as dst:
+                dst.writelines(line for line in src if line.strip() != "bbl loader")
+            solution = expected
+
         clist = ["diff", "-Z", "-u", output_file, solution, f'--label="your output:({output_file})"', f'--label="answer:({solution})"']
         cmd = " ".join(clist)
         try:
@@ -186,8 +245,55 @@ class Grader:
 
         return retcode == 0
     
+    def collect_profile(self, case_type, case_id):
+        if case_type == "basic":
+            case_name = self.basic_cases[case_id]
+        elif case_type == "advance":
+            case_name = self.advance_cases[case_id]
+        elif case_type == "bonus":
+            case_name = self.bonus_cases[case_id]
+        profile = "%s/%s.profile" % (self.save_path, case_name)
+
+        def read_profile():
+            if not os.path.exists(profile):
+                return None
+            with open(profile) as src:
+                return src.read().split()
+
+        if os.path.exists(profile):
+            os.remove(profile)
+        self.gen_riscv_code(case_type, case_id, ["--profile-generate=%s" % profile])
+        self.compile_riscv_code(case_type, case_id)
+        self.run_riscv_code(case_type, case_id)
+        # the instrumented build has to print the same as any other
+        if not self.compare_file_content(case_type, case_id):
+            return None
+
+        fresh = read_profile()
+        if fresh is None or len(fresh) < 3 or fresh[0] != "p-profile":
+            self.diff_result += "{}\nno profile written to {}\n".format(case_name, profile)
+            return None
+
+        # counts of another build of the program are dropped, not added to
+        stale = ["p-profile", str((int(fresh[1]) + 1) % 2**32)] + fresh[2:]
+        with open(profile, "w") as dst:
+            dst.write("\n".join(stale) + "\n")
+        self.run_riscv_code(case_type, case_id)
+        if read_profile() != fresh:
+            self.diff_result += "{}\nprofile {} kept the counts of a different checksum\n".format(case_name, profile)
+            return None
+
+        return profile
+
     def test_sample_case(self, case_type, case_id):
-        self.gen_riscv_code(case_type, case_id)
+        extra_flags = []
+        if self.profile_runtime is not None:
+            profile = self.collect_profile(case_type, case_id)
+            if profile is None:
+                return False
+            extra_flags.append("--profile-use=%s" % profile)
+
+        self.gen_riscv_code(case_type, case_id, extra_flags)
         self.compile_riscv_code(case_type, case_id)
         self.run_riscv_code(case_type, case_id)
 
@@ -247,15 +353,46 @@ def main():
                                         default="./executable")
     parser.add_argument("--code-result-path", help="Path that stores the output content of your generated risc-v instructions.", 
                                         default="./code_executed_result")
-    parser.add_argument("--io-file", help="IO file for io function", 
-                                    default="./io.c")
+    parser.add_argument("--io-file", help="IO file for io function (default: ./io.c, ./io_x86_64.c for x86_64-linux)")
+    parser.add_argument("--target", help="Target to compile and run the cases for.",
+                                    choices=["riscv32", "x86_64-linux"], default="riscv32")
+    parser.add_argument("--regalloc", help="Register allocator to compile the cases with.",
+                                    choices=["linear-scan", "sethi-ullman", "stack"])
+    parser.add_argument("--rvc", help="Compile the cases with compressed instructions.",
+                                    action="store_true")
+    parser.add_argument("--run", help="Interpret the cases with the compiler's bytecode VM instead of building them.",
+                                    action="store_true")
+    parser.add_argument("--emit", help="Output of the compiler to build the cases from.",
+                                    choices=["asm", "obj"], default="asm")
+    parser.add_argument("--profile", help="Build the cases with --profile-generate, linking this profile runtime, then rebuild them with --profile-use.",
+                                    nargs="?", const="../src/runtime/profile.c", metavar="RUNTIME")
+    parser.add_argument("--march", help="ISA to compile the cases for and run them on, e.g. rv32gcv.")
     args = parser.parse_args()
+    if args.profile is not None and (args.run or args.target != "riscv32"):
+        parser.error("--profile needs the riscv32 target")
+    if args.io_file is None:
+        args.io_file = "./io_x86_64.c" if args.target == "x86_64-linux" else "./io.c"
+    flags = []
+    if args.regalloc is not None:
+        flags.append("--regalloc=%s" % args.regalloc)
+    if args.rvc:
+        flags.append("--rvc")
+    if args.emit != "asm":
+        flags.append("--emit=%s" % args.emit)
+    if args.march is not None:
+        flags.append("-march=%s" % args.march)
 
     g = Grader(compiler = args.compiler, 
                 save_path = args.save_path,
                 executable_file_path = args.executable_file_path,
                 code_result_path = args.code_result_path,
-                io_file = args.io_file)
+                io_file = args.io_file,
+                target = args.target,
+                flags = flags,
+                isa = args.march or "RV32",
+                vm = args.run,
+                emit = args.emit,
+                profile_runtime = args.profile)
     g.run()
 
 if __name__ == "__main__":